@@ -267,6 +267,33 @@ h225_init_routine(void)
 
 }
 
+/* Drop the RAS calls of the conversations that are being expired */
+static gboolean
+h225ras_call_expiring(gpointer key, gpointer value, gpointer user_data _U_)
+{
+	h225ras_call_info_key *h225ras_call_key = (h225ras_call_info_key *)key;
+	h225ras_call_t *h225ras_call, *next_call;
+
+	if (!conversation_expiring(h225ras_call_key->conversation))
+		return FALSE;
+	for (h225ras_call = (h225ras_call_t *)value; h225ras_call != NULL; h225ras_call = next_call) {
+		next_call = h225ras_call->next_call;
+		wmem_free(wmem_file_scope(), h225ras_call);
+	}
+	wmem_free(wmem_file_scope(), h225ras_call_key);
+	return TRUE;
+}
+
+static void
+h225_expire_conversations(void)
+{
+	int i;
+
+	for(i=0;i<7;i++) {
+		g_hash_table_foreach_remove(ras_calls[i], h225ras_call_expiring, NULL);
+	}
+}
+
 static int
 dissect_h225_H323UserInformation(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data _U_)
 {
@@ -407,6 +434,7 @@ void proto_register_h225(void) {
   gef_content_dissector_table = register_dissector_table("h225.gef.content", "H.225 Generic Extensible Framework", FT_STRING, BASE_NONE);
 
   register_init_routine(&h225_init_routine);
+  conversation_register_expire_func(h225_expire_conversations);
   h225_tap = register_tap("h225");
 
   oid_add_from_string("Version 1","0.0.8.2250.0.1");
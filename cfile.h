@@ -26,6 +26,8 @@
 #include <epan/epan.h>
 #include <epan/column-info.h>
 #include <epan/dfilter/dfilter.h>
+#include <epan/dfilter/dfcache.h>
+#include <epan/protocol_set.h>
 #include <epan/frame_data.h>
 #include <epan/frame_data_sequence.h>
 #include <wiretap/wtap.h>
@@ -92,6 +94,7 @@ typedef struct _capture_file {
   dfilter_t   *dfcode;          /* Compiled display filter program */
   gchar       *dfilter;         /* Display filter string */
   gboolean     redissecting;    /* TRUE if currently redissecting (cf_redissect_packets) */
+  gboolean     frames_undissected; /* TRUE if the frames were listed from a packet index and haven't all been dissected in order yet */
   /* search */
   gchar       *sfilter;         /* Filter, hex value, or string being searched */
   gboolean     hex;             /* TRUE if "Hex value" search was last selected */
@@ -128,6 +131,9 @@ typedef struct _capture_file {
   const frame_data *ref;
   frame_data  *prev_dis;
   frame_data  *prev_cap;
+  GSList      *filter_results;  /* Results of recently applied display filters (see file.c) */
+  dfcache_t   *field_cache;     /* Values of the fields display filters use most */
+  protocol_set_table_t *protocol_sets; /* Sets of protocols the frames have (see frame_data) */
 } capture_file;
 
 extern void cap_file_init(capture_file *cf);
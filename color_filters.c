@@ -58,6 +58,12 @@ static GSList *color_filter_list = NULL;
 static GSList *color_filter_deleted_list = NULL;
 static GSList *color_filter_valid_list   = NULL;
 
+/* the compiled filters of the enabled entries of color_filter_list,
+ * merged so that a packet is colorized with one run of a filter
+ * program; built when it's first needed */
+static dfilter_batch_t *color_filter_batch = NULL;
+static GPtrArray       *color_filter_batch_entries = NULL;
+
 /* Color Filters can en-/disabled. */
 static gboolean filters_enabled = TRUE;
 
@@ -66,6 +72,18 @@ static gboolean filters_enabled = TRUE;
  */
 static gboolean tmp_colors_set = FALSE;
 
+/* throw away the merged filters when the filter list changes */
+static void
+color_filters_changed(void)
+{
+    dfilter_batch_free(color_filter_batch);
+    color_filter_batch = NULL;
+    if (color_filter_batch_entries != NULL) {
+        g_ptr_array_free(color_filter_batch_entries, TRUE);
+        color_filter_batch_entries = NULL;
+    }
+}
+
 /* Create a new filter */
 color_filter_t *
 color_filter_new(const gchar *name,          /* The name of the filter to create */
@@ -177,6 +195,7 @@ color_filters_set_tmp(guint8 filt_nr, gchar *filter, gboolean disabled)
                               " text: \"%s\".\n%s", name, filter, err_msg);
                 g_free(err_msg);
             } else {
+                color_filters_changed();
                 if (colorf->filter_text != NULL)
                     g_free(colorf->filter_text);
                 if (colorf->c_colorfilter != NULL)
@@ -216,8 +235,10 @@ color_filter_delete(color_filter_t *colorf)
         g_free(colorf->filter_name);
     if (colorf->filter_text != NULL)
         g_free(colorf->filter_text);
-    if (colorf->c_colorfilter != NULL)
+    if (colorf->c_colorfilter != NULL) {
+        color_filters_changed();
         dfilter_free(colorf->c_colorfilter);
+    }
     g_free(colorf);
 }
 
@@ -283,6 +304,8 @@ color_filter_list_clone(GSList *cfl)
 void
 color_filters_init(void)
 {
+    color_filters_changed();
+
     /* delete all currently existing filters */
     color_filter_list_delete(&color_filter_list);
 
@@ -298,6 +321,8 @@ color_filters_init(void)
 void
 color_filters_reload(void)
 {
+    color_filters_changed();
+
     /* "move" old entries to the deleted list
      * we must keep them until the dissection no longer needs them */
     color_filter_deleted_list = g_slist_concat(color_filter_deleted_list, color_filter_list);
@@ -373,6 +398,8 @@ color_filter_validate_cb(gpointer filter_arg, gpointer unused _U_)
 void
 color_filters_apply(GSList *tmp_cfl, GSList *edit_cfl)
 {
+    color_filters_changed();
+
     /* "move" old entries to the deleted list
      * we must keep them until the dissection no longer needs them */
     color_filter_deleted_list = g_slist_concat(color_filter_deleted_list, color_filter_list);
@@ -433,26 +460,41 @@ color_filters_prime_edt(epan_dissect_t *edt)
         g_slist_foreach(color_filter_list, prime_edt, edt);
 }
 
+/* merge the filters of the enabled color filters, in the order
+ * in which they're tried */
+static void
+color_filters_build_batch(void)
+{
+    GSList         *curr;
+    color_filter_t *colorf;
+
+    color_filter_batch = dfilter_batch_new(TRUE);
+    color_filter_batch_entries = g_ptr_array_new();
+
+    for (curr = color_filter_list; curr != NULL; curr = g_slist_next(curr)) {
+        colorf = (color_filter_t *)curr->data;
+        if ( (!colorf->disabled) &&
+             (colorf->c_colorfilter != NULL) ) {
+            dfilter_batch_add(color_filter_batch, colorf->c_colorfilter);
+            g_ptr_array_add(color_filter_batch_entries, colorf);
+        }
+    }
+}
+
 /* * Return the color_t for later use */
 const color_filter_t *
 color_filters_colorize_packet(epan_dissect_t *edt)
 {
-    GSList         *curr;
-    color_filter_t *colorf;
+    int matched;
 
     /* If we have color filters, "search" for the matching one. */
     if (color_filters_used()) {
-        curr = color_filter_list;
-
-        while(curr != NULL) {
-            colorf = (color_filter_t *)curr->data;
-            if ( (!colorf->disabled) &&
-                 (colorf->c_colorfilter != NULL) &&
-                 dfilter_apply_edt(colorf->c_colorfilter, edt)) {
-                return colorf;
-            }
-            curr = g_slist_next(curr);
-        }
+        if (color_filter_batch == NULL)
+            color_filters_build_batch();
+
+        matched = dfilter_batch_apply_edt(color_filter_batch, edt);
+        if (matched >= 0)
+            return (const color_filter_t *)g_ptr_array_index(color_filter_batch_entries, matched);
     }
 
     return NULL;
@@ -59,6 +59,7 @@
 #endif
 
 #include "wtap.h"
+#include "wtap_index.h"
 
 #ifndef HAVE_GETOPT_LONG
 #include "wsutil/wsgetopt.h"
@@ -77,6 +78,7 @@
 # include "wsutil/strptime.h"
 #endif
 
+#include <wsutil/buffer.h>
 #include <wsutil/crash_info.h>
 #include <wsutil/filesystem.h>
 #include <wsutil/md5.h>
@@ -131,6 +133,9 @@ static int       ignored_bytes  = 0;  /* Used with -I */
 #define ALNUM_CHARS     "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789"
 #define ALNUM_LEN       (sizeof(ALNUM_CHARS) - 1)
 
+/* Long options without a corresponding single-character option */
+#define LONGOPT_COMPRESS 256
+
 struct time_adjustment {
     nstime_t tv;
     int is_negative;
@@ -164,6 +169,7 @@ static time_t                 stoptime                  = 0;
 static gboolean               check_startstop           = FALSE;
 static gboolean               dup_detect                = FALSE;
 static gboolean               dup_detect_by_time        = FALSE;
+static wtap_compression_type  compression_type          = WTAP_UNCOMPRESSED;
 
 static int                    do_strict_time_adjustment = FALSE;
 static struct time_adjustment strict_time_adj           = {{0, 0}, 0}; /* strict time adjustment */
@@ -754,6 +760,9 @@ print_usage(FILE *output)
     fprintf(output, "  -T <encap type>        set the output file encapsulation type; default is the\n");
     fprintf(output, "                         same as the input file. An empty \"-T\" option will\n");
     fprintf(output, "                         list the encapsulation types.\n");
+    fprintf(output, "  -z                     gzip-compress the output file(s).\n");
+    fprintf(output, "  --compress <type>      compress the output file(s) with <type>, one of\n");
+    fprintf(output, "                         gzip, zstd or lz4.\n");
     fprintf(output, "\n");
     fprintf(output, "Miscellaneous:\n");
     fprintf(output, "  -h                     display this help and exit.\n");
@@ -869,6 +878,38 @@ get_editcap_runtime_info(GString *str)
 #endif
 }
 
+/*
+ * With -A and -B, only the time stamps of the records outside the time
+ * frame are looked at.  If the file has an up-to-date packet index (see
+ * "tshark --write-index"), those are taken from the index, and only the
+ * records in the time frame are read, with random access; for a gzipped
+ * file, the fast seek points kept with the index let inflating start
+ * near each of those records rather than at the start of the file.
+ */
+static gboolean
+read_indexed_record(wtap *wth, wtap_index *idx, struct wtap_pkthdr *phdr,
+                    Buffer *buf, int *err, gchar **err_info)
+{
+    wtap_index_entry entry;
+
+    if (!wtap_index_read(idx, &entry, err))
+        return FALSE;
+
+    if (entry.has_ts && entry.ts.secs >= starttime && entry.ts.secs < stoptime)
+        return wtap_seek_read(wth, entry.data_offset, phdr, buf, err, err_info);
+
+    phdr->rec_type = REC_TYPE_PACKET;
+    phdr->presence_flags = WTAP_HAS_CAP_LEN;
+    if (entry.has_ts)
+        phdr->presence_flags |= WTAP_HAS_TS;
+    phdr->ts = entry.ts;
+    phdr->caplen = entry.caplen;
+    phdr->len = entry.len;
+    phdr->pkt_encap = entry.pkt_encap;
+    phdr->pkt_tsprec = entry.pkt_tsprec;
+    return TRUE;
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -882,6 +923,7 @@ DIAG_OFF(cast-qual)
     static const struct option long_options[] = {
         {(char *)"help", no_argument, NULL, 'h'},
         {(char *)"version", no_argument, NULL, 'V'},
+        {(char *)"compress", required_argument, NULL, LONGOPT_COMPRESS},
         {0, 0, 0, 0 }
     };
 DIAG_ON(cast-qual)
@@ -909,6 +951,10 @@ DIAG_ON(cast-qual)
 
     const struct wtap_pkthdr    *phdr;
     struct wtap_pkthdr           snap_phdr;
+    gboolean                     use_index;
+    wtap_index                  *pkt_index = NULL;
+    struct wtap_pkthdr           index_phdr;
+    Buffer                       index_buf;
     wtapng_iface_descriptions_t *idb_inf;
     wtapng_section_t            *shb_hdr;
 
@@ -962,7 +1008,7 @@ DIAG_ON(cast-qual)
 #endif
 
     /* Process the options */
-    while ((opt = getopt_long(argc, argv, "A:B:c:C:dD:E:F:hi:I:Lrs:S:t:T:vVw:", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "A:B:c:C:dD:E:F:hi:I:Lrs:S:t:T:vVw:z", long_options, NULL)) != -1) {
         switch (opt) {
         case 'A':
         {
@@ -1172,6 +1218,29 @@ DIAG_ON(cast-qual)
             set_rel_time(optarg);
             break;
 
+        case 'z':
+            compression_type = WTAP_GZIP_COMPRESSED;
+            break;
+
+        case LONGOPT_COMPRESS:
+            if (strcmp(optarg, "gzip") == 0)
+                compression_type = WTAP_GZIP_COMPRESSED;
+            else if (strcmp(optarg, "zstd") == 0)
+                compression_type = WTAP_ZSTD_COMPRESSED;
+            else if (strcmp(optarg, "lz4") == 0)
+                compression_type = WTAP_LZ4_COMPRESSED;
+            else {
+                fprintf(stderr, "editcap: \"%s\" isn't a valid compression type\n",
+                        optarg);
+                exit(1);
+            }
+            if (!wtap_can_write_compression_type(compression_type)) {
+                fprintf(stderr, "editcap: this version of editcap can't write %s-compressed files\n",
+                        optarg);
+                exit(1);
+            }
+            break;
+
         case '?':              /* Bad options if GNU getopt */
             switch(optopt) {
             case'F':
@@ -1223,7 +1292,19 @@ DIAG_ON(cast-qual)
         exit(1);
     }
 
-    wth = wtap_open_offline(argv[optind], WTAP_TYPE_AUTO, &err, &err_info, FALSE);
+    if (compression_type != WTAP_UNCOMPRESSED &&
+        !wtap_dump_can_compress(out_file_type_subtype)) {
+        fprintf(stderr, "editcap: %s files can't be written compressed\n",
+                wtap_file_type_subtype_string(out_file_type_subtype));
+        exit(1);
+    }
+
+    /* A packet index can only be used to skip the records outside the
+       time frame if every record doesn't have to be looked at anyway, to
+       split the output. */
+    use_index = check_startstop && split_packet_count == 0 && secs_per_block == 0;
+
+    wth = wtap_open_offline(argv[optind], WTAP_TYPE_AUTO, &err, &err_info, use_index);
 
     if (!wth) {
         fprintf(stderr, "editcap: Can't open %s: %s\n", argv[optind],
@@ -1264,10 +1345,22 @@ DIAG_ON(cast-qual)
             }
         }
 
-        while (wtap_read(wth, &err, &err_info, &data_offset)) {
+        if (use_index) {
+            pkt_index = wtap_index_open(wth, argv[optind]);
+            if (pkt_index != NULL) {
+                if (verbose)
+                    fprintf(stderr, "Using the packet index of %s.\n", argv[optind]);
+                wtap_phdr_init(&index_phdr);
+                ws_buffer_init(&index_buf, 1500);
+            }
+        }
+
+        while (pkt_index != NULL ?
+               read_indexed_record(wth, pkt_index, &index_phdr, &index_buf, &err, &err_info) :
+               wtap_read(wth, &err, &err_info, &data_offset)) {
             read_count++;
 
-            phdr = wtap_phdr(wth);
+            phdr = pkt_index != NULL ? &index_phdr : wtap_phdr(wth);
 
             if (read_count == 1) {  /* the first packet */
                 if (split_packet_count > 0 || secs_per_block > 0) {
@@ -1285,9 +1378,9 @@ DIAG_ON(cast-qual)
                     shb_hdr->shb_user_appl = g_strdup("Editcap " VERSION);
                 }
 
-                pdh = wtap_dump_open_ng(filename, out_file_type_subtype, out_frame_type,
-                                        snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
-                                        FALSE /* compressed */, shb_hdr, idb_inf, &err);
+                pdh = wtap_dump_open_compressed(filename, out_file_type_subtype, out_frame_type,
+                                                snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
+                                                compression_type, shb_hdr, idb_inf, &err);
 
                 if (pdh == NULL) {
                     fprintf(stderr, "editcap: Can't open or create %s: %s\n",
@@ -1296,7 +1389,7 @@ DIAG_ON(cast-qual)
                 }
             }
 
-            buf = wtap_buf_ptr(wth);
+            buf = pkt_index != NULL ? ws_buffer_start_ptr(&index_buf) : wtap_buf_ptr(wth);
 
             /*
              * Not all packets have time stamps. Only process the time
@@ -1326,9 +1419,9 @@ DIAG_ON(cast-qual)
                         if (verbose)
                             fprintf(stderr, "Continuing writing in file %s\n", filename);
 
-                        pdh = wtap_dump_open_ng(filename, out_file_type_subtype, out_frame_type,
-                                                snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
-                                                FALSE /* compressed */, shb_hdr, idb_inf, &err);
+                        pdh = wtap_dump_open_compressed(filename, out_file_type_subtype, out_frame_type,
+                                                        snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
+                                                        compression_type, shb_hdr, idb_inf, &err);
 
                         if (pdh == NULL) {
                             fprintf(stderr, "editcap: Can't open or create %s: %s\n",
@@ -1355,9 +1448,9 @@ DIAG_ON(cast-qual)
                     if (verbose)
                         fprintf(stderr, "Continuing writing in file %s\n", filename);
 
-                    pdh = wtap_dump_open_ng(filename, out_file_type_subtype, out_frame_type,
-                                            snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
-                                            FALSE /* compressed */, shb_hdr, idb_inf, &err);
+                    pdh = wtap_dump_open_compressed(filename, out_file_type_subtype, out_frame_type,
+                                                    snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
+                                                    compression_type, shb_hdr, idb_inf, &err);
                     if (pdh == NULL) {
                         fprintf(stderr, "editcap: Can't open or create %s: %s\n",
                                 filename, wtap_strerror(err));
@@ -1392,7 +1485,7 @@ DIAG_ON(cast-qual)
                 /* We simply write it, perhaps after truncating it; we could
                  * do other things, like modify it. */
 
-                phdr = wtap_phdr(wth);
+                phdr = pkt_index != NULL ? &index_phdr : wtap_phdr(wth);
 
                 if (snaplen != 0) {
                     if (phdr->caplen > snaplen) {
@@ -1684,6 +1777,12 @@ DIAG_ON(cast-qual)
         g_free(fprefix);
         g_free(fsuffix);
 
+        if (pkt_index != NULL) {
+            wtap_index_close(pkt_index);
+            wtap_phdr_cleanup(&index_phdr);
+            ws_buffer_free(&index_buf);
+        }
+
         if (err != 0) {
             /* Print a message noting that the read failed somewhere along the
              * line. */
@@ -1702,9 +1801,9 @@ DIAG_ON(cast-qual)
             g_free (filename);
             filename = g_strdup(argv[optind+1]);
 
-            pdh = wtap_dump_open_ng(filename, out_file_type_subtype, out_frame_type,
-                                    snaplen ? MIN(snaplen, wtap_snapshot_length(wth)): wtap_snapshot_length(wth),
-                                    FALSE /* compressed */, shb_hdr, idb_inf, &err);
+            pdh = wtap_dump_open_compressed(filename, out_file_type_subtype, out_frame_type,
+                                            snaplen ? MIN(snaplen, wtap_snapshot_length(wth)): wtap_snapshot_length(wth),
+                                            compression_type, shb_hdr, idb_inf, &err);
             if (pdh == NULL) {
                 fprintf(stderr, "editcap: Can't open or create %s: %s\n",
                         filename, wtap_strerror(err));
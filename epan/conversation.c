@@ -39,44 +39,71 @@ int _debug_conversation_indent = 0;
 #endif
 
 /*
- * Hash table for conversations with no wildcards.
+ * An index of the conversations with the same wildcards, by address/port
+ * pairs.
+ *
+ * It's an open-addressing hash table with linear probing; each slot
+ * holds the hash of its key, so that a probe doesn't have to look at
+ * the key unless the hashes are equal.  As ports get reused, there can
+ * be many conversations with the same key, set up in different frames;
+ * a slot holds an array of them, sorted by setup frame, so that the one
+ * for a given frame can be found by binary search.  Most keys have only
+ * one conversation, which is held in the slot itself.
  */
-static GHashTable *conversation_hashtable_exact = NULL;
+typedef struct {
+	guint32		hash;		/* hash of the key, or 0 if the slot is free */
+	guint32		count;		/* number of conversations with the key */
+	conversation_key *key;		/* key of one of them */
+	union {
+		conversation_t	*conv;	/* if count is 1 */
+		conversation_t	**convs; /* if count is more, by setup frame */
+	} u;
+} conv_slot_t;
+
+typedef struct {
+	conv_slot_t	*slots;		/* NULL until conversation_init() */
+	guint32		mask;		/* number of slots - 1 */
+	guint32		keys;		/* slots in use */
+	guint32		conversations;
+	guint		(*hash_func)(gconstpointer);
+	gint		(*match_func)(gconstpointer, gconstpointer);
+} conv_index_t;
+
+#define CONV_INDEX_INITIAL_SIZE	256
 
 /*
- * Hash table for conversations with one wildcard address.
+ * Index of conversations with no wildcards.
  */
-static GHashTable *conversation_hashtable_no_addr2 = NULL;
+static conv_index_t conversation_index_exact;
 
 /*
- * Hash table for conversations with one wildcard port.
+ * Index of conversations with one wildcard address.
  */
-static GHashTable *conversation_hashtable_no_port2 = NULL;
+static conv_index_t conversation_index_no_addr2;
 
 /*
- * Hash table for conversations with one wildcard address and port.
+ * Index of conversations with one wildcard port.
  */
-static GHashTable *conversation_hashtable_no_addr2_or_port2 = NULL;
-
-
-#ifdef __NOT_USED__
-typedef struct conversation_key {
-	struct conversation_key *next;
-	address	addr1;
-	address	addr2;
-	port_type ptype;
-	guint32	port1;
-	guint32	port2;
-} conversation_key;
-#endif
+static conv_index_t conversation_index_no_port2;
+
 /*
- * Linked list of conversation keys, so we can, before freeing them all,
- * free the address data allocations associated with them.
+ * Index of conversations with one wildcard address and port.
  */
-static conversation_key *conversation_keys;
+static conv_index_t conversation_index_no_addr2_or_port2;
 
 static guint32 new_index;
 
+/*
+ * Functions to free protocols' conversation data when conversations
+ * are expired, by protocol ID; functions to call before conversations
+ * are expired, and the conversations being expired while they're
+ * called; and the number of conversations that have been expired.
+ */
+static GHashTable *proto_data_free_funcs;
+static GSList *expire_funcs;
+static GHashTable *expiring_conversations;
+static guint64 conversations_expired;
+
 /*
  * Protocol-specific data attached to a conversation_t structure - protocol
  * index and opaque pointer.
@@ -458,203 +485,302 @@ conversation_match_no_addr2_or_port2(gconstpointer v, gconstpointer w)
 }
 
 /*
- * Free the proto_data.  The conversation itself is wmem-allocated with
- * file scope.
+ * Hash a key for an index; 0 marks free slots, so it's never 0.
  */
-static void
-free_data_list(gpointer value)
+static guint32
+conv_index_hash(const conv_index_t *index, const conversation_key *key)
 {
-	conversation_t *conv = (conversation_t *)value;
-
-	/* TODO: file scoped wmem_list? There's no singly-linked wmem_ list */
-	g_slist_free(conv->data_list);
-
-	/* Not really necessary, but... */
-	conv->data_list = NULL;
+	guint32 hash = index->hash_func(key);
 
+	return hash != 0 ? hash : 1;
 }
 
 /*
- * Destroy all existing conversations
+ * Find the slot for a key: the one that has it, or the free one where
+ * it would go.
  */
-void
-conversation_cleanup(void)
+static conv_slot_t *
+conv_index_find_slot(const conv_index_t *index, const conversation_key *key, const guint32 hash)
 {
-	/*  Clean up the hash tables, but only after freeing any proto_data
-	 *  that may be hanging off the conversations.
-	 *  The conversation keys are wmem-allocated with file scope so we
-	 *  don't have to clean them up.
-	 */
-	conversation_keys = NULL;
-	if (conversation_hashtable_exact != NULL) {
-		g_hash_table_destroy(conversation_hashtable_exact);
-	}
-	if (conversation_hashtable_no_addr2 != NULL) {
-		g_hash_table_destroy(conversation_hashtable_no_addr2);
-	}
-	if (conversation_hashtable_no_port2 != NULL) {
-		g_hash_table_destroy(conversation_hashtable_no_port2);
-	}
-	if (conversation_hashtable_no_addr2_or_port2 != NULL) {
-		g_hash_table_destroy(conversation_hashtable_no_addr2_or_port2);
+	guint32 i = hash & index->mask;
+	conv_slot_t *slot;
+
+	for (;;) {
+		slot = &index->slots[i];
+		if (slot->hash == 0)
+			return slot;
+		if (slot->hash == hash && index->match_func(slot->key, key))
+			return slot;
+		i = (i + 1) & index->mask;
 	}
+}
 
-	conversation_hashtable_exact = NULL;
-	conversation_hashtable_no_addr2 = NULL;
-	conversation_hashtable_no_port2 = NULL;
-	conversation_hashtable_no_addr2_or_port2 = NULL;
+static void
+conv_index_create(conv_index_t *index, guint (*hash_func)(gconstpointer),
+    gint (*match_func)(gconstpointer, gconstpointer))
+{
+	index->slots = g_new0(conv_slot_t, CONV_INDEX_INITIAL_SIZE);
+	index->mask = CONV_INDEX_INITIAL_SIZE - 1;
+	index->keys = 0;
+	index->conversations = 0;
+	index->hash_func = hash_func;
+	index->match_func = match_func;
 }
 
 /*
- * Initialize some variables every time a file is loaded or re-loaded.
- * Create a new hash table for the conversations in the new file.
+ * Free the index, and the proto_data lists of its conversations.  The
+ * conversations themselves, and their keys, are wmem-allocated with
+ * file scope.
  */
-void
-conversation_init(void)
+static void
+conv_index_destroy(conv_index_t *index)
 {
-	/*
-	 * Free up any space allocated for conversation protocol data
-	 * areas.
-	 *
-	 * We can free the space, as the structures it contains are
-	 * pointed to by conversation data structures that were freed
-	 * above.
-	 */
-	conversation_hashtable_exact =
-	    g_hash_table_new_full(conversation_hash_exact,
-	      conversation_match_exact, NULL, free_data_list);
-	conversation_hashtable_no_addr2 =
-	    g_hash_table_new_full(conversation_hash_no_addr2,
-	      conversation_match_no_addr2, NULL, free_data_list);
-	conversation_hashtable_no_port2 =
-	    g_hash_table_new_full(conversation_hash_no_port2,
-	      conversation_match_no_port2, NULL, free_data_list);
-	conversation_hashtable_no_addr2_or_port2 =
-	    g_hash_table_new_full(conversation_hash_no_addr2_or_port2,
-	      conversation_match_no_addr2_or_port2, NULL, free_data_list);
+	conv_slot_t *slot;
+	guint32 i, j;
 
-	/*
-	 * Start the conversation indices over at 0.
-	 */
-	new_index = 0;
+	if (index->slots == NULL)
+		return;
+
+	for (i = 0; i <= index->mask; i++) {
+		slot = &index->slots[i];
+		if (slot->hash == 0)
+			continue;
+		if (slot->count == 1) {
+			g_slist_free(slot->u.conv->data_list);
+			slot->u.conv->data_list = NULL;
+		} else {
+			for (j = 0; j < slot->count; j++) {
+				/* TODO: file scoped wmem_list? There's no singly-linked wmem_ list */
+				g_slist_free(slot->u.convs[j]->data_list);
+				slot->u.convs[j]->data_list = NULL;
+			}
+			g_free(slot->u.convs);
+		}
+	}
+	g_free(index->slots);
+	index->slots = NULL;
 }
 
 /*
- * Does the right thing when inserting into one of the conversation hash tables,
- * taking into account ordering and hash chains and all that good stuff.
- *
- * Mostly adapted from the old conversation_new().
+ * Double the number of slots, putting each key in its slot in the new
+ * table; the hashes are kept, so keys aren't hashed again.
  */
 static void
-conversation_insert_into_hashtable(GHashTable *hashtable, conversation_t *conv)
+conv_index_grow(conv_index_t *index)
 {
-	conversation_t *chain_head, *chain_tail, *cur, *prev;
+	conv_slot_t *old_slots = index->slots;
+	guint32 old_size = index->mask + 1;
+	guint32 i, j;
+
+	index->slots = g_new0(conv_slot_t, old_size * 2);
+	index->mask = old_size * 2 - 1;
+	for (i = 0; i < old_size; i++) {
+		if (old_slots[i].hash == 0)
+			continue;
+		j = old_slots[i].hash & index->mask;
+		while (index->slots[j].hash != 0)
+			j = (j + 1) & index->mask;
+		index->slots[j] = old_slots[i];
+	}
+	g_free(old_slots);
+}
 
-	chain_head = (conversation_t *)g_hash_table_lookup(hashtable, conv->key_ptr);
+/*
+ * Return the position in a slot's array of the first conversation set
+ * up after frame_num.
+ */
+static guint32
+conv_slot_upper_bound(const conv_slot_t *slot, const guint32 frame_num)
+{
+	guint32 lo = 0, hi = slot->count, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (slot->u.convs[mid]->setup_frame <= frame_num)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
 
-	if (NULL==chain_head) {
-		/* New entry */
-		conv->next = NULL;
-		conv->last = conv;
-		g_hash_table_insert(hashtable, conv->key_ptr, conv);
+/*
+ * Add a conversation to an index, after any others with the same key
+ * that were set up in the same frame or before.
+ */
+static void
+conversation_insert_into_index(conv_index_t *index, conversation_t *conv)
+{
+	conv_slot_t *slot;
+	conversation_t *first;
+	guint32 hash, pos;
+
+	hash = conv_index_hash(index, conv->key_ptr);
+	slot = conv_index_find_slot(index, conv->key_ptr, hash);
+	index->conversations++;
+
+	if (slot->hash == 0) {
+		/* New key; keep at most 3/4 of the slots in use */
+		if ((index->keys + 1) > (index->mask + 1) / 4 * 3) {
+			conv_index_grow(index);
+			slot = conv_index_find_slot(index, conv->key_ptr, hash);
+		}
 		DPRINT(("created a new conversation chain"));
+		slot->hash = hash;
+		slot->count = 1;
+		slot->key = conv->key_ptr;
+		slot->u.conv = conv;
+		index->keys++;
+		return;
 	}
-	else {
-		/* There's an existing chain for this key */
-		DPRINT(("there's an existing conversation chain"));
-
-		chain_tail = chain_head->last;
-
-		if(conv->setup_frame >= chain_tail->setup_frame) {
-			/* This convo belongs at the end of the chain */
-			conv->next = NULL;
-			conv->last = NULL;
-			chain_tail->next = conv;
-			chain_head->last = conv;
-		}
-		else {
-			/* Loop through the chain to find the right spot */
-			cur = chain_head;
-			prev = NULL;
-
-			for (; (conv->setup_frame > cur->setup_frame) && cur->next; prev=cur, cur=cur->next)
-				;
-
-			if (NULL==prev) {
-				/* Changing the head of the chain */
-				conv->next = chain_head;
-				conv->last = chain_tail;
-				chain_head->last = NULL;
-				g_hash_table_insert(hashtable, conv->key_ptr, conv);
-			}
-			else {
-				/* Inserting into the middle of the chain */
-				conv->next = cur;
-				conv->last = NULL;
-				prev->next = conv;
-			}
-		}
+
+	/* There's an existing chain for this key */
+	DPRINT(("there's an existing conversation chain"));
+	if (slot->count == 1) {
+		first = slot->u.conv;
+		slot->u.convs = g_new(conversation_t *, 2);
+		slot->u.convs[0] = first;
+	} else if ((slot->count & (slot->count - 1)) == 0) {
+		/* The array is full; it holds a power of 2 */
+		slot->u.convs = g_renew(conversation_t *, slot->u.convs, slot->count * 2);
 	}
+
+	if (conv->setup_frame >= slot->u.convs[slot->count - 1]->setup_frame) {
+		/* This convo belongs at the end of the chain */
+		pos = slot->count;
+	} else {
+		pos = conv_slot_upper_bound(slot, conv->setup_frame);
+		memmove(&slot->u.convs[pos + 1], &slot->u.convs[pos],
+		    (slot->count - pos) * sizeof (conversation_t *));
+	}
+	slot->u.convs[pos] = conv;
+	slot->count++;
 }
 
 /*
- * Does the right thing when removing from one of the conversation hash tables,
- * taking into account ordering and hash chains and all that good stuff.
+ * Remove a conversation from an index, e.g. because its key is about to
+ * change.
  */
 static void
-conversation_remove_from_hashtable(GHashTable *hashtable, conversation_t *conv)
+conversation_remove_from_index(conv_index_t *index, conversation_t *conv)
 {
-	conversation_t *chain_head, *cur, *prev;
-
-	chain_head = (conversation_t *)g_hash_table_lookup(hashtable, conv->key_ptr);
-
-	if (conv == chain_head) {
-		/* We are currently the front of the chain */
-		if (NULL == conv->next) {
-			/* We are the only conversation in the chain, no need to
-			 * update next pointer, but do not call
-			 * g_hash_table_remove() either because the conv data
-			 * will be re-inserted. The memory is released when
-			 * conversion_cleanup() is called. */
-			g_hash_table_steal(hashtable, conv->key_ptr);
-		}
-		else {
-			/* Update the head of the chain */
-			chain_head = conv->next;
-			chain_head->last = conv->last;
+	conv_slot_t *slot, *next;
+	guint32 i, j, home, pos;
 
-			if (conv->latest_found == conv)
-				chain_head->latest_found = NULL;
-			else
-				chain_head->latest_found = conv->latest_found;
+	slot = conv_index_find_slot(index, conv->key_ptr, conv_index_hash(index, conv->key_ptr));
+	if (slot->hash == 0) {
+		/* XXX: Conversation not found. Wrong index? */
+		return;
+	}
 
-			g_hash_table_insert(hashtable, chain_head->key_ptr, chain_head);
+	if (slot->count == 1) {
+		if (slot->u.conv != conv)
+			return;
+	} else {
+		/* Find it among those set up in the same frame */
+		pos = conv_slot_upper_bound(slot, conv->setup_frame);
+		while (pos > 0 && slot->u.convs[pos - 1] != conv &&
+		    slot->u.convs[pos - 1]->setup_frame == conv->setup_frame)
+			pos--;
+		if (pos == 0 || slot->u.convs[pos - 1] != conv)
+			return;
+		pos--;
+
+		memmove(&slot->u.convs[pos], &slot->u.convs[pos + 1],
+		    (slot->count - pos - 1) * sizeof (conversation_t *));
+		slot->count--;
+		if (slot->count == 1) {
+			conversation_t *last = slot->u.convs[0];
+
+			g_free(slot->u.convs);
+			slot->u.conv = last;
 		}
+		/* The key is about to change; don't keep it as the slot's */
+		if (slot->key == conv->key_ptr)
+			slot->key = slot->count == 1 ? slot->u.conv->key_ptr : slot->u.convs[0]->key_ptr;
+		index->conversations--;
+		return;
 	}
-	else {
-		/* We are not the front of the chain. Loop through to find us.
-		 * Start loop at chain_head->next rather than chain_head because
-		 * we already know we're not at the head. */
-		cur = chain_head->next;
-		prev = chain_head;
-
-		for (; (cur != conv) && cur->next; prev=cur, cur=cur->next)
-			;
-
-		if (cur != conv) {
-			/* XXX: Conversation not found. Wrong hashtable? */
-			return;
+
+	/* It was the only one with its key; free the slot, and move back
+	   the keys after it that would have had it if it was free, so that
+	   probing doesn't stop short of them. */
+	index->conversations--;
+	index->keys--;
+	i = (guint32)(slot - index->slots);
+	j = i;
+	for (;;) {
+		j = (j + 1) & index->mask;
+		next = &index->slots[j];
+		if (next->hash == 0)
+			break;
+		home = next->hash & index->mask;
+		if ((j > i && (home <= i || home > j)) ||
+		    (j < i && (home <= i && home > j))) {
+			index->slots[i] = *next;
+			i = j;
 		}
+	}
+	index->slots[i].hash = 0;
+}
 
-		prev->next = conv->next;
+/*
+ * Destroy all existing conversations
+ */
+void
+conversation_cleanup(void)
+{
+	/*  Clean up the indices, but only after freeing any proto_data
+	 *  that may be hanging off the conversations.
+	 *  The conversations and their keys are wmem-allocated with file
+	 *  scope so we don't have to clean them up.
+	 */
+	conv_index_destroy(&conversation_index_exact);
+	conv_index_destroy(&conversation_index_no_addr2);
+	conv_index_destroy(&conversation_index_no_port2);
+	conv_index_destroy(&conversation_index_no_addr2_or_port2);
+}
 
-		if (NULL == conv->next) {
-			/* We're at the very end of the list. */
-			chain_head->last = prev;
-		}
+/*
+ * Initialize some variables every time a file is loaded or re-loaded.
+ * Create new indices for the conversations in the new file.
+ */
+void
+conversation_init(void)
+{
+	conv_index_create(&conversation_index_exact,
+	    conversation_hash_exact, conversation_match_exact);
+	conv_index_create(&conversation_index_no_addr2,
+	    conversation_hash_no_addr2, conversation_match_no_addr2);
+	conv_index_create(&conversation_index_no_port2,
+	    conversation_hash_no_port2, conversation_match_no_port2);
+	conv_index_create(&conversation_index_no_addr2_or_port2,
+	    conversation_hash_no_addr2_or_port2, conversation_match_no_addr2_or_port2);
+
+	/*
+	 * Start the conversation indices over at 0.
+	 */
+	new_index = 0;
+}
 
-		if (chain_head->latest_found == conv)
-			chain_head->latest_found = prev;
+/*
+ * Return the index for conversations with the given wildcard options.
+ */
+static conv_index_t *
+conversation_index_for_options(const guint options)
+{
+	if (options & NO_ADDR2) {
+		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
+			return &conversation_index_no_addr2_or_port2;
+		} else {
+			return &conversation_index_no_addr2;
+		}
+	} else {
+		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
+			return &conversation_index_no_port2;
+		} else {
+			return &conversation_index_exact;
+		}
 	}
 }
 
@@ -674,7 +800,7 @@ conversation_new(const guint32 setup_frame, const address *addr1, const address
 	DISSECTOR_ASSERT(!(options | CONVERSATION_TEMPLATE) || ((options | (NO_ADDR2 | NO_PORT2 | NO_PORT2_FORCE))) &&
 				"A conversation template may not be constructed without wildcard options");
 */
-	GHashTable* hashtable;
+	conv_index_t *index;
 	conversation_t *conversation=NULL;
 	conversation_key *new_key;
 
@@ -682,23 +808,9 @@ conversation_new(const guint32 setup_frame, const address *addr1, const address
 		    setup_frame, address_to_str(wmem_packet_scope(), addr1), port1,
 		    address_to_str(wmem_packet_scope(), addr2), port2, ptype));
 
-	if (options & NO_ADDR2) {
-		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
-			hashtable = conversation_hashtable_no_addr2_or_port2;
-		} else {
-			hashtable = conversation_hashtable_no_addr2;
-		}
-	} else {
-		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
-			hashtable = conversation_hashtable_no_port2;
-		} else {
-			hashtable = conversation_hashtable_exact;
-		}
-	}
+	index = conversation_index_for_options(options);
 
 	new_key = wmem_new(wmem_file_scope(), struct conversation_key);
-	new_key->next = conversation_keys;
-	conversation_keys = new_key;
 	WMEM_COPY_ADDRESS(wmem_file_scope(), &new_key->addr1, addr1);
 	WMEM_COPY_ADDRESS(wmem_file_scope(), &new_key->addr2, addr2);
 	new_key->ptype = ptype;
@@ -722,7 +834,7 @@ conversation_new(const guint32 setup_frame, const address *addr1, const address
 	new_index++;
 
 	DINDENT();
-	conversation_insert_into_hashtable(hashtable, conversation);
+	conversation_insert_into_index(index, conversation);
 	DENDENT();
 
 	return conversation;
@@ -748,16 +860,16 @@ conversation_set_port2(conversation_t *conv, const guint32 port)
 
 	DINDENT();
 	if (conv->options & NO_ADDR2) {
-		conversation_remove_from_hashtable(conversation_hashtable_no_addr2_or_port2, conv);
+		conversation_remove_from_index(&conversation_index_no_addr2_or_port2, conv);
 	} else {
-		conversation_remove_from_hashtable(conversation_hashtable_no_port2, conv);
+		conversation_remove_from_index(&conversation_index_no_port2, conv);
 	}
 	conv->options &= ~NO_PORT2;
 	conv->key_ptr->port2  = port;
 	if (conv->options & NO_ADDR2) {
-		conversation_insert_into_hashtable(conversation_hashtable_no_addr2, conv);
+		conversation_insert_into_index(&conversation_index_no_addr2, conv);
 	} else {
-		conversation_insert_into_hashtable(conversation_hashtable_exact, conv);
+		conversation_insert_into_index(&conversation_index_exact, conv);
 	}
 	DENDENT();
 }
@@ -785,32 +897,32 @@ conversation_set_addr2(conversation_t *conv, const address *addr)
 
 	DINDENT();
 	if (conv->options & NO_PORT2) {
-		conversation_remove_from_hashtable(conversation_hashtable_no_addr2_or_port2, conv);
+		conversation_remove_from_index(&conversation_index_no_addr2_or_port2, conv);
 	} else {
-		conversation_remove_from_hashtable(conversation_hashtable_no_port2, conv);
+		conversation_remove_from_index(&conversation_index_no_addr2, conv);
 	}
 	conv->options &= ~NO_ADDR2;
 	WMEM_COPY_ADDRESS(wmem_file_scope(), &conv->key_ptr->addr2, addr);
 	if (conv->options & NO_PORT2) {
-		conversation_insert_into_hashtable(conversation_hashtable_no_port2, conv);
+		conversation_insert_into_index(&conversation_index_no_port2, conv);
 	} else {
-		conversation_insert_into_hashtable(conversation_hashtable_exact, conv);
+		conversation_insert_into_index(&conversation_index_exact, conv);
 	}
 	DENDENT();
 }
 
 /*
- * Search a particular hash table for a conversation with the specified
+ * Search a particular index for a conversation with the specified
  * {addr1, port1, addr2, port2} and set up before frame_num.
  */
 static conversation_t *
-conversation_lookup_hashtable(GHashTable *hashtable, const guint32 frame_num, const address *addr1, const address *addr2,
+conversation_lookup_index(const conv_index_t *index, const guint32 frame_num, const address *addr1, const address *addr2,
     const port_type ptype, const guint32 port1, const guint32 port2)
 {
-	conversation_t* convo=NULL;
-	conversation_t* match=NULL;
-	conversation_t* chain_head=NULL;
+	const conv_slot_t *slot;
 	conversation_key key;
+	conversation_t *conv;
+	guint32 pos;
 
 	/*
 	 * We don't make a copy of the address data, we just copy the
@@ -822,28 +934,24 @@ conversation_lookup_hashtable(GHashTable *hashtable, const guint32 frame_num, co
 	key.port1 = port1;
 	key.port2 = port2;
 
-	chain_head = (conversation_t *)g_hash_table_lookup(hashtable, &key);
-
-	if (chain_head && (chain_head->setup_frame <= frame_num)) {
-		match = chain_head;
+	slot = conv_index_find_slot(index, &key, conv_index_hash(index, &key));
+	if (slot->hash == 0)
+		return NULL;
 
-		if((chain_head->last)&&(chain_head->last->setup_frame<=frame_num))
-			return chain_head->last;
-
-		if((chain_head->latest_found)&&(chain_head->latest_found->setup_frame<=frame_num))
-			match = chain_head->latest_found;
-
-		for (convo = match; convo && convo->setup_frame <= frame_num; convo = convo->next) {
-			if (convo->setup_frame > match->setup_frame) {
-				match = convo;
-			}
-		}
+	if (slot->count == 1) {
+		conv = slot->u.conv->setup_frame <= frame_num ? slot->u.conv : NULL;
+	} else if (slot->u.convs[slot->count - 1]->setup_frame <= frame_num) {
+		/* Usually the frame is after every setup frame */
+		conv = slot->u.convs[slot->count - 1];
+	} else {
+		pos = conv_slot_upper_bound(slot, frame_num);
+		conv = pos != 0 ? slot->u.convs[pos - 1] : NULL;
 	}
 
-    if (match)
-    	chain_head->latest_found = match;
-
-	return match;
+	/* Note the activity, for conversation_expire() */
+	if (conv != NULL && frame_num > conv->last_frame)
+		conv->last_frame = frame_num;
+	return conv;
 }
 
 
@@ -899,14 +1007,14 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
        */
       DPRINT(("trying exact match"));
       conversation =
-         conversation_lookup_hashtable(conversation_hashtable_exact,
+         conversation_lookup_index(&conversation_index_exact,
          frame_num, addr_a, addr_b, ptype,
          port_a, port_b);
       /* Didn't work, try the other direction */
       if (conversation == NULL) {
 	      DPRINT(("trying opposite direction"));
 	      conversation =
-		 conversation_lookup_hashtable(conversation_hashtable_exact,
+		 conversation_lookup_index(&conversation_index_exact,
 		 frame_num, addr_b, addr_a, ptype,
 		 port_b, port_a);
       }
@@ -915,7 +1023,7 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
           * TCP/UDP ports are in TCP/IP.
           */
          conversation =
-            conversation_lookup_hashtable(conversation_hashtable_exact,
+            conversation_lookup_index(&conversation_index_exact,
             frame_num, addr_b, addr_a, ptype,
             port_a, port_b);
       }
@@ -940,14 +1048,14 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
        */
       DPRINT(("trying wildcarded dest address"));
       conversation =
-         conversation_lookup_hashtable(conversation_hashtable_no_addr2,
+         conversation_lookup_index(&conversation_index_no_addr2,
          frame_num, addr_a, addr_b, ptype, port_a, port_b);
       if ((conversation == NULL) && (addr_a->type == AT_FC)) {
          /* In Fibre channel, OXID & RXID are never swapped as
           * TCP/UDP ports are in TCP/IP.
           */
          conversation =
-            conversation_lookup_hashtable(conversation_hashtable_no_addr2,
+            conversation_lookup_index(&conversation_index_no_addr2,
             frame_num, addr_b, addr_a, ptype,
             port_a, port_b);
       }
@@ -992,7 +1100,7 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
       if (!(options & NO_ADDR_B)) {
          DPRINT(("trying dest addr:port as source addr:port with wildcarded dest addr"));
          conversation =
-            conversation_lookup_hashtable(conversation_hashtable_no_addr2,
+            conversation_lookup_index(&conversation_index_no_addr2,
             frame_num, addr_b, addr_a, ptype, port_b, port_a);
          if (conversation != NULL) {
             /*
@@ -1036,14 +1144,14 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
        */
       DPRINT(("trying wildcarded dest port"));
       conversation =
-         conversation_lookup_hashtable(conversation_hashtable_no_port2,
+         conversation_lookup_index(&conversation_index_no_port2,
          frame_num, addr_a, addr_b, ptype, port_a, port_b);
       if ((conversation == NULL) && (addr_a->type == AT_FC)) {
          /* In Fibre channel, OXID & RXID are never swapped as
           * TCP/UDP ports are in TCP/IP
           */
          conversation =
-            conversation_lookup_hashtable(conversation_hashtable_no_port2,
+            conversation_lookup_index(&conversation_index_no_port2,
             frame_num, addr_b, addr_a, ptype, port_a, port_b);
       }
       if (conversation != NULL) {
@@ -1087,7 +1195,7 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
       if (!(options & NO_PORT_B)) {
          DPRINT(("trying dest addr:port as source addr:port and wildcarded dest port"));
          conversation =
-            conversation_lookup_hashtable(conversation_hashtable_no_port2,
+            conversation_lookup_index(&conversation_index_no_port2,
             frame_num, addr_b, addr_a, ptype, port_b, port_a);
          if (conversation != NULL) {
             /*
@@ -1126,7 +1234,7 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
     */
    DPRINT(("trying wildcarding dest addr:port"));
    conversation =
-      conversation_lookup_hashtable(conversation_hashtable_no_addr2_or_port2,
+      conversation_lookup_index(&conversation_index_no_addr2_or_port2,
       frame_num, addr_a, addr_b, ptype, port_a, port_b);
    if (conversation != NULL) {
       /*
@@ -1173,11 +1281,11 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
    DPRINT(("trying dest addr:port as source addr:port and wildcarding dest addr:port"));
    if (addr_a->type == AT_FC)
       conversation =
-      conversation_lookup_hashtable(conversation_hashtable_no_addr2_or_port2,
+      conversation_lookup_index(&conversation_index_no_addr2_or_port2,
       frame_num, addr_b, addr_a, ptype, port_a, port_b);
    else
       conversation =
-      conversation_lookup_hashtable(conversation_hashtable_no_addr2_or_port2,
+      conversation_lookup_index(&conversation_index_no_addr2_or_port2,
       frame_num, addr_b, addr_a, ptype, port_b, port_a);
    if (conversation != NULL) {
       /*
@@ -1364,28 +1472,193 @@ find_or_create_conversation(packet_info *pinfo)
 	return conv;
 }
 
-GHashTable *
-get_conversation_hashtable_exact(void)
+void
+conversation_register_proto_data_free(const int proto, conversation_proto_data_free_func func)
 {
-	return conversation_hashtable_exact;
+	if (proto_data_free_funcs == NULL)
+		proto_data_free_funcs = g_hash_table_new(g_direct_hash, g_direct_equal);
+	g_hash_table_insert(proto_data_free_funcs, GINT_TO_POINTER(proto), (gpointer)func);
 }
 
-GHashTable *
-get_conversation_hashtable_no_addr2(void)
+void
+conversation_register_expire_func(conversation_expire_func func)
 {
-	return conversation_hashtable_no_addr2;
+	expire_funcs = g_slist_append(expire_funcs, (gpointer)func);
 }
 
-GHashTable *
-get_conversation_hashtable_no_port2(void)
+gboolean
+conversation_expiring(const conversation_t *conv)
 {
-	return conversation_hashtable_no_port2;
+	return expiring_conversations != NULL &&
+	    g_hash_table_lookup(expiring_conversations, conv) != NULL;
 }
 
-GHashTable *
-get_conversation_hashtable_no_addr2_or_port2(void)
+/*
+ * Free a conversation that's been removed from its index, with its key
+ * and its protocols' data.
+ */
+static void
+conversation_free(conversation_t *conv)
 {
-	return conversation_hashtable_no_addr2_or_port2;
+	conversation_proto_data_free_func func;
+	conv_proto_data *p1;
+	GSList *item;
+
+	for (item = conv->data_list; item != NULL; item = item->next) {
+		p1 = (conv_proto_data *)item->data;
+		if (proto_data_free_funcs != NULL) {
+			func = (conversation_proto_data_free_func)g_hash_table_lookup(proto_data_free_funcs,
+			    GINT_TO_POINTER(p1->proto));
+			if (func != NULL)
+				func(p1->proto_data);
+		}
+		wmem_free(wmem_file_scope(), p1);
+	}
+	g_slist_free(conv->data_list);
+
+	wmem_free(wmem_file_scope(), (void *)conv->key_ptr->addr1.data);
+	wmem_free(wmem_file_scope(), (void *)conv->key_ptr->addr2.data);
+	wmem_free(wmem_file_scope(), conv->key_ptr);
+	wmem_free(wmem_file_scope(), conv);
+}
+
+/*
+ * Remove and free the conversations in an index whose last frame is
+ * before frame_num.
+ */
+static void
+conv_index_expire(conv_index_t *index, const guint32 frame_num, GPtrArray *idle)
+{
+	conv_slot_t *slot;
+	conversation_t *conv;
+	GSList *item;
+	guint32 i, j;
+
+	if (index->slots == NULL)
+		return;
+
+	/* Removing a key moves others back, so collect them first */
+	for (i = 0; i <= index->mask; i++) {
+		slot = &index->slots[i];
+		if (slot->hash == 0)
+			continue;
+		if (slot->count == 1) {
+			if (slot->u.conv->last_frame < frame_num)
+				g_ptr_array_add(idle, slot->u.conv);
+		} else {
+			for (j = 0; j < slot->count; j++) {
+				if (slot->u.convs[j]->last_frame < frame_num)
+					g_ptr_array_add(idle, slot->u.convs[j]);
+			}
+		}
+	}
+	if (idle->len == 0)
+		return;
+
+	/* Let dissectors drop the conversations from their own tables */
+	if (expire_funcs != NULL) {
+		expiring_conversations = g_hash_table_new(g_direct_hash, g_direct_equal);
+		for (i = 0; i < idle->len; i++) {
+			conv = (conversation_t *)g_ptr_array_index(idle, i);
+			g_hash_table_insert(expiring_conversations, conv, conv);
+		}
+		for (item = expire_funcs; item != NULL; item = item->next)
+			((conversation_expire_func)item->data)();
+		g_hash_table_destroy(expiring_conversations);
+		expiring_conversations = NULL;
+	}
+
+	for (i = 0; i < idle->len; i++) {
+		conv = (conversation_t *)g_ptr_array_index(idle, i);
+		conversation_remove_from_index(index, conv);
+		conversation_free(conv);
+	}
+	conversations_expired += idle->len;
+	g_ptr_array_set_size(idle, 0);
+}
+
+void
+conversation_expire(const guint32 frame_num)
+{
+	GPtrArray *idle = g_ptr_array_new();
+
+	conv_index_expire(&conversation_index_exact, frame_num, idle);
+	conv_index_expire(&conversation_index_no_addr2, frame_num, idle);
+	conv_index_expire(&conversation_index_no_port2, frame_num, idle);
+	conv_index_expire(&conversation_index_no_addr2_or_port2, frame_num, idle);
+	g_ptr_array_free(idle, TRUE);
+}
+
+void
+conversation_get_expiry_stats(conversation_expiry_stats_t *stats)
+{
+	stats->expired = conversations_expired;
+	stats->retained = conversation_index_exact.conversations +
+	    conversation_index_no_addr2.conversations +
+	    conversation_index_no_port2.conversations +
+	    conversation_index_no_addr2_or_port2.conversations;
+}
+
+static const conv_index_t *
+conversation_get_index(const conversation_index_e which)
+{
+	switch (which) {
+	case CONVERSATION_INDEX_EXACT:
+		return &conversation_index_exact;
+	case CONVERSATION_INDEX_NO_ADDR2:
+		return &conversation_index_no_addr2;
+	case CONVERSATION_INDEX_NO_PORT2:
+		return &conversation_index_no_port2;
+	case CONVERSATION_INDEX_NO_ADDR2_OR_PORT2:
+		return &conversation_index_no_addr2_or_port2;
+	default:
+		return NULL;
+	}
+}
+
+void
+conversation_get_index_stats(const conversation_index_e which, conversation_index_stats_t *stats)
+{
+	const conv_index_t *index = conversation_get_index(which);
+	guint32 i;
+
+	memset(stats, 0, sizeof *stats);
+	if (index == NULL || index->slots == NULL)
+		return;
+
+	stats->keys = index->keys;
+	stats->conversations = index->conversations;
+	stats->slots = index->mask + 1;
+	stats->bytes = (index->mask + 1) * sizeof (conv_slot_t);
+	for (i = 0; i <= index->mask; i++) {
+		guint32 count = index->slots[i].count;
+
+		if (index->slots[i].hash == 0 || count == 1)
+			continue;
+		/* The array holds the next power of 2 at or above count */
+		while (count & (count - 1))
+			count &= count - 1;
+		if (count != index->slots[i].count)
+			count *= 2;
+		stats->bytes += count * sizeof (conversation_t *);
+	}
+}
+
+void
+conversation_index_foreach(const conversation_index_e which, conversation_key_func func, gpointer user_data)
+{
+	const conv_index_t *index = conversation_get_index(which);
+	const conv_slot_t *slot;
+	guint32 i;
+
+	if (index == NULL || index->slots == NULL)
+		return;
+
+	for (i = 0; i <= index->mask; i++) {
+		slot = &index->slots[i];
+		if (slot->hash != 0)
+			func(slot->key, slot->hash, slot->count, user_data);
+	}
 }
 
 /*
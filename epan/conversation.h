@@ -61,7 +61,6 @@ extern "C" {
  * Data structure representing a conversation.
  */
 typedef struct conversation_key {
-	struct conversation_key *next;
 	address	addr1;
 	address	addr2;
 	port_type ptype;
@@ -70,10 +69,6 @@ typedef struct conversation_key {
 } conversation_key;
 
 typedef struct conversation {
-	struct conversation *next;	/** pointer to next conversation on hash chain */
-	struct conversation *last;	/** pointer to the last conversation on hash chain */
-	struct conversation *latest_found;
-								/** pointer to the last conversation on hash chain */
 	guint32	index;				/** unique ID for conversation */
 	guint32 setup_frame;		/** frame number that setup this conversation */
 	/* Assume that setup_frame is also the lowest frame number for now. */
@@ -181,17 +176,90 @@ try_conversation_dissector(const address *addr_a, const address *addr_b, const p
 extern void conversation_set_port2(conversation_t *conv, const guint32 port);
 extern void conversation_set_addr2(conversation_t *conv, const address *addr);
 
+/**
+ * The indices that conversations are kept in, by which of their address 2
+ * and port 2 are wildcards.
+ */
+typedef enum {
+	CONVERSATION_INDEX_EXACT,
+	CONVERSATION_INDEX_NO_ADDR2,
+	CONVERSATION_INDEX_NO_PORT2,
+	CONVERSATION_INDEX_NO_ADDR2_OR_PORT2
+} conversation_index_e;
+
+typedef struct {
+	guint	keys;		/** distinct address/port pairs */
+	guint	conversations;	/** conversations, set up in different frames */
+	guint	slots;		/** slots in the index's hash table */
+	gsize	bytes;		/** memory used by the index, not counting the conversations */
+} conversation_index_stats_t;
+
+/**
+ * Get the size of one of the conversation indices.
+ */
+WS_DLL_PUBLIC
+void conversation_get_index_stats(const conversation_index_e which, conversation_index_stats_t *stats);
+
+typedef void (*conversation_key_func)(const conversation_key *key, guint hash, guint count, gpointer user_data);
+
+/**
+ * Call func for each address/port pair in one of the conversation
+ * indices, with its hash and the number of conversations with it.
+ */
+WS_DLL_PUBLIC
+void conversation_index_foreach(const conversation_index_e which, conversation_key_func func, gpointer user_data);
+
+typedef void (*conversation_proto_data_free_func)(void *proto_data);
+
+/**
+ * Register a function to free a protocol's conversation data when the
+ * conversation is expired.  Without one, the data is dropped from the
+ * conversation but stays allocated until the file is closed.
+ */
+WS_DLL_PUBLIC
+void conversation_register_proto_data_free(const int proto, conversation_proto_data_free_func func);
+
+typedef void (*conversation_expire_func)(void);
+
+/**
+ * Register a function to be called when conversations are about to be
+ * expired, for a dissector that keeps pointers to conversations in
+ * tables of its own to remove them; conversation_expiring() tells
+ * whether a conversation is one of those being expired.
+ */
 WS_DLL_PUBLIC
-GHashTable *get_conversation_hashtable_exact(void);
+void conversation_register_expire_func(conversation_expire_func func);
 
+/**
+ * Is the conversation one that's about to be expired?  Only meaningful
+ * in a function registered with conversation_register_expire_func().
+ */
 WS_DLL_PUBLIC
-GHashTable *get_conversation_hashtable_no_addr2(void);
+gboolean conversation_expiring(const conversation_t *conv);
 
+/**
+ * Free the conversations that have had no packets in or after frame
+ * frame_num, along with their protocols' data.  That's only safe if
+ * frames are dissected once, in order, and never revisited, e.g. in a
+ * long-running live capture in TShark without two-pass analysis; and
+ * only if dissectors that keep pointers to conversations anywhere but
+ * in conversation data remove them when they're told to with
+ * conversation_register_expire_func(), as those would be left dangling.
+ */
 WS_DLL_PUBLIC
-GHashTable * get_conversation_hashtable_no_port2(void);
+void conversation_expire(const guint32 frame_num);
 
+typedef struct {
+	guint64	expired;	/** conversations freed by conversation_expire() */
+	guint	retained;	/** conversations being kept */
+} conversation_expiry_stats_t;
+
+/**
+ * Get the number of conversations that have been expired since the
+ * program started, and the number that are being kept.
+ */
 WS_DLL_PUBLIC
-GHashTable *get_conversation_hashtable_no_addr2_or_port2(void);
+void conversation_get_expiry_stats(conversation_expiry_stats_t *stats);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,193 @@
+/* conversation_bench.c
+ * Times conversation lookups, and measures the memory that conversations
+ * take, for a workload with many conversations and heavy port reuse
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Usage: conversation_bench [tuples [packets [reuse]]]
+ *
+ * Synthesizes "packets" TCP packets between "tuples" address/port
+ * pairs; a packet starts a new conversation on its pair, as a SYN
+ * reusing the ports would, with a probability of 1 in "reuse".  The
+ * packets are looked up twice, as Wireshark does on the first pass
+ * through a file, creating the conversations that aren't found, and
+ * then when refiltering, when the lookups have to find the
+ * conversation that was current at the packet's frame number.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <glib.h>
+
+#include "address.h"
+#include "conversation.h"
+#include "wmem/wmem.h"
+
+#define DEFAULT_TUPLES	100000
+#define DEFAULT_PACKETS	2000000
+#define DEFAULT_REUSE	50
+
+typedef struct {
+	guint32 addr[2];
+	guint32 port[2];
+} tuple_t;
+
+static const char *index_names[] = {
+	"exact", "no addr2", "no port2", "no addr2 or port2"
+};
+
+static conversation_t *
+lookup(guint32 frame, const tuple_t *t, gboolean create)
+{
+	address src, dst;
+	conversation_t *conv;
+
+	SET_ADDRESS(&src, AT_IPv4, 4, &t->addr[0]);
+	SET_ADDRESS(&dst, AT_IPv4, 4, &t->addr[1]);
+	conv = find_conversation(frame, &src, &dst, PT_TCP, t->port[0], t->port[1], 0);
+	if (conv == NULL && create)
+		conv = conversation_new(frame, &src, &dst, PT_TCP, t->port[0], t->port[1], 0);
+	return conv;
+}
+
+int
+main(int argc, char **argv)
+{
+	guint n_tuples = DEFAULT_TUPLES;
+	guint n_packets = DEFAULT_PACKETS;
+	guint reuse = DEFAULT_REUSE;
+	tuple_t *tuples;
+	guint32 *packet_tuple;
+	conversation_t **packet_conv;
+	address src, dst;
+	GRand *rand;
+	GTimer *timer;
+	double first_pass, second_pass;
+	conversation_index_stats_t stats;
+	gsize index_bytes = 0;
+	guint n_conversations = 0;
+	guint mismatches = 0;
+	guint i, j;
+	int which;
+
+	if (argc > 1)
+		n_tuples = (guint)strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		n_packets = (guint)strtoul(argv[2], NULL, 10);
+	if (argc > 3)
+		reuse = (guint)strtoul(argv[3], NULL, 10);
+	if (n_tuples == 0 || n_packets == 0 || reuse == 0) {
+		fprintf(stderr, "usage: conversation_bench [tuples [packets [reuse]]]\n");
+		return 1;
+	}
+
+	wmem_init();
+	wmem_enter_file_scope();
+	conversation_init();
+
+	rand = g_rand_new_with_seed(1);
+	tuples = g_new(tuple_t, n_tuples);
+	for (i = 0; i < n_tuples; i++) {
+		tuples[i].addr[0] = g_htonl(0x0a000000 | g_rand_int_range(rand, 0, 1 << 16));
+		tuples[i].addr[1] = g_htonl(0xc0a80000 | g_rand_int_range(rand, 0, 1 << 8));
+		tuples[i].port[0] = g_rand_int_range(rand, 1024, 65536);
+		tuples[i].port[1] = (i % 4 == 0) ? 80 : g_rand_int_range(rand, 1, 1024);
+	}
+	packet_tuple = g_new(guint32, n_packets);
+	packet_conv = g_new(conversation_t *, n_packets);
+	for (i = 0; i < n_packets; i++)
+		packet_tuple[i] = g_rand_int_range(rand, 0, n_tuples);
+
+	/* First pass: frames in order, starting new conversations. */
+	timer = g_timer_new();
+	for (i = 0; i < n_packets; i++) {
+		const tuple_t *t = &tuples[packet_tuple[i]];
+
+		if (g_rand_int_range(rand, 0, reuse) == 0) {
+			SET_ADDRESS(&src, AT_IPv4, 4, &t->addr[0]);
+			SET_ADDRESS(&dst, AT_IPv4, 4, &t->addr[1]);
+			packet_conv[i] = conversation_new(i + 1, &src, &dst, PT_TCP,
+			    t->port[0], t->port[1], 0);
+		} else {
+			packet_conv[i] = lookup(i + 1, t, TRUE);
+		}
+	}
+	first_pass = g_timer_elapsed(timer, NULL);
+
+	/* Second pass: every frame has to find the conversation it had. */
+	g_timer_start(timer);
+	for (i = 0; i < n_packets; i++) {
+		if (lookup(i + 1, &tuples[packet_tuple[i]], FALSE) != packet_conv[i])
+			mismatches++;
+	}
+	second_pass = g_timer_elapsed(timer, NULL);
+	g_timer_destroy(timer);
+
+	for (which = CONVERSATION_INDEX_EXACT; which <= CONVERSATION_INDEX_NO_ADDR2_OR_PORT2; which++) {
+		conversation_get_index_stats((conversation_index_e)which, &stats);
+		printf("%-18s %8u keys %9u conversations %9u slots %10lu bytes\n",
+		    index_names[which], stats.keys, stats.conversations, stats.slots,
+		    (unsigned long)stats.bytes);
+		index_bytes += stats.bytes;
+		n_conversations += stats.conversations;
+	}
+
+	printf("%u packets, %u tuples, 1 in %u packets reuses ports\n",
+	    n_packets, n_tuples, reuse);
+	printf("first pass:  %.0f lookups/s\n", n_packets / first_pass);
+	printf("second pass: %.0f lookups/s\n", n_packets / second_pass);
+	if (n_conversations != 0) {
+		j = (guint)(sizeof (conversation_t) + sizeof (conversation_key) + 2 * 4);
+		printf("%u conversations, %u bytes each plus %.1f bytes of index\n",
+		    n_conversations, j, (double)index_bytes / n_conversations);
+	}
+
+	g_free(packet_conv);
+	g_free(packet_tuple);
+	g_free(tuples);
+	g_rand_free(rand);
+
+	conversation_cleanup();
+	wmem_leave_file_scope();
+	wmem_cleanup();
+
+	if (mismatches != 0) {
+		printf("FAILURE: %u packets found the wrong conversation\n", mismatches);
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
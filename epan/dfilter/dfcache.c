@@ -0,0 +1,848 @@
+/*
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <wsutil/file_util.h>
+#include <wsutil/tempfile.h>
+
+#include "dfcache.h"
+#include "dfilter-int.h"
+
+#include <ftypes/ftypes-int.h>
+
+/* How the values of a field are kept in a record.  Each field that's
+ * in the frame has a byte with the number of its slot, two bytes with
+ * the number of times it's in the frame, and that many values; the
+ * frames that the frame depends on are kept in the same way, under
+ * DEPENDENTS_TAG, as four-byte frame numbers.  Values are kept in
+ * native byte order, as the records don't outlive the process. */
+typedef enum {
+	KIND_NONE,		/* can't be kept */
+	KIND_PRESENCE,		/* protocol, or field without a value; no values */
+	KIND_INTEGER,		/* 4 bytes, "uinteger" member */
+	KIND_INTEGER64,		/* 8 bytes, "integer64" member */
+	KIND_FLOATING,		/* 8 bytes */
+	KIND_TIME,		/* 8 bytes of seconds, 4 of nanoseconds */
+	KIND_IPv4,		/* 4 bytes of address, 4 of netmask */
+	KIND_IPv6,		/* 16 bytes of address, 4 of prefix */
+	KIND_GUID,		/* sizeof (e_guid_t) bytes */
+	KIND_STRING,		/* 4 bytes of length, then the string */
+	KIND_BYTES		/* 4 bytes of length, then the bytes */
+} value_kind_t;
+
+#define DEPENDENTS_TAG	0xff
+
+typedef struct {
+	int		hfid;
+	ftenum_t	ftype;
+	value_kind_t	kind;
+	GPtrArray	*pool;		/* fvalues that values are decoded into */
+	/* While a filter is being applied: */
+	const guint8	*values;	/* where the values start in the record */
+	guint		count;		/* and how many there are */
+} slot_t;
+
+typedef struct {
+	guint64		location;	/* offset in memory, or RECORD_IN_FILE and offset in the file */
+	guint32		length;
+	gboolean	stored;
+} record_t;
+
+#define RECORD_IN_FILE	G_GUINT64_CONSTANT(0x8000000000000000)
+
+/* Records are kept in memory in blocks of this size; a record isn't
+ * split between blocks. */
+#define CHUNK_SIZE	(256 * 1024)
+
+struct _dfcache {
+	slot_t		slots[DFCACHE_MAX_FIELDS];
+	guint		n_slots;
+	GHashTable	*slot_of_hfid;	/* hfid -> slot number + 1 */
+	GHashTable	*uses;		/* hfid -> number of filters that looked at it */
+	int		proto_frame;
+	GArray		*records;	/* record_t of each frame, by frame number - 1 */
+	GPtrArray	*chunks;	/* blocks of CHUNK_SIZE bytes */
+	gsize		chunk_used;	/* bytes used of the last block */
+	gsize		memory_limit;
+	int		fd;		/* temporary file for the records beyond the limit, or -1 */
+	char		*filename;
+	guint64		file_size;
+	gboolean	file_failed;	/* couldn't create it or write to it */
+	GByteArray	*buf;		/* record being built, or read from the file */
+	/* While a filter is being applied: */
+	const guint8	*dependents;
+	guint		n_dependents;
+};
+
+/* Fields of the "frame" protocol whose values can't change without the
+ * frame being dissected again. */
+static const char *stable_frame_fields[] = {
+	"frame.number",
+	"frame.len",
+	"frame.cap_len",
+	"frame.protocols",
+	"frame.encap_type",
+	"frame.interface_id",
+	NULL
+};
+
+/* Fields that are kept, if there's room for them, before any filter
+ * has looked at them. */
+static const char *default_fields[] = {
+	"frame.len",
+	"frame.protocols",
+	"eth.addr",
+	"ip.addr",
+	"ip.src",
+	"ip.dst",
+	"ipv6.addr",
+	"tcp.port",
+	"udp.port",
+	"ip",
+	"ipv6",
+	"tcp",
+	"udp",
+	"arp",
+	"icmp",
+	"dns",
+	"http",
+	NULL
+};
+
+static value_kind_t
+field_kind(const dfcache_t *cache, const header_field_info *hfinfo)
+{
+	const char	**name;
+
+	if (hfinfo->parent != -1 && hfinfo->parent == cache->proto_frame) {
+		for (name = stable_frame_fields; *name != NULL; name++) {
+			if (strcmp(hfinfo->abbrev, *name) == 0)
+				break;
+		}
+		if (*name == NULL)
+			return KIND_NONE;
+	}
+
+	switch (hfinfo->type) {
+		case FT_PROTOCOL:
+		case FT_NONE:
+			return KIND_PRESENCE;
+
+		case FT_BOOLEAN:
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+		case FT_IPXNET:
+		case FT_FRAMENUM:
+			return KIND_INTEGER;
+
+		case FT_UINT40:
+		case FT_UINT48:
+		case FT_UINT56:
+		case FT_UINT64:
+		case FT_INT40:
+		case FT_INT48:
+		case FT_INT56:
+		case FT_INT64:
+		case FT_EUI64:
+			return KIND_INTEGER64;
+
+		case FT_FLOAT:
+		case FT_DOUBLE:
+			return KIND_FLOATING;
+
+		case FT_ABSOLUTE_TIME:
+		case FT_RELATIVE_TIME:
+			return KIND_TIME;
+
+		case FT_IPv4:
+			return KIND_IPv4;
+
+		case FT_IPv6:
+			return KIND_IPv6;
+
+		case FT_GUID:
+			return KIND_GUID;
+
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+			return KIND_STRING;
+
+		case FT_ETHER:
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_OID:
+		case FT_AX25:
+		case FT_VINES:
+		case FT_REL_OID:
+		case FT_SYSTEM_ID:
+		case FT_FCWWN:
+			return KIND_BYTES;
+
+		default:
+			return KIND_NONE;
+	}
+}
+
+static void
+append_value(GByteArray *buf, value_kind_t kind, const fvalue_t *fv)
+{
+	gint64	secs;
+	guint32	u32;
+
+	switch (kind) {
+		case KIND_INTEGER:
+			g_byte_array_append(buf, (const guint8 *)&fv->value.uinteger, 4);
+			break;
+
+		case KIND_INTEGER64:
+			g_byte_array_append(buf, (const guint8 *)&fv->value.integer64, 8);
+			break;
+
+		case KIND_FLOATING:
+			g_byte_array_append(buf, (const guint8 *)&fv->value.floating, 8);
+			break;
+
+		case KIND_TIME:
+			secs = (gint64)fv->value.time.secs;
+			u32 = (guint32)fv->value.time.nsecs;
+			g_byte_array_append(buf, (const guint8 *)&secs, 8);
+			g_byte_array_append(buf, (const guint8 *)&u32, 4);
+			break;
+
+		case KIND_IPv4:
+			g_byte_array_append(buf, (const guint8 *)&fv->value.ipv4.addr, 4);
+			g_byte_array_append(buf, (const guint8 *)&fv->value.ipv4.nmask, 4);
+			break;
+
+		case KIND_IPv6:
+			u32 = fv->value.ipv6.prefix;
+			g_byte_array_append(buf, fv->value.ipv6.addr.bytes, 16);
+			g_byte_array_append(buf, (const guint8 *)&u32, 4);
+			break;
+
+		case KIND_GUID:
+			g_byte_array_append(buf, (const guint8 *)&fv->value.guid, sizeof(e_guid_t));
+			break;
+
+		case KIND_STRING:
+			u32 = fv->value.string ? (guint32)strlen(fv->value.string) : 0;
+			g_byte_array_append(buf, (const guint8 *)&u32, 4);
+			g_byte_array_append(buf, (const guint8 *)fv->value.string, u32);
+			break;
+
+		case KIND_BYTES:
+			u32 = fv->value.bytes ? fv->value.bytes->len : 0;
+			g_byte_array_append(buf, (const guint8 *)&u32, 4);
+			if (u32 != 0)
+				g_byte_array_append(buf, fv->value.bytes->data, u32);
+			break;
+
+		default:
+			g_assert_not_reached();
+	}
+}
+
+/* Size of a value in a record. */
+static gsize
+value_size(value_kind_t kind, const guint8 *p)
+{
+	guint32	u32;
+
+	switch (kind) {
+		case KIND_INTEGER:
+			return 4;
+		case KIND_INTEGER64:
+		case KIND_FLOATING:
+		case KIND_IPv4:
+			return 8;
+		case KIND_TIME:
+			return 12;
+		case KIND_IPv6:
+			return 20;
+		case KIND_GUID:
+			return sizeof(e_guid_t);
+		case KIND_STRING:
+		case KIND_BYTES:
+			memcpy(&u32, p, 4);
+			return 4 + (gsize)u32;
+		default:
+			g_assert_not_reached();
+			return 0;
+	}
+}
+
+/* Sets fv, which is of the slot's ftype, to a value in a record. */
+static void
+decode_value(value_kind_t kind, fvalue_t *fv, const guint8 *p)
+{
+	gint64	secs;
+	guint32	u32;
+
+	switch (kind) {
+		case KIND_INTEGER:
+			memcpy(&fv->value.uinteger, p, 4);
+			break;
+
+		case KIND_INTEGER64:
+			memcpy(&fv->value.integer64, p, 8);
+			break;
+
+		case KIND_FLOATING:
+			memcpy(&fv->value.floating, p, 8);
+			break;
+
+		case KIND_TIME:
+			memcpy(&secs, p, 8);
+			memcpy(&u32, p + 8, 4);
+			fv->value.time.secs = (time_t)secs;
+			fv->value.time.nsecs = (int)u32;
+			break;
+
+		case KIND_IPv4:
+			memcpy(&fv->value.ipv4.addr, p, 4);
+			memcpy(&fv->value.ipv4.nmask, p + 4, 4);
+			break;
+
+		case KIND_IPv6:
+			memcpy(fv->value.ipv6.addr.bytes, p, 16);
+			memcpy(&u32, p + 16, 4);
+			fv->value.ipv6.prefix = u32;
+			break;
+
+		case KIND_GUID:
+			memcpy(&fv->value.guid, p, sizeof(e_guid_t));
+			break;
+
+		case KIND_STRING:
+			memcpy(&u32, p, 4);
+			g_free(fv->value.string);
+			fv->value.string = g_strndup((const gchar *)p + 4, u32);
+			break;
+
+		case KIND_BYTES:
+			memcpy(&u32, p, 4);
+			if (fv->value.bytes == NULL)
+				fv->value.bytes = g_byte_array_new();
+			g_byte_array_set_size(fv->value.bytes, 0);
+			g_byte_array_append(fv->value.bytes, p + 4, u32);
+			break;
+
+		default:
+			g_assert_not_reached();
+	}
+}
+
+static slot_t *
+find_slot(const dfcache_t *cache, int hfid)
+{
+	guint	n;
+
+	n = GPOINTER_TO_UINT(g_hash_table_lookup(cache->slot_of_hfid, GINT_TO_POINTER(hfid)));
+	return n != 0 ? (slot_t *)&cache->slots[n - 1] : NULL;
+}
+
+static void
+free_slots(dfcache_t *cache)
+{
+	slot_t	*slot;
+	guint	i, j;
+
+	for (i = 0; i < cache->n_slots; i++) {
+		slot = &cache->slots[i];
+		for (j = 0; j < slot->pool->len; j++) {
+			FVALUE_FREE((fvalue_t *)g_ptr_array_index(slot->pool, j));
+		}
+		g_ptr_array_free(slot->pool, TRUE);
+	}
+	cache->n_slots = 0;
+	g_hash_table_remove_all(cache->slot_of_hfid);
+}
+
+/* Keeps a field and the others with the same name, if there's room. */
+static void
+add_field(dfcache_t *cache, header_field_info *hfinfo)
+{
+	slot_t		*slot;
+	value_kind_t	kind;
+
+	for (; hfinfo != NULL; hfinfo = hfinfo->same_name_next) {
+		if (cache->n_slots == DFCACHE_MAX_FIELDS)
+			return;
+		if (find_slot(cache, hfinfo->id) != NULL)
+			continue;
+		kind = field_kind(cache, hfinfo);
+		if (kind == KIND_NONE)
+			continue;
+
+		slot = &cache->slots[cache->n_slots++];
+		slot->hfid = hfinfo->id;
+		slot->ftype = hfinfo->type;
+		slot->kind = kind;
+		slot->pool = g_ptr_array_new();
+		slot->values = NULL;
+		slot->count = 0;
+		g_hash_table_insert(cache->slot_of_hfid, GINT_TO_POINTER(hfinfo->id),
+			GUINT_TO_POINTER(cache->n_slots));
+	}
+}
+
+typedef struct {
+	int	hfid;
+	guint	uses;
+} field_uses_t;
+
+static gint
+compare_uses(gconstpointer a, gconstpointer b)
+{
+	const field_uses_t	*fa = (const field_uses_t *)a;
+	const field_uses_t	*fb = (const field_uses_t *)b;
+
+	if (fa->uses != fb->uses)
+		return fa->uses > fb->uses ? -1 : 1;
+	return fa->hfid - fb->hfid;
+}
+
+/* Chooses the fields to keep: the ones "wanted", then the ones the
+ * most filters have looked at, then the default ones. */
+static void
+choose_fields(dfcache_t *cache, GHashTable *wanted)
+{
+	GHashTableIter		iter;
+	gpointer		key, value;
+	GArray			*by_uses;
+	field_uses_t		fu;
+	header_field_info	*hfinfo;
+	const char		**name;
+	guint			i;
+
+	free_slots(cache);
+	dfcache_clear(cache);
+
+	g_hash_table_iter_init(&iter, wanted);
+	while (g_hash_table_iter_next(&iter, &key, NULL)) {
+		add_field(cache, proto_registrar_get_nth(GPOINTER_TO_INT(key)));
+	}
+
+	by_uses = g_array_new(FALSE, FALSE, sizeof(field_uses_t));
+	g_hash_table_iter_init(&iter, cache->uses);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		fu.hfid = GPOINTER_TO_INT(key);
+		fu.uses = GPOINTER_TO_UINT(value);
+		g_array_append_val(by_uses, fu);
+	}
+	g_array_sort(by_uses, compare_uses);
+	for (i = 0; i < by_uses->len; i++) {
+		add_field(cache, proto_registrar_get_nth(g_array_index(by_uses, field_uses_t, i).hfid));
+	}
+	g_array_free(by_uses, TRUE);
+
+	for (name = default_fields; *name != NULL; name++) {
+		hfinfo = proto_registrar_get_byname(*name);
+		if (hfinfo != NULL)
+			add_field(cache, hfinfo);
+	}
+}
+
+dfcache_t *
+dfcache_new(void)
+{
+	dfcache_t	*cache;
+
+	cache = g_new0(dfcache_t, 1);
+	cache->slot_of_hfid = g_hash_table_new(g_direct_hash, g_direct_equal);
+	cache->uses = g_hash_table_new(g_direct_hash, g_direct_equal);
+	cache->proto_frame = proto_get_id_by_filter_name("frame");
+	cache->records = g_array_new(FALSE, TRUE, sizeof(record_t));
+	cache->chunks = g_ptr_array_new();
+	cache->fd = -1;
+	cache->buf = g_byte_array_new();
+
+	return cache;
+}
+
+void
+dfcache_free(dfcache_t *cache)
+{
+	dfcache_clear(cache);
+	free_slots(cache);
+	g_hash_table_destroy(cache->slot_of_hfid);
+	g_hash_table_destroy(cache->uses);
+	g_array_free(cache->records, TRUE);
+	g_ptr_array_free(cache->chunks, TRUE);
+	if (cache->fd != -1) {
+		ws_close(cache->fd);
+		ws_unlink(cache->filename);
+	}
+	g_free(cache->filename);
+	g_byte_array_free(cache->buf, TRUE);
+	g_free(cache);
+}
+
+void
+dfcache_set_memory_limit(dfcache_t *cache, gsize memory_limit)
+{
+	cache->memory_limit = memory_limit;
+}
+
+void
+dfcache_clear(dfcache_t *cache)
+{
+	guint	i;
+
+	for (i = 0; i < cache->chunks->len; i++) {
+		g_free(g_ptr_array_index(cache->chunks, i));
+	}
+	g_ptr_array_set_size(cache->chunks, 0);
+	cache->chunk_used = 0;
+
+	/* The file is kept, and written over */
+	cache->file_size = 0;
+	cache->file_failed = FALSE;
+
+	g_array_set_size(cache->records, 0);
+}
+
+void
+dfcache_forget_frame(dfcache_t *cache, guint32 framenum)
+{
+	if (framenum != 0 && framenum <= cache->records->len)
+		g_array_index(cache->records, record_t, framenum - 1).stored = FALSE;
+}
+
+static void
+note_field(int hfid, gboolean values, gpointer user_data)
+{
+	GHashTable	*wanted = (GHashTable *)user_data;
+
+	/* 1 if only the presence of the field is looked at, 2 if its
+	 * values are */
+	if (values || g_hash_table_lookup(wanted, GINT_TO_POINTER(hfid)) == NULL)
+		g_hash_table_insert(wanted, GINT_TO_POINTER(hfid), GINT_TO_POINTER(values ? 2 : 1));
+}
+
+gboolean
+dfcache_use_filter(dfcache_t *cache, const dfilter_t *df)
+{
+	GHashTable	*wanted;
+	GHashTableIter	iter;
+	gpointer	key, value;
+	gboolean	values, covered = TRUE, keepable = TRUE;
+	slot_t		*slot;
+	value_kind_t	kind;
+	guint		uses;
+
+	wanted = g_hash_table_new(g_direct_hash, g_direct_equal);
+	dfilter_foreach_field(df, note_field, wanted);
+
+	g_hash_table_iter_init(&iter, wanted);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		values = GPOINTER_TO_INT(value) == 2;
+
+		uses = GPOINTER_TO_UINT(g_hash_table_lookup(cache->uses, key));
+		g_hash_table_insert(cache->uses, key, GUINT_TO_POINTER(uses + 1));
+
+		slot = find_slot(cache, GPOINTER_TO_INT(key));
+		if (slot == NULL || (values && slot->kind == KIND_PRESENCE))
+			covered = FALSE;
+
+		kind = field_kind(cache, proto_registrar_get_nth(GPOINTER_TO_INT(key)));
+		if (kind == KIND_NONE || (values && kind == KIND_PRESENCE))
+			keepable = FALSE;
+	}
+
+	/* If the filter looks at fields that can't be kept, there's no
+	 * point in throwing away what's kept for its sake. */
+	if (!covered && keepable && g_hash_table_size(wanted) <= DFCACHE_MAX_FIELDS)
+		choose_fields(cache, wanted);
+
+	g_hash_table_destroy(wanted);
+	return covered;
+}
+
+void
+dfcache_prime(const dfcache_t *cache, epan_dissect_t *edt)
+{
+	guint	i;
+
+	for (i = 0; i < cache->n_slots; i++) {
+		proto_tree_prime_hfid(edt->tree, cache->slots[i].hfid);
+	}
+}
+
+static gboolean
+write_to_file(dfcache_t *cache, const guint8 *data, guint32 length)
+{
+	char	*name;
+
+	if (cache->file_failed)
+		return FALSE;
+
+	if (cache->fd == -1) {
+		cache->fd = create_tempfile(&name, "wireshark_dfcache");
+		if (cache->fd == -1) {
+			cache->file_failed = TRUE;
+			return FALSE;
+		}
+		cache->filename = g_strdup(name);
+	}
+
+	if (ws_lseek64(cache->fd, cache->file_size, SEEK_SET) == -1 ||
+	    ws_write(cache->fd, data, length) != (int)length) {
+		cache->file_failed = TRUE;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static void
+put_record(dfcache_t *cache, guint32 framenum, const guint8 *data, guint32 length)
+{
+	record_t	rec;
+	gsize		n_chunks = cache->chunks->len;
+
+	rec.length = length;
+	rec.stored = TRUE;
+
+	if (length == 0) {
+		rec.location = 0;
+	}
+	else if (length <= CHUNK_SIZE &&
+	    ((n_chunks != 0 && cache->chunk_used + length <= CHUNK_SIZE) ||
+	     (n_chunks + 1) * CHUNK_SIZE <= cache->memory_limit)) {
+		if (n_chunks == 0 || cache->chunk_used + length > CHUNK_SIZE) {
+			g_ptr_array_add(cache->chunks, g_malloc(CHUNK_SIZE));
+			cache->chunk_used = 0;
+			n_chunks++;
+		}
+		memcpy((guint8 *)g_ptr_array_index(cache->chunks, n_chunks - 1) + cache->chunk_used,
+			data, length);
+		rec.location = (guint64)(n_chunks - 1) * CHUNK_SIZE + cache->chunk_used;
+		cache->chunk_used += length;
+	}
+	else {
+		if (!write_to_file(cache, data, length))
+			return;
+		rec.location = RECORD_IN_FILE | cache->file_size;
+		cache->file_size += length;
+	}
+
+	if (framenum > cache->records->len)
+		g_array_set_size(cache->records, framenum);
+	g_array_index(cache->records, record_t, framenum - 1) = rec;
+}
+
+void
+dfcache_store_frame(dfcache_t *cache, guint32 framenum, epan_dissect_t *edt)
+{
+	GByteArray	*buf = cache->buf;
+	GPtrArray	*finfos;
+	GSList		*dep;
+	slot_t		*slot;
+	guint		i, j, len;
+	guint32		u32;
+	guint16		count;
+	guint8		tag;
+
+	if (framenum == 0 || edt->tree == NULL || cache->n_slots == 0)
+		return;
+	if (framenum <= cache->records->len &&
+	    g_array_index(cache->records, record_t, framenum - 1).stored)
+		return;
+
+	g_byte_array_set_size(buf, 0);
+	for (i = 0; i < cache->n_slots; i++) {
+		slot = &cache->slots[i];
+		finfos = proto_get_finfo_ptr_array(edt->tree, slot->hfid);
+		len = finfos != NULL ? g_ptr_array_len(finfos) : 0;
+		if (len == 0)
+			continue;
+		if (len > G_MAXUINT16)
+			return;	/* too many to keep */
+
+		tag = (guint8)i;
+		count = (guint16)len;
+		g_byte_array_append(buf, &tag, 1);
+		g_byte_array_append(buf, (const guint8 *)&count, 2);
+		if (slot->kind == KIND_PRESENCE)
+			continue;
+		for (j = 0; j < len; j++) {
+			append_value(buf, slot->kind,
+				&((field_info *)g_ptr_array_index(finfos, j))->value);
+		}
+	}
+
+	len = g_slist_length(edt->pi.dependent_frames);
+	if (len > G_MAXUINT16)
+		return;
+	if (len != 0) {
+		tag = DEPENDENTS_TAG;
+		count = (guint16)len;
+		g_byte_array_append(buf, &tag, 1);
+		g_byte_array_append(buf, (const guint8 *)&count, 2);
+		for (dep = edt->pi.dependent_frames; dep != NULL; dep = dep->next) {
+			u32 = GPOINTER_TO_UINT(dep->data);
+			g_byte_array_append(buf, (const guint8 *)&u32, 4);
+		}
+	}
+
+	put_record(cache, framenum, buf->data, buf->len);
+}
+
+static gboolean
+source_exists(int hfid, gpointer data)
+{
+	slot_t	*slot = find_slot((dfcache_t *)data, hfid);
+
+	return slot != NULL && slot->count != 0;
+}
+
+static void
+source_read(int hfid, GPtrArray *fvalues, gpointer data)
+{
+	slot_t		*slot = find_slot((dfcache_t *)data, hfid);
+	const guint8	*p;
+	fvalue_t	*fv;
+	guint		i;
+
+	if (slot == NULL || slot->kind == KIND_PRESENCE)
+		return;
+
+	while (slot->pool->len < slot->count) {
+		g_ptr_array_add(slot->pool, fvalue_new(slot->ftype));
+	}
+	p = slot->values;
+	for (i = 0; i < slot->count; i++) {
+		fv = (fvalue_t *)g_ptr_array_index(slot->pool, i);
+		decode_value(slot->kind, fv, p);
+		g_ptr_array_add(fvalues, fv);
+		p += value_size(slot->kind, p);
+	}
+}
+
+/* Finds where the values of each field, and the frames the frame
+ * depends on, are in a record. */
+static void
+parse_record(dfcache_t *cache, const guint8 *p, guint32 length)
+{
+	const guint8	*end = p + length;
+	slot_t		*slot;
+	guint16		count;
+	guint		i;
+
+	for (i = 0; i < cache->n_slots; i++) {
+		cache->slots[i].count = 0;
+	}
+	cache->n_dependents = 0;
+
+	while (p < end) {
+		memcpy(&count, p + 1, 2);
+		if (*p == DEPENDENTS_TAG) {
+			cache->dependents = p + 3;
+			cache->n_dependents = count;
+			p += 3 + 4 * (gsize)count;
+			continue;
+		}
+
+		slot = &cache->slots[*p];
+		p += 3;
+		slot->values = p;
+		slot->count = count;
+		if (slot->kind != KIND_PRESENCE) {
+			for (i = 0; i < count; i++) {
+				p += value_size(slot->kind, p);
+			}
+		}
+	}
+}
+
+gboolean
+dfcache_apply(dfcache_t *cache, guint32 framenum, dfilter_t *df,
+		GFunc dependent_func, gpointer user_data, gboolean *passed)
+{
+	const record_t		*rec;
+	const guint8		*data;
+	dfilter_field_source_t	source;
+	guint32			u32;
+	guint			i;
+
+	if (framenum == 0 || framenum > cache->records->len)
+		return FALSE;
+	rec = &g_array_index(cache->records, record_t, framenum - 1);
+	if (!rec->stored)
+		return FALSE;
+
+	if (rec->length == 0) {
+		data = NULL;
+	}
+	else if (!(rec->location & RECORD_IN_FILE)) {
+		data = (const guint8 *)g_ptr_array_index(cache->chunks, rec->location / CHUNK_SIZE) +
+			rec->location % CHUNK_SIZE;
+	}
+	else {
+		g_byte_array_set_size(cache->buf, rec->length);
+		if (ws_lseek64(cache->fd, rec->location & ~RECORD_IN_FILE, SEEK_SET) == -1 ||
+		    ws_read(cache->fd, cache->buf->data, rec->length) != (int)rec->length)
+			return FALSE;
+		data = cache->buf->data;
+	}
+	parse_record(cache, data, rec->length);
+
+	source.exists = source_exists;
+	source.read = source_read;
+	source.data = cache;
+	*passed = dfilter_apply_fields(df, &source);
+
+	if (*passed && dependent_func != NULL) {
+		for (i = 0; i < cache->n_dependents; i++) {
+			memcpy(&u32, cache->dependents + 4 * i, 4);
+			dependent_func(GUINT_TO_POINTER(u32), user_data);
+		}
+	}
+	return TRUE;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,114 @@
+/*
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DFCACHE_H
+#define DFCACHE_H
+
+#include <glib.h>
+#include "ws_symbol_export.h"
+
+#include <epan/epan_dissect.h>
+#include <epan/dfilter/dfilter.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* A cache of the values that the fields display filters use most had
+ * in each frame of a capture file, so that a filter that looks only at
+ * those fields can be applied to a frame without dissecting it again.
+ *
+ * The fields are chosen by how many of the filters that have been
+ * applied used them, along with a few that are commonly filtered on,
+ * such as the addresses and ports.  Fields of the "frame" protocol whose
+ * values can change without the frame being dissected again, such as
+ * frame.marked or frame.time_relative, are never kept.
+ *
+ * The values of a frame are kept as one record; up to a limit, the
+ * records are kept in memory, and beyond it they are written to a
+ * temporary file. */
+typedef struct _dfcache dfcache_t;
+
+/* Most fields whose values are kept. */
+#define DFCACHE_MAX_FIELDS	32
+
+WS_DLL_PUBLIC
+dfcache_t *
+dfcache_new(void);
+
+WS_DLL_PUBLIC
+void
+dfcache_free(dfcache_t *cache);
+
+/* Sets how many bytes of records are kept in memory; it applies to
+ * records stored from then on. */
+WS_DLL_PUBLIC
+void
+dfcache_set_memory_limit(dfcache_t *cache, gsize memory_limit);
+
+/* Forgets the values of every frame, e.g. because the frames are being
+ * dissected again from scratch. */
+WS_DLL_PUBLIC
+void
+dfcache_clear(dfcache_t *cache);
+
+/* Forgets the values of one frame, e.g. because it's been ignored. */
+WS_DLL_PUBLIC
+void
+dfcache_forget_frame(dfcache_t *cache, guint32 framenum);
+
+/* Notes that df is being applied to the frames.  Returns TRUE if the
+ * cache keeps every field that df looks at, so that df can be applied
+ * with dfcache_apply() to the frames whose values have been stored.
+ * Otherwise, if all of df's fields can be kept, the fields to keep are
+ * chosen again, including those of df, and all the frames are
+ * forgotten. */
+WS_DLL_PUBLIC
+gboolean
+dfcache_use_filter(dfcache_t *cache, const dfilter_t *df);
+
+/* Prime a proto_tree with the fields that the cache keeps, before
+ * dissecting a frame to store with dfcache_store_frame(). */
+WS_DLL_PUBLIC
+void
+dfcache_prime(const dfcache_t *cache, epan_dissect_t *edt);
+
+/* Stores the values of the fields of a dissected frame, if they aren't
+ * stored already; edt must have been primed with dfcache_prime(). */
+WS_DLL_PUBLIC
+void
+dfcache_store_frame(dfcache_t *cache, guint32 framenum, epan_dissect_t *edt);
+
+/* Applies df to the stored values of a frame, setting *passed to the
+ * result; if the frame passes, dependent_func is called for each of
+ * the frames it depends on, with the frame number as a GUINT_TO_POINTER
+ * and user_data, as for the dependent_frames of its packet_info.
+ * Returns FALSE if the values of the frame aren't stored, in which case
+ * the frame has to be dissected. */
+WS_DLL_PUBLIC
+gboolean
+dfcache_apply(dfcache_t *cache, guint32 framenum, dfilter_t *df,
+		GFunc dependent_func, gpointer user_data, gboolean *passed);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
@@ -27,17 +27,50 @@
 #include <epan/proto.h>
 #include <stdio.h>
 
+/* Where dfilter_apply_fields() gets the fields of a packet from,
+ * instead of from a proto_tree. */
+typedef struct {
+	/* Is the field or protocol in the packet? */
+	gboolean (*exists)(int hfid, gpointer data);
+	/* Append the values of the field in the packet to fvalues, as
+	 * fvalue_t pointers that stay valid until the dfilter has been
+	 * applied. */
+	void (*read)(int hfid, GPtrArray *fvalues, gpointer data);
+	gpointer data;
+} dfilter_field_source_t;
+
+/* Apply compiled dfilter to the fields that "source" has; it's asked
+ * only about the fields that dfilter_foreach_field() reports. */
+gboolean
+dfilter_apply_fields(dfilter_t *df, const dfilter_field_source_t *source);
+
+typedef void (*dfilter_field_func)(int hfid, gboolean values, gpointer user_data);
+
+/* Calls func for each field or protocol that df looks at, with
+ * "values" FALSE if df only checks whether it's in the packet, and
+ * TRUE if it looks at its values.  A field may be reported more than
+ * once. */
+void
+dfilter_foreach_field(const dfilter_t *df, dfilter_field_func func, gpointer user_data);
+
 /* Passed back to user */
 struct epan_dfilter {
 	GPtrArray	*insns;
 	GPtrArray	*consts;
 	guint		num_registers;
 	guint		max_registers;
-	GList		**registers;
+	GPtrArray	**registers;
 	gboolean	*attempted_load;
+	gboolean	*free_registers;
 	int		*interesting_fields;
 	int		num_interesting_fields;
 	GPtrArray	*deprecated;
+	GPtrArray	*optimizations;
+	guint32		*results;	/* batch: bitmap of the filters that matched */
+	const guint32	*wanted;	/* batch: bitmap of the filters to run, or NULL to run them all */
+	struct _dfvm_cinsn *code;	/* insns specialized by dfvm_specialize(), or NULL */
+	GPtrArray	*conjuncts;	/* the top-level "&&"ed tests, written out for dfilter_refines(), or NULL */
+	const dfilter_field_source_t *source;	/* where dfilter_apply_fields() reads fields from */
 };
 
 typedef struct {
@@ -53,6 +86,7 @@ typedef struct {
 	int		next_const_id;
 	int		next_register;
 	int		first_constant; /* first register used as a constant */
+	GPtrArray	*optimizations; /* descriptions of what the optimizer did */
 } dfwork_t;
 
 /*
@@ -21,13 +21,19 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "dfilter-int.h"
 #include "syntax-tree.h"
 #include "gencode.h"
+#include "optimize.h"
 #include "semcheck.h"
 #include "dfvm.h"
+#include "sttype-test.h"
+#include "sttype-range.h"
+#include "sttype-set.h"
+#include <ftypes/ftypes-int.h>
 #include <epan/epan_dissect.h>
 #include "dfilter.h"
 #include "dfilter-macro.h"
@@ -42,6 +48,14 @@ int     df_lex(void);
 /* Holds the singular instance of our Lemon parser object */
 static void*	ParserObj = NULL;
 
+/* FALSE if the WIRESHARK_DFILTER_NO_OPTIMIZE environment variable was
+ * set when we were initialized */
+static gboolean	optimize_filters = TRUE;
+
+/* FALSE if the WIRESHARK_DFILTER_INTERPRET environment variable was
+ * set when we were initialized */
+static gboolean	specialize_filters = TRUE;
+
 /*
  * XXX - if we're using a version of Flex that supports reentrant lexical
  * analyzers, we should put this into the lexical analyzer's state.
@@ -86,6 +100,14 @@ dfilter_init(void)
 	sttype_init();
 
 	dfilter_macro_init();
+
+	/* Filters can be compiled as written, without optimizing them,
+	 * so that the optimizer can be checked against that */
+	optimize_filters = getenv("WIRESHARK_DFILTER_NO_OPTIMIZE") == NULL;
+
+	/* They can also be run in the interpreter rather than as
+	 * specialized code, so that that can be checked against it */
+	specialize_filters = getenv("WIRESHARK_DFILTER_INTERPRET") == NULL;
 }
 
 /* Clean-up the dfilter module */
@@ -128,6 +150,17 @@ free_insns(GPtrArray *insns)
 	g_ptr_array_free(insns, TRUE);
 }
 
+static void
+free_string_array(GPtrArray *array)
+{
+	guint i;
+
+	for (i = 0; i < array->len; i++) {
+		g_free(g_ptr_array_index(array, i));
+	}
+	g_ptr_array_free(array, TRUE);
+}
+
 void
 dfilter_free(dfilter_t *df)
 {
@@ -145,11 +178,11 @@ dfilter_free(dfilter_t *df)
 
 	g_free(df->interesting_fields);
 
+	dfvm_free_code(df);
+
 	/* clear registers */
 	for (i = 0; i < df->max_registers; i++) {
-		if (df->registers[i]) {
-			g_list_free(df->registers[i]);
-		}
+		g_ptr_array_free(df->registers[i], TRUE);
 	}
 
 	if (df->deprecated) {
@@ -160,11 +193,39 @@ dfilter_free(dfilter_t *df)
 		g_ptr_array_free(df->deprecated, TRUE);
 	}
 
+	if (df->optimizations) {
+		free_string_array(df->optimizations);
+	}
+
+	if (df->conjuncts) {
+		free_string_array(df->conjuncts);
+	}
+
 	g_free(df->registers);
 	g_free(df->attempted_load);
+	g_free(df->free_registers);
+	g_free(df->results);
 	g_free(df);
 }
 
+/* Allocate the run-time space for a dfilter_t whose registers below
+ * num_registers are loaded for each packet, and whose registers from
+ * there to max_registers hold constants. */
+static void
+dfilter_init_registers(dfilter_t *df, guint num_registers, guint max_registers)
+{
+	guint i;
+
+	df->num_registers = num_registers;
+	df->max_registers = max_registers;
+	df->registers = g_new(GPtrArray*, df->max_registers);
+	for (i = 0; i < df->max_registers; i++) {
+		df->registers[i] = g_ptr_array_new();
+	}
+	df->attempted_load = g_new0(gboolean, df->max_registers);
+	df->free_registers = g_new0(gboolean, df->max_registers);
+}
+
 
 static dfwork_t*
 dfwork_new(void)
@@ -200,6 +261,10 @@ dfwork_free(dfwork_t *dfw)
 		free_insns(dfw->consts);
 	}
 
+	if (dfw->optimizations) {
+		free_string_array(dfw->optimizations);
+	}
+
 	/*
 	 * We don't free the error message string; our caller will return
 	 * it to its caller.
@@ -207,6 +272,160 @@ dfwork_free(dfwork_t *dfw)
 	g_free(dfw);
 }
 
+/* Write out a constant so that two constants are written out the same
+ * way only if they're the same.  The display filter representation of
+ * an address leaves out its netmask or prefix, and that of a
+ * floating-point number may be rounded. */
+static gboolean
+fvalue_signature(GString *sig, fvalue_t *fv)
+{
+	char	*repr;
+
+	g_string_append_printf(sig, "%s:", fvalue_type_name(fv));
+	switch (fvalue_type_ftenum(fv)) {
+		case FT_FLOAT:
+		case FT_DOUBLE:
+			g_string_append_printf(sig, "%a", fv->value.floating);
+			return TRUE;
+		default:
+			break;
+	}
+
+	repr = fvalue_to_string_repr(fv, FTREPR_DFILTER, BASE_NONE, NULL);
+	if (repr == NULL)
+		return FALSE;
+	g_string_append(sig, repr);
+	g_free(repr);
+
+	if (fvalue_type_ftenum(fv) == FT_IPv4)
+		g_string_append_printf(sig, "/%08x", fv->value.ipv4.nmask);
+	else if (fvalue_type_ftenum(fv) == FT_IPv6)
+		g_string_append_printf(sig, "/%u", fv->value.ipv6.prefix);
+	return TRUE;
+}
+
+static void
+drange_node_signature(gpointer data, gpointer user_data)
+{
+	drange_node	*drnode = (drange_node *)data;
+	GString		*sig = (GString *)user_data;
+
+	switch (drange_node_get_ending(drnode)) {
+		case DRANGE_NODE_END_T_LENGTH:
+			g_string_append_printf(sig, "%d:%d,",
+				drange_node_get_start_offset(drnode),
+				drange_node_get_length(drnode));
+			break;
+		case DRANGE_NODE_END_T_OFFSET:
+			g_string_append_printf(sig, "%d-%d,",
+				drange_node_get_start_offset(drnode),
+				drange_node_get_end_offset(drnode));
+			break;
+		case DRANGE_NODE_END_T_TO_THE_END:
+			g_string_append_printf(sig, "%d:,",
+				drange_node_get_start_offset(drnode));
+			break;
+		default:
+			g_assert_not_reached();
+	}
+}
+
+/* Write out a checked syntax tree in a canonical form.  Returns FALSE
+ * if there's something in it that can't be written out.  Function calls
+ * aren't written out: what a function makes of its arguments is up to
+ * the function, so a filter that calls one is never taken to refine, or
+ * be refined by, another. */
+static gboolean
+node_signature(GString *sig, stnode_t *node)
+{
+	test_op_t	op;
+	stnode_t	*arg1, *arg2;
+	GSList		*p;
+
+	switch (stnode_type_id(node)) {
+		case STTYPE_TEST:
+			sttype_test_get(node, &op, &arg1, &arg2);
+			g_string_append_printf(sig, "(%d", op);
+			if (arg1) {
+				g_string_append_c(sig, ' ');
+				if (!node_signature(sig, arg1))
+					return FALSE;
+			}
+			if (arg2) {
+				g_string_append_c(sig, ' ');
+				if (!node_signature(sig, arg2))
+					return FALSE;
+			}
+			g_string_append_c(sig, ')');
+			return TRUE;
+
+		case STTYPE_FIELD:
+			g_string_append(sig, ((header_field_info *)stnode_data(node))->abbrev);
+			return TRUE;
+
+		case STTYPE_FVALUE:
+			return fvalue_signature(sig, (fvalue_t *)stnode_data(node));
+
+		case STTYPE_RANGE:
+			if (!node_signature(sig, sttype_range_entity(node)))
+				return FALSE;
+			g_string_append_c(sig, '[');
+			drange_foreach_drange_node(sttype_range_drange(node),
+				drange_node_signature, sig);
+			g_string_append_c(sig, ']');
+			return TRUE;
+
+		case STTYPE_SET:
+			g_string_append_c(sig, '{');
+			for (p = sttype_set_members(node); p; p = p->next) {
+				if (!node_signature(sig, (stnode_t *)p->data))
+					return FALSE;
+				g_string_append_c(sig, ',');
+			}
+			g_string_append_c(sig, '}');
+			return TRUE;
+
+		default:
+			return FALSE;
+	}
+}
+
+static gboolean
+add_conjuncts(GPtrArray *conjuncts, stnode_t *node)
+{
+	test_op_t	op;
+	stnode_t	*arg1, *arg2;
+	GString		*sig;
+
+	sttype_test_get(node, &op, &arg1, &arg2);
+	if (op == TEST_OP_AND)
+		return add_conjuncts(conjuncts, arg1) && add_conjuncts(conjuncts, arg2);
+
+	sig = g_string_new("");
+	if (!node_signature(sig, node)) {
+		g_string_free(sig, TRUE);
+		return FALSE;
+	}
+	g_ptr_array_add(conjuncts, g_string_free(sig, FALSE));
+	return TRUE;
+}
+
+/* The tests that are "&&"ed together at the top of a checked syntax
+ * tree, each written out in a canonical form, for dfilter_refines();
+ * NULL if they can't all be written out. */
+static GPtrArray *
+filter_conjuncts(stnode_t *st_root)
+{
+	GPtrArray	*conjuncts;
+
+	conjuncts = g_ptr_array_new();
+	if (!add_conjuncts(conjuncts, st_root)) {
+		free_string_array(conjuncts);
+		return NULL;
+	}
+	return conjuncts;
+}
+
 gboolean
 dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
 {
@@ -218,6 +437,7 @@ dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
 	guint		i;
 	/* XXX, GHashTable */
 	GPtrArray	*deprecated;
+	GPtrArray	*conjuncts;
 
 	g_assert(dfp);
 
@@ -329,6 +549,14 @@ dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
 			goto FAILURE;
 		}
 
+		/* Write out the tests that are "&&"ed together, before the
+		 * optimizer rewrites them */
+		conjuncts = filter_conjuncts(dfw->st_root);
+
+		/* Rewrite the syntax tree into a cheaper equivalent */
+		if (optimize_filters)
+			dfw_optimize(dfw);
+
 		/* Create bytecode */
 		dfw_gencode(dfw);
 
@@ -342,17 +570,25 @@ dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
 			&dfilter->num_interesting_fields);
 
 		/* Initialize run-time space */
-		dfilter->num_registers = dfw->first_constant;
-		dfilter->max_registers = dfw->next_register;
-		dfilter->registers = g_new0(GList*, dfilter->max_registers);
-		dfilter->attempted_load = g_new0(gboolean, dfilter->max_registers);
+		dfilter_init_registers(dfilter, dfw->first_constant,
+			dfw->next_register);
 
 		/* Initialize constants */
 		dfvm_init_const(dfilter);
 
+		/* Specialize the bytecode, which needs the constants */
+		if (specialize_filters)
+			dfvm_specialize(dfilter);
+
 		/* Add any deprecated items */
 		dfilter->deprecated = deprecated;
 
+		/* Note what the optimizer did */
+		dfilter->optimizations = dfw->optimizations;
+		dfw->optimizations = NULL;
+
+		dfilter->conjuncts = conjuncts;
+
 		/* And give it to the user. */
 		*dfp = dfilter;
 	}
@@ -391,6 +627,42 @@ FAILURE:
 }
 
 
+/* Does df have all of the tests that are "&&"ed together in old_df? */
+gboolean
+dfilter_refines(const dfilter_t *df, const dfilter_t *old_df)
+{
+	guint	i, j;
+
+	if (old_df == NULL)
+		return TRUE;
+	if (df == NULL || df->conjuncts == NULL || old_df->conjuncts == NULL)
+		return FALSE;
+
+	for (i = 0; i < old_df->conjuncts->len; i++) {
+		for (j = 0; j < df->conjuncts->len; j++) {
+			if (strcmp((const char *)g_ptr_array_index(old_df->conjuncts, i),
+			    (const char *)g_ptr_array_index(df->conjuncts, j)) == 0)
+				break;
+		}
+		if (j == df->conjuncts->len)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+gboolean
+dfilter_uses_protocol(const dfilter_t *df, int proto_id)
+{
+	int	i, hfid;
+
+	for (i = 0; i < df->num_interesting_fields; i++) {
+		hfid = df->interesting_fields[i];
+		if (hfid == proto_id || proto_registrar_get_parent(hfid) == proto_id)
+			return TRUE;
+	}
+	return FALSE;
+}
+
 gboolean
 dfilter_apply(dfilter_t *df, proto_tree *tree)
 {
@@ -403,6 +675,88 @@ dfilter_apply_edt(dfilter_t *df, epan_dissect_t* edt)
 	return dfvm_apply(df, edt->tree);
 }
 
+gboolean
+dfilter_apply_fields(dfilter_t *df, const dfilter_field_source_t *source)
+{
+	gboolean	passed;
+
+	df->source = source;
+	passed = dfvm_apply(df, NULL);
+	df->source = NULL;
+	return passed;
+}
+
+void
+dfilter_foreach_field(const dfilter_t *df, dfilter_field_func func, gpointer user_data)
+{
+	dfvm_insn_t		*insn;
+	header_field_info	*hfinfo;
+	guint			i;
+
+	for (i = 0; i < df->insns->len; i++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, i);
+		if (insn->op != CHECK_EXISTS && insn->op != READ_TREE)
+			continue;
+		for (hfinfo = insn->arg1->value.hfinfo; hfinfo; hfinfo = hfinfo->same_name_next) {
+			func(hfinfo->id, insn->op == READ_TREE, user_data);
+		}
+	}
+}
+
+static void
+note_protocol_test(int hfid, gboolean values, gpointer user_data)
+{
+	int	*result = (int *)user_data;
+
+	if (values || proto_registrar_get_ftype(hfid) != FT_PROTOCOL)
+		*result = -1;
+	else if (*result == 0)
+		*result = 1;
+}
+
+gboolean
+dfilter_tests_protocols_only(const dfilter_t *df)
+{
+	int	result = 0;	/* no field yet */
+
+	dfilter_foreach_field(df, note_protocol_test, &result);
+	return result == 1;
+}
+
+typedef struct {
+	dfilter_protocol_func	has_protocol;
+	gpointer		user_data;
+} protocol_source_t;
+
+static gboolean
+protocol_source_exists(int hfid, gpointer data)
+{
+	protocol_source_t	*ps = (protocol_source_t *)data;
+
+	return ps->has_protocol(hfid, ps->user_data);
+}
+
+static void
+protocol_source_read(int hfid _U_, GPtrArray *fvalues _U_, gpointer data _U_)
+{
+	/* dfilter_tests_protocols_only() said that nothing is read */
+	g_assert_not_reached();
+}
+
+gboolean
+dfilter_apply_protocols(dfilter_t *df, dfilter_protocol_func has_protocol,
+		gpointer user_data)
+{
+	dfilter_field_source_t	source;
+	protocol_source_t	ps;
+
+	ps.has_protocol = has_protocol;
+	ps.user_data = user_data;
+	source.exists = protocol_source_exists;
+	source.read = protocol_source_read;
+	source.data = &ps;
+	return dfilter_apply_fields(df, &source);
+}
 
 void
 dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree)
@@ -438,6 +792,324 @@ dfilter_dump(dfilter_t *df)
 		}
 		printf("\n");
 	}
+
+	if (df->optimizations && df->optimizations->len) {
+		printf("\nOptimizations:\n");
+		for (i = 0; i < df->optimizations->len; i++) {
+			printf("%s\n", (char *) g_ptr_array_index(df->optimizations, i));
+		}
+	}
+}
+
+
+struct epan_dfilter_batch {
+	GPtrArray	*filters;	/* the dfilter_t's in the batch */
+	gboolean	first_match_only;
+	dfilter_t	*prog;		/* the merged program, built when the
+					   batch is first run */
+};
+
+dfilter_batch_t *
+dfilter_batch_new(gboolean first_match_only)
+{
+	dfilter_batch_t	*batch;
+
+	batch = g_new(dfilter_batch_t, 1);
+	batch->filters = g_ptr_array_new();
+	batch->first_match_only = first_match_only;
+	batch->prog = NULL;
+
+	return batch;
+}
+
+/* The instructions of the merged program share their fvalues, dranges,
+ * sets and functions with the filters of the batch, so only the
+ * instructions and values themselves are freed. */
+static void
+batch_free_insns(GPtrArray *insns)
+{
+	guint		i;
+	dfvm_insn_t	*insn;
+
+	for (i = 0; i < insns->len; i++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(insns, i);
+		g_free(insn->arg1);
+		g_free(insn->arg2);
+		g_free(insn->arg3);
+		g_free(insn->arg4);
+		g_free(insn);
+	}
+	g_ptr_array_free(insns, TRUE);
+}
+
+static void
+batch_free_prog(dfilter_t *prog)
+{
+	guint i;
+
+	dfvm_free_code(prog);
+	batch_free_insns(prog->insns);
+	batch_free_insns(prog->consts);
+	for (i = 0; i < prog->max_registers; i++) {
+		g_ptr_array_free(prog->registers[i], TRUE);
+	}
+	g_free(prog->registers);
+	g_free(prog->attempted_load);
+	g_free(prog->free_registers);
+	g_free(prog->results);
+	g_free(prog);
+}
+
+void
+dfilter_batch_free(dfilter_batch_t *batch)
+{
+	if (!batch)
+		return;
+
+	if (batch->prog) {
+		batch_free_prog(batch->prog);
+	}
+	g_ptr_array_free(batch->filters, TRUE);
+	g_free(batch);
+}
+
+guint
+dfilter_batch_add(dfilter_batch_t *batch, dfilter_t *df)
+{
+	g_assert(df);
+
+	if (batch->prog) {
+		batch_free_prog(batch->prog);
+		batch->prog = NULL;
+	}
+	g_ptr_array_add(batch->filters, df);
+	return batch->filters->len - 1;
+}
+
+guint
+dfilter_batch_count(const dfilter_batch_t *batch)
+{
+	return batch->filters->len;
+}
+
+void
+dfilter_batch_prime_proto_tree(const dfilter_batch_t *batch, proto_tree *tree)
+{
+	guint i;
+
+	for (i = 0; i < batch->filters->len; i++) {
+		dfilter_prime_proto_tree(
+			(dfilter_t *)g_ptr_array_index(batch->filters, i), tree);
+	}
+}
+
+/* Copy a value of an instruction of a filter into the merged program,
+ * renumbering registers and jump targets. */
+static dfvm_value_t*
+batch_copy_value(const dfvm_value_t *v, const guint *regmap, guint base)
+{
+	dfvm_value_t	*copy;
+
+	if (!v)
+		return NULL;
+
+	copy = dfvm_value_new(v->type);
+	copy->value = v->value;
+	if (v->type == REGISTER) {
+		copy->value.numeric = regmap[v->value.numeric];
+	}
+	else if (v->type == INSN_NUMBER) {
+		copy->value.numeric = v->value.numeric + base;
+	}
+	return copy;
+}
+
+static dfvm_insn_t*
+batch_copy_insn(const dfvm_insn_t *insn, const guint *regmap, guint base)
+{
+	dfvm_insn_t	*copy;
+
+	copy = dfvm_insn_new(insn->op);
+	copy->id = insn->id + base;
+	copy->arg1 = batch_copy_value(insn->arg1, regmap, base);
+	copy->arg2 = batch_copy_value(insn->arg2, regmap, base);
+	copy->arg3 = batch_copy_value(insn->arg3, regmap, base);
+	copy->arg4 = batch_copy_value(insn->arg4, regmap, base);
+	return copy;
+}
+
+/* Merge the filters of a batch into one program.
+ *
+ * The instructions of the filters are run one filter after the other,
+ * with each filter's RETURN replaced by a STORE_RESULT that records
+ * whether the filter matched; if only the first match is wanted, it is
+ * followed by a jump to the RETURN at the end of the program.  Each
+ * filter starts with a SKIP_FILTER that jumps past it if it isn't one
+ * of the filters dfilter_batch_apply_edt_wanted() was asked to run.
+ *
+ * Every register into which a filter reads a field becomes the one
+ * register of the program for that field, so that a field is read from
+ * the proto_tree once, by the first filter that needs it, and the
+ * filters after it find it already loaded.  The other registers of the
+ * filters, i.e. the results of slices and functions and the constants,
+ * are given registers of their own. */
+static dfilter_t*
+batch_build_prog(dfilter_batch_t *batch)
+{
+	dfilter_t	*prog, *df;
+	GHashTable	*field_registers;
+	guint		**regmaps;
+	guint		num_registers = 0, num_consts = 0;
+	guint		i, id, reg, base;
+	gpointer	value;
+	dfvm_insn_t	*insn, *skip;
+	GSList		*exits = NULL, *l;
+
+	field_registers = g_hash_table_new(g_direct_hash, g_direct_equal);
+	regmaps = g_new(guint*, batch->filters->len);
+
+	/* Number the registers loaded for each packet... */
+	for (i = 0; i < batch->filters->len; i++) {
+		df = (dfilter_t *)g_ptr_array_index(batch->filters, i);
+		regmaps[i] = g_new(guint, df->max_registers);
+		for (reg = 0; reg < df->num_registers; reg++) {
+			regmaps[i][reg] = G_MAXUINT;
+		}
+		for (id = 0; id < df->insns->len; id++) {
+			insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, id);
+			if (insn->op != READ_TREE)
+				continue;
+
+			if (!g_hash_table_lookup_extended(field_registers,
+					insn->arg1->value.hfinfo, NULL, &value)) {
+				value = GUINT_TO_POINTER(num_registers++);
+				g_hash_table_insert(field_registers,
+					insn->arg1->value.hfinfo, value);
+			}
+			regmaps[i][insn->arg2->value.numeric] = GPOINTER_TO_UINT(value);
+		}
+		for (reg = 0; reg < df->num_registers; reg++) {
+			if (regmaps[i][reg] == G_MAXUINT) {
+				regmaps[i][reg] = num_registers++;
+			}
+		}
+	}
+	g_hash_table_destroy(field_registers);
+
+	/* ...and put the constants after all of them */
+	for (i = 0; i < batch->filters->len; i++) {
+		df = (dfilter_t *)g_ptr_array_index(batch->filters, i);
+		for (reg = df->num_registers; reg < df->max_registers; reg++) {
+			regmaps[i][reg] = num_registers + num_consts++;
+		}
+	}
+
+	prog = dfilter_new();
+	prog->insns = g_ptr_array_new();
+	prog->consts = g_ptr_array_new();
+
+	for (i = 0; i < batch->filters->len; i++) {
+		df = (dfilter_t *)g_ptr_array_index(batch->filters, i);
+
+		for (id = 0; id < df->consts->len; id++) {
+			insn = (dfvm_insn_t *)g_ptr_array_index(df->consts, id);
+			g_ptr_array_add(prog->consts,
+				batch_copy_insn(insn, regmaps[i], 0));
+		}
+
+		skip = dfvm_insn_new(SKIP_FILTER);
+		skip->id = prog->insns->len;
+		skip->arg1 = dfvm_value_new(INTEGER);
+		skip->arg1->value.numeric = i;
+		skip->arg2 = dfvm_value_new(INSN_NUMBER);
+		g_ptr_array_add(prog->insns, skip);
+
+		base = prog->insns->len;
+		for (id = 0; id < df->insns->len; id++) {
+			insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, id);
+			if (insn->op == RETURN) {
+				insn = dfvm_insn_new(STORE_RESULT);
+				insn->id = base + id;
+				insn->arg1 = dfvm_value_new(INTEGER);
+				insn->arg1->value.numeric = i;
+			}
+			else {
+				insn = batch_copy_insn(insn, regmaps[i], base);
+			}
+			g_ptr_array_add(prog->insns, insn);
+		}
+
+		if (batch->first_match_only) {
+			insn = dfvm_insn_new(IF_TRUE_GOTO);
+			insn->id = prog->insns->len;
+			insn->arg1 = dfvm_value_new(INSN_NUMBER);
+			g_ptr_array_add(prog->insns, insn);
+			exits = g_slist_prepend(exits, insn->arg1);
+		}
+		skip->arg2->value.numeric = prog->insns->len;
+
+		g_free(regmaps[i]);
+	}
+	g_free(regmaps);
+
+	insn = dfvm_insn_new(RETURN);
+	insn->id = prog->insns->len;
+	g_ptr_array_add(prog->insns, insn);
+	for (l = exits; l; l = l->next) {
+		((dfvm_value_t *)l->data)->value.numeric = insn->id;
+	}
+	g_slist_free(exits);
+
+	dfilter_init_registers(prog, num_registers, num_registers + num_consts);
+	prog->results = g_new0(guint32, (batch->filters->len + 31) / 32);
+	dfvm_init_const(prog);
+	if (specialize_filters)
+		dfvm_specialize(prog);
+
+	return prog;
+}
+
+int
+dfilter_batch_apply_edt(dfilter_batch_t *batch, epan_dissect_t *edt)
+{
+	return dfilter_batch_apply_edt_wanted(batch, edt, NULL);
+}
+
+int
+dfilter_batch_apply_edt_wanted(dfilter_batch_t *batch, epan_dissect_t *edt,
+		const guint32 *wanted)
+{
+	guint	i, words;
+
+	if (batch->filters->len == 0)
+		return -1;
+
+	if (!batch->prog) {
+		batch->prog = batch_build_prog(batch);
+	}
+
+	words = (batch->filters->len + 31) / 32;
+	memset(batch->prog->results, 0, words * sizeof (guint32));
+	batch->prog->wanted = wanted;
+	dfvm_apply(batch->prog, edt->tree);
+	batch->prog->wanted = NULL;
+
+	for (i = 0; i < words; i++) {
+		if (batch->prog->results[i]) {
+			return i * 32 +
+				g_bit_nth_lsf(batch->prog->results[i], -1);
+		}
+	}
+	return -1;
+}
+
+gboolean
+dfilter_batch_matched(const dfilter_batch_t *batch, guint idx)
+{
+	if (!batch->prog || idx >= batch->filters->len)
+		return FALSE;
+
+	return (batch->prog->results[idx / 32] & (1U << (idx % 32))) != 0;
 }
 
 /*
@@ -84,11 +84,99 @@ WS_DLL_PUBLIC
 GPtrArray *
 dfilter_deprecated_tokens(dfilter_t *df);
 
+/* Does every packet that passes df also pass old_df?  This is only
+ * found to be so when each of the tests that are "&&"ed together in
+ * old_df is one of those of df, so a FALSE answer doesn't mean that
+ * it isn't so.  Any filter refines a NULL one, and a NULL one refines
+ * only a NULL one; a filter that calls a function neither refines nor
+ * is refined by any other. */
+WS_DLL_PUBLIC
+gboolean
+dfilter_refines(const dfilter_t *df, const dfilter_t *old_df);
+
+/* Does df refer to the protocol proto_id, or to any of its fields? */
+WS_DLL_PUBLIC
+gboolean
+dfilter_uses_protocol(const dfilter_t *df, int proto_id);
+
+/* Does df only test whether protocols are in the packet, as "dns" or
+ * "sip || !rtp" do? */
+WS_DLL_PUBLIC
+gboolean
+dfilter_tests_protocols_only(const dfilter_t *df);
+
+typedef gboolean (*dfilter_protocol_func)(int proto_id, gpointer user_data);
+
+/* Apply a dfilter that dfilter_tests_protocols_only(), with has_protocol
+ * saying whether each protocol it tests is in the packet. */
+WS_DLL_PUBLIC
+gboolean
+dfilter_apply_protocols(dfilter_t *df, dfilter_protocol_func has_protocol,
+		gpointer user_data);
+
 /* Print bytecode of dfilter to stdout */
 WS_DLL_PUBLIC
 void
 dfilter_dump(dfilter_t *df);
 
+/* A batch of compiled dfilters that are run on the same packets, e.g.
+ * the coloring rules or the filters of the tap listeners.  The filters
+ * are merged into one program, in which a field that several of the
+ * filters refer to is only read from the proto_tree once, and running
+ * it records which of the filters matched.
+ *
+ * The batch doesn't own the filters, and it must be freed before any
+ * of them is. */
+typedef struct epan_dfilter_batch dfilter_batch_t;
+
+/* Creates an empty batch.  If first_match_only is TRUE, running the
+ * batch stops at the first filter that matches, and the ones after it
+ * are treated as not having matched. */
+WS_DLL_PUBLIC
+dfilter_batch_t *
+dfilter_batch_new(gboolean first_match_only);
+
+/* Frees a batch, but not its filters. */
+WS_DLL_PUBLIC
+void
+dfilter_batch_free(dfilter_batch_t *batch);
+
+/* Adds a filter to a batch, and returns its index in the batch. */
+WS_DLL_PUBLIC
+guint
+dfilter_batch_add(dfilter_batch_t *batch, dfilter_t *df);
+
+/* Number of filters in a batch. */
+WS_DLL_PUBLIC
+guint
+dfilter_batch_count(const dfilter_batch_t *batch);
+
+/* Prime a proto_tree using the fields/protocols used in the filters
+ * of a batch. */
+WS_DLL_PUBLIC
+void
+dfilter_batch_prime_proto_tree(const dfilter_batch_t *batch, proto_tree *tree);
+
+/* Runs all the filters of a batch on a dissected packet.  Returns the
+ * index of the first filter that matched, or -1 if none did. */
+WS_DLL_PUBLIC
+int
+dfilter_batch_apply_edt(dfilter_batch_t *batch, struct epan_dissect *edt);
+
+/* Runs only those filters of a batch whose bits are set in wanted, a
+ * bitmap of (dfilter_batch_count() + 31) / 32 words; the others are
+ * treated as not matching.  Returns what dfilter_batch_apply_edt() does. */
+WS_DLL_PUBLIC
+int
+dfilter_batch_apply_edt_wanted(dfilter_batch_t *batch, struct epan_dissect *edt,
+		const guint32 *wanted);
+
+/* Did the filter with the given index match the packet the batch was
+ * last run on? */
+WS_DLL_PUBLIC
+gboolean
+dfilter_batch_matched(const dfilter_batch_t *batch, guint idx);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,359 @@
+/*
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "dfsearch.h"
+
+#include <ftypes/ftypes-int.h>
+#include <wsutil/ws_mempbrk.h>
+
+/* What the members of a search, and the values searched, are made of.
+ * fvalue_contains() searches all the string types with strstr() and all
+ * the byte string types with epan_memmem(), so those can be scanned as
+ * bytes; an empty member is never found by either. */
+typedef enum {
+	SEARCH_NONE,		/* can't be scanned */
+	SEARCH_STRING,
+	SEARCH_BYTES
+} search_kind_t;
+
+/* The most distinct first bytes of members for which skipping ahead
+ * with ws_mempbrk_exec() is worth it; that's as many as its SSE 4.2
+ * version handles. */
+#define MAX_SKIP_BYTES	16
+
+#define NO_STATE	G_MAXUINT32
+
+struct _dfsearch {
+	GPtrArray	*members;	/* the fvalues, for fvalue_contains() and dumping */
+	search_kind_t	kind;		/* kind of all the members, or SEARCH_NONE */
+
+	/* The automaton.  Bytes that don't occur in any member are all
+	 * in class 0, so each state needs only a row of num_classes
+	 * transitions. */
+	guint16		classes[256];
+	guint		num_classes;
+	guint		num_states;
+	guint32		*next;		/* num_states rows of num_classes states */
+	guint8		*accepts;	/* does a member end in the state? */
+	gboolean	skip;		/* skip ahead with ws_mempbrk_exec() in state 0? */
+	ws_mempbrk_pattern first_bytes;	/* bytes that start a member */
+};
+
+static search_kind_t
+search_kind(const fvalue_t *fv)
+{
+	switch (fv->ftype->ftype) {
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+			return SEARCH_STRING;
+
+		case FT_ETHER:
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_OID:
+		case FT_AX25:
+		case FT_VINES:
+		case FT_REL_OID:
+		case FT_SYSTEM_ID:
+		case FT_FCWWN:
+			return SEARCH_BYTES;
+
+		default:
+			return SEARCH_NONE;
+	}
+}
+
+/* The bytes of a member, or of a value being searched. */
+static const guint8 *
+search_bytes(const fvalue_t *fv, search_kind_t kind, guint *len)
+{
+	if (kind == SEARCH_STRING) {
+		*len = (guint)strlen(fv->value.string);
+		return (const guint8 *)fv->value.string;
+	}
+	*len = fv->value.bytes->len;
+	return fv->value.bytes->data;
+}
+
+dfsearch_t*
+dfsearch_new(void)
+{
+	dfsearch_t	*search;
+
+	search = g_new0(dfsearch_t, 1);
+	search->members = g_ptr_array_new();
+	search->kind = SEARCH_NONE;
+
+	return search;
+}
+
+void
+dfsearch_free(dfsearch_t *search)
+{
+	guint	i;
+
+	for (i = 0; i < search->members->len; i++) {
+		FVALUE_FREE((fvalue_t *)g_ptr_array_index(search->members, i));
+	}
+	g_ptr_array_free(search->members, TRUE);
+	g_free(search->next);
+	g_free(search->accepts);
+	g_free(search);
+}
+
+gboolean
+dfsearch_searchable(const fvalue_t *fv)
+{
+	return search_kind(fv) != SEARCH_NONE;
+}
+
+void
+dfsearch_add(dfsearch_t *search, fvalue_t *fv)
+{
+	g_assert(search->next == NULL);
+	g_ptr_array_add(search->members, fv);
+}
+
+guint
+dfsearch_count(const dfsearch_t *search)
+{
+	return search->members->len;
+}
+
+static guint32
+add_state(dfsearch_t *search, GArray *next, GByteArray *accepts)
+{
+	guint32	state = search->num_states++;
+	guint32	none = NO_STATE;
+	guint8	no = 0;
+	guint	c;
+
+	for (c = 0; c < search->num_classes; c++) {
+		g_array_append_val(next, none);
+	}
+	g_byte_array_append(accepts, &no, 1);
+	return state;
+}
+
+void
+dfsearch_compile(dfsearch_t *search)
+{
+	GArray		*next;
+	GByteArray	*accepts;
+	guint32		*fail, *queue;
+	guint32		*row, state, child;
+	guint		head, tail;
+	guint		i, j, len, c, nc;
+	const guint8	*bytes;
+	search_kind_t	kind;
+	gchar		needles[MAX_SKIP_BYTES + 1];
+	guint		num_needles = 0;
+	gboolean	first[256];
+
+	if (search->members->len == 0)
+		return;
+
+	/* The automaton is only used if all the members are of one kind. */
+	kind = search_kind((fvalue_t *)g_ptr_array_index(search->members, 0));
+	for (i = 1; i < search->members->len; i++) {
+		if (search_kind((fvalue_t *)g_ptr_array_index(search->members, i)) != kind)
+			return;
+	}
+	if (kind == SEARCH_NONE)
+		return;
+
+	/* Give each byte that occurs in a member a class of its own. */
+	memset(search->classes, 0, sizeof search->classes);
+	memset(first, 0, sizeof first);
+	search->num_classes = 1;
+	for (i = 0; i < search->members->len; i++) {
+		bytes = search_bytes((fvalue_t *)g_ptr_array_index(search->members, i), kind, &len);
+		for (j = 0; j < len; j++) {
+			if (search->classes[bytes[j]] == 0)
+				search->classes[bytes[j]] = (guint16)search->num_classes++;
+		}
+		if (len > 0)
+			first[bytes[0]] = TRUE;
+	}
+	nc = search->num_classes;
+
+	/* The trie of the members; state 0 is the root. */
+	next = g_array_new(FALSE, FALSE, sizeof(guint32));
+	accepts = g_byte_array_new();
+	add_state(search, next, accepts);
+	for (i = 0; i < search->members->len; i++) {
+		bytes = search_bytes((fvalue_t *)g_ptr_array_index(search->members, i), kind, &len);
+		if (len == 0)
+			continue;
+		state = 0;
+		for (j = 0; j < len; j++) {
+			c = search->classes[bytes[j]];
+			child = g_array_index(next, guint32, state * nc + c);
+			if (child == NO_STATE) {
+				child = add_state(search, next, accepts);
+				g_array_index(next, guint32, state * nc + c) = child;
+			}
+			state = child;
+		}
+		accepts->data[state] = 1;
+	}
+
+	/* Breadth first, work out where each state goes on a byte that
+	 * doesn't continue a member: where the longest suffix of what it
+	 * matched that is also in the trie goes.  That makes the trie into
+	 * a DFA.  A state accepts if a suffix of it does. */
+	fail = g_new0(guint32, search->num_states);
+	queue = g_new(guint32, search->num_states);
+	head = tail = 0;
+	row = (guint32 *)(void *)next->data;
+	for (c = 0; c < nc; c++) {
+		child = row[c];
+		if (child == NO_STATE) {
+			row[c] = 0;
+		}
+		else {
+			fail[child] = 0;
+			queue[tail++] = child;
+		}
+	}
+	while (head < tail) {
+		state = queue[head++];
+		row = (guint32 *)(void *)next->data + state * nc;
+		for (c = 0; c < nc; c++) {
+			child = row[c];
+			if (child == NO_STATE) {
+				row[c] = ((guint32 *)(void *)next->data)[fail[state] * nc + c];
+			}
+			else {
+				fail[child] = ((guint32 *)(void *)next->data)[fail[state] * nc + c];
+				accepts->data[child] |= accepts->data[fail[child]];
+				queue[tail++] = child;
+			}
+		}
+	}
+	g_free(fail);
+	g_free(queue);
+
+	search->next = (guint32 *)(void *)g_array_free(next, FALSE);
+	search->accepts = g_byte_array_free(accepts, FALSE);
+	search->kind = kind;
+
+	/* ws_mempbrk_compile() takes the bytes to look for as a string,
+	 * and indexes with them as chars, so only skip ahead to ASCII. */
+	search->skip = TRUE;
+	for (c = 0; c < 256; c++) {
+		if (!first[c])
+			continue;
+		if (c == 0 || c > 0x7f || num_needles == MAX_SKIP_BYTES) {
+			search->skip = FALSE;
+			break;
+		}
+		needles[num_needles++] = (gchar)c;
+	}
+	needles[num_needles] = '\0';
+	if (num_needles == 0)
+		search->skip = FALSE;
+	if (search->skip) {
+		memset(&search->first_bytes, 0, sizeof search->first_bytes);
+		ws_mempbrk_compile(&search->first_bytes, needles);
+	}
+}
+
+static gboolean
+contains_linear(const dfsearch_t *search, const fvalue_t *fv)
+{
+	guint	i;
+
+	for (i = 0; i < search->members->len; i++) {
+		if (fvalue_contains(fv, (const fvalue_t *)g_ptr_array_index(search->members, i)))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+gboolean
+dfsearch_contains(const dfsearch_t *search, const fvalue_t *fv)
+{
+	const guint8	*p, *end;
+	const guint32	*next = search->next;
+	const guint16	*classes = search->classes;
+	guint		nc = search->num_classes;
+	guint32		state = 0;
+	guint		len;
+
+	if (search->kind == SEARCH_NONE || search_kind(fv) != search->kind)
+		return contains_linear(search, fv);
+
+	p = search_bytes(fv, search->kind, &len);
+	end = p + len;
+	while (p < end) {
+		if (state == 0 && search->skip) {
+			p = ws_mempbrk_exec(p, end - p, &search->first_bytes, NULL);
+			if (p == NULL)
+				return FALSE;
+		}
+		state = next[state * nc + classes[*p++]];
+		if (search->accepts[state])
+			return TRUE;
+	}
+	return FALSE;
+}
+
+void
+dfsearch_dump(FILE *f, const dfsearch_t *search, guint max_members)
+{
+	guint	i;
+	char	*value_str;
+
+	fprintf(f, "{");
+	for (i = 0; i < search->members->len && i < max_members; i++) {
+		value_str = fvalue_to_string_repr(
+			(fvalue_t *)g_ptr_array_index(search->members, i),
+			FTREPR_DFILTER, BASE_NONE, NULL);
+		fprintf(f, "%s%s", i ? ", " : "", value_str);
+		g_free(value_str);
+	}
+	if (i < search->members->len) {
+		fprintf(f, ", ... %u more", search->members->len - i);
+	}
+	fprintf(f, "}");
+	if (search->kind != SEARCH_NONE) {
+		fprintf(f, " (%u states)", search->num_states);
+	}
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
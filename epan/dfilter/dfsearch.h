@@ -0,0 +1,70 @@
+/*
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DFSEARCH_H
+#define DFSEARCH_H
+
+#include <stdio.h>
+#include <glib.h>
+#include "ftypes/ftypes.h"
+
+/* A set of constant strings or byte strings, which the ANY_CONTAINS_ANY
+ * instruction searches field values for all at once.
+ *
+ * The members are compiled into an Aho-Corasick automaton, so a value
+ * is scanned once however many members there are.  While no member has
+ * been partly matched, the scan skips ahead with ws_mempbrk_exec() to
+ * the next byte that starts a member.  A value of a kind other than the
+ * members' is compared with them one by one with fvalue_contains(). */
+typedef struct _dfsearch dfsearch_t;
+
+dfsearch_t*
+dfsearch_new(void);
+
+void
+dfsearch_free(dfsearch_t *search);
+
+/* Can fv be a member of a search, i.e. is it a string or a byte string? */
+gboolean
+dfsearch_searchable(const fvalue_t *fv);
+
+/* Add a member to the search; the search takes ownership of the
+ * fvalue.  Members can't be added once the search has been compiled. */
+void
+dfsearch_add(dfsearch_t *search, fvalue_t *fv);
+
+/* Build the automaton, after all of the members have been added. */
+void
+dfsearch_compile(dfsearch_t *search);
+
+/* Number of members of the search. */
+guint
+dfsearch_count(const dfsearch_t *search);
+
+/* Is there a member of the search that fvalue_contains() would find
+ * in fv? */
+gboolean
+dfsearch_contains(const dfsearch_t *search, const fvalue_t *fv);
+
+/* Print the members of the search, up to max_members of them. */
+void
+dfsearch_dump(FILE *f, const dfsearch_t *search, guint max_members);
+
+#endif
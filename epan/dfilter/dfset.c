@@ -0,0 +1,421 @@
+/*
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "dfset.h"
+
+#include <ftypes/ftypes-int.h>
+
+/* What a hash key is made from.  fvalue_eq() compares the values of
+ * all of the ftypes of one kind in the same way, e.g. all the integer
+ * types of up to 32 bits by their "uinteger" member, so they have to
+ * hash the same way too. */
+typedef enum {
+	KEY_NONE,		/* can't be hashed */
+	KEY_BOOLEAN,
+	KEY_INTEGER,
+	KEY_INTEGER64,
+	KEY_TIME,
+	KEY_STRING,
+	KEY_BYTES,
+	KEY_GUID,
+	KEY_IPv4,
+	KEY_IPv6
+} key_kind_t;
+
+/* A netmask or prefix length, and an IPv6 address, is the longest key
+ * that's kept in the key itself. */
+#define KEY_BUF_LEN	(4 + 16)
+
+typedef struct {
+	key_kind_t	kind;
+	guint		hash;
+	gsize		len;
+	const guint8	*data;	/* buf, or the string or bytes of the member */
+	guint8		buf[KEY_BUF_LEN];
+} set_key_t;
+
+struct _dfset {
+	GHashTable	*table;		/* set_key_t's of the hashed members */
+	GPtrArray	*members;	/* all the members, for freeing and dumping */
+	GPtrArray	*unhashed;	/* the members that aren't in table */
+	GArray		*ipv4_masks;	/* distinct netmasks of IPv4 members */
+	GArray		*ipv6_prefixes;	/* distinct prefixes of IPv6 members */
+};
+
+static key_kind_t
+key_kind(const fvalue_t *fv)
+{
+	switch (fv->ftype->ftype) {
+		case FT_BOOLEAN:
+			return KEY_BOOLEAN;
+
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+		case FT_IPXNET:
+		case FT_FRAMENUM:
+			return KEY_INTEGER;
+
+		case FT_UINT40:
+		case FT_UINT48:
+		case FT_UINT56:
+		case FT_UINT64:
+		case FT_INT40:
+		case FT_INT48:
+		case FT_INT56:
+		case FT_INT64:
+		case FT_EUI64:
+			return KEY_INTEGER64;
+
+		case FT_ABSOLUTE_TIME:
+		case FT_RELATIVE_TIME:
+			return KEY_TIME;
+
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+			return KEY_STRING;
+
+		case FT_ETHER:
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_OID:
+		case FT_AX25:
+		case FT_VINES:
+		case FT_REL_OID:
+		case FT_SYSTEM_ID:
+		case FT_FCWWN:
+			return KEY_BYTES;
+
+		case FT_GUID:
+			return KEY_GUID;
+
+		case FT_IPv4:
+			return KEY_IPv4;
+
+		case FT_IPv6:
+			return KEY_IPv6;
+
+		default:
+			/* Floating point numbers, for one, can be equal
+			 * without being the same bits. */
+			return KEY_NONE;
+	}
+}
+
+static guint
+key_hash(gconstpointer v)
+{
+	return ((const set_key_t *)v)->hash;
+}
+
+static gboolean
+key_equal(gconstpointer v1, gconstpointer v2)
+{
+	const set_key_t *a = (const set_key_t *)v1;
+	const set_key_t *b = (const set_key_t *)v2;
+
+	return a->kind == b->kind && a->len == b->len &&
+	    memcmp(a->data, b->data, a->len) == 0;
+}
+
+/* Make the key for an fvalue of a hashable kind.  An IPv4 address is
+ * masked with "mask", an IPv6 address is cut to "mask" bits. */
+static void
+make_key(set_key_t *key, const fvalue_t *fv, key_kind_t kind, guint32 mask)
+{
+	guint32		u32, prefix;
+	guint64		u64;
+	gint64		secs;
+	const guint8	*p;
+	gsize		i;
+	guint		hash;
+
+	key->kind = kind;
+	key->data = key->buf;
+
+	switch (kind) {
+		case KEY_BOOLEAN:
+			key->buf[0] = fv->value.uinteger ? 1 : 0;
+			key->len = 1;
+			break;
+
+		case KEY_INTEGER:
+			u32 = fv->value.uinteger;
+			memcpy(key->buf, &u32, 4);
+			key->len = 4;
+			break;
+
+		case KEY_INTEGER64:
+			u64 = fv->value.uinteger64;
+			memcpy(key->buf, &u64, 8);
+			key->len = 8;
+			break;
+
+		case KEY_TIME:
+			/* nstime_t has padding, so copy the members */
+			secs = (gint64)fv->value.time.secs;
+			u32 = (guint32)fv->value.time.nsecs;
+			memcpy(key->buf, &secs, 8);
+			memcpy(key->buf + 8, &u32, 4);
+			key->len = 12;
+			break;
+
+		case KEY_STRING:
+			key->data = (const guint8 *)fv->value.string;
+			key->len = strlen(fv->value.string);
+			break;
+
+		case KEY_BYTES:
+			key->data = fv->value.bytes->data;
+			key->len = fv->value.bytes->len;
+			break;
+
+		case KEY_GUID:
+			memcpy(key->buf, &fv->value.guid, sizeof(e_guid_t));
+			key->len = sizeof(e_guid_t);
+			break;
+
+		case KEY_IPv4:
+			u32 = fv->value.ipv4.addr & mask;
+			memcpy(key->buf, &mask, 4);
+			memcpy(key->buf + 4, &u32, 4);
+			key->len = 8;
+			break;
+
+		case KEY_IPv6:
+			prefix = MIN(mask, 128);
+			memcpy(key->buf, &prefix, 4);
+			memcpy(key->buf + 4, fv->value.ipv6.addr.bytes, 16);
+			for (i = 0; i < 16; i++) {
+				if (prefix >= 8) {
+					prefix -= 8;
+				}
+				else {
+					key->buf[4 + i] &= (guint8)(0xff00 >> prefix);
+					prefix = 0;
+				}
+			}
+			key->len = 20;
+			break;
+
+		case KEY_NONE:
+		default:
+			g_assert_not_reached();
+	}
+
+	/* FNV-1a */
+	hash = 2166136261U ^ (guint)kind;
+	for (i = 0, p = key->data; i < key->len; i++) {
+		hash ^= p[i];
+		hash *= 16777619U;
+	}
+	key->hash = hash;
+}
+
+/* Add a netmask or prefix to a list of the distinct ones. */
+static void
+add_mask(GArray *masks, guint32 mask)
+{
+	guint i;
+
+	for (i = 0; i < masks->len; i++) {
+		if (g_array_index(masks, guint32, i) == mask)
+			return;
+	}
+	g_array_append_val(masks, mask);
+}
+
+dfset_t*
+dfset_new(void)
+{
+	dfset_t	*set;
+
+	set = g_new(dfset_t, 1);
+	set->table = g_hash_table_new_full(key_hash, key_equal, g_free, NULL);
+	set->members = g_ptr_array_new();
+	set->unhashed = g_ptr_array_new();
+	set->ipv4_masks = g_array_new(FALSE, FALSE, sizeof(guint32));
+	set->ipv6_prefixes = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+	return set;
+}
+
+void
+dfset_free(dfset_t *set)
+{
+	guint	i;
+
+	for (i = 0; i < set->members->len; i++) {
+		FVALUE_FREE((fvalue_t *)g_ptr_array_index(set->members, i));
+	}
+	g_ptr_array_free(set->members, TRUE);
+	g_ptr_array_free(set->unhashed, TRUE);
+	g_hash_table_destroy(set->table);
+	g_array_free(set->ipv4_masks, TRUE);
+	g_array_free(set->ipv6_prefixes, TRUE);
+	g_free(set);
+}
+
+void
+dfset_add(dfset_t *set, fvalue_t *fv)
+{
+	set_key_t	*key;
+	key_kind_t	kind;
+	guint32		mask = 0;
+
+	kind = key_kind(fv);
+	if (kind == KEY_NONE) {
+		g_ptr_array_add(set->members, fv);
+		g_ptr_array_add(set->unhashed, fv);
+		return;
+	}
+
+	if (kind == KEY_IPv4) {
+		mask = fv->value.ipv4.nmask;
+	}
+	else if (kind == KEY_IPv6) {
+		mask = MIN(fv->value.ipv6.prefix, 128);
+	}
+
+	key = g_new(set_key_t, 1);
+	make_key(key, fv, kind, mask);
+	if (g_hash_table_lookup(set->table, key)) {
+		/* Already a member */
+		g_free(key);
+		FVALUE_FREE(fv);
+		return;
+	}
+
+	/* The key of a string or byte string points into the fvalue,
+	 * which the set keeps until it's freed. */
+	g_hash_table_insert(set->table, key, key);
+	g_ptr_array_add(set->members, fv);
+
+	if (kind == KEY_IPv4) {
+		add_mask(set->ipv4_masks, mask);
+	}
+	else if (kind == KEY_IPv6) {
+		add_mask(set->ipv6_prefixes, mask);
+	}
+}
+
+guint
+dfset_count(const dfset_t *set)
+{
+	return set->members->len;
+}
+
+static gboolean
+contains_linear(GPtrArray *members, const fvalue_t *fv)
+{
+	guint	i;
+
+	for (i = 0; i < members->len; i++) {
+		if (fvalue_eq(fv, (const fvalue_t *)g_ptr_array_index(members, i)))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+gboolean
+dfset_contains(const dfset_t *set, const fvalue_t *fv)
+{
+	set_key_t	key;
+	key_kind_t	kind;
+	GArray		*masks;
+	guint		i;
+
+	kind = key_kind(fv);
+	switch (kind) {
+		case KEY_NONE:
+			return contains_linear(set->members, fv);
+
+		case KEY_IPv4:
+		case KEY_IPv6:
+			/* A value that has a netmask of its own matches
+			 * members on fewer bits than their own netmask,
+			 * which can't be looked up; values read from
+			 * packets don't have one. */
+			if (kind == KEY_IPv4 ?
+			    fv->value.ipv4.nmask != 0xffffffff :
+			    fv->value.ipv6.prefix < 128) {
+				return contains_linear(set->members, fv);
+			}
+			masks = kind == KEY_IPv4 ? set->ipv4_masks : set->ipv6_prefixes;
+			for (i = 0; i < masks->len; i++) {
+				make_key(&key, fv, kind, g_array_index(masks, guint32, i));
+				if (g_hash_table_lookup(set->table, &key))
+					return TRUE;
+			}
+			break;
+
+		default:
+			make_key(&key, fv, kind, 0);
+			if (g_hash_table_lookup(set->table, &key))
+				return TRUE;
+			break;
+	}
+
+	return contains_linear(set->unhashed, fv);
+}
+
+void
+dfset_dump(FILE *f, const dfset_t *set, guint max_members)
+{
+	guint	i;
+	char	*value_str;
+
+	fprintf(f, "{");
+	for (i = 0; i < set->members->len && i < max_members; i++) {
+		value_str = fvalue_to_string_repr(
+			(fvalue_t *)g_ptr_array_index(set->members, i),
+			FTREPR_DFILTER, BASE_NONE, NULL);
+		fprintf(f, "%s%s", i ? ", " : "", value_str);
+		g_free(value_str);
+	}
+	if (i < set->members->len) {
+		fprintf(f, ", ... %u more", set->members->len - i);
+	}
+	fprintf(f, "}");
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,64 @@
+/*
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DFSET_H
+#define DFSET_H
+
+#include <stdio.h>
+#include <glib.h>
+#include "ftypes/ftypes.h"
+
+/* A set of constant fvalues, which the ANY_IN instruction tests
+ * field values against.
+ *
+ * Members of the types that are compared for equality byte by byte
+ * (integers, strings, byte strings, addresses, GUIDs, times) are kept
+ * in a hash table, so that testing a value costs the same however big
+ * the set is.  IPv4 and IPv6 members that have a netmask or prefix are
+ * kept in the hash table with the address masked, and a value is
+ * looked up once for each distinct netmask in the set.  Members of any
+ * other type are compared with the value one by one. */
+typedef struct _dfset dfset_t;
+
+dfset_t*
+dfset_new(void);
+
+void
+dfset_free(dfset_t *set);
+
+/* Add a member to the set; the set takes ownership of the fvalue,
+ * and frees it if it's already in the set. */
+void
+dfset_add(dfset_t *set, fvalue_t *fv);
+
+/* Number of distinct members of the set. */
+guint
+dfset_count(const dfset_t *set);
+
+/* Is there a member of the set that fvalue_eq() would find equal
+ * to fv? */
+gboolean
+dfset_contains(const dfset_t *set, const fvalue_t *fv);
+
+/* Print the members of the set, up to max_members of them. */
+void
+dfset_dump(FILE *f, const dfset_t *set, guint max_members);
+
+#endif
@@ -33,16 +33,15 @@
 
 /* Convert an FT_STRING using a callback function */
 static gboolean
-string_walk(GList* arg1list, GList **retval, gchar(*conv_func)(gchar))
+string_walk(GPtrArray* arg1array, GPtrArray *retval, gchar(*conv_func)(gchar))
 {
-    GList       *arg1;
+    guint       i;
     fvalue_t    *arg_fvalue;
     fvalue_t    *new_ft_string;
     char *s, *c;
 
-    arg1 = arg1list;
-    while (arg1) {
-        arg_fvalue = (fvalue_t *)arg1->data;
+    for (i = 0; i < arg1array->len; i++) {
+        arg_fvalue = (fvalue_t *)g_ptr_array_index(arg1array, i);
         /* XXX - it would be nice to handle FT_TVBUFF, too */
         if (IS_FT_STRING(fvalue_type_ftenum(arg_fvalue))) {
             s = (char *)wmem_strdup(NULL, (gchar *)fvalue_get(arg_fvalue));
@@ -54,9 +53,8 @@ string_walk(GList* arg1list, GList **retval, gchar(*conv_func)(gchar))
             new_ft_string = fvalue_new(FT_STRING);
             fvalue_set_string(new_ft_string, s);
             wmem_free(NULL, s);
-            *retval = g_list_append(*retval, new_ft_string);
+            g_ptr_array_add(retval, new_ft_string);
         }
-        arg1 = arg1->next;
     }
 
     return TRUE;
@@ -64,36 +62,34 @@ string_walk(GList* arg1list, GList **retval, gchar(*conv_func)(gchar))
 
 /* dfilter function: lower() */
 static gboolean
-df_func_lower(GList* arg1list, GList *arg2junk _U_, GList **retval)
+df_func_lower(GPtrArray* arg1array, GPtrArray *arg2junk _U_, GPtrArray *retval)
 {
-    return string_walk(arg1list, retval, g_ascii_tolower);
+    return string_walk(arg1array, retval, g_ascii_tolower);
 }
 
 /* dfilter function: upper() */
 static gboolean
-df_func_upper(GList* arg1list, GList *arg2junk _U_, GList **retval)
+df_func_upper(GPtrArray* arg1array, GPtrArray *arg2junk _U_, GPtrArray *retval)
 {
-    return string_walk(arg1list, retval, g_ascii_toupper);
+    return string_walk(arg1array, retval, g_ascii_toupper);
 }
 
 /* dfilter function: len() */
 static gboolean
-df_func_len(GList* arg1list, GList *arg2junk _U_, GList **retval)
+df_func_len(GPtrArray* arg1array, GPtrArray *arg2junk _U_, GPtrArray *retval)
 {
-    GList       *arg1;
+    guint       i;
     fvalue_t    *arg_fvalue;
     fvalue_t    *ft_len;
 
-    arg1 = arg1list;
-    while (arg1) {
-        arg_fvalue = (fvalue_t *)arg1->data;
+    for (i = 0; i < arg1array->len; i++) {
+        arg_fvalue = (fvalue_t *)g_ptr_array_index(arg1array, i);
         /* XXX - it would be nice to handle other types */
         if (IS_FT_STRING(fvalue_type_ftenum(arg_fvalue))) {
             ft_len = fvalue_new(FT_UINT32);
             fvalue_set_uinteger(ft_len, (guint) strlen((char *)fvalue_get(arg_fvalue)));
-            *retval = g_list_append(*retval, ft_len);
+            g_ptr_array_add(retval, ft_len);
         }
-        arg1 = arg1->next;
     }
 
     return TRUE;
@@ -101,21 +97,18 @@ df_func_len(GList* arg1list, GList *arg2junk _U_, GList **retval)
 
 /* dfilter function: size() */
 static gboolean
-df_func_size(GList* arg1list, GList *arg2junk _U_, GList **retval)
+df_func_size(GPtrArray* arg1array, GPtrArray *arg2junk _U_, GPtrArray *retval)
 {
-    GList       *arg1;
+    guint       i;
     fvalue_t    *arg_fvalue;
     fvalue_t    *ft_len;
 
-    arg1 = arg1list;
-    while (arg1) {
-        arg_fvalue = (fvalue_t *)arg1->data;
+    for (i = 0; i < arg1array->len; i++) {
+        arg_fvalue = (fvalue_t *)g_ptr_array_index(arg1array, i);
 
         ft_len = fvalue_new(FT_UINT32);
         fvalue_set_uinteger(ft_len, fvalue_length(arg_fvalue));
-        *retval = g_list_append(*retval, ft_len);
-
-        arg1 = arg1->next;
+        g_ptr_array_add(retval, ft_len);
     }
 
     return TRUE;
@@ -123,16 +116,16 @@ df_func_size(GList* arg1list, GList *arg2junk _U_, GList **retval)
 
 /* dfilter function: count() */
 static gboolean
-df_func_count(GList* arg1list, GList *arg2junk _U_, GList **retval)
+df_func_count(GPtrArray* arg1array, GPtrArray *arg2junk _U_, GPtrArray *retval)
 {
     fvalue_t *ft_ret;
     guint32   num_items;
 
-    num_items = (guint32)g_list_length(arg1list);
+    num_items = (guint32)arg1array->len;
 
     ft_ret = fvalue_new(FT_UINT32);
     fvalue_set_uinteger(ft_ret, num_items);
-    *retval = g_list_append(*retval, ft_ret);
+    g_ptr_array_add(retval, ft_ret);
 
     return TRUE;
 }
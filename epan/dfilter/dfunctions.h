@@ -25,8 +25,10 @@
 #include <ftypes/ftypes.h>
 #include "syntax-tree.h"
 
-/* The run-time logic of the dfilter function */
-typedef gboolean (*DFFuncType)(GList *arg1list, GList *arg2list, GList **retval);
+/* The run-time logic of the dfilter function; it appends the fvalue_t's
+ * it makes to retval, and they're freed once the packet has been
+ * filtered. */
+typedef gboolean (*DFFuncType)(GPtrArray *arg1array, GPtrArray *arg2array, GPtrArray *retval);
 
 /* The semantic check for the dfilter function */
 typedef void (*DFSemCheckType)(dfwork_t *dfw, int param_num, stnode_t *st_node);
@@ -20,10 +20,44 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include "dfvm.h"
 
 #include <ftypes/ftypes-int.h>
 
+typedef gboolean (*FvalueCmpFunc)(const fvalue_t*, const fvalue_t*);
+
+/* An instruction of the code dfvm_specialize() makes */
+typedef struct _dfvm_cinsn dfvm_cinsn_t;
+
+/* Carries out an instruction, and returns the number of the next one,
+ * or -1 to stop. */
+typedef int (*dfvm_handler_t)(dfilter_t *df, proto_tree *tree,
+		const dfvm_cinsn_t *ci, gboolean *accum);
+
+struct _dfvm_cinsn {
+	dfvm_handler_t		handler;
+	const dfvm_insn_t	*insn;		/* what it was made from */
+	int			next;		/* number of the next insn */
+	const char		*specialized;	/* what it was specialized to, or NULL */
+
+	/* For tests against a constant */
+	int			reg;		/* register of the field values */
+	drange_node		*slice;		/* slice of them that's tested, or NULL */
+	union {
+		guint32		uinteger;
+		gint32		sinteger;
+		guint64		uinteger64;
+		gint64		sinteger64;
+		ipv4_addr	ipv4;
+		const GByteArray *bytes;
+	} k;					/* the constant */
+
+	/* For tests done through the ftype functions */
+	FvalueCmpFunc		cmp;
+};
+
 dfvm_insn_t*
 dfvm_insn_new(dfvm_opcode_t op)
 {
@@ -48,6 +82,12 @@ dfvm_value_free(dfvm_value_t *v)
 		case DRANGE:
 			drange_free(v->value.drange);
 			break;
+		case FVALUE_SET:
+			dfset_free(v->value.set);
+			break;
+		case FVALUE_SEARCH:
+			dfsearch_free(v->value.search);
+			break;
 		default:
 			/* nothing */
 			;
@@ -130,8 +170,12 @@ dfvm_dump(FILE *f, dfilter_t *df)
 			case ANY_BITWISE_AND:
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
+			case ANY_IN:
+			case ANY_CONTAINS_ANY:
 			case NOT:
 			case RETURN:
+			case STORE_RESULT:
+			case SKIP_FILTER:
 			case IF_TRUE_GOTO:
 			case IF_FALSE_GOTO:
 			default:
@@ -264,6 +308,20 @@ dfvm_dump(FILE *f, dfilter_t *df)
 					id, arg1->value.numeric, arg2->value.numeric);
 				break;
 
+			case ANY_IN:
+				fprintf(f, "%05d ANY_IN\t\treg#%u in ",
+					id, arg1->value.numeric);
+				dfset_dump(f, arg2->value.set, 8);
+				fprintf(f, "\n");
+				break;
+
+			case ANY_CONTAINS_ANY:
+				fprintf(f, "%05d ANY_CONTAINS_ANY\treg#%u contains any of ",
+					id, arg1->value.numeric);
+				dfsearch_dump(f, arg2->value.search, 8);
+				fprintf(f, "\n");
+				break;
+
 			case NOT:
 				fprintf(f, "%05d NOT\n", id);
 				break;
@@ -272,6 +330,17 @@ dfvm_dump(FILE *f, dfilter_t *df)
 				fprintf(f, "%05d RETURN\n", id);
 				break;
 
+			case STORE_RESULT:
+				fprintf(f, "%05d STORE_RESULT\t%u\n",
+						id, arg1->value.numeric);
+				break;
+
+			case SKIP_FILTER:
+				fprintf(f, "%05d SKIP_FILTER\t%u -> %u\n",
+						id, arg1->value.numeric,
+						arg2->value.numeric);
+				break;
+
 			case IF_TRUE_GOTO:
 				fprintf(f, "%05d IF-TRUE-GOTO\t%u\n",
 						id, arg1->value.numeric);
@@ -287,133 +356,515 @@ dfvm_dump(FILE *f, dfilter_t *df)
 				break;
 		}
 	}
+
+	if (df->code) {
+		fprintf(f, "\nSpecialized:\n");
+		for (id = 0; id < length; id++) {
+			if (df->code[id].specialized) {
+				fprintf(f, "%05d %s\n", id, df->code[id].specialized);
+			}
+		}
+	}
 }
 
-/* Reads a field from the proto_tree and loads the fvalues into a register,
- * if that field has not already been read. */
+/* Reads a field from the proto_tree, or from the source of fields that
+ * dfilter_apply_fields() was given, and loads the fvalues into a
+ * register, if that field has not already been read.
+ *
+ * The register is an array that belongs to the dfilter and keeps its
+ * storage from one packet to the next, so once it has grown to the
+ * number of occurrences of the field in a packet, loading the field
+ * doesn't allocate anything. */
 static gboolean
 read_tree(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo, int reg)
 {
 	GPtrArray	*finfos;
+	GPtrArray	*fvalues = df->registers[reg];
 	field_info	*finfo;
-	int		i, len;
-	GList		*fvalues = NULL;
-	gboolean	found_something = FALSE;
+	guint		i, len;
 
 	/* Already loaded in this run of the dfilter? */
 	if (df->attempted_load[reg]) {
-		if (df->registers[reg]) {
-			return TRUE;
-		}
-		else {
-			return FALSE;
-		}
+		return fvalues->len != 0;
 	}
 
 	df->attempted_load[reg] = TRUE;
 
-	while (hfinfo) {
-		finfos = proto_get_finfo_ptr_array(tree, hfinfo->id);
-		if ((finfos == NULL) || (g_ptr_array_len(finfos) == 0)) {
+	if (df->source) {
+		while (hfinfo) {
+			df->source->read(hfinfo->id, fvalues, df->source->data);
 			hfinfo = hfinfo->same_name_next;
-			continue;
-		}
-		else {
-			found_something = TRUE;
 		}
+		return fvalues->len != 0;
+	}
 
-		len = finfos->len;
-		for (i = 0; i < len; i++) {
-			finfo = (field_info *)g_ptr_array_index(finfos, i);
-			fvalues = g_list_prepend(fvalues, &finfo->value);
+	while (hfinfo) {
+		finfos = proto_get_finfo_ptr_array(tree, hfinfo->id);
+		if (finfos != NULL) {
+			len = g_ptr_array_len(finfos);
+			for (i = 0; i < len; i++) {
+				finfo = (field_info *)g_ptr_array_index(finfos, i);
+				g_ptr_array_add(fvalues, &finfo->value);
+			}
 		}
 
 		hfinfo = hfinfo->same_name_next;
 	}
 
-	if (!found_something) {
-		return FALSE;
-	}
+	return fvalues->len != 0;
+}
 
-	df->registers[reg] = fvalues;
-	return TRUE;
+/* Is the field, or any other field with the same name, in the
+ * proto_tree? */
+static gboolean
+check_exists(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo)
+{
+	while (hfinfo) {
+		if (df->source ?
+		    df->source->exists(hfinfo->id, df->source->data) :
+		    proto_check_for_protocol_or_field(tree, hfinfo->id)) {
+			return TRUE;
+		}
+		hfinfo = hfinfo->same_name_next;
+	}
+	return FALSE;
 }
 
 
 static gboolean
 put_fvalue(dfilter_t *df, fvalue_t *fv, int reg)
 {
-	df->registers[reg] = g_list_append(NULL, fv);
+	g_ptr_array_add(df->registers[reg], fv);
 	return TRUE;
 }
 
-typedef gboolean (*FvalueCmpFunc)(const fvalue_t*, const fvalue_t*);
-
 static gboolean
 any_test(dfilter_t *df, FvalueCmpFunc cmp, int reg1, int reg2)
 {
-	GList	*list_a, *list_b;
-
-	list_a = df->registers[reg1];
-
-	while (list_a) {
-		list_b = df->registers[reg2];
-		while (list_b) {
-			if (cmp((fvalue_t *)list_a->data, (fvalue_t *)list_b->data)) {
+	GPtrArray	*array_a = df->registers[reg1];
+	GPtrArray	*array_b = df->registers[reg2];
+	guint		i, j;
+
+	for (i = 0; i < array_a->len; i++) {
+		for (j = 0; j < array_b->len; j++) {
+			if (cmp((fvalue_t *)g_ptr_array_index(array_a, i),
+			    (fvalue_t *)g_ptr_array_index(array_b, j))) {
 				return TRUE;
 			}
-			list_b = g_list_next(list_b);
 		}
-		list_a = g_list_next(list_a);
 	}
 	return FALSE;
 }
 
+/* Is any of the values in a register in a set? */
+static gboolean
+any_in(dfilter_t *df, int reg, const dfset_t *set)
+{
+	GPtrArray	*array = df->registers[reg];
+	guint		i;
+
+	for (i = 0; i < array->len; i++) {
+		if (dfset_contains(set, (fvalue_t *)g_ptr_array_index(array, i))) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/* Does any of the values in a register contain any of the members of
+ * a search? */
+static gboolean
+any_contains_any(dfilter_t *df, int reg, const dfsearch_t *search)
+{
+	GPtrArray	*array = df->registers[reg];
+	guint		i;
+
+	for (i = 0; i < array->len; i++) {
+		if (dfsearch_contains(search, (fvalue_t *)g_ptr_array_index(array, i))) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
 
-/* Free the list nodes w/o freeing the memory that each
- * list node points to. */
+
+/* Empty the per-packet registers, keeping their storage for the next
+ * packet, and free the fvalues that were made for this packet. */
 static void
 free_register_overhead(dfilter_t* df)
 {
-	guint i;
+	guint i, j;
 
 	for (i = 0; i < df->num_registers; i++) {
 		df->attempted_load[i] = FALSE;
-		if (df->registers[i]) {
-			g_list_free(df->registers[i]);
-			df->registers[i] = NULL;
+		if (df->free_registers[i]) {
+			for (j = 0; j < df->registers[i]->len; j++) {
+				FVALUE_FREE((fvalue_t *)g_ptr_array_index(df->registers[i], j));
+			}
+			df->free_registers[i] = FALSE;
 		}
+		g_ptr_array_set_size(df->registers[i], 0);
 	}
 }
 
-/* Takes the list of fvalue_t's in a register, uses fvalue_slice()
- * to make a new list of fvalue_t's (which are ranges, or byte-slices),
- * and puts the new list into a new register. */
+/* Takes the fvalue_t's in a register, uses fvalue_slice()
+ * to make new fvalue_t's (which are ranges, or byte-slices),
+ * and puts them into a new register. */
 static void
 mk_range(dfilter_t *df, int from_reg, int to_reg, drange_t *d_range)
 {
-	GList		*from_list, *to_list;
+	GPtrArray	*from_array = df->registers[from_reg];
+	GPtrArray	*to_array = df->registers[to_reg];
 	fvalue_t	*old_fv, *new_fv;
+	guint		i;
 
-	to_list = NULL;
-	from_list = df->registers[from_reg];
-
-	while (from_list) {
-		old_fv = (fvalue_t*)from_list->data;
+	for (i = 0; i < from_array->len; i++) {
+		old_fv = (fvalue_t*)g_ptr_array_index(from_array, i);
 		new_fv = fvalue_slice(old_fv, d_range);
 		/* Assert here because semcheck.c should have
 		 * already caught the cases in which a slice
 		 * cannot be made. */
 		g_assert(new_fv);
-		to_list = g_list_append(to_list, new_fv);
+		g_ptr_array_add(to_array, new_fv);
+	}
+
+	df->free_registers[to_reg] = TRUE;
+}
+
+
+/*
+ * Specialized code.
+ *
+ * dfvm_specialize() turns each instruction of a filter into a
+ * dfvm_cinsn_t, which has a pointer to the function that carries it
+ * out and whatever that function needs, and dfvm_apply() runs those
+ * by calling the function of one after another, each returning the
+ * number of the next, instead of interpreting the instructions.
+ *
+ * Most instructions get a function that does what the interpreter does.
+ * A test of a field against a constant, where the field and the
+ * constant are integers of up to 32 bits, 64-bit integers, IPv4
+ * addresses or byte strings, gets a function that compares the values
+ * of the field with the constant directly rather than through the
+ * ftype's comparison function; all the ftypes of each of those kinds
+ * compare their values in the same way.  A slice of a byte string
+ * field that's only tested against a constant isn't made at all; the
+ * bytes of the field are compared with the constant where they are.
+ */
+static int
+run_check_exists(dfilter_t *df, proto_tree *tree, const dfvm_cinsn_t *ci,
+		gboolean *accum)
+{
+	*accum = check_exists(df, tree, ci->insn->arg1->value.hfinfo);
+	return ci->next;
+}
+
+static int
+run_read_tree(dfilter_t *df, proto_tree *tree, const dfvm_cinsn_t *ci,
+		gboolean *accum)
+{
+	*accum = read_tree(df, tree, ci->insn->arg1->value.hfinfo,
+			ci->insn->arg2->value.numeric);
+	return ci->next;
+}
+
+static int
+run_call_function(dfilter_t *df, proto_tree *tree _U_, const dfvm_cinsn_t *ci,
+		gboolean *accum)
+{
+	const dfvm_insn_t	*insn = ci->insn;
+	GPtrArray		*param1 = NULL;
+	GPtrArray		*param2 = NULL;
+
+	if (insn->arg3) {
+		param1 = df->registers[insn->arg3->value.numeric];
+	}
+	if (insn->arg4) {
+		param2 = df->registers[insn->arg4->value.numeric];
+	}
+	*accum = insn->arg1->value.funcdef->function(param1, param2,
+			df->registers[insn->arg2->value.numeric]);
+	df->free_registers[insn->arg2->value.numeric] = TRUE;
+	return ci->next;
+}
+
+static int
+run_mk_range(dfilter_t *df, proto_tree *tree _U_, const dfvm_cinsn_t *ci,
+		gboolean *accum _U_)
+{
+	mk_range(df, ci->insn->arg1->value.numeric, ci->insn->arg2->value.numeric,
+			ci->insn->arg3->value.drange);
+	return ci->next;
+}
+
+static int
+run_any_test(dfilter_t *df, proto_tree *tree _U_, const dfvm_cinsn_t *ci,
+		gboolean *accum)
+{
+	*accum = any_test(df, ci->cmp, ci->insn->arg1->value.numeric,
+			ci->insn->arg2->value.numeric);
+	return ci->next;
+}
+
+static int
+run_any_in(dfilter_t *df, proto_tree *tree _U_, const dfvm_cinsn_t *ci,
+		gboolean *accum)
+{
+	*accum = any_in(df, ci->insn->arg1->value.numeric,
+			ci->insn->arg2->value.set);
+	return ci->next;
+}
+
+static int
+run_any_contains_any(dfilter_t *df, proto_tree *tree _U_,
+		const dfvm_cinsn_t *ci, gboolean *accum)
+{
+	*accum = any_contains_any(df, ci->insn->arg1->value.numeric,
+			ci->insn->arg2->value.search);
+	return ci->next;
+}
+
+/* An instruction whose work is done by another */
+static int
+run_nothing(dfilter_t *df _U_, proto_tree *tree _U_, const dfvm_cinsn_t *ci,
+		gboolean *accum _U_)
+{
+	return ci->next;
+}
+
+static int
+run_not(dfilter_t *df _U_, proto_tree *tree _U_, const dfvm_cinsn_t *ci,
+		gboolean *accum)
+{
+	*accum = !*accum;
+	return ci->next;
+}
+
+static int
+run_return(dfilter_t *df, proto_tree *tree _U_, const dfvm_cinsn_t *ci _U_,
+		gboolean *accum _U_)
+{
+	free_register_overhead(df);
+	return -1;
+}
+
+static int
+run_store_result(dfilter_t *df, proto_tree *tree _U_, const dfvm_cinsn_t *ci,
+		gboolean *accum)
+{
+	guint32	n = ci->insn->arg1->value.numeric;
+
+	if (*accum) {
+		df->results[n / 32] |= 1U << (n % 32);
+	}
+	return ci->next;
+}
+
+static int
+run_skip_filter(dfilter_t *df, proto_tree *tree _U_, const dfvm_cinsn_t *ci,
+		gboolean *accum _U_)
+{
+	guint32	n = ci->insn->arg1->value.numeric;
+
+	if (df->wanted && !(df->wanted[n / 32] & (1U << (n % 32)))) {
+		return (int)ci->insn->arg2->value.numeric;
+	}
+	return ci->next;
+}
+
+static int
+run_if_true_goto(dfilter_t *df _U_, proto_tree *tree _U_, const dfvm_cinsn_t *ci,
+		gboolean *accum)
+{
+	return *accum ? (int)ci->insn->arg1->value.numeric : ci->next;
+}
+
+static int
+run_if_false_goto(dfilter_t *df _U_, proto_tree *tree _U_, const dfvm_cinsn_t *ci,
+		gboolean *accum)
+{
+	return *accum ? ci->next : (int)ci->insn->arg1->value.numeric;
+}
+
+/* Tests of the values of a field, v, against a constant, k; the field
+ * is the left-hand side of the test, as the specializer swaps the sides
+ * of a test with the constant on the left. */
+#define DEFINE_TEST(name, type, member, test) \
+static int \
+name(dfilter_t *df, proto_tree *tree _U_, const dfvm_cinsn_t *ci, \
+		gboolean *accum) \
+{ \
+	GPtrArray	*values = df->registers[ci->reg]; \
+	const type	k = ci->k.member; \
+	guint		i; \
+ \
+	for (i = 0; i < values->len; i++) { \
+		const type v = ((fvalue_t *)g_ptr_array_index(values, i))->value.member; \
+		if (test) { \
+			*accum = TRUE; \
+			return ci->next; \
+		} \
+	} \
+	*accum = FALSE; \
+	return ci->next; \
+}
 
-		from_list = g_list_next(from_list);
+DEFINE_TEST(run_uint_eq, guint32, uinteger, v == k)
+DEFINE_TEST(run_uint_ne, guint32, uinteger, v != k)
+DEFINE_TEST(run_uint_gt, guint32, uinteger, v > k)
+DEFINE_TEST(run_uint_ge, guint32, uinteger, v >= k)
+DEFINE_TEST(run_uint_lt, guint32, uinteger, v < k)
+DEFINE_TEST(run_uint_le, guint32, uinteger, v <= k)
+DEFINE_TEST(run_uint_and, guint32, uinteger, (v & k) != 0)
+DEFINE_TEST(run_sint_gt, gint32, sinteger, v > k)
+DEFINE_TEST(run_sint_ge, gint32, sinteger, v >= k)
+DEFINE_TEST(run_sint_lt, gint32, sinteger, v < k)
+DEFINE_TEST(run_sint_le, gint32, sinteger, v <= k)
+DEFINE_TEST(run_uint64_eq, guint64, uinteger64, v == k)
+DEFINE_TEST(run_uint64_ne, guint64, uinteger64, v != k)
+DEFINE_TEST(run_uint64_gt, guint64, uinteger64, v > k)
+DEFINE_TEST(run_uint64_ge, guint64, uinteger64, v >= k)
+DEFINE_TEST(run_uint64_lt, guint64, uinteger64, v < k)
+DEFINE_TEST(run_uint64_le, guint64, uinteger64, v <= k)
+DEFINE_TEST(run_uint64_and, guint64, uinteger64, (v & k) != 0)
+DEFINE_TEST(run_sint64_gt, gint64, sinteger64, v > k)
+DEFINE_TEST(run_sint64_ge, gint64, sinteger64, v >= k)
+DEFINE_TEST(run_sint64_lt, gint64, sinteger64, v < k)
+DEFINE_TEST(run_sint64_le, gint64, sinteger64, v <= k)
+
+/* IPv4 addresses are compared on the bits of the shorter netmask, as
+ * ipv4_addr_eq() and friends do. */
+#define IPV4_MASKED(a, b)	((a).addr & MIN((a).nmask, (b).nmask))
+
+DEFINE_TEST(run_ipv4_eq, ipv4_addr, ipv4, IPV4_MASKED(v, k) == IPV4_MASKED(k, v))
+DEFINE_TEST(run_ipv4_ne, ipv4_addr, ipv4, IPV4_MASKED(v, k) != IPV4_MASKED(k, v))
+DEFINE_TEST(run_ipv4_gt, ipv4_addr, ipv4, IPV4_MASKED(v, k) > IPV4_MASKED(k, v))
+DEFINE_TEST(run_ipv4_ge, ipv4_addr, ipv4, IPV4_MASKED(v, k) >= IPV4_MASKED(k, v))
+DEFINE_TEST(run_ipv4_lt, ipv4_addr, ipv4, IPV4_MASKED(v, k) < IPV4_MASKED(k, v))
+DEFINE_TEST(run_ipv4_le, ipv4_addr, ipv4, IPV4_MASKED(v, k) <= IPV4_MASKED(k, v))
+
+/* Work out where a slice of a single range starts in a field
+ * field_length bytes long and how long it is, as fvalue_slice() does.
+ * Returns FALSE if the range doesn't fit, which makes fvalue_slice()
+ * return an empty byte string. */
+static gboolean
+slice_bounds(drange_node *node, guint field_length, guint *p_start,
+		guint *p_length)
+{
+	gint	start_offset, end_offset, length;
+
+	start_offset = drange_node_get_start_offset(node);
+	if (start_offset < 0) {
+		start_offset = field_length + start_offset;
+		if (start_offset < 0) {
+			return FALSE;
+		}
+	}
+
+	switch (drange_node_get_ending(node)) {
+		case DRANGE_NODE_END_T_TO_THE_END:
+			length = field_length - start_offset;
+			if (length <= 0) {
+				return FALSE;
+			}
+			break;
+
+		case DRANGE_NODE_END_T_LENGTH:
+			length = drange_node_get_length(node);
+			if (start_offset + length > (int) field_length) {
+				return FALSE;
+			}
+			break;
+
+		case DRANGE_NODE_END_T_OFFSET:
+			end_offset = drange_node_get_end_offset(node);
+			if (end_offset < 0) {
+				end_offset = field_length + end_offset;
+				if (end_offset < start_offset) {
+					return FALSE;
+				}
+			} else if (end_offset >= (int) field_length) {
+				return FALSE;
+			}
+			length = end_offset - start_offset + 1;
+			break;
+
+		default:
+			g_assert_not_reached();
+			return FALSE;
 	}
 
-	df->registers[to_reg] = to_list;
+	*p_start = start_offset;
+	*p_length = length;
+	return TRUE;
 }
 
+/* Are the bytes of a value of a byte string field, or of the slice of
+ * them that's tested, the same as the constant? */
+static gboolean
+bytes_equal(const dfvm_cinsn_t *ci, const fvalue_t *fv)
+{
+	const GByteArray	*bytes = fv->value.bytes;
+	const GByteArray	*k = ci->k.bytes;
+	guint			start = 0;
+	guint			length = bytes->len;
 
+	if (ci->slice && !slice_bounds(ci->slice, bytes->len, &start, &length)) {
+		length = 0;
+	}
+	if (length != k->len) {
+		return FALSE;
+	}
+	return length == 0 || memcmp(bytes->data + start, k->data, length) == 0;
+}
+
+static int
+run_bytes_eq(dfilter_t *df, proto_tree *tree _U_, const dfvm_cinsn_t *ci,
+		gboolean *accum)
+{
+	GPtrArray	*values = df->registers[ci->reg];
+	guint		i;
+
+	for (i = 0; i < values->len; i++) {
+		if (bytes_equal(ci, (fvalue_t *)g_ptr_array_index(values, i))) {
+			*accum = TRUE;
+			return ci->next;
+		}
+	}
+	*accum = FALSE;
+	return ci->next;
+}
+
+static int
+run_bytes_ne(dfilter_t *df, proto_tree *tree _U_, const dfvm_cinsn_t *ci,
+		gboolean *accum)
+{
+	GPtrArray	*values = df->registers[ci->reg];
+	guint		i;
+
+	for (i = 0; i < values->len; i++) {
+		if (!bytes_equal(ci, (fvalue_t *)g_ptr_array_index(values, i))) {
+			*accum = TRUE;
+			return ci->next;
+		}
+	}
+	*accum = FALSE;
+	return ci->next;
+}
+
+static gboolean
+apply_code(dfilter_t *df, proto_tree *tree)
+{
+	const dfvm_cinsn_t	*code = df->code;
+	gboolean		accum = TRUE;
+	int			id = 0;
+
+	do {
+		id = code[id].handler(df, tree, &code[id], &accum);
+	} while (id >= 0);
+
+	return accum;
+}
 
 gboolean
 dfvm_apply(dfilter_t *df, proto_tree *tree)
@@ -425,11 +876,14 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 	dfvm_value_t	*arg2;
 	dfvm_value_t	*arg3 = NULL;
 	dfvm_value_t	*arg4 = NULL;
-	header_field_info	*hfinfo;
-	GList		*param1;
-	GList		*param2;
+	GPtrArray	*param1;
+	GPtrArray	*param2;
+
+	g_assert(tree || df->source);
 
-	g_assert(tree);
+	if (df->code) {
+		return apply_code(df, tree);
+	}
 
 	length = df->insns->len;
 
@@ -442,17 +896,7 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 
 		switch (insn->op) {
 			case CHECK_EXISTS:
-				hfinfo = arg1->value.hfinfo;
-				while(hfinfo) {
-					accum = proto_check_for_protocol_or_field(tree,
-							hfinfo->id);
-					if (accum) {
-						break;
-					}
-					else {
-						hfinfo = hfinfo->same_name_next;
-					}
-				}
+				accum = check_exists(df, tree, arg1->value.hfinfo);
 				break;
 
 			case READ_TREE:
@@ -472,7 +916,8 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 					param2 = df->registers[arg4->value.numeric];
 				}
 				accum = arg1->value.funcdef->function(param1, param2,
-						&df->registers[arg2->value.numeric]);
+						df->registers[arg2->value.numeric]);
+				df->free_registers[arg2->value.numeric] = TRUE;
 				break;
 
 			case MK_RANGE:
@@ -527,6 +972,16 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 						arg1->value.numeric, arg2->value.numeric);
 				break;
 
+			case ANY_IN:
+				accum = any_in(df, arg1->value.numeric,
+						arg2->value.set);
+				break;
+
+			case ANY_CONTAINS_ANY:
+				accum = any_contains_any(df, arg1->value.numeric,
+						arg2->value.search);
+				break;
+
 			case NOT:
 				accum = !accum;
 				break;
@@ -535,6 +990,23 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 				free_register_overhead(df);
 				return accum;
 
+			case STORE_RESULT:
+				/* The end of one of the filters of a batch */
+				if (accum) {
+					df->results[arg1->value.numeric / 32] |=
+						1U << (arg1->value.numeric % 32);
+				}
+				break;
+
+			case SKIP_FILTER:
+				/* The start of one of the filters of a batch */
+				if (df->wanted && !(df->wanted[arg1->value.numeric / 32] &
+						(1U << (arg1->value.numeric % 32)))) {
+					id = arg2->value.numeric;
+					goto AGAIN;
+				}
+				break;
+
 			case IF_TRUE_GOTO:
 				if (accum) {
 					id = arg1->value.numeric;
@@ -601,8 +1073,12 @@ dfvm_init_const(dfilter_t *df)
 			case ANY_BITWISE_AND:
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
+			case ANY_IN:
+			case ANY_CONTAINS_ANY:
 			case NOT:
 			case RETURN:
+			case STORE_RESULT:
+			case SKIP_FILTER:
 			case IF_TRUE_GOTO:
 			case IF_FALSE_GOTO:
 			default:
@@ -614,6 +1090,404 @@ dfvm_init_const(dfilter_t *df)
 	return;
 }
 
+/* The kinds of values that specialized tests compare; all the ftypes
+ * of a kind have the same comparison functions. */
+typedef enum {
+	KIND_NONE,
+	KIND_UINT,
+	KIND_SINT,
+	KIND_UINT64,
+	KIND_SINT64,
+	KIND_IPv4,
+	KIND_BYTES
+} value_kind_t;
+
+static value_kind_t
+ftype_kind(ftenum_t ftype)
+{
+	switch (ftype) {
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+			return KIND_UINT;
+
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+			return KIND_SINT;
+
+		case FT_UINT40:
+		case FT_UINT48:
+		case FT_UINT56:
+		case FT_UINT64:
+			return KIND_UINT64;
+
+		case FT_INT40:
+		case FT_INT48:
+		case FT_INT56:
+		case FT_INT64:
+			return KIND_SINT64;
+
+		case FT_IPv4:
+			return KIND_IPv4;
+
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_AX25:
+		case FT_VINES:
+		case FT_ETHER:
+		case FT_OID:
+		case FT_REL_OID:
+		case FT_SYSTEM_ID:
+		case FT_FCWWN:
+			return KIND_BYTES;
+
+		default:
+			return KIND_NONE;
+	}
+}
+
+/* The kind of the values a per-packet register can hold, worked out
+ * from the instructions that load it. */
+static value_kind_t
+register_kind(dfilter_t *df, guint reg)
+{
+	dfvm_insn_t		*insn;
+	header_field_info	*hfinfo;
+	value_kind_t		kind = KIND_NONE, insn_kind;
+	gboolean		loaded = FALSE;
+	guint			id;
+
+	for (id = 0; id < df->insns->len; id++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, id);
+		switch (insn->op) {
+			case READ_TREE:
+				if (insn->arg2->value.numeric != reg)
+					continue;
+				hfinfo = insn->arg1->value.hfinfo;
+				insn_kind = ftype_kind(hfinfo->type);
+				for (; hfinfo; hfinfo = hfinfo->same_name_next) {
+					if (ftype_kind(hfinfo->type) != insn_kind)
+						return KIND_NONE;
+				}
+				break;
+
+			case MK_RANGE:
+				if (insn->arg2->value.numeric != reg)
+					continue;
+				/* fvalue_slice() makes FT_BYTES values */
+				insn_kind = KIND_BYTES;
+				break;
+
+			case CALL_FUNCTION:
+				if (insn->arg2->value.numeric != reg)
+					continue;
+				return KIND_NONE;
+
+			default:
+				continue;
+		}
+		if (loaded && insn_kind != kind)
+			return KIND_NONE;
+		kind = insn_kind;
+		loaded = TRUE;
+	}
+
+	return kind;
+}
+
+/* How many instructions read a register? */
+static guint
+register_readers(dfilter_t *df, guint reg)
+{
+	dfvm_insn_t	*insn;
+	guint		id, n = 0;
+
+	for (id = 0; id < df->insns->len; id++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, id);
+		switch (insn->op) {
+			case ANY_EQ:
+			case ANY_NE:
+			case ANY_GT:
+			case ANY_GE:
+			case ANY_LT:
+			case ANY_LE:
+			case ANY_BITWISE_AND:
+			case ANY_CONTAINS:
+			case ANY_MATCHES:
+				n += insn->arg1->value.numeric == reg;
+				n += insn->arg2->value.numeric == reg;
+				break;
+
+			case ANY_IN:
+			case ANY_CONTAINS_ANY:
+			case MK_RANGE:
+				n += insn->arg1->value.numeric == reg;
+				break;
+
+			case CALL_FUNCTION:
+				n += insn->arg3 && insn->arg3->value.numeric == reg;
+				n += insn->arg4 && insn->arg4->value.numeric == reg;
+				break;
+
+			default:
+				break;
+		}
+	}
+	return n;
+}
+
+/* The specialized functions for a test, by kind, for the field on the
+ * left-hand side; NULL where there's none. */
+static const struct {
+	dfvm_opcode_t	op;
+	dfvm_handler_t	handlers[KIND_BYTES + 1];
+} specialized_tests[] = {
+	{ ANY_EQ, { NULL, run_uint_eq, run_uint_eq, run_uint64_eq, run_uint64_eq, run_ipv4_eq, run_bytes_eq } },
+	{ ANY_NE, { NULL, run_uint_ne, run_uint_ne, run_uint64_ne, run_uint64_ne, run_ipv4_ne, run_bytes_ne } },
+	{ ANY_GT, { NULL, run_uint_gt, run_sint_gt, run_uint64_gt, run_sint64_gt, run_ipv4_gt, NULL } },
+	{ ANY_GE, { NULL, run_uint_ge, run_sint_ge, run_uint64_ge, run_sint64_ge, run_ipv4_ge, NULL } },
+	{ ANY_LT, { NULL, run_uint_lt, run_sint_lt, run_uint64_lt, run_sint64_lt, run_ipv4_lt, NULL } },
+	{ ANY_LE, { NULL, run_uint_le, run_sint_le, run_uint64_le, run_sint64_le, run_ipv4_le, NULL } },
+	{ ANY_BITWISE_AND, { NULL, run_uint_and, run_uint_and, run_uint64_and, run_uint64_and, NULL, NULL } }
+};
+
+static const char *kind_names[] = {
+	NULL, "uint", "sint", "uint64", "sint64", "ipv4", "bytes"
+};
+
+/* The test that "const OP field" is, as "field OP' const". */
+static dfvm_opcode_t
+swap_test(dfvm_opcode_t op)
+{
+	switch (op) {
+		case ANY_GT:	return ANY_LT;
+		case ANY_GE:	return ANY_LE;
+		case ANY_LT:	return ANY_GT;
+		case ANY_LE:	return ANY_GE;
+		default:	return op;
+	}
+}
+
+/* Specialize a test of a per-packet register against a constant, if
+ * the values of both are of a kind that has a specialized function for
+ * that test.  If the register is made by a MK_RANGE of a single range of
+ * a byte string field, and nothing else reads it, the slice is compared
+ * where it is in the values of the field, and the MK_RANGE is skipped. */
+static void
+specialize_test(dfilter_t *df, dfvm_cinsn_t *ci)
+{
+	const dfvm_insn_t	*insn = ci->insn;
+	guint			reg1 = insn->arg1->value.numeric;
+	guint			reg2 = insn->arg2->value.numeric;
+	guint			field_reg, const_reg, id;
+	dfvm_opcode_t		op = insn->op;
+	value_kind_t		kind;
+	fvalue_t		*k;
+	dfvm_handler_t		handler = NULL;
+	dfvm_cinsn_t		*mk_range_ci;
+	drange_t		*range;
+
+	/* One side has to be a constant, the other loaded per packet */
+	if (reg1 < df->num_registers && reg2 >= df->num_registers) {
+		field_reg = reg1;
+		const_reg = reg2;
+	}
+	else if (reg2 < df->num_registers && reg1 >= df->num_registers) {
+		field_reg = reg2;
+		const_reg = reg1;
+		op = swap_test(op);
+	}
+	else {
+		return;
+	}
+
+	k = (fvalue_t *)g_ptr_array_index(df->registers[const_reg], 0);
+	kind = ftype_kind(fvalue_type_ftenum(k));
+	if (kind == KIND_NONE || register_kind(df, field_reg) != kind)
+		return;
+
+	for (id = 0; id < G_N_ELEMENTS(specialized_tests); id++) {
+		if (specialized_tests[id].op == op) {
+			handler = specialized_tests[id].handlers[kind];
+			break;
+		}
+	}
+	if (handler == NULL)
+		return;
+
+	ci->handler = handler;
+	ci->reg = field_reg;
+	ci->specialized = kind_names[kind];
+	switch (kind) {
+		case KIND_UINT:
+			ci->k.uinteger = k->value.uinteger;
+			break;
+		case KIND_SINT:
+			ci->k.sinteger = k->value.sinteger;
+			break;
+		case KIND_UINT64:
+			ci->k.uinteger64 = k->value.uinteger64;
+			break;
+		case KIND_SINT64:
+			ci->k.sinteger64 = k->value.sinteger64;
+			break;
+		case KIND_IPv4:
+			ci->k.ipv4 = k->value.ipv4;
+			break;
+		case KIND_BYTES:
+			ci->k.bytes = k->value.bytes;
+			break;
+		case KIND_NONE:
+		default:
+			g_assert_not_reached();
+	}
+
+	if (kind != KIND_BYTES || register_readers(df, field_reg) != 1)
+		return;
+
+	for (id = 0; id < df->insns->len; id++) {
+		mk_range_ci = &df->code[id];
+		if (mk_range_ci->insn->op != MK_RANGE ||
+		    mk_range_ci->insn->arg2->value.numeric != field_reg)
+			continue;
+
+		range = mk_range_ci->insn->arg3->value.drange;
+		if (g_slist_length(range->range_list) == 1 &&
+		    register_kind(df, mk_range_ci->insn->arg1->value.numeric) == KIND_BYTES) {
+			ci->reg = mk_range_ci->insn->arg1->value.numeric;
+			ci->slice = (drange_node *)range->range_list->data;
+			ci->specialized = "bytes slice";
+			mk_range_ci->handler = run_nothing;
+			mk_range_ci->specialized = "skipped";
+		}
+		break;
+	}
+}
+
+void
+dfvm_specialize(dfilter_t *df)
+{
+	dfvm_cinsn_t	*ci;
+	guint		id;
+
+	df->code = g_new0(dfvm_cinsn_t, df->insns->len);
+
+	for (id = 0; id < df->insns->len; id++) {
+		ci = &df->code[id];
+		ci->insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, id);
+		ci->next = id + 1;
+
+		switch (ci->insn->op) {
+			case CHECK_EXISTS:
+				ci->handler = run_check_exists;
+				break;
+			case READ_TREE:
+				ci->handler = run_read_tree;
+				break;
+			case CALL_FUNCTION:
+				ci->handler = run_call_function;
+				break;
+			case MK_RANGE:
+				ci->handler = run_mk_range;
+				break;
+			case ANY_EQ:
+				ci->handler = run_any_test;
+				ci->cmp = fvalue_eq;
+				break;
+			case ANY_NE:
+				ci->handler = run_any_test;
+				ci->cmp = fvalue_ne;
+				break;
+			case ANY_GT:
+				ci->handler = run_any_test;
+				ci->cmp = fvalue_gt;
+				break;
+			case ANY_GE:
+				ci->handler = run_any_test;
+				ci->cmp = fvalue_ge;
+				break;
+			case ANY_LT:
+				ci->handler = run_any_test;
+				ci->cmp = fvalue_lt;
+				break;
+			case ANY_LE:
+				ci->handler = run_any_test;
+				ci->cmp = fvalue_le;
+				break;
+			case ANY_BITWISE_AND:
+				ci->handler = run_any_test;
+				ci->cmp = fvalue_bitwise_and;
+				break;
+			case ANY_CONTAINS:
+				ci->handler = run_any_test;
+				ci->cmp = fvalue_contains;
+				break;
+			case ANY_MATCHES:
+				ci->handler = run_any_test;
+				ci->cmp = fvalue_matches;
+				break;
+			case ANY_IN:
+				ci->handler = run_any_in;
+				break;
+			case ANY_CONTAINS_ANY:
+				ci->handler = run_any_contains_any;
+				break;
+			case NOT:
+				ci->handler = run_not;
+				break;
+			case RETURN:
+				ci->handler = run_return;
+				break;
+			case STORE_RESULT:
+				ci->handler = run_store_result;
+				break;
+			case SKIP_FILTER:
+				ci->handler = run_skip_filter;
+				break;
+			case IF_TRUE_GOTO:
+				ci->handler = run_if_true_goto;
+				break;
+			case IF_FALSE_GOTO:
+				ci->handler = run_if_false_goto;
+				break;
+			case PUT_FVALUE:
+			default:
+				g_assert_not_reached();
+				break;
+		}
+	}
+
+	/* Now that every instruction has been made, specialize the tests;
+	 * that can change the MK_RANGE instructions they read. */
+	for (id = 0; id < df->insns->len; id++) {
+		ci = &df->code[id];
+		switch (ci->insn->op) {
+			case ANY_EQ:
+			case ANY_NE:
+			case ANY_GT:
+			case ANY_GE:
+			case ANY_LT:
+			case ANY_LE:
+			case ANY_BITWISE_AND:
+				specialize_test(df, ci);
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+void
+dfvm_free_code(dfilter_t *df)
+{
+	g_free(df->code);
+	df->code = NULL;
+}
+
+
 /*
  * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
  *
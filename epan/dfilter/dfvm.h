@@ -27,6 +27,8 @@
 #include "syntax-tree.h"
 #include "drange.h"
 #include "dfunctions.h"
+#include "dfset.h"
+#include "dfsearch.h"
 
 typedef enum {
 	EMPTY,
@@ -36,7 +38,9 @@ typedef enum {
 	REGISTER,
 	INTEGER,
 	DRANGE,
-	FUNCTION_DEF
+	FUNCTION_DEF,
+	FVALUE_SET,
+	FVALUE_SEARCH
 } dfvm_value_type_t;
 
 typedef struct {
@@ -48,6 +52,8 @@ typedef struct {
 		drange_t		*drange;
 		header_field_info	*hfinfo;
         df_func_def_t   *funcdef;
+		dfset_t			*set;
+		dfsearch_t		*search;
 	} value;
 
 } dfvm_value_t;
@@ -71,7 +77,11 @@ typedef enum {
 	ANY_BITWISE_AND,
 	ANY_CONTAINS,
 	ANY_MATCHES,
+	ANY_IN,
+	ANY_CONTAINS_ANY,
 	MK_RANGE,
+	STORE_RESULT,
+	SKIP_FILTER,
     CALL_FUNCTION
 
 } dfvm_opcode_t;
@@ -103,4 +113,16 @@ dfvm_apply(dfilter_t *df, proto_tree *tree);
 void
 dfvm_init_const(dfilter_t *df);
 
+/* Turn the instructions of a filter whose constants have been
+ * initialized into code that dfvm_apply() runs instead of interpreting
+ * them, with tests of integer, IPv4 and byte string fields against
+ * constants done on the values themselves rather than through the
+ * ftype functions. */
+void
+dfvm_specialize(dfilter_t *df);
+
+/* Free what dfvm_specialize() made. */
+void
+dfvm_free_code(dfilter_t *df);
+
 #endif
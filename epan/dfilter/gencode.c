@@ -27,6 +27,7 @@
 #include "sttype-range.h"
 #include "sttype-test.h"
 #include "sttype-function.h"
+#include "sttype-set.h"
 #include "ftypes/ftypes.h"
 
 static void
@@ -277,6 +278,77 @@ gen_relation(dfwork_t *dfw, dfvm_opcode_t op, stnode_t *st_arg1, stnode_t *st_ar
 	}
 }
 
+/* The members of the set aren't put into a register; they go into
+ * a dfset_t that belongs to the ANY_IN instruction, which looks the
+ * values of the LHS up in it. */
+static void
+gen_set_membership(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	dfvm_insn_t	*insn;
+	dfvm_value_t	*val1, *val2;
+	dfvm_value_t	*jmp = NULL;
+	dfset_t		*set;
+	GSList		*members;
+	int		reg;
+
+	reg = gen_entity(dfw, st_arg1, &jmp);
+
+	set = dfset_new();
+	for (members = sttype_set_members(st_arg2); members; members = members->next) {
+		dfset_add(set, (fvalue_t *)stnode_data((stnode_t *)members->data));
+	}
+
+	insn = dfvm_insn_new(ANY_IN);
+	val1 = dfvm_value_new(REGISTER);
+	val1->value.numeric = reg;
+	val2 = dfvm_value_new(FVALUE_SET);
+	val2->value.set = set;
+	insn->arg1 = val1;
+	insn->arg2 = val2;
+	dfw_append_insn(dfw, insn);
+
+	if (jmp) {
+		jmp->value.numeric = dfw->next_insn_id;
+	}
+}
+
+/* A "contains" test of a set of strings, which the optimizer makes from
+ * "||"ed "contains" tests of one field, is done like a set membership
+ * test: the strings go into a dfsearch_t that belongs to the
+ * ANY_CONTAINS_ANY instruction, which searches the values of the LHS for
+ * all of them at once. */
+static void
+gen_contains_any(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	dfvm_insn_t	*insn;
+	dfvm_value_t	*val1, *val2;
+	dfvm_value_t	*jmp = NULL;
+	dfsearch_t	*search;
+	GSList		*members;
+	int		reg;
+
+	reg = gen_entity(dfw, st_arg1, &jmp);
+
+	search = dfsearch_new();
+	for (members = sttype_set_members(st_arg2); members; members = members->next) {
+		dfsearch_add(search, (fvalue_t *)stnode_data((stnode_t *)members->data));
+	}
+	dfsearch_compile(search);
+
+	insn = dfvm_insn_new(ANY_CONTAINS_ANY);
+	val1 = dfvm_value_new(REGISTER);
+	val1->value.numeric = reg;
+	val2 = dfvm_value_new(FVALUE_SEARCH);
+	val2->value.search = search;
+	insn->arg1 = val1;
+	insn->arg2 = val2;
+	dfw_append_insn(dfw, insn);
+
+	if (jmp) {
+		jmp->value.numeric = dfw->next_insn_id;
+	}
+}
+
 /* Parse an entity, returning the reg that it gets put into.
  * p_jmp will be set if it has to be set by the calling code; it should
  * be set to the place to jump to, to return to the calling code,
@@ -416,12 +488,19 @@ gen_test(dfwork_t *dfw, stnode_t *st_node)
 			break;
 
 		case TEST_OP_CONTAINS:
-			gen_relation(dfw, ANY_CONTAINS, st_arg1, st_arg2);
+			if (stnode_type_id(st_arg2) == STTYPE_SET)
+				gen_contains_any(dfw, st_arg1, st_arg2);
+			else
+				gen_relation(dfw, ANY_CONTAINS, st_arg1, st_arg2);
 			break;
 
 		case TEST_OP_MATCHES:
 			gen_relation(dfw, ANY_MATCHES, st_arg1, st_arg2);
 			break;
+
+		case TEST_OP_IN:
+			gen_set_membership(dfw, st_arg1, st_arg2);
+			break;
 	}
 }
 
@@ -0,0 +1,595 @@
+/*
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "dfilter-int.h"
+#include "optimize.h"
+#include "syntax-tree.h"
+#include "sttype-range.h"
+#include "sttype-test.h"
+#include "sttype-function.h"
+#include "sttype-set.h"
+#include "dfsearch.h"
+
+#include <ftypes/ftypes-int.h>
+
+/*
+ * The optimizer works on the syntax tree rather than on the DFVM
+ * program.  It flattens each chain of "&&" or "||" tests and then:
+ *
+ *  - drops the tests that are the same as an earlier test in the chain;
+ *  - turns the "field == constant" and "field in {...}" tests of a "||"
+ *    chain that test the same field into a single test of whether any
+ *    occurrence of the field is in the set of all their constants, so
+ *    that the field is read and looked up in the set only once;
+ *  - likewise turns the "field contains string" tests of a "||" chain
+ *    that search the same field into a single test that searches it for
+ *    all of the strings at once;
+ *  - orders the tests of the chain by how much they cost to evaluate,
+ *    cheapest first, so that the chain stops as early, and as cheaply,
+ *    as it can.  Tests have no side effects, so their order doesn't
+ *    change the result.
+ *
+ * It also removes double negations.
+ */
+
+typedef struct {
+	guint	duplicates;	/* tests dropped as duplicates */
+	guint	negations;	/* double negations removed */
+	guint	sets;		/* set tests made */
+	guint	set_members;	/* tests folded into set tests */
+	guint	searches;	/* multiple-string "contains" tests made */
+	guint	search_members;	/* tests folded into those */
+	guint	reordered;	/* chains reordered by cost */
+} optimize_stats_t;
+
+static stnode_t *
+optimize_test(stnode_t *st_node, optimize_stats_t *stats);
+
+/* Free the fvalues held by FVALUE nodes in a subtree; stnode_free()
+ * frees the nodes, but not those. */
+static void
+free_fvalues(stnode_t *st_node)
+{
+	stnode_t	*st_arg1, *st_arg2;
+	GSList		*p;
+
+	if (st_node == NULL)
+		return;
+
+	switch (stnode_type_id(st_node)) {
+		case STTYPE_TEST:
+			sttype_test_get(st_node, NULL, &st_arg1, &st_arg2);
+			free_fvalues(st_arg1);
+			free_fvalues(st_arg2);
+			break;
+		case STTYPE_FVALUE:
+			FVALUE_FREE((fvalue_t *)stnode_data(st_node));
+			break;
+		case STTYPE_RANGE:
+			free_fvalues(sttype_range_entity(st_node));
+			break;
+		case STTYPE_FUNCTION:
+			for (p = sttype_function_params(st_node); p; p = p->next)
+				free_fvalues((stnode_t *)p->data);
+			break;
+		case STTYPE_SET:
+			for (p = sttype_set_members(st_node); p; p = p->next)
+				free_fvalues((stnode_t *)p->data);
+			break;
+		default:
+			break;
+	}
+}
+
+static void
+free_subtree(stnode_t *st_node)
+{
+	free_fvalues(st_node);
+	stnode_free(st_node);
+}
+
+/* Free a test node without freeing its operands. */
+static void
+free_test_node(stnode_t *st_node)
+{
+	sttype_test_set2_args(st_node, NULL, NULL);
+	stnode_free(st_node);
+}
+
+static gboolean
+fvalues_equal(fvalue_t *a, fvalue_t *b)
+{
+	char		*repr_a, *repr_b;
+	gboolean	equal;
+
+	if (fvalue_type_ftenum(a) != fvalue_type_ftenum(b))
+		return FALSE;
+
+	/* The representation of an address leaves out its netmask or
+	 * prefix, and that of a floating-point number may be rounded. */
+	switch (fvalue_type_ftenum(a)) {
+		case FT_IPv4:
+			return a->value.ipv4.addr == b->value.ipv4.addr &&
+			    a->value.ipv4.nmask == b->value.ipv4.nmask;
+		case FT_IPv6:
+			return memcmp(a->value.ipv6.addr.bytes,
+			    b->value.ipv6.addr.bytes, 16) == 0 &&
+			    a->value.ipv6.prefix == b->value.ipv6.prefix;
+		case FT_FLOAT:
+		case FT_DOUBLE:
+			return a->value.floating == b->value.floating;
+		default:
+			break;
+	}
+
+	/* Not every type can be compared with ==, but two values that
+	 * the display filter language writes the same way are the same. */
+	repr_a = fvalue_to_string_repr(a, FTREPR_DFILTER, BASE_NONE, NULL);
+	repr_b = fvalue_to_string_repr(b, FTREPR_DFILTER, BASE_NONE, NULL);
+	equal = repr_a != NULL && repr_b != NULL && strcmp(repr_a, repr_b) == 0;
+	g_free(repr_a);
+	g_free(repr_b);
+	return equal;
+}
+
+/* Are two subtrees certain to evaluate to the same thing?  Ranges and
+ * functions are never considered equal. */
+static gboolean
+nodes_equal(stnode_t *a, stnode_t *b)
+{
+	test_op_t	op_a, op_b;
+	stnode_t	*a1, *a2, *b1, *b2;
+	GSList		*pa, *pb;
+
+	if (a == NULL || b == NULL)
+		return a == b;
+
+	if (stnode_type_id(a) != stnode_type_id(b))
+		return FALSE;
+
+	switch (stnode_type_id(a)) {
+		case STTYPE_TEST:
+			sttype_test_get(a, &op_a, &a1, &a2);
+			sttype_test_get(b, &op_b, &b1, &b2);
+			return op_a == op_b && nodes_equal(a1, b1) && nodes_equal(a2, b2);
+		case STTYPE_FIELD:
+			return stnode_data(a) == stnode_data(b);
+		case STTYPE_FVALUE:
+			return fvalues_equal((fvalue_t *)stnode_data(a),
+			    (fvalue_t *)stnode_data(b));
+		case STTYPE_SET:
+			if (sttype_set_count(a) != sttype_set_count(b))
+				return FALSE;
+			for (pa = sttype_set_members(a), pb = sttype_set_members(b);
+			    pa && pb; pa = pa->next, pb = pb->next) {
+				if (!nodes_equal((stnode_t *)pa->data, (stnode_t *)pb->data))
+					return FALSE;
+			}
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+/* Rough relative cost of loading an entity into a register. */
+static guint
+entity_cost(stnode_t *st_node)
+{
+	guint	cost;
+	GSList	*p;
+
+	switch (stnode_type_id(st_node)) {
+		case STTYPE_FIELD:
+			return 2;
+		case STTYPE_RANGE:
+			return entity_cost(sttype_range_entity(st_node)) + 2;
+		case STTYPE_FUNCTION:
+			cost = 4;
+			for (p = sttype_function_params(st_node); p; p = p->next)
+				cost += entity_cost((stnode_t *)p->data);
+			return cost;
+		default:
+			/* Constants are loaded once, not per packet. */
+			return 0;
+	}
+}
+
+/* Rough relative cost of evaluating a test: checking for a field is
+ * cheapest, comparisons cost more than that, searching for a substring
+ * more still, and matching a regular expression most of all. */
+static guint
+test_cost(stnode_t *st_node)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+
+	sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+
+	switch (st_op) {
+		case TEST_OP_EXISTS:
+			return 1;
+		case TEST_OP_NOT:
+			return test_cost(st_arg1);
+		case TEST_OP_AND:
+		case TEST_OP_OR:
+			return test_cost(st_arg1) + test_cost(st_arg2);
+		case TEST_OP_CONTAINS:
+			if (stnode_type_id(st_arg2) == STTYPE_SET)
+				return entity_cost(st_arg1) + 4 + sttype_set_count(st_arg2) / 8;
+			return entity_cost(st_arg1) + entity_cost(st_arg2) + 4;
+		case TEST_OP_MATCHES:
+			return entity_cost(st_arg1) + entity_cost(st_arg2) + 16;
+		case TEST_OP_IN:
+			return entity_cost(st_arg1) + 1 + sttype_set_count(st_arg2) / 4;
+		default:
+			return entity_cost(st_arg1) + entity_cost(st_arg2) + 1;
+	}
+}
+
+/* Take the operands of a chain of tests that are all combined with
+ * chain_op, freeing the nodes that combined them. */
+static void
+flatten_chain(stnode_t *st_node, test_op_t chain_op, GPtrArray *operands)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+
+	sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+	if (st_op != chain_op) {
+		g_ptr_array_add(operands, st_node);
+		return;
+	}
+	free_test_node(st_node);
+	flatten_chain(st_arg1, chain_op, operands);
+	flatten_chain(st_arg2, chain_op, operands);
+}
+
+/* If a test holds when a field is equal to one of some constants, i.e.
+ * it's "field == constant" or "field in {...}", return the field, and
+ * the nodes for the field and for the constant or the set. */
+static header_field_info *
+member_test(stnode_t *st_node, test_op_t *p_op, stnode_t **p_field,
+    stnode_t **p_value)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+
+	sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+	if (st_op != TEST_OP_EQ && st_op != TEST_OP_IN)
+		return NULL;
+
+	if (stnode_type_id(st_arg1) == STTYPE_FIELD &&
+	    (stnode_type_id(st_arg2) == STTYPE_FVALUE ||
+	     stnode_type_id(st_arg2) == STTYPE_SET)) {
+		*p_field = st_arg1;
+		*p_value = st_arg2;
+	}
+	else if (stnode_type_id(st_arg1) == STTYPE_FVALUE &&
+	    stnode_type_id(st_arg2) == STTYPE_FIELD) {
+		*p_field = st_arg2;
+		*p_value = st_arg1;
+	}
+	else {
+		return NULL;
+	}
+	*p_op = st_op;
+	return (header_field_info *)stnode_data(*p_field);
+}
+
+/* In a chain of "||" tests, fold the tests that compare the same field
+ * with a constant, or with the members of a set, into a single test of
+ * whether the field is in the set of all those constants. */
+static void
+lower_to_sets(GPtrArray *operands, optimize_stats_t *stats)
+{
+	guint			i, j;
+	test_op_t		op_i, op_j;
+	stnode_t		*field_i, *value_i, *field_j, *value_j;
+	stnode_t		*test_i, *test_j;
+	stnode_t		*set;
+	header_field_info	*hfinfo;
+
+	for (i = 0; i < operands->len; i++) {
+		test_i = (stnode_t *)g_ptr_array_index(operands, i);
+		hfinfo = member_test(test_i, &op_i, &field_i, &value_i);
+		if (hfinfo == NULL)
+			continue;
+
+		set = NULL;
+		for (j = i + 1; j < operands->len; ) {
+			test_j = (stnode_t *)g_ptr_array_index(operands, j);
+
+			if (member_test(test_j, &op_j, &field_j, &value_j) != hfinfo) {
+				j++;
+				continue;
+			}
+
+			if (set == NULL) {
+				if (op_i == TEST_OP_IN) {
+					set = value_i;
+				}
+				else {
+					set = stnode_new(STTYPE_SET, NULL);
+					sttype_set_add(set, value_i);
+					sttype_test_set2(test_i, TEST_OP_IN,
+					    field_i, set);
+				}
+				stats->sets++;
+				stats->set_members++;
+			}
+			if (op_j == TEST_OP_IN) {
+				sttype_set_merge(set, value_j);
+				stnode_free(value_j);
+			}
+			else {
+				sttype_set_add(set, value_j);
+			}
+			stnode_free(field_j);
+			free_test_node(test_j);
+			g_ptr_array_remove_index(operands, j);
+			stats->set_members++;
+		}
+	}
+}
+
+/* If a test searches a field for a string or byte string, i.e. it's
+ * "field contains constant", or for any of a set of them, return the
+ * field, and the nodes for the field and for the constant or the set. */
+static header_field_info *
+search_test(stnode_t *st_node, stnode_t **p_field, stnode_t **p_value)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+
+	sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+	if (st_op != TEST_OP_CONTAINS || stnode_type_id(st_arg1) != STTYPE_FIELD)
+		return NULL;
+
+	if (stnode_type_id(st_arg2) == STTYPE_FVALUE) {
+		if (!dfsearch_searchable((fvalue_t *)stnode_data(st_arg2)))
+			return NULL;
+	}
+	else if (stnode_type_id(st_arg2) != STTYPE_SET) {
+		return NULL;
+	}
+	*p_field = st_arg1;
+	*p_value = st_arg2;
+	return (header_field_info *)stnode_data(st_arg1);
+}
+
+/* In a chain of "||" tests, fold the tests that search the same field
+ * for a string into a single test that searches it for all of them. */
+static void
+lower_to_searches(GPtrArray *operands, optimize_stats_t *stats)
+{
+	guint			i, j;
+	stnode_t		*field_i, *value_i, *field_j, *value_j;
+	stnode_t		*test_i, *test_j;
+	stnode_t		*set;
+	header_field_info	*hfinfo;
+
+	for (i = 0; i < operands->len; i++) {
+		test_i = (stnode_t *)g_ptr_array_index(operands, i);
+		hfinfo = search_test(test_i, &field_i, &value_i);
+		if (hfinfo == NULL)
+			continue;
+
+		set = NULL;
+		for (j = i + 1; j < operands->len; ) {
+			test_j = (stnode_t *)g_ptr_array_index(operands, j);
+
+			if (search_test(test_j, &field_j, &value_j) != hfinfo) {
+				j++;
+				continue;
+			}
+
+			if (set == NULL) {
+				if (stnode_type_id(value_i) == STTYPE_SET) {
+					set = value_i;
+				}
+				else {
+					set = stnode_new(STTYPE_SET, NULL);
+					sttype_set_add(set, value_i);
+					sttype_test_set2(test_i, TEST_OP_CONTAINS,
+					    field_i, set);
+				}
+				stats->searches++;
+				stats->search_members++;
+			}
+			if (stnode_type_id(value_j) == STTYPE_SET) {
+				sttype_set_merge(set, value_j);
+				stnode_free(value_j);
+			}
+			else {
+				sttype_set_add(set, value_j);
+			}
+			stnode_free(field_j);
+			free_test_node(test_j);
+			g_ptr_array_remove_index(operands, j);
+			stats->search_members++;
+		}
+	}
+}
+
+/* Sort the tests of a chain by cost, keeping tests of equal cost in the
+ * order in which they were written. */
+static gboolean
+sort_by_cost(GPtrArray *operands)
+{
+	guint		i, j, n = operands->len;
+	guint		*costs;
+	gpointer	node;
+	guint		cost;
+	gboolean	moved = FALSE;
+
+	costs = g_new(guint, n);
+	for (i = 0; i < n; i++)
+		costs[i] = test_cost((stnode_t *)g_ptr_array_index(operands, i));
+
+	for (i = 1; i < n; i++) {
+		node = g_ptr_array_index(operands, i);
+		cost = costs[i];
+		for (j = i; j > 0 && costs[j - 1] > cost; j--) {
+			g_ptr_array_index(operands, j) = g_ptr_array_index(operands, j - 1);
+			costs[j] = costs[j - 1];
+			moved = TRUE;
+		}
+		g_ptr_array_index(operands, j) = node;
+		costs[j] = cost;
+	}
+
+	g_free(costs);
+	return moved;
+}
+
+static stnode_t *
+optimize_chain(stnode_t *st_node, test_op_t chain_op, optimize_stats_t *stats)
+{
+	GPtrArray	*operands;
+	guint		i, j;
+	stnode_t	*chain;
+
+	operands = g_ptr_array_new();
+	flatten_chain(st_node, chain_op, operands);
+
+	for (i = 0; i < operands->len; i++) {
+		g_ptr_array_index(operands, i) = optimize_test(
+		    (stnode_t *)g_ptr_array_index(operands, i), stats);
+	}
+
+	for (i = 0; i < operands->len; i++) {
+		for (j = i + 1; j < operands->len; ) {
+			if (nodes_equal((stnode_t *)g_ptr_array_index(operands, i),
+			    (stnode_t *)g_ptr_array_index(operands, j))) {
+				free_subtree((stnode_t *)g_ptr_array_index(operands, j));
+				g_ptr_array_remove_index(operands, j);
+				stats->duplicates++;
+			}
+			else {
+				j++;
+			}
+		}
+	}
+
+	if (chain_op == TEST_OP_OR) {
+		lower_to_sets(operands, stats);
+		lower_to_searches(operands, stats);
+	}
+
+	if (sort_by_cost(operands))
+		stats->reordered++;
+
+	/* Rebuild the chain so that each test jumps straight to the end
+	 * when it decides the result: a op (b op (c op d)). */
+	chain = (stnode_t *)g_ptr_array_index(operands, operands->len - 1);
+	for (i = operands->len - 1; i > 0; i--) {
+		st_node = stnode_new(STTYPE_TEST, NULL);
+		sttype_test_set2(st_node, chain_op,
+		    (stnode_t *)g_ptr_array_index(operands, i - 1), chain);
+		chain = st_node;
+	}
+
+	g_ptr_array_free(operands, TRUE);
+	return chain;
+}
+
+static stnode_t *
+optimize_test(stnode_t *st_node, optimize_stats_t *stats)
+{
+	test_op_t	st_op, inner_op;
+	stnode_t	*st_arg1, *inner_arg;
+
+	sttype_test_get(st_node, &st_op, &st_arg1, NULL);
+
+	switch (st_op) {
+		case TEST_OP_NOT:
+			st_arg1 = optimize_test(st_arg1, stats);
+			sttype_test_get(st_arg1, &inner_op, &inner_arg, NULL);
+			if (inner_op == TEST_OP_NOT) {
+				/* !!x is x */
+				free_test_node(st_arg1);
+				free_test_node(st_node);
+				stats->negations++;
+				return inner_arg;
+			}
+			sttype_test_set2_args(st_node, st_arg1, NULL);
+			return st_node;
+
+		case TEST_OP_AND:
+		case TEST_OP_OR:
+			return optimize_chain(st_node, st_op, stats);
+
+		default:
+			return st_node;
+	}
+}
+
+void
+dfw_optimize(dfwork_t *dfw)
+{
+	optimize_stats_t	stats;
+
+	memset(&stats, 0, sizeof stats);
+
+	/* The parser assures that the top-most syntax-tree node will be
+	 * a TEST node. */
+	g_assert(stnode_type_id(dfw->st_root) == STTYPE_TEST);
+	dfw->st_root = optimize_test(dfw->st_root, &stats);
+
+	dfw->optimizations = g_ptr_array_new();
+	if (stats.duplicates)
+		g_ptr_array_add(dfw->optimizations, g_strdup_printf(
+		    "%u duplicate test%s removed", stats.duplicates,
+		    stats.duplicates == 1 ? "" : "s"));
+	if (stats.negations)
+		g_ptr_array_add(dfw->optimizations, g_strdup_printf(
+		    "%u double negation%s removed", stats.negations,
+		    stats.negations == 1 ? "" : "s"));
+	if (stats.sets)
+		g_ptr_array_add(dfw->optimizations, g_strdup_printf(
+		    "%u tests merged into %u set test%s", stats.set_members,
+		    stats.sets, stats.sets == 1 ? "" : "s"));
+	if (stats.searches)
+		g_ptr_array_add(dfw->optimizations, g_strdup_printf(
+		    "%u \"contains\" tests merged into %u multiple-string search%s",
+		    stats.search_members, stats.searches,
+		    stats.searches == 1 ? "" : "es"));
+	if (stats.reordered)
+		g_ptr_array_add(dfw->optimizations, g_strdup_printf(
+		    "%u chain%s of tests reordered by cost", stats.reordered,
+		    stats.reordered == 1 ? "" : "s"));
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
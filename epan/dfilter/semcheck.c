@@ -28,6 +28,7 @@
 #include "sttype-range.h"
 #include "sttype-test.h"
 #include "sttype-function.h"
+#include "sttype-set.h"
 
 #include <epan/exceptions.h>
 #include <epan/packet.h>
@@ -430,6 +431,7 @@ check_exists(dfwork_t *dfw, stnode_t *st_arg1)
 		case STTYPE_TEST:
 		case STTYPE_INTEGER:
 		case STTYPE_FVALUE:
+		case STTYPE_SET:
 		case STTYPE_NUM_TYPES:
 			g_assert_not_reached();
 	}
@@ -1257,6 +1259,42 @@ header_field_info   *hfinfo;
 	}
 }
 
+/* Check the semantics of a set membership test.  The LHS is in the
+ * set if it's equal to one of the members, so each member is checked,
+ * and converted to an fvalue, as the RHS of an "==" test would be. */
+static void
+check_set_membership(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	stnode_t	*st_eq;
+	GSList		*members;
+
+	switch (stnode_type_id(st_arg1)) {
+		case STTYPE_FIELD:
+		case STTYPE_RANGE:
+		case STTYPE_FUNCTION:
+			break;
+		default:
+			dfilter_fail(dfw, "Only a field, a slice or a function can be tested for membership of a set.");
+			THROW(TypeError);
+	}
+
+	/* The "==" test borrows the LHS and the member it's checking. */
+	st_eq = stnode_new(STTYPE_TEST, NULL);
+	TRY {
+		for (members = sttype_set_members(st_arg2); members; members = members->next) {
+			sttype_test_set2(st_eq, TEST_OP_EQ, st_arg1, (stnode_t *)members->data);
+			check_relation(dfw, "in", FALSE, ftype_can_eq, st_eq,
+					st_arg1, (stnode_t *)members->data);
+			sttype_test_get(st_eq, NULL, NULL, (stnode_t **)&members->data);
+		}
+	}
+	FINALLY {
+		sttype_test_set2_args(st_eq, NULL, NULL);
+		stnode_free(st_eq);
+	}
+	ENDTRY;
+}
+
 /* Check the semantics of any type of TEST */
 static void
 check_test(dfwork_t *dfw, stnode_t *st_node, GPtrArray *deprecated)
@@ -1332,6 +1370,9 @@ check_test(dfwork_t *dfw, stnode_t *st_node, GPtrArray *deprecated)
 			break;
 		case TEST_OP_MATCHES:
 			check_relation(dfw, "matches", TRUE, ftype_can_matches, st_node, st_arg1, st_arg2);			break;
+		case TEST_OP_IN:
+			check_set_membership(dfw, st_arg1, st_arg2);
+			break;
 
 		default:
 			g_assert_not_reached();
@@ -0,0 +1,159 @@
+/*
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include "syntax-tree.h"
+#include "sttype-set.h"
+
+typedef struct {
+	guint32		magic;
+	GSList		*members;
+	GSList		*last;		/* so that adding a member is O(1) */
+	guint		count;
+} set_t;
+
+#define SET_MAGIC	0x5e75e700
+
+static gpointer
+set_new(gpointer junk)
+{
+	set_t		*set;
+
+	g_assert(junk == NULL);
+
+	set = g_new(set_t, 1);
+
+	set->magic = SET_MAGIC;
+	set->members = NULL;
+	set->last = NULL;
+	set->count = 0;
+
+	return (gpointer) set;
+}
+
+static gpointer
+set_dup(gconstpointer data)
+{
+	const set_t	*org = (const set_t *)data;
+	set_t		*set;
+	GSList		*p;
+
+	set = (set_t *)set_new(NULL);
+
+	for (p = org->members; p; p = p->next) {
+		set->members = g_slist_prepend(set->members,
+		    stnode_dup((const stnode_t *)p->data));
+	}
+	set->last = set->members;
+	set->members = g_slist_reverse(set->members);
+	set->count = org->count;
+
+	return (gpointer) set;
+}
+
+static void
+set_free(gpointer value)
+{
+	set_t	*set = (set_t *)value;
+	GSList	*p;
+
+	assert_magic(set, SET_MAGIC);
+
+	for (p = set->members; p; p = p->next) {
+		stnode_free((stnode_t *)p->data);
+	}
+	g_slist_free(set->members);
+	g_free(set);
+}
+
+void
+sttype_set_add(stnode_t *node, stnode_t *member)
+{
+	set_t	*set;
+
+	set = (set_t *)stnode_data(node);
+	assert_magic(set, SET_MAGIC);
+
+	if (set->last) {
+		set->last = g_slist_append(set->last, member)->next;
+	}
+	else {
+		set->members = set->last = g_slist_append(NULL, member);
+	}
+	set->count++;
+}
+
+void
+sttype_set_merge(stnode_t *node, stnode_t *other)
+{
+	set_t	*set, *set2;
+
+	set = (set_t *)stnode_data(node);
+	assert_magic(set, SET_MAGIC);
+	set2 = (set_t *)stnode_data(other);
+	assert_magic(set2, SET_MAGIC);
+
+	if (set2->members == NULL)
+		return;
+
+	if (set->last) {
+		set->last->next = set2->members;
+	}
+	else {
+		set->members = set2->members;
+	}
+	set->last = set2->last;
+	set->count += set2->count;
+
+	set2->members = NULL;
+	set2->last = NULL;
+	set2->count = 0;
+}
+
+STTYPE_ACCESSOR(GSList*, set, members, SET_MAGIC)
+STTYPE_ACCESSOR(guint, set, count, SET_MAGIC)
+
+void
+sttype_register_set(void)
+{
+	static sttype_t set_type = {
+		STTYPE_SET,
+		"SET",
+		set_new,
+		set_free,
+		set_dup
+	};
+
+	sttype_register(&set_type);
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
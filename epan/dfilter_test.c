@@ -0,0 +1,655 @@
+/* dfilter_test.c
+ * Tests for the display filter API, the field cache and protocol sets
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <wsutil/filesystem.h>
+#include <wsutil/privileges.h>
+
+#include <wiretap/wtap.h>
+
+#include "epan.h"
+#include "epan_dissect.h"
+#include "frame_data.h"
+#include "tvbuff.h"
+#include "dfilter/dfilter.h"
+#include "dfilter/dfcache.h"
+#include "protocol_set.h"
+#include "register.h"
+
+static dfilter_t *
+compile(const char *text)
+{
+    dfilter_t *df = NULL;
+    gchar *err_msg = NULL;
+    gboolean ok;
+
+    ok = dfilter_compile(text, &df, &err_msg);
+    if (!ok)
+        g_error("can't compile \"%s\": %s", text, err_msg);
+    return df;
+}
+
+/* Does the filter "text" refine "old_text", i.e. would the results of
+   "old_text" be reused when "text" is applied after it? */
+static gboolean
+refines(const char *text, const char *old_text)
+{
+    dfilter_t *df, *old_df;
+    gboolean ret;
+
+    df = compile(text);
+    old_df = compile(old_text);
+    ret = dfilter_refines(df, old_df);
+    dfilter_free(df);
+    dfilter_free(old_df);
+    return ret;
+}
+
+static void
+dfilter_test_refines_same(void)
+{
+    g_assert(refines("ip.src == 10.0.0.1", "ip.src == 10.0.0.1"));
+    g_assert(refines("tcp.port==80", "tcp.port == 0x50"));
+    g_assert(refines("ip.src == 10.0.0.1 && tcp.port == 80",
+                     "tcp.port == 80 && ip.src == 10.0.0.1"));
+    g_assert(!refines("ip.src == 10.0.0.0/8", "ip.src == 10.0.0.0/16"));
+    g_assert(!refines("ip.src == 10.0.0.0/16", "ip.src == 10.0.0.0/8"));
+}
+
+/* A filter that narrows down the last one reuses its results... */
+static void
+dfilter_test_refines_narrowed(void)
+{
+    g_assert(refines("ip.src == 10.0.0.1 && tcp.port == 80",
+                     "ip.src == 10.0.0.1"));
+    g_assert(refines("tcp.port == 80 && tcp.flags.syn == 1 && ip.src == 10.0.0.1",
+                     "ip.src == 10.0.0.1 && tcp.port == 80"));
+    g_assert(refines("(ip.src == 10.0.0.1 || tcp.port == 80) && udp",
+                     "ip.src == 10.0.0.1 || tcp.port == 80"));
+}
+
+/* ...and one that broadens it doesn't. */
+static void
+dfilter_test_refines_broadened(void)
+{
+    g_assert(!refines("ip.src == 10.0.0.1",
+                      "ip.src == 10.0.0.1 && tcp.port == 80"));
+    g_assert(!refines("ip.src == 10.0.0.1 && udp",
+                      "ip.src == 10.0.0.1 && tcp.port == 80"));
+    g_assert(!refines("ip.src == 10.0.0.1", "ip.src == 10.0.0.2"));
+}
+
+static void
+dfilter_test_refines_or(void)
+{
+    g_assert(!refines("ip.src == 10.0.0.1 || tcp.port == 80",
+                      "ip.src == 10.0.0.1"));
+    g_assert(!refines("ip.src == 10.0.0.1 || tcp.port == 80",
+                      "tcp.port == 80"));
+    g_assert(!refines("(ip.src == 10.0.0.1 && tcp.port == 80) || udp",
+                      "ip.src == 10.0.0.1"));
+}
+
+static void
+dfilter_test_refines_not(void)
+{
+    g_assert(!refines("!ip.src == 10.0.0.1", "ip.src == 10.0.0.1"));
+    g_assert(!refines("ip.src == 10.0.0.1", "!ip.src == 10.0.0.1"));
+    g_assert(!refines("!(ip.src == 10.0.0.1 && tcp.port == 80)",
+                      "ip.src == 10.0.0.1"));
+    g_assert(!refines("!(ip.src == 10.0.0.1 && tcp.port == 80)",
+                      "!ip.src == 10.0.0.1"));
+    g_assert(!refines("!ip.src == 10.0.0.1",
+                      "!(ip.src == 10.0.0.1 && tcp.port == 80)"));
+}
+
+static void
+dfilter_test_refines_function(void)
+{
+    g_assert(!refines("len(http.host) == 3", "len(http.host) == 3"));
+    g_assert(!refines("len(http.host) == 3 && tcp.port == 80",
+                      "tcp.port == 80"));
+    g_assert(!refines("tcp.port == 80",
+                      "len(http.host) == 3 && tcp.port == 80"));
+    g_assert(!refines("upper(http.host) == \"A\" && tcp.port == 80",
+                      "upper(http.host) == \"A\""));
+}
+
+static void
+dfilter_test_refines_null(void)
+{
+    dfilter_t *df;
+
+    df = compile("tcp.port == 80");
+    g_assert(dfilter_refines(df, NULL));
+    g_assert(!dfilter_refines(NULL, df));
+    g_assert(dfilter_refines(NULL, NULL));
+    dfilter_free(df);
+}
+
+/* The field cache, protocol set and refiltering tests dissect the frames
+   of a capture file, which is given on the command line; they aren't run
+   without one. */
+static const char *capture_file;
+
+#define MAX_FRAMES      64
+#define MAX_FILTERS     8
+
+typedef struct {
+    guint n_dfs;
+    dfilter_t *dfs[MAX_FILTERS];
+    guint32 n_frames;
+    /* The results of the filters on the frames freshly dissected */
+    gboolean passed[MAX_FRAMES][MAX_FILTERS];
+    /* The number of the set of protocols each frame has */
+    guint16 proto_sets[MAX_FRAMES];
+} capture_test_t;
+
+static void
+compile_filters(capture_test_t *t, const char **filters, guint n_filters)
+{
+    guint i;
+
+    g_assert(n_filters <= MAX_FILTERS);
+    for (i = 0; i < n_filters; i++)
+        t->dfs[i] = compile(filters[i]);
+    t->n_dfs = n_filters;
+}
+
+static void
+free_filters(capture_test_t *t)
+{
+    guint i;
+
+    for (i = 0; i < t->n_dfs; i++)
+        dfilter_free(t->dfs[i]);
+    t->n_dfs = 0;
+}
+
+/* Dissects each frame of the capture file, as cf_read() does, noting the
+   results of the filters, and storing the frame's fields in the cache
+   and recording its protocols in the table, if there are ones. */
+static void
+dissect_capture(capture_test_t *t, dfcache_t *cache,
+                protocol_set_table_t *sets)
+{
+    wtap *wth;
+    epan_t *session;
+    epan_dissect_t *edt;
+    frame_data fdata;
+    const frame_data *ref;
+    struct wtap_pkthdr *phdr;
+    nstime_t elapsed_time;
+    gint64 data_offset;
+    guint32 cum_bytes = 0;
+    gchar *err_info = NULL;
+    int err;
+    guint i;
+
+    wth = wtap_open_offline(capture_file, WTAP_TYPE_AUTO, &err, &err_info, FALSE);
+    g_assert(wth != NULL);
+    session = epan_new();
+    nstime_set_zero(&elapsed_time);
+
+    t->n_frames = 0;
+    while (wtap_read(wth, &err, &err_info, &data_offset)) {
+        g_assert(t->n_frames < MAX_FRAMES);
+        phdr = wtap_phdr(wth);
+        frame_data_init(&fdata, t->n_frames + 1, phdr, data_offset, cum_bytes);
+        ref = NULL;
+        frame_data_set_before_dissect(&fdata, &elapsed_time, &ref, NULL);
+
+        edt = epan_dissect_new(session, TRUE, FALSE);
+        if (sets != NULL)
+            epan_dissect_fake_protocols(edt, FALSE);
+        for (i = 0; i < t->n_dfs; i++)
+            epan_dissect_prime_dfilter(edt, t->dfs[i]);
+        if (cache != NULL)
+            dfcache_prime(cache, edt);
+        epan_dissect_run(edt, wtap_file_type_subtype(wth), phdr,
+                         tvb_new_real_data(wtap_buf_ptr(wth), phdr->caplen, phdr->caplen),
+                         &fdata, NULL);
+        if (cache != NULL)
+            dfcache_store_frame(cache, fdata.num, edt);
+        t->proto_sets[t->n_frames] = (sets != NULL) ?
+            protocol_set_table_add_tree(sets, edt->tree) : 0;
+        for (i = 0; i < t->n_dfs; i++)
+            t->passed[t->n_frames][i] = dfilter_apply_edt(t->dfs[i], edt);
+        epan_dissect_free(edt);
+
+        frame_data_set_after_dissect(&fdata, &cum_bytes);
+        frame_data_destroy(&fdata);
+        t->n_frames++;
+    }
+    g_assert(err == 0);
+    g_assert(t->n_frames > 0);
+
+    epan_free(session);
+    wtap_close(wth);
+}
+
+static const char *cache_filters[] = {
+    "bootp",
+    "bootp.option.dhcp == 1",
+    "udp.srcport == 67",
+    "ip.src == 0.0.0.0 && udp.dstport == 67",
+    "frame.len > 320",
+    "!(bootp.option.dhcp in {1 3})",
+    "tcp"
+};
+
+/* Compiles the filters, and has the cache keep all their fields. */
+static dfcache_t *
+new_cache(capture_test_t *t, gsize memory_limit)
+{
+    dfcache_t *cache;
+    guint i;
+
+    compile_filters(t, cache_filters, G_N_ELEMENTS(cache_filters));
+
+    cache = dfcache_new();
+    dfcache_set_memory_limit(cache, memory_limit);
+    for (i = 0; i < t->n_dfs; i++)
+        dfcache_use_filter(cache, t->dfs[i]);
+    for (i = 0; i < t->n_dfs; i++)
+        g_assert(dfcache_use_filter(cache, t->dfs[i]));
+    return cache;
+}
+
+static void
+free_cache(capture_test_t *t, dfcache_t *cache)
+{
+    dfcache_free(cache);
+    free_filters(t);
+}
+
+/* Is every frame stored in the cache, with every filter giving the same
+   result on the stored values as on the dissected frame? */
+static void
+check_cached(capture_test_t *t, dfcache_t *cache)
+{
+    gboolean stored, passed;
+    guint32 framenum;
+    guint i;
+
+    for (framenum = 1; framenum <= t->n_frames; framenum++) {
+        for (i = 0; i < t->n_dfs; i++) {
+            stored = dfcache_apply(cache, framenum, t->dfs[i], NULL, NULL, &passed);
+            g_assert(stored);
+            g_assert(passed == t->passed[framenum - 1][i]);
+        }
+    }
+}
+
+static gboolean
+frame_stored(capture_test_t *t, dfcache_t *cache, guint32 framenum)
+{
+    gboolean passed;
+
+    return dfcache_apply(cache, framenum, t->dfs[0], NULL, NULL, &passed);
+}
+
+static void
+dfcache_test_cached(void)
+{
+    capture_test_t t;
+    dfcache_t *cache;
+
+    cache = new_cache(&t, 1024 * 1024);
+    dissect_capture(&t, cache, NULL);
+    check_cached(&t, cache);
+    free_cache(&t, cache);
+}
+
+/* With no memory to keep them in, the records all go to the temporary
+   file, and must read back the same. */
+static void
+dfcache_test_spill(void)
+{
+    capture_test_t t;
+    dfcache_t *cache;
+
+    cache = new_cache(&t, 0);
+    dissect_capture(&t, cache, NULL);
+    check_cached(&t, cache);
+
+    /* Frames stored again after a clear are written over the file. */
+    dfcache_clear(cache);
+    dissect_capture(&t, cache, NULL);
+    check_cached(&t, cache);
+    free_cache(&t, cache);
+}
+
+/* A change to the preferences has the frames dissected again, and
+   clears the cache. */
+static void
+dfcache_test_invalidate_clear(void)
+{
+    capture_test_t t;
+    dfcache_t *cache;
+    guint32 framenum;
+
+    cache = new_cache(&t, 1024 * 1024);
+    dissect_capture(&t, cache, NULL);
+    dfcache_clear(cache);
+    for (framenum = 1; framenum <= t.n_frames; framenum++)
+        g_assert(!frame_stored(&t, cache, framenum));
+    free_cache(&t, cache);
+}
+
+static void
+dfcache_test_invalidate_frame(void)
+{
+    capture_test_t t;
+    dfcache_t *cache;
+    guint32 framenum;
+
+    cache = new_cache(&t, 1024 * 1024);
+    dissect_capture(&t, cache, NULL);
+    dfcache_forget_frame(cache, 1);
+    g_assert(!frame_stored(&t, cache, 1));
+    for (framenum = 2; framenum <= t.n_frames; framenum++)
+        g_assert(frame_stored(&t, cache, framenum));
+    free_cache(&t, cache);
+}
+
+static void
+dfcache_test_invalidate_filter(void)
+{
+    capture_test_t t;
+    dfcache_t *cache;
+    dfilter_t *df;
+    guint32 framenum;
+
+    cache = new_cache(&t, 1024 * 1024);
+    dissect_capture(&t, cache, NULL);
+
+    /* A filter on a field that can't be kept isn't covered, but leaves
+       what's kept alone... */
+    df = compile("frame.time_relative > 1");
+    g_assert(!dfcache_use_filter(cache, df));
+    dfilter_free(df);
+    for (framenum = 1; framenum <= t.n_frames; framenum++)
+        g_assert(frame_stored(&t, cache, framenum));
+
+    /* ...but one on fields that can be has them kept from then on, and
+       the frames stored without them are forgotten. */
+    df = compile("bootp.hw.len == 6");
+    g_assert(!dfcache_use_filter(cache, df));
+    for (framenum = 1; framenum <= t.n_frames; framenum++)
+        g_assert(!frame_stored(&t, cache, framenum));
+    g_assert(dfcache_use_filter(cache, df));
+    dfilter_free(df);
+
+    dissect_capture(&t, cache, NULL);
+    check_cached(&t, cache);
+    free_cache(&t, cache);
+}
+
+static const char *protocol_filters[] = {
+    "bootp",
+    "!arp",
+    "udp && !tcp",
+    "ip || ipv6",
+    "eth && !(dns || http)",
+    "!bootp"
+};
+
+/* Each filter that only tests for protocols must give the same result
+   on the set of protocols a frame has as on the frame. */
+static void
+protocol_set_test_filter(void)
+{
+    capture_test_t t;
+    protocol_set_table_t *sets;
+    protocol_set_filter_t *psf;
+    gboolean ok, passed;
+    guint32 framenum;
+    guint i;
+
+    compile_filters(&t, protocol_filters, G_N_ELEMENTS(protocol_filters));
+    sets = protocol_set_table_new();
+    dissect_capture(&t, NULL, sets);
+
+    for (i = 0; i < t.n_dfs; i++) {
+        psf = protocol_set_filter_new(sets, t.dfs[i]);
+        g_assert(psf != NULL);
+        for (framenum = 1; framenum <= t.n_frames; framenum++) {
+            ok = protocol_set_filter_apply(psf, t.proto_sets[framenum - 1], &passed);
+            g_assert(ok);
+            g_assert(passed == t.passed[framenum - 1][i]);
+        }
+        protocol_set_filter_free(psf);
+    }
+
+    protocol_set_table_free(sets);
+    free_filters(&t);
+}
+
+static void
+protocol_set_test_values(void)
+{
+    protocol_set_table_t *sets;
+    dfilter_t *df;
+
+    sets = protocol_set_table_new();
+    df = compile("udp.port == 67");
+    g_assert(protocol_set_filter_new(sets, df) == NULL);
+    dfilter_free(df);
+    df = compile("bootp && bootp.option.dhcp");
+    g_assert(protocol_set_filter_new(sets, df) == NULL);
+    dfilter_free(df);
+    df = compile("frame.len > 320");
+    g_assert(protocol_set_filter_new(sets, df) == NULL);
+    dfilter_free(df);
+    protocol_set_table_free(sets);
+}
+
+static void
+protocol_set_test_contains(void)
+{
+    static const char *filters[] = { "bootp" };
+    capture_test_t t;
+    protocol_set_table_t *sets;
+    guint32 framenum;
+    guint16 set;
+
+    compile_filters(&t, filters, G_N_ELEMENTS(filters));
+    sets = protocol_set_table_new();
+    dissect_capture(&t, NULL, sets);
+
+    /* The frames of dhcp.pcap have the same protocols, so they share
+       a set. */
+    set = t.proto_sets[0];
+    g_assert(set != 0);
+    for (framenum = 1; framenum <= t.n_frames; framenum++)
+        g_assert(t.proto_sets[framenum - 1] == set);
+    g_assert(protocol_set_contains(sets, set, proto_get_id_by_filter_name("udp")));
+    g_assert(protocol_set_contains(sets, set, proto_get_id_by_filter_name("bootp")));
+    g_assert(!protocol_set_contains(sets, set, proto_get_id_by_filter_name("tcp")));
+    g_assert(!protocol_set_contains(sets, set + 1, proto_get_id_by_filter_name("udp")));
+    g_assert(!protocol_set_contains(sets, 0, proto_get_id_by_filter_name("udp")));
+
+    protocol_set_table_free(sets);
+    free_filters(&t);
+}
+
+/* Once the table has been cleared, as it is when the frames are to be
+   dissected from scratch, the sets the frames had are unknown. */
+static void
+protocol_set_test_clear(void)
+{
+    static const char *filters[] = { "bootp" };
+    capture_test_t t;
+    protocol_set_table_t *sets;
+    protocol_set_filter_t *psf;
+    gboolean passed;
+
+    compile_filters(&t, filters, G_N_ELEMENTS(filters));
+    sets = protocol_set_table_new();
+    dissect_capture(&t, NULL, sets);
+    protocol_set_table_clear(sets);
+
+    psf = protocol_set_filter_new(sets, t.dfs[0]);
+    g_assert(psf != NULL);
+    g_assert(!protocol_set_filter_apply(psf, t.proto_sets[0], &passed));
+    g_assert(!protocol_set_filter_apply(psf, 0, &passed));
+    g_assert(!protocol_set_contains(sets, t.proto_sets[0],
+                                    proto_get_id_by_filter_name("udp")));
+    protocol_set_filter_free(psf);
+
+    protocol_set_table_free(sets);
+    free_filters(&t);
+}
+
+/* Applies "text" after "old_text", which it refines, the way
+   rescan_packets() does: the frames that failed "old_text" fail it, and
+   of the others, those whose fate can be found from their sets of
+   protocols or from the field cache aren't dissected.  The results must
+   be those of "text" on the frames freshly dissected, and no frame may
+   have to be dissected again. */
+static void
+refilter(const char *old_text, const char *text)
+{
+    capture_test_t old_t, t;
+    dfcache_t *cache;
+    protocol_set_table_t *sets;
+    protocol_set_filter_t *psf;
+    gboolean use_cache, passed;
+    guint32 framenum;
+    guint dissected = 0;
+
+    compile_filters(&old_t, &old_text, 1);
+    cache = dfcache_new();
+    dfcache_set_memory_limit(cache, 1024 * 1024);
+    dfcache_use_filter(cache, old_t.dfs[0]);
+    sets = protocol_set_table_new();
+    dissect_capture(&old_t, cache, sets);
+
+    compile_filters(&t, &text, 1);
+    g_assert(dfilter_refines(t.dfs[0], old_t.dfs[0]));
+    use_cache = dfcache_use_filter(cache, t.dfs[0]);
+    psf = protocol_set_filter_new(sets, t.dfs[0]);
+    dissect_capture(&t, NULL, NULL);
+
+    for (framenum = 1; framenum <= t.n_frames; framenum++) {
+        if (!old_t.passed[framenum - 1][0])
+            passed = FALSE;
+        else if (psf != NULL &&
+                 protocol_set_filter_apply(psf, old_t.proto_sets[framenum - 1], &passed))
+            ;
+        else if (use_cache &&
+                 dfcache_apply(cache, framenum, t.dfs[0], NULL, NULL, &passed))
+            ;
+        else {
+            passed = t.passed[framenum - 1][0];
+            dissected++;
+        }
+        g_assert(passed == t.passed[framenum - 1][0]);
+    }
+    g_assert(dissected == 0);
+
+    if (psf != NULL)
+        protocol_set_filter_free(psf);
+    protocol_set_table_free(sets);
+    dfcache_free(cache);
+    free_filters(&t);
+    free_filters(&old_t);
+}
+
+static void
+refilter_test_protocols(void)
+{
+    refilter("udp", "udp && bootp");
+    refilter("bootp", "bootp && !tcp");
+}
+
+static void
+refilter_test_fields(void)
+{
+    refilter("udp", "udp && ip.src == 0.0.0.0");
+    refilter("ip.src == 0.0.0.0", "ip.src == 0.0.0.0 && udp.port == 67");
+}
+
+int
+main(int argc, char **argv)
+{
+    char *progfile_dir_error;
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/dfilter/refines/same",      dfilter_test_refines_same);
+    g_test_add_func("/dfilter/refines/narrowed",  dfilter_test_refines_narrowed);
+    g_test_add_func("/dfilter/refines/broadened", dfilter_test_refines_broadened);
+    g_test_add_func("/dfilter/refines/or",        dfilter_test_refines_or);
+    g_test_add_func("/dfilter/refines/not",       dfilter_test_refines_not);
+    g_test_add_func("/dfilter/refines/function",  dfilter_test_refines_function);
+    g_test_add_func("/dfilter/refines/null",      dfilter_test_refines_null);
+
+    if (argc > 1) {
+        capture_file = argv[1];
+        g_test_add_func("/dfcache/cached",            dfcache_test_cached);
+        g_test_add_func("/dfcache/spill",             dfcache_test_spill);
+        g_test_add_func("/dfcache/invalidate/clear",  dfcache_test_invalidate_clear);
+        g_test_add_func("/dfcache/invalidate/frame",  dfcache_test_invalidate_frame);
+        g_test_add_func("/dfcache/invalidate/filter", dfcache_test_invalidate_filter);
+        g_test_add_func("/protocol_set/filter",       protocol_set_test_filter);
+        g_test_add_func("/protocol_set/values",       protocol_set_test_values);
+        g_test_add_func("/protocol_set/contains",     protocol_set_test_contains);
+        g_test_add_func("/protocol_set/clear",        protocol_set_test_clear);
+        g_test_add_func("/refilter/protocols",        refilter_test_protocols);
+        g_test_add_func("/refilter/fields",           refilter_test_fields);
+    }
+
+    init_process_policies();
+    progfile_dir_error = init_progfile_dir(argv[0], (void *)main);
+    g_free(progfile_dir_error);
+
+    epan_init(register_all_protocols, register_all_protocol_handoffs,
+              NULL, NULL);
+
+    ret = g_test_run();
+
+    epan_cleanup();
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -384,6 +384,7 @@ proto_register_file(void)
 
 	proto_file = proto_register_protocol("File", "File", "file");
 	proto_register_field_array(proto_file, hf, array_length(hf));
+	packet_prune_field_needs_all_layers(hf_file_protocols);
 	proto_register_subtree_array(ett, array_length(ett));
 	new_register_dissector("file",dissect_file_record,proto_file);
 
@@ -411,6 +411,25 @@ ata_init(void)
 
 }
 
+/* Drop the unanswered commands of the conversations that are being expired */
+static gboolean
+ata_cmd_expiring(gpointer key, gpointer value _U_, gpointer user_data _U_)
+{
+  ata_info_t *ata_info=(ata_info_t *)key;
+
+  if(!conversation_expiring(ata_info->conversation)){
+    return FALSE;
+  }
+  wmem_free(wmem_file_scope(), ata_info);
+  return TRUE;
+}
+
+static void
+ata_expire_conversations(void)
+{
+  g_hash_table_foreach_remove(ata_cmd_unmatched, ata_cmd_expiring, NULL);
+}
+
 void
 proto_register_aoe(void)
 {
@@ -480,6 +499,7 @@ proto_register_aoe(void)
   aoe_handle = register_dissector("aoe", dissect_aoe, proto_aoe);
 
   register_init_routine(ata_init);
+  conversation_register_expire_func(ata_expire_conversations);
 }
 
 void
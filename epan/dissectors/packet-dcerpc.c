@@ -5953,6 +5953,49 @@ dissect_dcerpc_dg(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *dat
     return TRUE;
 }
 
+/* Drop the binds and calls of the conversations that are being expired,
+   and free their keys */
+static gboolean
+dcerpc_bind_expiring(gpointer key, gpointer value _U_, gpointer user_data _U_)
+{
+    dcerpc_bind_key *bind_key = (dcerpc_bind_key *)key;
+
+    if (!conversation_expiring(bind_key->conv))
+        return FALSE;
+    wmem_free(wmem_file_scope(), bind_key);
+    return TRUE;
+}
+
+static gboolean
+dcerpc_cn_call_expiring(gpointer key, gpointer value _U_, gpointer user_data _U_)
+{
+    dcerpc_cn_call_key *call_key = (dcerpc_cn_call_key *)key;
+
+    if (!conversation_expiring(call_key->conv))
+        return FALSE;
+    wmem_free(wmem_file_scope(), call_key);
+    return TRUE;
+}
+
+static gboolean
+dcerpc_dg_call_expiring(gpointer key, gpointer value _U_, gpointer user_data _U_)
+{
+    dcerpc_dg_call_key *call_key = (dcerpc_dg_call_key *)key;
+
+    if (!conversation_expiring(call_key->conv))
+        return FALSE;
+    wmem_free(wmem_file_scope(), call_key);
+    return TRUE;
+}
+
+static void
+dcerpc_expire_conversations(void)
+{
+    g_hash_table_foreach_remove(dcerpc_binds, dcerpc_bind_expiring, NULL);
+    g_hash_table_foreach_remove(dcerpc_cn_calls, dcerpc_cn_call_expiring, NULL);
+    g_hash_table_foreach_remove(dcerpc_dg_calls, dcerpc_dg_call_expiring, NULL);
+}
+
 static void
 dcerpc_init_protocol(void)
 {
@@ -6379,6 +6422,7 @@ proto_register_dcerpc(void)
     expert_register_field_array(expert_dcerpc, ei, array_length(ei));
 
     register_init_routine(dcerpc_init_protocol);
+    conversation_register_expire_func(dcerpc_expire_conversations);
     dcerpc_module = prefs_register_protocol(proto_dcerpc, NULL);
     prefs_register_bool_preference(dcerpc_module,
                                    "desegment_dcerpc",
@@ -3642,6 +3642,16 @@ dissect_answer_records(tvbuff_t *tvb, int cur_off, int dns_data_offset,
   return cur_off - start_off;
 }
 
+/* Free the data of a conversation that's being expired */
+static void
+free_dns_conversation_data(void *data)
+{
+  dns_conv_info_t *dns_info = (dns_conv_info_t *)data;
+
+  wmem_tree_destroy(dns_info->pdus, TRUE);
+  wmem_free(wmem_file_scope(), dns_info);
+}
+
 static void
 dissect_dns_common(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
     gboolean is_tcp, gboolean is_mdns, gboolean is_llmnr)
@@ -5559,6 +5569,8 @@ proto_register_dns(void)
   dns_tsig_dissector_table = register_dissector_table("dns.tsig.mac", "DNS TSIG MAC Dissectors", FT_STRING, BASE_NONE);
 
   dns_tap = register_tap("dns");
+
+  conversation_register_proto_data_free(proto_dns, free_dns_conversation_data);
 }
 
 /*
@@ -1926,6 +1926,7 @@ proto_register_dtls(void)
   dtls_associations = g_tree_new(ssl_association_cmp);
 
   register_init_routine(dtls_init);
+  conversation_register_proto_data_free(proto_dtls, ssl_free_session);
   ssl_lib_init();
   dtls_tap = register_tap("dtls");
   ssl_debug_printf("proto_register_dtls: registered tap %s:%d\n",
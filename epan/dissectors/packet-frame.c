@@ -149,6 +149,9 @@ static const value_string packet_word_reception_types[] = {
 dissector_table_t wtap_encap_dissector_table;
 static dissector_table_t wtap_fts_rec_dissector_table;
 
+/* Shift offset of frames whose time stamps haven't been shifted */
+static const nstime_t no_shift_offset = { 0, 0 };
+
 /*
  * Routine used to register frame end routine.  The routine should only
  * be registered when the dissector is used in the frame, not in the
@@ -178,6 +181,7 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree, void*
 	proto_tree  *comments_tree;
 	proto_item  *item;
 	const gchar *cap_plurality, *frame_plurality;
+	const nstime_t *shift_offset;
 	frame_data_t *fr_data = (frame_data_t*)data;
 
 	tree=parent_tree;
@@ -350,8 +354,11 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree, void*
 								  " the valid range is 0-1000000000",
 								  (long) pinfo->fd->abs_ts.nsecs);
 			}
+			shift_offset = epan_get_frame_shift_offset(pinfo->epan, pinfo->fd->num);
+			if (shift_offset == NULL)
+				shift_offset = &no_shift_offset;
 			item = proto_tree_add_time(fh_tree, hf_frame_shift_offset, tvb,
-					    0, 0, &(pinfo->fd->shift_offset));
+					    0, 0, shift_offset);
 			PROTO_ITEM_SET_GENERATED(item);
 
 			if (generate_epoch_time) {
@@ -876,6 +883,7 @@ proto_register_frame(void)
 	proto_frame = proto_register_protocol("Frame", "Frame", "frame");
 	proto_pkt_comment = proto_register_protocol("Packet comments", "Pkt_Comment", "pkt_comment");
 	proto_register_field_array(proto_frame, hf, array_length(hf));
+	packet_prune_field_needs_all_layers(hf_frame_protocols);
 	proto_register_field_array(proto_frame, &hf_encap, 1);
 	proto_register_subtree_array(ett, array_length(ett));
 	expert_frame = expert_register_protocol(proto_frame);
@@ -608,6 +608,24 @@ dissect_http_kerberos(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
 }
 
 
+/* Free the data of a conversation that's being expired */
+static void
+free_http_conversation_data(void *data)
+{
+	http_conv_t *conv_data = (http_conv_t *)data;
+	http_req_res_t *req_res, *prev;
+
+	for (req_res = conv_data->req_res_tail; req_res != NULL; req_res = prev) {
+		prev = req_res->prev;
+		wmem_free(wmem_file_scope(), req_res);
+	}
+	wmem_free(wmem_file_scope(), conv_data->http_host);
+	wmem_free(wmem_file_scope(), conv_data->request_method);
+	wmem_free(wmem_file_scope(), conv_data->request_uri);
+	wmem_free(wmem_file_scope(), (void *)conv_data->server_addr.data);
+	wmem_free(wmem_file_scope(), conv_data);
+}
+
 static http_conv_t *
 get_http_conversation_data(packet_info *pinfo)
 {
@@ -3376,6 +3394,8 @@ proto_register_http(void)
 	 */
 	http_tap = register_tap("http"); /* HTTP statistics tap */
 	http_eo_tap = register_tap("http_eo"); /* HTTP Export Object tap */
+
+	conversation_register_proto_data_free(proto_http, free_http_conversation_data);
 }
 
 /*
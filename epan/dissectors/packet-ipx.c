@@ -531,6 +531,26 @@ spx_postseq_cleanup(void)
 	}
 }
 
+/* Drop the packets of the conversations that are being expired */
+static gboolean
+spx_hash_expiring(gpointer key, gpointer value, gpointer user_data _U_)
+{
+	spx_hash_key		*spx_key = (spx_hash_key *)key;
+
+	if (!conversation_expiring(spx_key->conversation))
+		return FALSE;
+	wmem_free(wmem_file_scope(), spx_key);
+	wmem_free(wmem_file_scope(), value);
+	return TRUE;
+}
+
+static void
+spx_expire_conversations(void)
+{
+	if (spx_hash)
+		g_hash_table_foreach_remove(spx_hash, spx_hash_expiring, NULL);
+}
+
 static spx_hash_value*
 spx_hash_insert(conversation_t *conversation, guint32 spx_src, guint16 spx_seq)
 {
@@ -1604,6 +1624,7 @@ proto_register_ipx(void)
 
 	register_init_routine(&spx_init_protocol);
 	register_postseq_cleanup_routine(&spx_postseq_cleanup);
+	conversation_register_expire_func(spx_expire_conversations);
 	ipx_tap=register_tap("ipx");
 
 	register_conversation_table(proto_ipx, TRUE, ipx_conversation_packet, ipx_hostlist_packet);
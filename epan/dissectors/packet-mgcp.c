@@ -582,6 +582,23 @@ static void mgcp_init_protocol(void)
 	mgcp_calls = g_hash_table_new(mgcp_call_hash, mgcp_call_equal);
 }
 
+/* Drop the calls of the conversations that are being expired */
+static gboolean mgcp_call_expiring(gpointer key, gpointer value, gpointer user_data _U_)
+{
+	mgcp_call_info_key *call_key = (mgcp_call_info_key *)key;
+
+	if (!conversation_expiring(call_key->conversation))
+		return FALSE;
+	wmem_free(wmem_file_scope(), call_key);
+	wmem_free(wmem_file_scope(), value);
+	return TRUE;
+}
+
+static void mgcp_expire_conversations(void)
+{
+	g_hash_table_foreach_remove(mgcp_calls, mgcp_call_expiring, NULL);
+}
+
 
 /*
  * is_mgcp_verb - A function for determining whether there is a
@@ -2210,6 +2227,7 @@ void proto_register_mgcp(void)
 	proto_register_field_array(proto_mgcp, hf, array_length(hf));
 	proto_register_subtree_array(ett, array_length(ett));
 	register_init_routine(&mgcp_init_protocol);
+	conversation_register_expire_func(mgcp_expire_conversations);
 
 	new_register_dissector("mgcp", dissect_mgcp, proto_mgcp);
 
@@ -250,6 +250,25 @@ mncp_postseq_cleanup(void)
 {
 }
 
+/* Drop the sessions of the conversations that are being expired */
+static gboolean
+mncp_expiring(gpointer key, gpointer value, gpointer user_data _U_)
+{
+    mncp_rhash_key *mncp_key = (mncp_rhash_key *)key;
+
+    if (!conversation_expiring(mncp_key->conversation))
+        return FALSE;
+    wmem_free(wmem_file_scope(), mncp_key);
+    wmem_free(wmem_file_scope(), value);
+    return TRUE;
+}
+
+static void
+mncp_expire_conversations(void)
+{
+    g_hash_table_foreach_remove(mncp_rhash, mncp_expiring, NULL);
+}
+
 static mncp_rhash_value*
 mncp_hash_insert(conversation_t *conversation, guint32 nwconnection, guint8 nwtask, packet_info *pinfo)
 {
@@ -1135,6 +1154,7 @@ proto_register_ncp(void)
     ncp_tap.stat=register_tap("ncp_srt");
     ncp_tap.hdr=register_tap("ncp");
     register_postseq_cleanup_routine(&mncp_postseq_cleanup);
+    conversation_register_expire_func(mncp_expire_conversations);
 
     register_conversation_table(proto_ncp, FALSE, ncp_conversation_packet, ncp_hostlist_packet);
 }
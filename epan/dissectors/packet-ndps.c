@@ -4104,6 +4104,26 @@ ndps_postseq_cleanup(void)
      * needed during random-access processing of the proto_tree.*/
 }
 
+/* Drop the requests of the conversations that are being expired */
+static gboolean
+ndps_hash_expiring(gpointer key, gpointer value, gpointer user_data _U_)
+{
+    ndps_req_hash_key           *request_key = (ndps_req_hash_key *)key;
+
+    if (!conversation_expiring(request_key->conversation))
+        return FALSE;
+    wmem_free(wmem_file_scope(), request_key);
+    wmem_free(wmem_file_scope(), value);
+    return TRUE;
+}
+
+static void
+ndps_expire_conversations(void)
+{
+    if (ndps_req_hash)
+        g_hash_table_foreach_remove(ndps_req_hash, ndps_hash_expiring, NULL);
+}
+
 static ndps_req_hash_value*
 ndps_hash_insert(conversation_t *conversation, guint32 ndps_xport)
 {
@@ -9522,6 +9542,7 @@ proto_register_ndps(void)
 
     register_init_routine(&ndps_init_protocol);
     register_postseq_cleanup_routine(&ndps_postseq_cleanup);
+    conversation_register_expire_func(ndps_expire_conversations);
 }
 
 void
@@ -1930,6 +1930,25 @@ radius_init_protocol(void)
 	radius_calls = g_hash_table_new(radius_call_hash, radius_call_equal);
 }
 
+/* Drop the calls of the conversations that are being expired */
+static gboolean
+radius_call_expiring(gpointer key, gpointer value, gpointer user_data _U_)
+{
+	radius_call_info_key *call_key = (radius_call_info_key *)key;
+
+	if (!conversation_expiring(call_key->conversation))
+		return FALSE;
+	wmem_free(wmem_file_scope(), call_key);
+	wmem_free(wmem_file_scope(), value);
+	return TRUE;
+}
+
+static void
+radius_expire_conversations(void)
+{
+	g_hash_table_foreach_remove(radius_calls, radius_call_expiring, NULL);
+}
+
 static void register_radius_fields(const char* unused _U_) {
 	 hf_register_info base_hf[] = {
 		 { &hf_radius_req,
@@ -2110,6 +2129,7 @@ proto_register_radius(void)
 	proto_radius = proto_register_protocol("Radius Protocol", "RADIUS", "radius");
 	new_register_dissector("radius", dissect_radius, proto_radius);
 	register_init_routine(&radius_init_protocol);
+	conversation_register_expire_func(radius_expire_conversations);
 	radius_module = prefs_register_protocol(proto_radius, proto_reg_handoff_radius);
 	prefs_register_string_preference(radius_module,"shared_secret","Shared Secret",
 					 "Shared secret used to decode User Passwords",
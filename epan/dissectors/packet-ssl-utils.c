@@ -2525,6 +2525,24 @@ ssl_create_decoder(SslCipherSuite *cipher_suite, gint compression,
     return dec;
 }
 
+static void
+ssl_decoder_destroy(SslDecoder *dec)
+{
+    if (dec == NULL)
+        return;
+
+    ssl_cipher_cleanup(&dec->evp);
+    if (dec->decomp != NULL) {
+#ifdef HAVE_LIBZ
+        inflateEnd(&dec->decomp->istream);
+#endif
+        wmem_free(wmem_file_scope(), dec->decomp);
+    }
+    wmem_tree_destroy(dec->flow->multisegment_pdus, TRUE);
+    wmem_free(wmem_file_scope(), dec->flow);
+    wmem_free(wmem_file_scope(), dec);
+}
+
 static int
 ssl_decrypt_pre_master_secret(SslDecryptSession *ssl_session,
                               StringInfo *encrypted_pre_master,
@@ -3973,6 +3991,11 @@ ssl_cipher_setiv(SSL_CIPHER_CTX *cipher _U_, guchar* iv _U_, gint iv_len _U_)
     return 0;
 }
 
+static void
+ssl_decoder_destroy(SslDecoder *dec _U_)
+{
+}
+
 #endif /* defined(HAVE_LIBGNUTLS) && defined(HAVE_LIBGCRYPT) */
 
 /* get ssl data for this session. if no ssl data is found allocate a new one*/
@@ -4021,6 +4044,22 @@ ssl_get_session(conversation_t *conversation, dissector_handle_t ssl_handle)
     return ssl_session;
 }
 
+/* Free the data of a session whose conversation is being expired */
+void
+ssl_free_session(void *data)
+{
+    SslDecryptSession *ssl_session = (SslDecryptSession *)data;
+
+    ssl_decoder_destroy(ssl_session->client);
+    ssl_decoder_destroy(ssl_session->server);
+    ssl_decoder_destroy(ssl_session->client_new);
+    ssl_decoder_destroy(ssl_session->server_new);
+    wmem_free(wmem_file_scope(), ssl_session->session_ticket.data);
+    wmem_free(wmem_file_scope(), ssl_session->handshake_data.data);
+    wmem_free(wmem_file_scope(), (void *)ssl_session->session.srv_addr.data);
+    wmem_free(wmem_file_scope(), ssl_session);
+}
+
 void
 ssl_set_server(SslSession *session, address *addr, port_type ptype, guint32 port)
 {
@@ -465,6 +465,13 @@ ssl_lib_init(void);
 extern SslDecryptSession *
 ssl_get_session(conversation_t *conversation, dissector_handle_t ssl_handle);
 
+/** Free a SslSession when its conversation is expired; see
+ * conversation_register_proto_data_free().
+ * @param data The SslDecryptSession.
+ */
+extern void
+ssl_free_session(void *data);
+
 /** Set server address and port */
 extern void
 ssl_set_server(SslSession *session, address *addr, port_type ptype, guint32 port);
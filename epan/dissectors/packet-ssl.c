@@ -4146,6 +4146,7 @@ proto_register_ssl(void)
     ssl_associations = g_tree_new(ssl_association_cmp);
 
     register_init_routine(ssl_init);
+    conversation_register_proto_data_free(proto_ssl, ssl_free_session);
     ssl_lib_init();
     ssl_tap = register_tap("ssl");
     ssl_debug_printf("proto_register_ssl: registered tap %s:%d\n",
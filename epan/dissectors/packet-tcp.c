@@ -735,6 +735,33 @@ init_tcp_conversation_data(packet_info *pinfo)
     return tcpd;
 }
 
+static void
+free_tcp_flow_data(tcp_flow_t *flow)
+{
+    tcp_unacked_t *ual, *tmpual;
+
+    for (ual = flow->segments; ual; ual = tmpual) {
+        tmpual = ual->next;
+        wmem_free(wmem_file_scope(), ual);
+    }
+    wmem_tree_destroy(flow->multisegment_pdus, TRUE);
+    wmem_free(wmem_file_scope(), flow->username);
+    wmem_free(wmem_file_scope(), flow->command);
+}
+
+/* Free the data of a conversation that's being expired */
+static void
+free_tcp_conversation_data(void *data)
+{
+    struct tcp_analysis *tcpd = (struct tcp_analysis *)data;
+
+    free_tcp_flow_data(&tcpd->flow1);
+    free_tcp_flow_data(&tcpd->flow2);
+    /* tcpd->ta is one of the values of the acked table */
+    wmem_tree_destroy(tcpd->acked_table, TRUE);
+    wmem_free(wmem_file_scope(), tcpd);
+}
+
 struct tcp_analysis *
 get_tcp_conversation_data(conversation_t *conv, packet_info *pinfo)
 {
@@ -6024,6 +6051,7 @@ proto_register_tcp(void)
         &tcp_exp_options_with_magic);
 
     register_init_routine(tcp_init);
+    conversation_register_proto_data_free(proto_tcp, free_tcp_conversation_data);
 
     register_decode_as(&tcp_da);
 
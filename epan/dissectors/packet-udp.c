@@ -232,6 +232,24 @@ init_udp_conversation_data(void)
   return udpd;
 }
 
+static void
+free_udp_flow_data(udp_flow_t *flow)
+{
+  wmem_free(wmem_file_scope(), flow->username);
+  wmem_free(wmem_file_scope(), flow->command);
+}
+
+/* Free the data of a conversation that's being expired */
+static void
+free_udp_conversation_data(void *data)
+{
+  struct udp_analysis *udpd = (struct udp_analysis *)data;
+
+  free_udp_flow_data(&udpd->flow1);
+  free_udp_flow_data(&udpd->flow2);
+  wmem_free(wmem_file_scope(), udpd);
+}
+
 struct udp_analysis *
 get_udp_conversation_data(conversation_t *conv, packet_info *pinfo)
 {
@@ -1010,6 +1028,7 @@ proto_register_udp(void)
   register_color_conversation_filter("udp", "UDP", udp_color_filter_valid, udp_build_color_filter);
 
   register_init_routine(udp_init);
+  conversation_register_proto_data_free(proto_udp, free_udp_conversation_data);
 
 }
 
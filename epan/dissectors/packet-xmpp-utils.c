@@ -785,11 +785,15 @@ proto_item_get_text(proto_item *item)
     if(fi==NULL)
         return NULL;
 
-    if (fi->rep == NULL)
+    if (fi->rep != NULL) {
+        result = wmem_strdup(wmem_packet_scope(), fi->rep->representation);
+    } else if (fi->label_pending != NULL) {
+        result = (gchar *)wmem_alloc(wmem_packet_scope(), ITEM_LABEL_LENGTH);
+        proto_item_fill_label(fi, result);
+    } else {
         return NULL;
+    }
 
-
-    result = wmem_strdup(wmem_packet_scope(), fi->rep->representation);
     return result;
 }
 
@@ -29,8 +29,14 @@ struct epan_session {
 	void *data;
 
 	const nstime_t *(*get_frame_ts)(void *data, guint32 frame_num);
+	const nstime_t *(*get_frame_shift_offset)(void *data, guint32 frame_num);
 	const char *(*get_interface_name)(void *data, guint32 interface_id);
 	const char *(*get_user_comment)(void *data, const frame_data *fd);
+
+	/* Expiry of idle state; see epan_set_state_expiry() */
+	guint state_idle_secs;		/* 0 if state is kept until the file is closed */
+	GQueue *state_samples;		/* first frame of each second, oldest first */
+	time_t last_expiry_secs;	/* capture time of the last expiry */
 };
 
 #endif
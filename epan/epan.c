@@ -37,6 +37,7 @@
 #include "epan_dissect.h"
 
 #include "conversation.h"
+#include "reassemble.h"
 #include "circuit.h"
 #include "except.h"
 #include "packet.h"
@@ -154,12 +155,69 @@ epan_new(void)
 {
 	epan_t *session = g_slice_new(epan_t);
 
+	session->state_idle_secs = 0;
+	session->state_samples = NULL;
+	session->last_expiry_secs = 0;
+
 	/* XXX, it should take session as param */
 	init_dissection();
 
 	return session;
 }
 
+typedef struct {
+	guint32 frame_num;
+	time_t secs;
+} state_sample_t;
+
+void
+epan_set_state_expiry(epan_t *session, guint idle_secs)
+{
+	session->state_idle_secs = idle_secs;
+	if (idle_secs != 0 && session->state_samples == NULL)
+		session->state_samples = g_queue_new();
+}
+
+/*
+ * Note the first frame of each second of capture time and, a few times
+ * per idle period (each expiry goes through all the state), free the
+ * state that's had no frames since the first frame of the second that
+ * was state_idle_secs ago.
+ */
+static void
+epan_expire_state(epan_t *session, const frame_data *fd)
+{
+	state_sample_t *sample;
+	guint32 expire_before = 0;
+	guint interval;
+
+	if (session == NULL || session->state_idle_secs == 0 || fd->flags.visited)
+		return;
+
+	sample = (state_sample_t *)g_queue_peek_tail(session->state_samples);
+	if (sample != NULL && fd->abs_ts.secs <= sample->secs)
+		return;
+	sample = g_slice_new(state_sample_t);
+	sample->frame_num = fd->num;
+	sample->secs = fd->abs_ts.secs;
+	g_queue_push_tail(session->state_samples, sample);
+
+	interval = MAX(session->state_idle_secs / 4, 1);
+	if (fd->abs_ts.secs - session->last_expiry_secs < (time_t)interval)
+		return;
+
+	while ((sample = (state_sample_t *)g_queue_peek_head(session->state_samples)) != NULL &&
+	       sample->secs + (time_t)session->state_idle_secs <= fd->abs_ts.secs) {
+		expire_before = sample->frame_num;
+		g_slice_free(state_sample_t, g_queue_pop_head(session->state_samples));
+	}
+	if (expire_before != 0) {
+		session->last_expiry_secs = fd->abs_ts.secs;
+		conversation_expire(expire_before);
+		reassembly_expire(expire_before);
+	}
+}
+
 const char *
 epan_get_user_comment(const epan_t *session, const frame_data *fd)
 {
@@ -192,6 +250,15 @@ epan_get_frame_ts(const epan_t *session, guint32 frame_num)
 	return abs_ts;
 }
 
+const nstime_t *
+epan_get_frame_shift_offset(const epan_t *session, guint32 frame_num)
+{
+	if (session->get_frame_shift_offset)
+		return session->get_frame_shift_offset(session->data, frame_num);
+
+	return NULL;
+}
+
 void
 epan_free(epan_t *session)
 {
@@ -199,6 +266,11 @@ epan_free(epan_t *session)
 		/* XXX, it should take session as param */
 		cleanup_dissection();
 
+		if (session->state_samples != NULL) {
+			while (!g_queue_is_empty(session->state_samples))
+				g_slice_free(state_sample_t, g_queue_pop_head(session->state_samples));
+			g_queue_free(session->state_samples);
+		}
 		g_slice_free(epan_t, session);
 	}
 }
@@ -267,6 +339,7 @@ epan_dissect_init(epan_dissect_t *edt, epan_t *session, const gboolean create_pr
 	}
 
 	edt->tvb = NULL;
+	edt->prune_dissection = FALSE;
 
 	return edt;
 }
@@ -318,11 +391,22 @@ epan_dissect_fake_protocols(epan_dissect_t *edt, const gboolean fake_protocols)
 		proto_tree_set_fake_protocols(edt->tree, fake_protocols);
 }
 
+void
+epan_dissect_prune_dissection(epan_dissect_t *edt, const gboolean prune)
+{
+	if (edt) {
+		edt->prune_dissection = prune;
+		if (edt->tree)
+			proto_tree_set_record_primed(edt->tree, prune);
+	}
+}
+
 void
 epan_dissect_run(epan_dissect_t *edt, int file_type_subtype,
         struct wtap_pkthdr *phdr, tvbuff_t *tvb, frame_data *fd,
         column_info *cinfo)
 {
+	epan_expire_state(edt->session, fd);
 #ifdef HAVE_LUA
 	wslua_prime_dfilter(edt); /* done before entering wmem scope */
 #endif
@@ -338,6 +422,7 @@ epan_dissect_run_with_taps(epan_dissect_t *edt, int file_type_subtype,
         struct wtap_pkthdr *phdr, tvbuff_t *tvb, frame_data *fd,
         column_info *cinfo)
 {
+	epan_expire_state(edt->session, fd);
 	wmem_enter_packet_scope();
 	tap_queue_init(edt);
 	dissect_record(edt, file_type_subtype, phdr, tvb, fd, cinfo);
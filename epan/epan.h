@@ -138,8 +138,20 @@ WS_DLL_PUBLIC const char *epan_get_interface_name(const epan_t *session, guint32
 
 const nstime_t *epan_get_frame_ts(const epan_t *session, guint32 frame_num);
 
+const nstime_t *epan_get_frame_shift_offset(const epan_t *session, guint32 frame_num);
+
 WS_DLL_PUBLIC void epan_free(epan_t *session);
 
+/**
+ * As frames are dissected, free the conversation and reassembly state
+ * that's been idle for more than idle_secs seconds of capture time; 0,
+ * the default, keeps it all until the file is closed.  That's only for
+ * sessions in which frames are dissected once, in order, and never
+ * revisited, such as a long-running live capture in TShark without
+ * two-pass analysis; see conversation_expire() and reassembly_expire().
+ */
+WS_DLL_PUBLIC void epan_set_state_expiry(epan_t *session, guint idle_secs);
+
 WS_DLL_PUBLIC const gchar*
 epan_get_version(void);
 
@@ -176,6 +188,16 @@ WS_DLL_PUBLIC
 void
 epan_dissect_fake_protocols(epan_dissect_t *edt, const gboolean fake_protocols);
 
+/** Indicate whether subdissectors that can't add any of the fields the
+ * tree is primed with may be skipped.  Frames dissected for the first
+ * time are dissected in full, and are used to learn which protocols lead
+ * to the primed fields; only frames that have already been dissected once
+ * with the same fields primed are pruned.  Use only if nothing but the
+ * primed fields is looked at, not the columns or the rest of the tree. */
+WS_DLL_PUBLIC
+void
+epan_dissect_prune_dissection(epan_dissect_t *edt, const gboolean prune);
+
 /** run a single packet dissection */
 WS_DLL_PUBLIC
 void
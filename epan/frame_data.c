@@ -310,12 +310,12 @@ frame_data_init(frame_data *fdata, guint32 num,
   fdata->flags.has_ts = (phdr->presence_flags & WTAP_HAS_TS) ? 1 : 0;
   fdata->flags.has_phdr_comment = (phdr->opt_comment != NULL);
   fdata->flags.has_user_comment = 0;
+  fdata->flags.has_dependents = 0;
   fdata->tsprec = (gint16)phdr->pkt_tsprec;
+  fdata->proto_set = 0;
   fdata->color_filter = NULL;
   fdata->abs_ts.secs = phdr->ts.secs;
   fdata->abs_ts.nsecs = phdr->ts.nsecs;
-  fdata->shift_offset.secs = 0;
-  fdata->shift_offset.nsecs = 0;
   fdata->frame_ref_num = 0;
   fdata->prev_dis_num = 0;
 }
@@ -374,6 +374,7 @@ void
 frame_data_reset(frame_data *fdata)
 {
   fdata->flags.visited = 0;
+  fdata->proto_set = 0;
 
   if (fdata->pfd) {
     g_slist_free(fdata->pfd);
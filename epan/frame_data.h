@@ -60,17 +60,25 @@ typedef enum {
 
 /** The frame number is the ordinal number of the frame in the capture, so
    it's 1-origin.  In various contexts, 0 as a frame number means "frame
-   number unknown". */
+   number unknown".
+
+   Wireshark and two-pass TShark keep one of these for every frame, so
+   the fields are ordered to avoid padding, and things that are only set
+   for a few frames, such as the offset by which a frame's time stamp has
+   been shifted, are kept in side tables in the frame_data_sequence
+   instead. */
 DIAG_OFF(pedantic)
 typedef struct _frame_data {
   GSList      *pfd;          /**< Per frame proto data */
+  const void *color_filter;  /**< Per-packet matching color_filter_t object */
+  gint64       file_off;     /**< File offset */
+  nstime_t     abs_ts;       /**< Absolute timestamp */
   guint32      num;          /**< Frame number */
   guint32      pkt_len;      /**< Packet length */
   guint32      cap_len;      /**< Amount actually captured */
   guint32      cum_bytes;    /**< Cumulative bytes into the capture */
-  gint64       file_off;     /**< File offset */
-  guint16      subnum;       /**< subframe number, for protocols that require this */
-  gint16       lnk_t;        /**< Per-packet encapsulation/data-link type */
+  guint32      frame_ref_num; /**< Previous reference frame (0 if this is one) */
+  guint32      prev_dis_num; /**< Previous displayed frame (0 if first one) */
   struct {
     unsigned int passed_dfilter : 1; /**< 1 = display, 0 = no display */
     unsigned int dependent_of_displayed : 1; /**< 1 if a displayed frame depends on this frame */
@@ -82,15 +90,12 @@ typedef struct _frame_data {
     unsigned int has_ts         : 1; /**< 1 = has time stamp, 0 = no time stamp */
     unsigned int has_phdr_comment : 1; /** 1 = there's comment for this packet */
     unsigned int has_user_comment : 1; /** 1 = user set (also deleted) comment for this packet */
+    unsigned int has_dependents : 1; /**< 1 = depended on other frames when proto_set was recorded */
   } flags;
+  guint16      subnum;       /**< subframe number, for protocols that require this */
+  gint16       lnk_t;        /**< Per-packet encapsulation/data-link type */
   gint16       tsprec;       /**< Time stamp precision */
-
-  const void *color_filter;  /**< Per-packet matching color_filter_t object */
-
-  nstime_t     abs_ts;       /**< Absolute timestamp */
-  nstime_t     shift_offset; /**< How much the abs_tm of the frame is shifted */
-  guint32      frame_ref_num; /**< Previous reference frame (0 if this is one) */
-  guint32      prev_dis_num; /**< Previous displayed frame (0 if first one) */
+  guint16      proto_set;    /**< Set of protocols in the frame (see protocol_set.h), or 0 if not known */
 } frame_data;
 DIAG_ON(pedantic)
 
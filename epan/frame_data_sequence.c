@@ -22,6 +22,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <glib.h>
 
 #include <epan/packet.h>
@@ -44,8 +46,18 @@
 struct _frame_data_sequence {
   guint32      count;           /* Total number of frames */
   void        *ptree_root;      /* Pointer to the root node */
+  nstime_t   **shift_pages;     /* Time shift offsets, see below */
+  guint32      n_shift_pages;   /* Number of entries in shift_pages */
 };
 
+/*
+ * Few captures ever have their time stamps shifted, so rather than
+ * keeping a shift offset in every frame_data, we keep them in pages of
+ * NODES_PER_LEVEL offsets, indexed by frame number, and only allocate
+ * a page once a frame in it is given a non-zero offset.
+ */
+static const nstime_t no_shift_offset = { 0, 0 };
+
 /*
  * For a given frame number, calculate the indices into a level 3
  * node, a level 2 node, a level 1 node, and a leaf node.
@@ -67,6 +79,8 @@ new_frame_data_sequence(void)
   fds = (frame_data_sequence *)g_malloc(sizeof *fds);
   fds->count = 0;
   fds->ptree_root = NULL;
+  fds->shift_pages = NULL;
+  fds->n_shift_pages = 0;
   return fds;
 }
 
@@ -236,6 +250,56 @@ frame_data_sequence_find(frame_data_sequence *fds, guint32 num)
   return &leaf[LEAF_INDEX(num)];
 }
 
+/*
+ * Get the offset by which the time stamp of the specified frame has
+ * been shifted.
+ */
+const nstime_t *
+frame_data_sequence_get_shift_offset(frame_data_sequence *fds, guint32 num)
+{
+  guint32 page;
+
+  if (num == 0 || num > fds->count)
+    return &no_shift_offset;
+
+  page = (num - 1) >> LOG2_NODES_PER_LEVEL;
+  if (page >= fds->n_shift_pages || fds->shift_pages[page] == NULL)
+    return &no_shift_offset;
+  return &fds->shift_pages[page][LEAF_INDEX(num - 1)];
+}
+
+/*
+ * Set the offset by which the time stamp of the specified frame has
+ * been shifted.
+ */
+void
+frame_data_sequence_set_shift_offset(frame_data_sequence *fds, guint32 num,
+    const nstime_t *offset)
+{
+  guint32 page;
+
+  if (num == 0 || num > fds->count)
+    return;
+
+  page = (num - 1) >> LOG2_NODES_PER_LEVEL;
+  if (page >= fds->n_shift_pages || fds->shift_pages[page] == NULL) {
+    if (offset->secs == 0 && offset->nsecs == 0) {
+      /* Nothing to record, so don't allocate anything. */
+      return;
+    }
+    if (page >= fds->n_shift_pages) {
+      guint32 n_pages = ((fds->count - 1) >> LOG2_NODES_PER_LEVEL) + 1;
+
+      fds->shift_pages = g_renew(nstime_t *, fds->shift_pages, n_pages);
+      memset(&fds->shift_pages[fds->n_shift_pages], 0,
+             (n_pages - fds->n_shift_pages) * sizeof *fds->shift_pages);
+      fds->n_shift_pages = n_pages;
+    }
+    fds->shift_pages[page] = g_new0(nstime_t, NODES_PER_LEVEL);
+  }
+  nstime_copy(&fds->shift_pages[page][LEAF_INDEX(num - 1)], offset);
+}
+
 /* recursively frees a frame_data radix level */
 static void
 free_frame_data_array(void *array, guint count, guint level, gboolean last)
@@ -293,6 +357,7 @@ free_frame_data_sequence(frame_data_sequence *fds)
 {
   guint32 count  = fds->count;
   guint   levels = 0;
+  guint32 i;
 
   /* calculate how many levels we have */
   while (count) {
@@ -305,6 +370,11 @@ free_frame_data_sequence(frame_data_sequence *fds)
     free_frame_data_array(fds->ptree_root, fds->count, levels, TRUE);
   }
 
+  /* free the time shift offsets */
+  for (i = 0; i < fds->n_shift_pages; i++)
+    g_free(fds->shift_pages[i]);
+  g_free(fds->shift_pages);
+
   /* free the header struct */
   g_free(fds);
 }
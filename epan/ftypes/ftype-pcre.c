@@ -45,6 +45,86 @@ gregex_fvalue_free(fvalue_t *fv)
     }
 }
 
+/* Compiled regular expressions, by pattern, so that compiling a filter
+ * again, as the GUI does each time a filter is applied, or compiling
+ * several filters that match the same pattern, doesn't compile the
+ * pattern again.  The cache holds a reference to each GRegex; when it's
+ * full, the least recently used one is dropped. */
+#define REGEX_CACHE_MAX 256
+
+typedef struct {
+    gchar  *pattern;
+    GRegex *re;
+} regex_cache_entry_t;
+
+static GHashTable *regex_cache = NULL;  /* pattern -> link in regex_lru */
+static GQueue     *regex_lru = NULL;    /* entries, most recently used first */
+
+static void
+regex_cache_entry_free(regex_cache_entry_t *entry)
+{
+    g_free(entry->pattern);
+    g_regex_unref(entry->re);
+    g_free(entry);
+}
+
+/* Look up a pattern in the cache, and make it the most recently used. */
+static GRegex *
+regex_cache_lookup(const char *pattern)
+{
+    GList *link;
+
+    if (regex_cache == NULL)
+        return NULL;
+
+    link = (GList *)g_hash_table_lookup(regex_cache, pattern);
+    if (link == NULL)
+        return NULL;
+
+    g_queue_unlink(regex_lru, link);
+    g_queue_push_head_link(regex_lru, link);
+    return ((regex_cache_entry_t *)link->data)->re;
+}
+
+static void
+regex_cache_add(const char *pattern, GRegex *re)
+{
+    regex_cache_entry_t *entry;
+
+    if (regex_cache == NULL) {
+        regex_cache = g_hash_table_new(g_str_hash, g_str_equal);
+        regex_lru = g_queue_new();
+    }
+
+    if (g_queue_get_length(regex_lru) >= REGEX_CACHE_MAX) {
+        entry = (regex_cache_entry_t *)g_queue_pop_tail(regex_lru);
+        g_hash_table_remove(regex_cache, entry->pattern);
+        regex_cache_entry_free(entry);
+    }
+
+    entry = g_new(regex_cache_entry_t, 1);
+    entry->pattern = g_strdup(pattern);
+    entry->re = g_regex_ref(re);
+    g_queue_push_head(regex_lru, entry);
+    g_hash_table_insert(regex_cache, entry->pattern, regex_lru->head);
+}
+
+void
+ftype_cleanup_pcre(void)
+{
+    regex_cache_entry_t *entry;
+
+    if (regex_cache == NULL)
+        return;
+
+    while ((entry = (regex_cache_entry_t *)g_queue_pop_head(regex_lru)) != NULL)
+        regex_cache_entry_free(entry);
+    g_queue_free(regex_lru);
+    regex_lru = NULL;
+    g_hash_table_destroy(regex_cache);
+    regex_cache = NULL;
+}
+
 /* Determines whether pattern needs to match raw byte sequences */
 static gboolean
 raw_flag_needed(const gchar *pattern)
@@ -86,6 +166,12 @@ val_from_string(fvalue_t *fv, const char *pattern, gchar **err_msg)
     /* Free up the old value, if we have one */
     gregex_fvalue_free(fv);
 
+    fv->value.re = regex_cache_lookup(pattern);
+    if (fv->value.re) {
+        g_regex_ref(fv->value.re);
+        return TRUE;
+    }
+
     fv->value.re = g_regex_new(
             pattern,            /* pattern */
             cflags,             /* Compile options */
@@ -100,9 +186,12 @@ val_from_string(fvalue_t *fv, const char *pattern, gchar **err_msg)
         g_error_free(regex_error);
         if (fv->value.re) {
             g_regex_unref(fv->value.re);
+            fv->value.re = NULL;
         }
         return FALSE;
     }
+
+    regex_cache_add(pattern, fv->value.re);
     return TRUE;
 }
 
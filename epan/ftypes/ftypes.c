@@ -45,6 +45,13 @@ ftypes_initialize(void)
 	ftype_register_pcre();
 }
 
+/* Free what the ftype module has cached. */
+void
+ftypes_cleanup(void)
+{
+	ftype_cleanup_pcre();
+}
+
 /* Each ftype_t is registered via this function */
 void
 ftype_register(enum ftenum ftype, ftype_t *ft)
@@ -120,6 +120,10 @@ typedef enum ftrepr ftrepr_t;
 void
 ftypes_initialize(void);
 
+/* Free what the ftypes subsystem has cached. Called once, at exit. */
+void
+ftypes_cleanup(void);
+
 /* ---------------- FTYPE ----------------- */
 
 /* given two types, are they similar - for example can two
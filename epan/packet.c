@@ -109,6 +109,12 @@ struct heur_dissector_list {
 
 static GHashTable *heur_dissector_lists = NULL;
 
+/*
+ * Fields whose values are built from every protocol in the frame; see
+ * packet_prune_field_needs_all_layers().
+ */
+static GHashTable *prune_all_layers = NULL;
+
 static void
 destroy_heuristic_dissector_entry(gpointer data, gpointer user_data _U_)
 {
@@ -147,6 +153,8 @@ packet_init(void)
 
 	heur_dissector_lists = g_hash_table_new_full(g_str_hash, g_str_equal,
 			NULL, destroy_heuristic_dissector_list);
+
+	prune_all_layers = g_hash_table_new(g_direct_hash, g_direct_equal);
 }
 
 void
@@ -171,6 +179,7 @@ packet_cleanup(void)
 	g_hash_table_destroy(dissector_tables);
 	g_hash_table_destroy(registered_dissectors);
 	g_hash_table_destroy(heur_dissector_lists);
+	g_hash_table_destroy(prune_all_layers);
 }
 
 /*
@@ -213,6 +222,284 @@ call_init_routine(gpointer routine, gpointer dummy _U_)
 	(*func)();
 }
 
+/*
+ * Dissection pruning.
+ *
+ * A program that only wants a few fields out of each packet, and that
+ * dissects every frame once before it dissects it again (e.g. TShark in
+ * two-pass mode), can have the second dissection skip the subdissectors
+ * that can't lead to any of the fields it wants.
+ *
+ * While a frame is dissected for the first time with pruning turned on,
+ * we learn which protocol called which through a handle or heuristic
+ * list, which protocols were current when each primed field was added,
+ * and which new-style dissectors rejected data or didn't dissect all of
+ * it.  When a frame that has already been dissected is dissected again
+ * with the same fields primed, a subdissector whose protocol neither adds
+ * a primed field nor calls, directly or indirectly, a protocol that does
+ * isn't called at all.
+ *
+ * Only frames that have already been visited are pruned, so the state
+ * that dissectors keep between frames is the same as without pruning.
+ */
+typedef struct {
+	guint       frames;	/* frames learned from with the field primed */
+	guint       last_frame;	/* value of prune_frames when last primed */
+	GHashTable *protos;	/* protocols current when it was added */
+} prune_field_t;
+
+static GHashTable *prune_callers;	/* protocol -> set of its callers */
+static GHashTable *prune_fields;	/* hfid -> prune_field_t */
+static GHashTable *prune_unsafe;	/* protocols that can't be skipped */
+static guint       prune_frames;	/* frames learned from */
+static guint       prune_generation;	/* bumped whenever any of the above changes */
+
+/* The protocols to keep, for the fields and generation they were
+ * worked out for. */
+static GHashTable *prune_keep;
+static GArray     *prune_keep_hfids;
+static guint       prune_keep_generation;
+static gboolean    prune_keep_complete;
+
+static gboolean
+prune_set_contains(GHashTable *set, int id)
+{
+	return g_hash_table_lookup_extended(set, GINT_TO_POINTER(id), NULL, NULL);
+}
+
+static gboolean
+prune_set_add(GHashTable *set, int id)
+{
+	if (prune_set_contains(set, id))
+		return FALSE;
+	g_hash_table_insert(set, GINT_TO_POINTER(id), GINT_TO_POINTER(id));
+	return TRUE;
+}
+
+static void
+prune_field_free(gpointer data)
+{
+	prune_field_t *field = (prune_field_t *)data;
+
+	g_hash_table_destroy(field->protos);
+	g_free(field);
+}
+
+static void
+prune_init(void)
+{
+	prune_callers = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+	    NULL, (GDestroyNotify)g_hash_table_destroy);
+	prune_fields = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+	    NULL, prune_field_free);
+	prune_unsafe = g_hash_table_new(g_direct_hash, g_direct_equal);
+	prune_keep = g_hash_table_new(g_direct_hash, g_direct_equal);
+	prune_keep_hfids = g_array_new(FALSE, FALSE, sizeof(gint));
+	prune_frames = 0;
+	prune_generation++;
+}
+
+static void
+prune_cleanup(void)
+{
+	g_hash_table_destroy(prune_callers);
+	g_hash_table_destroy(prune_fields);
+	g_hash_table_destroy(prune_unsafe);
+	g_hash_table_destroy(prune_keep);
+	g_array_free(prune_keep_hfids, TRUE);
+	prune_callers = NULL;
+	prune_fields = NULL;
+	prune_unsafe = NULL;
+	prune_keep = NULL;
+	prune_keep_hfids = NULL;
+}
+
+static void
+prune_note_call(int caller_id, int callee_id)
+{
+	GHashTable *callers;
+
+	if (caller_id == -1 || caller_id == callee_id)
+		return;
+
+	callers = (GHashTable *)g_hash_table_lookup(prune_callers, GINT_TO_POINTER(callee_id));
+	if (callers == NULL) {
+		callers = g_hash_table_new(g_direct_hash, g_direct_equal);
+		g_hash_table_insert(prune_callers, GINT_TO_POINTER(callee_id), callers);
+	}
+	if (prune_set_add(callers, caller_id))
+		prune_generation++;
+}
+
+static void
+prune_note_unsafe(int proto_id)
+{
+	if (prune_set_add(prune_unsafe, proto_id))
+		prune_generation++;
+}
+
+void
+packet_prune_note_field(packet_info *pinfo, int hfid)
+{
+	prune_field_t *field;
+
+	if (pinfo->curr_proto_id == -1)
+		return;
+
+	field = (prune_field_t *)g_hash_table_lookup(prune_fields, GINT_TO_POINTER(hfid));
+	if (field != NULL && prune_set_add(field->protos, pinfo->curr_proto_id))
+		prune_generation++;
+}
+
+void
+packet_prune_field_needs_all_layers(int hfid)
+{
+	prune_set_add(prune_all_layers, hfid);
+}
+
+static gint
+prune_compare_hfids(gconstpointer a, gconstpointer b)
+{
+	return *(const gint *)a - *(const gint *)b;
+}
+
+/* Note that a frame is being learned from with the given fields primed. */
+static void
+prune_learn_frame(GArray *primed_hfids)
+{
+	prune_field_t *field;
+	guint          i;
+	gint           hfid;
+
+	prune_frames++;
+	for (i = 0; i < primed_hfids->len; i++) {
+		hfid = g_array_index(primed_hfids, gint, i);
+		field = (prune_field_t *)g_hash_table_lookup(prune_fields, GINT_TO_POINTER(hfid));
+		if (field == NULL) {
+			field = g_new(prune_field_t, 1);
+			field->frames = 0;
+			field->last_frame = 0;
+			field->protos = g_hash_table_new(g_direct_hash, g_direct_equal);
+			g_hash_table_insert(prune_fields, GINT_TO_POINTER(hfid), field);
+		}
+		/* The same field can be primed more than once */
+		if (field->last_frame != prune_frames) {
+			field->last_frame = prune_frames;
+			field->frames++;
+		}
+	}
+	prune_generation++;
+}
+
+static void
+prune_keep_add(GArray *queue, int proto_id)
+{
+	if (prune_set_add(prune_keep, proto_id))
+		g_array_append_val(queue, proto_id);
+}
+
+static void
+prune_keep_add_callers(gpointer key, gpointer value _U_, gpointer queue)
+{
+	prune_keep_add((GArray *)queue, GPOINTER_TO_INT(key));
+}
+
+/*
+ * Work out which protocols have to be dissected to get the primed fields
+ * of a frame.  Returns FALSE if any of those fields hasn't been learned
+ * on every frame learned from, in which case nothing can be pruned.
+ */
+static gboolean
+prune_compute_keep(GArray *primed_hfids)
+{
+	GArray            *hfids;
+	GArray            *queue;
+	header_field_info *hfinfo;
+	prune_field_t     *field;
+	GHashTable        *callers;
+	guint              i;
+	gint               hfid, proto_id;
+
+	hfids = g_array_sized_new(FALSE, FALSE, sizeof(gint), primed_hfids->len);
+	g_array_append_vals(hfids, primed_hfids->data, primed_hfids->len);
+	g_array_sort(hfids, prune_compare_hfids);
+
+	if (prune_keep_generation == prune_generation &&
+	    hfids->len == prune_keep_hfids->len &&
+	    memcmp(hfids->data, prune_keep_hfids->data, hfids->len * sizeof(gint)) == 0) {
+		g_array_free(hfids, TRUE);
+		return prune_keep_complete;
+	}
+
+	g_array_free(prune_keep_hfids, TRUE);
+	prune_keep_hfids = hfids;
+	prune_keep_generation = prune_generation;
+	prune_keep_complete = TRUE;
+	g_hash_table_remove_all(prune_keep);
+
+	queue = g_array_new(FALSE, FALSE, sizeof(gint));
+	for (i = 0; i < hfids->len; i++) {
+		hfid = g_array_index(hfids, gint, i);
+		hfinfo = proto_registrar_get_nth(hfid);
+
+		/* The protocol a field belongs to is always kept, in case
+		 * the field is only added once the frame has been visited. */
+		prune_keep_add(queue, hfinfo->parent == -1 ? hfid : hfinfo->parent);
+
+		field = (prune_field_t *)g_hash_table_lookup(prune_fields, GINT_TO_POINTER(hfid));
+		if (field == NULL || field->frames != prune_frames) {
+			prune_keep_complete = FALSE;
+			continue;
+		}
+		g_hash_table_foreach(field->protos, prune_keep_add_callers, queue);
+	}
+
+	/* Everything that calls a protocol that's kept is kept too */
+	for (i = 0; i < queue->len; i++) {
+		proto_id = g_array_index(queue, gint, i);
+		callers = (GHashTable *)g_hash_table_lookup(prune_callers, GINT_TO_POINTER(proto_id));
+		if (callers != NULL)
+			g_hash_table_foreach(callers, prune_keep_add_callers, queue);
+	}
+	g_array_free(queue, TRUE);
+
+	return prune_keep_complete;
+}
+
+/* Set up a frame's packet_info for learning or pruning. */
+static void
+prune_start_frame(epan_dissect_t *edt, frame_data *fd)
+{
+	GArray *primed_hfids;
+	guint   i;
+
+	edt->pi.curr_proto_id = -1;
+
+	if (!edt->prune_dissection || edt->tree == NULL)
+		return;
+
+	primed_hfids = PTREE_DATA(edt->tree)->primed_hfids;
+	if (primed_hfids == NULL || primed_hfids->len == 0)
+		return;
+
+	/* A field whose value names every protocol in the frame, such as
+	 * frame.protocols, is only added once the frame has been dissected,
+	 * while the protocol that adds it is current, so all it would be
+	 * credited to is that protocol; nothing can be pruned without
+	 * changing its value. */
+	for (i = 0; i < primed_hfids->len; i++) {
+		if (prune_set_contains(prune_all_layers, g_array_index(primed_hfids, gint, i)))
+			return;
+	}
+
+	if (!fd->flags.visited) {
+		prune_learn_frame(primed_hfids);
+		edt->pi.flags.prune_learn = TRUE;
+	} else if (prune_compute_keep(primed_hfids)) {
+		edt->pi.flags.prune_dissection = TRUE;
+	}
+}
+
 /*
  * XXX - for now, these are the same; the "init" routines free whatever
  * stuff is left over from any previous dissection, and then initialize
@@ -246,6 +533,9 @@ init_dissection(void)
 
 	/* Initialize the expert infos */
 	expert_packet_init();
+
+	/* Forget what dissection pruning learned */
+	prune_init();
 }
 
 void
@@ -269,6 +559,8 @@ cleanup_dissection(void)
 	/* Initialize the expert infos */
 	expert_packet_cleanup();
 
+	prune_cleanup();
+
 	wmem_leave_file_scope();
 
 	/*
@@ -468,6 +760,7 @@ dissect_record(epan_dissect_t *edt, int file_type_subtype,
 	edt->pi.link_dir = LINK_DIR_UNKNOWN;
 	edt->pi.layers = wmem_list_new(edt->pi.pool);
 	edt->tvb = tvb;
+	prune_start_frame(edt, fd);
 
 
 	frame_delta_abs_time(edt->session, fd, fd->frame_ref_num, &edt->pi.rel_ts);
@@ -531,6 +824,7 @@ dissect_file(epan_dissect_t *edt, struct wtap_pkthdr *phdr,
 	edt->pi.link_dir = LINK_DIR_UNKNOWN;
 	edt->pi.layers = wmem_list_new(edt->pi.pool);
 	edt->tvb = tvb;
+	prune_start_frame(edt, fd);
 
 
 	frame_delta_abs_time(edt->session, fd, fd->frame_ref_num, &edt->pi.rel_ts);
@@ -584,6 +878,29 @@ struct dissector_handle {
 	protocol_t	*protocol;
 };
 
+/*
+ * Can the call of a subdissector be skipped?  Not if its caller offers
+ * desegmentation, as whether the subdissector asks for more data
+ * changes what the caller does.
+ */
+static gboolean
+prune_can_skip(dissector_handle_t handle, packet_info *pinfo)
+{
+	int proto_id;
+
+	if (!pinfo->flags.prune_dissection || pinfo->curr_proto_id == -1 ||
+	    handle->protocol == NULL || pinfo->saved_can_desegment != 0)
+		return FALSE;
+
+	proto_id = proto_get_id(handle->protocol);
+	if (prune_set_contains(prune_keep, proto_id))
+		return FALSE;
+
+	/* Skipping a new-style dissector has to look like it accepted
+	 * all the data, which it has to have done while learning. */
+	return !(handle->is_new && prune_set_contains(prune_unsafe, proto_id));
+}
+
 /* This function will return
  * old style dissector :
  *   length of the payload or 1 of the payload is empty
@@ -648,6 +965,7 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo
  	packet_info *pinfo = pinfo_arg;
 	const char  *saved_proto;
 	guint16      saved_can_desegment;
+	int          saved_proto_id;
 	int          len;
 	guint        saved_layers_len = 0;
 
@@ -661,6 +979,7 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo
 
 	saved_proto = pinfo->current_proto;
 	saved_can_desegment = pinfo->can_desegment;
+	saved_proto_id = pinfo->curr_proto_id;
 	saved_layers_len = wmem_list_count(pinfo->layers);
 
 	/*
@@ -676,10 +995,23 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo
 	 * the desegmentation service.
 	 */
 	pinfo->saved_can_desegment = saved_can_desegment;
+
+	if (prune_can_skip(handle, pinfo)) {
+		/*
+		 * Nothing that dissector could lead to is wanted, so
+		 * pretend it dissected all of the data.
+		 */
+		len = tvb_captured_length(tvb);
+		return len > 0 ? len : 1;
+	}
+
 	pinfo->can_desegment = saved_can_desegment-(saved_can_desegment>0);
 	if (handle->protocol != NULL) {
 		pinfo->current_proto =
 			proto_get_protocol_short_name(handle->protocol);
+		if (pinfo->flags.prune_learn)
+			prune_note_call(saved_proto_id, proto_get_id(handle->protocol));
+		pinfo->curr_proto_id = proto_get_id(handle->protocol);
 
 		/*
 		 * Add the protocol name to the layers
@@ -699,6 +1031,10 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo
  		 */
 		len = call_dissector_through_handle(handle, tvb, pinfo, tree, data);
 	}
+	if (pinfo->flags.prune_learn && handle->is_new && handle->protocol != NULL &&
+	    (len == 0 || (guint)len < tvb_captured_length(tvb))) {
+		prune_note_unsafe(proto_get_id(handle->protocol));
+	}
 	if (len == 0) {
 		/*
  		 * That dissector didn't accept the packet, so
@@ -711,6 +1047,7 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo
  	}
  	pinfo->current_proto = saved_proto;
  	pinfo->can_desegment = saved_can_desegment;
+	pinfo->curr_proto_id = saved_proto_id;
 	return len;
 }
 
@@ -1987,6 +2324,7 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 	guint              saved_layers_len = 0;
 	heur_dtbl_entry_t *hdtbl_entry;
 	int                proto_id;
+	int                saved_proto_id;
 
 	/* can_desegment is set to 2 by anyone which offers this api/service.
 	   then everytime a subdissector is called it is decremented by one.
@@ -2004,6 +2342,7 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 	status      = FALSE;
 	saved_curr_proto = pinfo->current_proto;
 	saved_heur_list_name = pinfo->heur_list_name;
+	saved_proto_id = pinfo->curr_proto_id;
 
 	saved_layers_len = wmem_list_count(pinfo->layers);
 	*heur_dtbl_entry = NULL;
@@ -2034,6 +2373,15 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 			 * if the dissector fails.
 			 */
 			wmem_list_append(pinfo->layers, GINT_TO_POINTER(proto_id));
+
+			/*
+			 * Heuristic dissectors are never pruned, as which
+			 * of them accepts the packet changes what's done
+			 * with it, but what they call is learned.
+			 */
+			if (pinfo->flags.prune_learn)
+				prune_note_call(saved_proto_id, proto_id);
+			pinfo->curr_proto_id = proto_id;
 		}
 
 		pinfo->heur_list_name = hdtbl_entry->list_name;
@@ -2057,6 +2405,7 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 	pinfo->current_proto = saved_curr_proto;
 	pinfo->heur_list_name = saved_heur_list_name;
 	pinfo->can_desegment = saved_can_desegment;
+	pinfo->curr_proto_id = saved_proto_id;
 	return status;
 }
 
@@ -2625,11 +2974,16 @@ void
 call_all_postdissectors(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree)
 {
 	guint i;
+	guint32 saved_prune_dissection;
 
+	/* Postdissectors can have side effects, so they're never pruned */
+	saved_prune_dissection = pinfo->flags.prune_dissection;
+	pinfo->flags.prune_dissection = FALSE;
 	for(i = 0; i < num_of_postdissectors; i++) {
 		call_dissector_only((dissector_handle_t) g_ptr_array_index(post_dissectors,i),
 				    tvb,pinfo,tree, NULL);
 	}
+	pinfo->flags.prune_dissection = saved_prune_dissection;
 }
 
 /*
@@ -616,6 +616,20 @@ extern void dissect_file(struct epan_dissect *edt,
     struct wtap_pkthdr *phdr, tvbuff_t *tvb,
     frame_data *fd, column_info *cinfo);
 
+/*
+ * Called by proto.c when a primed field is added to the tree of a packet
+ * from which dissection pruning is learning which protocols add which
+ * fields.
+ */
+extern void packet_prune_note_field(packet_info *pinfo, int hfid);
+
+/*
+ * Registers a field whose value is built from all the protocols in a
+ * frame, e.g. from pinfo->layers, so that no subdissector is pruned
+ * while it's primed.
+ */
+WS_DLL_PUBLIC void packet_prune_field_needs_all_layers(int hfid);
+
 /* These functions are in packet-ethertype.c */
 extern void capture_ethertype(guint16 etype, const guchar *pd, int offset,
 		int len, packet_counts *ld);
@@ -66,6 +66,8 @@ typedef struct _packet_info {
   struct {
     guint32 in_error_pkt:1;         /**< TRUE if we're inside an {ICMP,CLNP,...} error packet */
     guint32 in_gre_pkt:1;           /**< TRUE if we're encapsulated inside a GRE packet */
+    guint32 prune_learn:1;          /**< TRUE if which protocols lead to the primed fields is being learned */
+    guint32 prune_dissection:1;     /**< TRUE if subdissectors that can't lead to a primed field are skipped */
   } flags;
   port_type ptype;                  /**< type of the following two port numbers */
   guint32 srcport;                  /**< source port */
@@ -152,6 +154,7 @@ typedef struct _packet_info {
 
   wmem_list_t *layers;      /**< layers of each protocol */
   guint8 curr_layer_num;       /**< The current "depth" or layer number in the current frame */
+  int curr_proto_id;           /**< protocol of the innermost dissector called through a handle or heuristic list, or -1 */
   guint16 link_number;
 
   guint16 clnp_srcref;          /**< clnp/cotp source reference (can't use srcport, this would confuse tpkt) */
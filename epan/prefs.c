@@ -2238,6 +2238,32 @@ prefs_register_modules(void)
                                    "Settings dialogs use a save button?",
                                    &prefs.gui_use_pref_save);
 
+    prefs_register_bool_preference(gui_module, "use_packet_index",
+                                   "Keep a packet index next to capture files",
+                                   "Write an index of packet offsets next to each pcap or pcapng file that's read, "
+                                   "and use it to list the packets when the file is reopened rather than reading "
+                                   "through the file. Packets are then only read when they're shown, until a display "
+                                   "filter or statistics need all of them to be dissected in order.",
+                                   &prefs.gui_use_packet_index);
+
+    prefs_register_uint_preference(gui_module, "field_cache_size",
+                                   "Megabytes of memory for the display filter field cache",
+                                   "When display filters are applied, keep the values of the fields they use most, "
+                                   "so that later filters using only those fields can be applied without dissecting "
+                                   "the packets again. Values beyond this many megabytes are kept in a temporary "
+                                   "file; 0 disables the cache.",
+                                   10,
+                                   &prefs.gui_field_cache_size);
+
+    prefs_register_bool_preference(gui_module, "record_protocols",
+                                   "Record the protocols in each packet",
+                                   "Note which protocols each packet has when it's dissected, so that display "
+                                   "filters that only test for protocols, such as \"dns\" or \"!arp\", can be "
+                                   "applied without dissecting the packets again. The protocols are only noted "
+                                   "while packets are being dissected for a display filter, which this makes "
+                                   "slightly slower.",
+                                   &prefs.gui_record_protocols);
+
     prefs_register_bool_preference(gui_module, "geometry.save.position",
                                    "Save window position at exit",
                                    "Save window position at exit?",
@@ -2955,6 +2981,9 @@ pre_init_prefs(void)
     prefs.gui_ask_unsaved            = TRUE;
     prefs.gui_find_wrap              = TRUE;
     prefs.gui_use_pref_save          = FALSE;
+    prefs.gui_use_packet_index       = FALSE;
+    prefs.gui_field_cache_size       = 64;
+    prefs.gui_record_protocols       = TRUE;
     prefs.gui_update_enabled         = TRUE;
     prefs.gui_update_channel         = UPDATE_CHANNEL_STABLE;
     prefs.gui_update_interval        = 60*60*24; /* Seconds */
@@ -172,6 +172,9 @@ typedef struct _e_prefs {
   gboolean     gui_ask_unsaved;
   gboolean     gui_find_wrap;
   gboolean     gui_use_pref_save;
+  gboolean     gui_use_packet_index;
+  guint        gui_field_cache_size;
+  gboolean     gui_record_protocols;
   gchar       *gui_webbrowser;
   gchar       *gui_window_title;
   gchar       *gui_start_title;
@@ -1208,6 +1208,34 @@ gboolean output_fields_has_cols(output_fields_t* fields)
     return fields->includes_col_fields;
 }
 
+void output_fields_prime_edt(output_fields_t* fields, epan_dissect_t *edt)
+{
+    gsize              i;
+    header_field_info *hfinfo;
+
+    g_assert(fields);
+
+    if (NULL == fields->fields || NULL == edt->tree)
+        return;
+
+    for (i = 0; i < fields->fields->len; ++i) {
+        gchar *field = (gchar *)g_ptr_array_index(fields->fields, i);
+
+        if (!strncmp(field, COLUMN_FIELD_FILTER, strlen(COLUMN_FIELD_FILTER)))
+            continue;
+
+        hfinfo = proto_registrar_get_byname(field);
+        if (NULL == hfinfo)
+            continue;
+
+        /* Prime all of the fields with that name */
+        while (hfinfo->same_name_prev_id != -1)
+            hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+        for (; hfinfo != NULL; hfinfo = hfinfo->same_name_next)
+            proto_tree_prime_hfid(edt->tree, hfinfo->id);
+    }
+}
+
 void write_fields_preamble(output_fields_t* fields, FILE *fh)
 {
     gsize i;
@@ -1419,6 +1447,11 @@ gchar* get_node_field_value(field_info* fi, epan_dissect_t* edt)
             /* Print out the full details for the protocol. */
             if (fi->rep) {
                 return g_strdup(fi->rep->representation);
+            } else if (fi->label_pending) {
+                gchar label_str[ITEM_LABEL_LENGTH];
+
+                proto_item_fill_label(fi, label_str);
+                return g_strdup(label_str);
             } else {
                 /* Just print out the protocol abbreviation */
                 return g_strdup(fi->hfinfo->abbrev);
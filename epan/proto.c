@@ -159,6 +159,7 @@ static const char *hf_try_val64_to_str(guint64 value, const header_field_info *h
 static void label_mark_truncated(char *label_str, gsize name_pos);
 #define LABEL_MARK_TRUNCATED_START(label_str) label_mark_truncated(label_str, 0)
 
+static void fill_label_default(field_info *fi, gchar *label_str);
 static void fill_label_boolean(field_info *fi, gchar *label_str);
 static void fill_label_bitfield(field_info *fi, gchar *label_str, gboolean is_signed);
 static void fill_label_bitfield64(field_info *fi, gchar *label_str, gboolean is_signed);
@@ -299,25 +300,228 @@ static GList *protocols = NULL;
 static GPtrArray *deregistered_fields = NULL;
 static GPtrArray *deregistered_data = NULL;
 
+/*
+ * Tree nodes, their field_infos and their labels are fixed-size objects
+ * that are created by the hundred for deep trees, and that all go away
+ * together when the dissection is reset, so they're carved out of an
+ * arena of their own rather than out of the packet-scope pool.  Each
+ * object type has a slab of chunks that is reset wholesale, without
+ * freeing anything, at the end of each packet, and the chunks are kept
+ * for the next tree; the arena also remembers which field_infos hold
+ * values that have to be cleaned up, so that resetting it doesn't have
+ * to walk the tree.
+ */
+#define PROTO_SLAB_CHUNK_SIZE	(64 * 1024)
+#define PROTO_SLAB_ALIGN(size)	\
+	(((size) + 2 * sizeof (gsize) - 1) & ~(2 * sizeof (gsize) - 1))
+
+typedef struct _proto_slab_chunk {
+	struct _proto_slab_chunk *next;
+} proto_slab_chunk_t;
+
+#define PROTO_SLAB_CHUNK_HEADER_SIZE	PROTO_SLAB_ALIGN(sizeof (proto_slab_chunk_t))
+
+typedef struct {
+	gsize               obj_size;
+	guint               per_chunk;
+	proto_slab_chunk_t *chunks;	/* every chunk allocated, in order */
+	proto_slab_chunk_t *cur;	/* chunk objects are being carved from */
+	guint               used;	/* objects carved from "cur" */
+	void               *free_list;	/* objects freed since the last reset */
+} proto_slab_t;
+
+/*
+ * Labels made from an item's field are rendered only when something asks
+ * for them (see proto_item_fill_label()); until then, an item whose label
+ * a dissector added text to, or gave the value text for, has the
+ * dissector's text kept here, with how to render the rest of the label.
+ * The value text of a LABEL_FORMAT_VALUE label follows the prefix, and
+ * the text appended to the label follows that.
+ */
+typedef enum {
+	LABEL_FORMAT_DEFAULT,	/* the label made from the field's value */
+	LABEL_FORMAT_VALUE	/* the field's name, and value text from the dissector */
+} label_format_e;
+
+struct _item_label_pending {
+	label_format_e format;
+	gint           prefix_len;	/* length of the prepended text */
+	gint           value_end;	/* offset of the end of the value text */
+	gint           value_len;	/* length the value text was formatted to */
+	gint           len;		/* length of all of the text */
+	gchar          text[ITEM_LABEL_LENGTH];
+};
+typedef struct _item_label_pending item_label_pending_t;
+
+struct _proto_tree_arena {
+	proto_slab_t  nodes;
+	proto_slab_t  finfos;
+	proto_slab_t  labels;
+	proto_slab_t  pending_labels;
+	GPtrArray    *cleanup;	/* field_infos with values to clean up */
+};
+
+/* The arena of the last tree freed, kept for the next tree */
+static proto_tree_arena_t *tree_arena_cache = NULL;
+
+static void
+proto_slab_init(proto_slab_t *slab, gsize obj_size)
+{
+	slab->obj_size  = PROTO_SLAB_ALIGN(obj_size);
+	slab->per_chunk = (guint)((PROTO_SLAB_CHUNK_SIZE - PROTO_SLAB_CHUNK_HEADER_SIZE) / slab->obj_size);
+	slab->chunks    = NULL;
+	slab->cur       = NULL;
+	slab->used      = 0;
+	slab->free_list = NULL;
+}
+
+static void *
+proto_slab_alloc(proto_slab_t *slab)
+{
+	void *obj;
+
+	if (slab->free_list) {
+		obj = slab->free_list;
+		slab->free_list = *(void **)obj;
+		return obj;
+	}
+
+	if (slab->cur == NULL || slab->used == slab->per_chunk) {
+		proto_slab_chunk_t *next = slab->cur ? slab->cur->next : slab->chunks;
+
+		if (next == NULL) {
+			next = (proto_slab_chunk_t *)g_malloc(PROTO_SLAB_CHUNK_SIZE);
+			next->next = NULL;
+			if (slab->cur)
+				slab->cur->next = next;
+			else
+				slab->chunks = next;
+		}
+		slab->cur  = next;
+		slab->used = 0;
+	}
+
+	obj = (guint8 *)slab->cur + PROTO_SLAB_CHUNK_HEADER_SIZE + slab->used * slab->obj_size;
+	slab->used++;
+	return obj;
+}
+
+static void
+proto_slab_free(proto_slab_t *slab, void *obj)
+{
+	*(void **)obj = slab->free_list;
+	slab->free_list = obj;
+}
+
+static void
+proto_slab_reset(proto_slab_t *slab)
+{
+	slab->cur       = NULL;
+	slab->used      = 0;
+	slab->free_list = NULL;
+}
+
+static void
+proto_slab_destroy(proto_slab_t *slab)
+{
+	proto_slab_chunk_t *chunk, *next;
+
+	for (chunk = slab->chunks; chunk != NULL; chunk = next) {
+		next = chunk->next;
+		g_free(chunk);
+	}
+	slab->chunks = NULL;
+	proto_slab_reset(slab);
+}
+
+static proto_tree_arena_t *
+proto_tree_arena_new(void)
+{
+	proto_tree_arena_t *arena;
+
+	if (tree_arena_cache != NULL) {
+		arena = tree_arena_cache;
+		tree_arena_cache = NULL;
+		return arena;
+	}
+
+	arena = g_new(proto_tree_arena_t, 1);
+	proto_slab_init(&arena->nodes, sizeof (proto_node));
+	proto_slab_init(&arena->finfos, sizeof (field_info));
+	proto_slab_init(&arena->labels, sizeof (item_label_t));
+	proto_slab_init(&arena->pending_labels, sizeof (item_label_pending_t));
+	arena->cleanup = g_ptr_array_new();
+	return arena;
+}
+
+/* Cleans up the values of the field_infos carved from the arena, and
+ * makes all of its objects available again. */
+static void
+proto_tree_arena_reset(proto_tree_arena_t *arena)
+{
+	guint i;
+
+	for (i = 0; i < arena->cleanup->len; i++) {
+		field_info *fi = (field_info *)g_ptr_array_index(arena->cleanup, i);
+
+		FVALUE_CLEANUP(&fi->value);
+	}
+	g_ptr_array_set_size(arena->cleanup, 0);
+
+	proto_slab_reset(&arena->nodes);
+	proto_slab_reset(&arena->finfos);
+	proto_slab_reset(&arena->labels);
+	proto_slab_reset(&arena->pending_labels);
+}
+
+static void
+proto_tree_arena_destroy(proto_tree_arena_t *arena)
+{
+	proto_tree_arena_reset(arena);
+	proto_slab_destroy(&arena->nodes);
+	proto_slab_destroy(&arena->finfos);
+	proto_slab_destroy(&arena->labels);
+	proto_slab_destroy(&arena->pending_labels);
+	g_ptr_array_free(arena->cleanup, TRUE);
+	g_free(arena);
+}
+
 /* Contains information about a field when a dissector calls
  * proto_tree_add_item.  */
-#define FIELD_INFO_NEW(pool, fi)  fi = wmem_new(pool, field_info)
-#define FIELD_INFO_FREE(pool, fi) wmem_free(pool, fi)
+#define FIELD_INFO_NEW(arena, fi)	\
+	fi = (field_info *)proto_slab_alloc(&(arena)->finfos)
+#define FIELD_INFO_FREE(arena, fi)	\
+	proto_slab_free(&(arena)->finfos, fi)
 
 /* Contains the space for proto_nodes. */
+#define PROTO_NODE_NEW(arena, node)	\
+	node = (proto_node *)proto_slab_alloc(&(arena)->nodes)
+
 #define PROTO_NODE_INIT(node)			\
 	node->first_child = NULL;		\
 	node->last_child = NULL;		\
 	node->next = NULL;
 
-#define PROTO_NODE_FREE(pool, node)			\
-	wmem_free(pool, node)
+#define PROTO_NODE_FREE(arena, node)			\
+	proto_slab_free(&(arena)->nodes, node)
 
 /* String space for protocol and field items for the GUI */
-#define ITEM_LABEL_NEW(pool, il)			\
-	il = wmem_new(pool, item_label_t);
-#define ITEM_LABEL_FREE(pool, il)			\
-	wmem_free(pool, il);
+#define ITEM_LABEL_NEW(arena, il)			\
+	il = (item_label_t *)proto_slab_alloc(&(arena)->labels);
+#define ITEM_LABEL_FREE(arena, il)			\
+	proto_slab_free(&(arena)->labels, il);
+
+/* Text for labels rendered on demand */
+#define ITEM_LABEL_PENDING_NEW(arena, ilp, fmt)		\
+	ilp = (item_label_pending_t *)proto_slab_alloc(&(arena)->pending_labels); \
+	ilp->format = fmt;				\
+	ilp->prefix_len = ilp->value_end = ilp->value_len = ilp->len = 0; \
+	ilp->text[0] = '\0';
+#define ITEM_LABEL_PENDING_FREE(arena, ilp)		\
+	proto_slab_free(&(arena)->pending_labels, ilp);
+
+/* The arena that a node's tree carves its objects from */
+#define PNODE_ARENA(node)	((node)->tree_data->arena)
 
 #define PROTO_REGISTRAR_GET_NTH(hfindex, hfinfo)						\
 	if((guint)hfindex >= gpa_hfinfo.len && getenv("WIRESHARK_ABORT_ON_DISSECTOR_BUG"))	\
@@ -573,6 +777,13 @@ proto_cleanup(void)
 
 	g_free(tree_is_expanded);
 	tree_is_expanded = NULL;
+
+	if (tree_arena_cache) {
+		proto_tree_arena_destroy(tree_arena_cache);
+		tree_arena_cache = NULL;
+	}
+
+	ftypes_cleanup();
 }
 
 static gboolean
@@ -670,22 +881,12 @@ free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
 	g_ptr_array_free(ptrs, TRUE);
 }
 
-static void
-proto_tree_free_node(proto_node *node, gpointer data _U_)
-{
-	field_info *finfo  = PNODE_FINFO(node);
-
-	proto_tree_children_foreach(node, proto_tree_free_node, NULL);
-
-	FVALUE_CLEANUP(&finfo->value);
-}
-
 void
 proto_tree_reset(proto_tree *tree)
 {
 	tree_data_t *tree_data = PTREE_DATA(tree);
 
-	proto_tree_children_foreach(tree, proto_tree_free_node, NULL);
+	proto_tree_arena_reset(tree_data->arena);
 
 	/* free tree data */
 	if (tree_data->interesting_hfids) {
@@ -697,6 +898,9 @@ proto_tree_reset(proto_tree *tree)
 		g_hash_table_remove_all(tree_data->interesting_hfids);
 	}
 
+	if (tree_data->primed_hfids)
+		g_array_set_size(tree_data->primed_hfids, 0);
+
 	/* Reset track of the number of children */
 	tree_data->count = 0;
 
@@ -709,7 +913,12 @@ proto_tree_free(proto_tree *tree)
 {
 	tree_data_t *tree_data = PTREE_DATA(tree);
 
-	proto_tree_children_foreach(tree, proto_tree_free_node, NULL);
+	/* keep the arena's chunks for the next tree */
+	proto_tree_arena_reset(tree_data->arena);
+	if (tree_arena_cache == NULL)
+		tree_arena_cache = tree_data->arena;
+	else
+		proto_tree_arena_destroy(tree_data->arena);
 
 	/* free tree data */
 	if (tree_data->interesting_hfids) {
@@ -721,6 +930,9 @@ proto_tree_free(proto_tree *tree)
 		g_hash_table_destroy(tree_data->interesting_hfids);
 	}
 
+	if (tree_data->primed_hfids)
+		g_array_free(tree_data->primed_hfids, TRUE);
+
 	g_slice_free(tree_data_t, tree_data);
 
 	g_slice_free(proto_tree, tree);
@@ -746,6 +958,19 @@ proto_tree_set_fake_protocols(proto_tree *tree, gboolean fake_protocols)
 	PTREE_DATA(tree)->fake_protocols = fake_protocols;
 }
 
+void
+proto_tree_set_record_primed(proto_tree *tree, gboolean record_primed)
+{
+	tree_data_t *tree_data = PTREE_DATA(tree);
+
+	if (record_primed && tree_data->primed_hfids == NULL)
+		tree_data->primed_hfids = g_array_new(FALSE, FALSE, sizeof(gint));
+	else if (!record_primed && tree_data->primed_hfids != NULL) {
+		g_array_free(tree_data->primed_hfids, TRUE);
+		tree_data->primed_hfids = NULL;
+	}
+}
+
 /* Assume dissector set only its protocol fields.
    This function is called by dissectors and allows the speeding up of filtering
    in wireshark; if this function returns FALSE it is safe to reset tree to NULL
@@ -1600,6 +1825,9 @@ tree_data_add_maybe_interesting_field(tree_data_t *tree_data, field_info *fi)
 	if (hfinfo->ref_type == HF_REF_TYPE_DIRECT) {
 		GPtrArray *ptrs = NULL;
 
+		if (tree_data->pinfo && tree_data->pinfo->flags.prune_learn)
+			packet_prune_note_field(tree_data->pinfo, hfinfo->id);
+
 		if (tree_data->interesting_hfids == NULL) {
 			/* Initialize the hash because we now know that it is needed */
 			tree_data->interesting_hfids =
@@ -3912,7 +4140,7 @@ proto_tree_add_node(proto_tree *tree, field_info *fi)
 		/* XXX - is it safe to continue here? */
 	}
 
-	pnode = wmem_new(PNODE_POOL(tree), proto_node);
+	PROTO_NODE_NEW(PNODE_ARENA(tree), pnode);
 	PROTO_NODE_INIT(pnode);
 	pnode->parent = tnode;
 	PNODE_FINFO(pnode) = fi;
@@ -4084,7 +4312,7 @@ new_field_info(proto_tree *tree, header_field_info *hfinfo, tvbuff_t *tvb,
 {
 	field_info *fi;
 
-	FIELD_INFO_NEW(PNODE_POOL(tree), fi);
+	FIELD_INFO_NEW(PNODE_ARENA(tree), fi);
 
 	fi->hfinfo     = hfinfo;
 	fi->start      = start;
@@ -4095,7 +4323,10 @@ new_field_info(proto_tree *tree, header_field_info *hfinfo, tvbuff_t *tvb,
 	if (!PTREE_DATA(tree)->visible)
 		FI_SET_FLAG(fi, FI_HIDDEN);
 	fvalue_init(&fi->value, fi->hfinfo->type);
+	if (fi->value.ftype->free_value)
+		g_ptr_array_add(PNODE_ARENA(tree)->cleanup, fi);
 	fi->rep        = NULL;
+	fi->label_pending = NULL;
 
 	/* add the data source tvbuff */
 	fi->ds_tvb = tvb ? tvb_get_ds_tvb(tvb) : NULL;
@@ -4109,7 +4340,8 @@ new_field_info(proto_tree *tree, header_field_info *hfinfo, tvbuff_t *tvb,
 /* If the protocol tree is to be visible, set the representation of a
    proto_tree entry with the name of the field for the item and with
    the value formatted with the supplied printf-style format and
-   argument list. */
+   argument list.  Only the value is formatted here; the rest of the
+   label is rendered by proto_item_fill_label() if it's asked for. */
 static void
 proto_tree_set_representation_value(proto_item *pi, const char *format, va_list ap)
 {
@@ -4118,44 +4350,17 @@ proto_tree_set_representation_value(proto_item *pi, const char *format, va_list
 	/* If the tree (GUI) or item isn't visible it's pointless for us to generate the protocol
 	 * items string representation */
 	if (PTREE_DATA(pi)->visible && !PROTO_ITEM_IS_HIDDEN(pi)) {
-		int               ret = 0;
-		field_info        *fi = PITEM_FINFO(pi);
-		header_field_info *hf;
+		field_info           *fi = PITEM_FINFO(pi);
+		item_label_pending_t *pending;
+		int                   ret;
 
 		DISSECTOR_ASSERT(fi);
 
-		hf = fi->hfinfo;
-
-		ITEM_LABEL_NEW(PNODE_POOL(pi), fi->rep);
-		if (hf->bitmask && (hf->type == FT_BOOLEAN || IS_FT_UINT(hf->type))) {
-			guint64 val;
-			char *p;
-
-			if (IS_FT_UINT(hf->type))
-				val = fvalue_get_uinteger(&fi->value);
-			else
-				val = fvalue_get_uinteger64(&fi->value);
-
-			val <<= hfinfo_bitshift(hf);
-
-			p = decode_bitfield_value(fi->rep->representation, val, hf->bitmask, hfinfo_bitwidth(hf));
-			ret = (int) (p - fi->rep->representation);
-		}
-
-		/* put in the hf name */
-		ret += g_snprintf(fi->rep->representation + ret, ITEM_LABEL_LENGTH - ret, "%s: ", hf->name);
-
-		/* If possible, Put in the value of the string */
-		if (ret < ITEM_LABEL_LENGTH) {
-			ret += g_vsnprintf(fi->rep->representation + ret,
-					  ITEM_LABEL_LENGTH - ret, format, ap);
-		}
-		if (ret >= ITEM_LABEL_LENGTH) {
-			/* Uh oh, we don't have enough room.  Tell the user
-			 * that the field is truncated.
-			 */
-			LABEL_MARK_TRUNCATED_START(fi->rep->representation);
-		}
+		ITEM_LABEL_PENDING_NEW(PNODE_ARENA(pi), pending, LABEL_FORMAT_VALUE);
+		ret = g_vsnprintf(pending->text, ITEM_LABEL_LENGTH, format, ap);
+		pending->value_len = ret;
+		pending->value_end = pending->len = MIN(ret, ITEM_LABEL_LENGTH - 1);
+		fi->label_pending = pending;
 	}
 }
 
@@ -4171,7 +4376,7 @@ proto_tree_set_representation(proto_item *pi, const char *format, va_list ap)
 	DISSECTOR_ASSERT(fi);
 
 	if (!PROTO_ITEM_IS_HIDDEN(pi)) {
-		ITEM_LABEL_NEW(PNODE_POOL(pi), fi->rep);
+		ITEM_LABEL_NEW(PNODE_ARENA(pi), fi->rep);
 		ret = g_vsnprintf(fi->rep->representation, ITEM_LABEL_LENGTH,
 				  format, ap);
 		if (ret >= ITEM_LABEL_LENGTH) {
@@ -4658,9 +4863,13 @@ proto_item_set_text(proto_item *pi, const char *format, ...)
 		return;
 
 	if (fi->rep) {
-		ITEM_LABEL_FREE(PNODE_POOL(pi), fi->rep);
+		ITEM_LABEL_FREE(PNODE_ARENA(pi), fi->rep);
 		fi->rep = NULL;
 	}
+	if (fi->label_pending) {
+		ITEM_LABEL_PENDING_FREE(PNODE_ARENA(pi), fi->label_pending);
+		fi->label_pending = NULL;
+	}
 
 	va_start(ap, format);
 	proto_tree_set_representation(pi, format, ap);
@@ -4684,12 +4893,26 @@ proto_item_append_text(proto_item *pi, const char *format, ...)
 
 	if (!PROTO_ITEM_IS_HIDDEN(pi)) {
 		/*
-		 * If we don't already have a representation,
-		 * generate the default representation.
+		 * If we don't already have a representation, keep
+		 * the text to append to the default representation
+		 * when it's generated.
 		 */
 		if (fi->rep == NULL) {
-			ITEM_LABEL_NEW(PNODE_POOL(pi), fi->rep);
-			proto_item_fill_label(fi, fi->rep->representation);
+			item_label_pending_t *pending = fi->label_pending;
+			int                   ret;
+
+			if (pending == NULL) {
+				ITEM_LABEL_PENDING_NEW(PNODE_ARENA(pi), pending, LABEL_FORMAT_DEFAULT);
+				fi->label_pending = pending;
+			}
+			if (pending->len < ITEM_LABEL_LENGTH - 1) {
+				va_start(ap, format);
+				ret = g_vsnprintf(pending->text + pending->len,
+					ITEM_LABEL_LENGTH - pending->len, format, ap);
+				va_end(ap);
+				pending->len = MIN(pending->len + ret, ITEM_LABEL_LENGTH - 1);
+			}
+			return;
 		}
 
 		curlen = strlen(fi->rep->representation);
@@ -4719,14 +4942,35 @@ proto_item_prepend_text(proto_item *pi, const char *format, ...)
 
 	if (!PROTO_ITEM_IS_HIDDEN(pi)) {
 		/*
-		 * If we don't already have a representation,
-		 * generate the default representation.
+		 * If we don't already have a representation, keep
+		 * the text to prepend to the default representation
+		 * when it's generated.
 		 */
 		if (fi->rep == NULL) {
-			ITEM_LABEL_NEW(PNODE_POOL(pi), fi->rep);
-			proto_item_fill_label(fi, representation);
-		} else
-			g_strlcpy(representation, fi->rep->representation, ITEM_LABEL_LENGTH);
+			item_label_pending_t *pending = fi->label_pending;
+			int                   ret;
+
+			if (pending == NULL) {
+				ITEM_LABEL_PENDING_NEW(PNODE_ARENA(pi), pending, LABEL_FORMAT_DEFAULT);
+				fi->label_pending = pending;
+			}
+			va_start(ap, format);
+			ret = g_vsnprintf(representation, ITEM_LABEL_LENGTH, format, ap);
+			va_end(ap);
+			if (ret > 0) {
+				/* the new text wins over the end of the old */
+				ret = MIN(ret, ITEM_LABEL_LENGTH - 1);
+				pending->len = MIN(pending->len + ret, ITEM_LABEL_LENGTH - 1);
+				memmove(pending->text + ret, pending->text, pending->len - ret);
+				memcpy(pending->text, representation, ret);
+				pending->text[pending->len] = '\0';
+				pending->prefix_len = MIN(pending->prefix_len + ret, pending->len);
+				pending->value_end  = MIN(pending->value_end + ret, pending->len);
+			}
+			return;
+		}
+
+		g_strlcpy(representation, fi->rep->representation, ITEM_LABEL_LENGTH);
 
 		va_start(ap, format);
 		g_vsnprintf(fi->rep->representation,
@@ -4806,6 +5050,7 @@ proto_tree_create_root(packet_info *pinfo)
 
 	/* Don't initialize the tree_data_t. Wait until we know we need it */
 	pnode->tree_data->interesting_hfids = NULL;
+	pnode->tree_data->primed_hfids = NULL;
 
 	/* Set the default to FALSE so it's easier to
 	 * find errors; if we expect to see the protocol tree
@@ -4819,6 +5064,8 @@ proto_tree_create_root(packet_info *pinfo)
 	/* Keep track of the number of children */
 	pnode->tree_data->count = 0;
 
+	pnode->tree_data->arena = proto_tree_arena_new();
+
 	return (proto_tree *)pnode;
 }
 
@@ -4826,11 +5073,17 @@ proto_tree_create_root(packet_info *pinfo)
 /* "prime" a proto_tree with a single hfid that a dfilter
  * is interested in. */
 void
-proto_tree_prime_hfid(proto_tree *tree _U_, const gint hfid)
+proto_tree_prime_hfid(proto_tree *tree, const gint hfid)
 {
 	header_field_info *hfinfo;
 
 	PROTO_REGISTRAR_GET_NTH(hfid, hfinfo);
+
+	/* remember it, if dissection pruning wants to know which fields
+	   are wanted */
+	if (tree && PTREE_DATA(tree)->primed_hfids)
+		g_array_append_val(PTREE_DATA(tree)->primed_hfids, hfid);
+
 	/* this field is referenced by a filter so increase the refcount.
 	   also increase the refcount for the parent, i.e the protocol.
 	*/
@@ -6125,8 +6378,73 @@ label_fill_descr(char *label_str, gsize pos, const header_field_info *hfinfo, co
 	return pos;
 }
 
+/* Renders the name of an item's field, and the value text that its
+ * dissector gave, as proto_tree_add_..._format_value() labels read. */
+static void
+fill_label_value(field_info *fi, const item_label_pending_t *pending, gchar *label_str)
+{
+	header_field_info *hf = fi->hfinfo;
+	int                ret = 0;
+
+	if (hf->bitmask && (hf->type == FT_BOOLEAN || IS_FT_UINT(hf->type))) {
+		guint64 val;
+		char *p;
+
+		if (IS_FT_UINT(hf->type))
+			val = fvalue_get_uinteger(&fi->value);
+		else
+			val = fvalue_get_uinteger64(&fi->value);
+
+		val <<= hfinfo_bitshift(hf);
+
+		p = decode_bitfield_value(label_str, val, hf->bitmask, hfinfo_bitwidth(hf));
+		ret = (int) (p - label_str);
+	}
+
+	/* put in the hf name */
+	ret += g_snprintf(label_str + ret, ITEM_LABEL_LENGTH - ret, "%s: ", hf->name);
+
+	/* If possible, Put in the value of the string */
+	if (ret < ITEM_LABEL_LENGTH) {
+		g_strlcpy(label_str + ret, pending->text + pending->prefix_len,
+			  MIN(pending->value_end - pending->prefix_len + 1, ITEM_LABEL_LENGTH - ret));
+		ret += pending->value_len;
+	}
+	if (ret >= ITEM_LABEL_LENGTH) {
+		/* Uh oh, we don't have enough room.  Tell the user
+		 * that the field is truncated.
+		 */
+		LABEL_MARK_TRUNCATED_START(label_str);
+	}
+}
+
 void
 proto_item_fill_label(field_info *fi, gchar *label_str)
+{
+	item_label_pending_t *pending;
+	gchar                 label[ITEM_LABEL_LENGTH];
+
+	if (!fi || !fi->label_pending) {
+		fill_label_default(fi, label_str);
+		return;
+	}
+
+	/* The label is the dissector's prepended text, the label
+	 * rendered from the field, and the dissector's appended text. */
+	pending = fi->label_pending;
+	if (pending->format == LABEL_FORMAT_VALUE)
+		fill_label_value(fi, pending, label);
+	else
+		fill_label_default(fi, label);
+
+	g_strlcpy(label_str, pending->text, pending->prefix_len + 1);
+	g_strlcat(label_str, label, ITEM_LABEL_LENGTH);
+	g_strlcat(label_str, pending->text + pending->value_end, ITEM_LABEL_LENGTH);
+}
+
+/* Renders the label that an item gets from its field's value. */
+static void
+fill_label_default(field_info *fi, gchar *label_str)
 {
 	header_field_info *hfinfo;
 	guint8		  *bytes;
@@ -7079,7 +7397,7 @@ proto_check_for_protocol_or_field(const proto_tree* tree, const int id)
 /* Return GPtrArray* of field_info pointers for all hfindex that appear in tree.
  * This only works if the hfindex was "primed" before the dissection
  * took place, as we just pass back the already-created GPtrArray*.
- * The caller should *not* free the GPtrArray*; proto_tree_free_node()
+ * The caller should *not* free the GPtrArray*; proto_tree_free()
  * handles that. */
 GPtrArray *
 proto_get_finfo_ptr_array(const proto_tree *tree, const int id)
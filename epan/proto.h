@@ -591,6 +591,10 @@ typedef struct _item_label_t {
 	char representation[ITEM_LABEL_LENGTH];
 } item_label_t;
 
+/** text that a dissector gave for part of a label that is rendered on
+ * demand; private to proto.c */
+struct _item_label_pending;
+
 
 /** Contains the field information for the proto_item. */
 typedef struct field_info {
@@ -602,6 +606,7 @@ typedef struct field_info {
 	gint			 tree_type;       /**< one of ETT_ or -1 */
 	guint32			 flags;           /**< bitfield like FI_GENERATED, ... */
 	item_label_t		*rep;             /**< string for GUI tree */
+	struct _item_label_pending *label_pending; /**< if rep is NULL, text to render the label with; see proto_item_fill_label() */
 	tvbuff_t		*ds_tvb;          /**< data source tvbuff */
 	fvalue_t		 value;
 } field_info;
@@ -666,14 +671,20 @@ typedef struct
 #define FI_GET_BITS_OFFSET(fi) (FI_GET_FLAG(fi, FI_BITS_OFFSET(7)) >> 5)
 #define FI_GET_BITS_SIZE(fi)   (FI_GET_FLAG(fi, FI_BITS_SIZE(63)) >> 8)
 
+/** The arena that a protocol tree's nodes, field_infos and labels are
+ * allocated from; private to proto.c. */
+typedef struct _proto_tree_arena proto_tree_arena_t;
+
 /** One of these exists for the entire protocol tree. Each proto_node
  * in the protocol tree points to the same copy. */
 typedef struct {
     GHashTable  *interesting_hfids;
+    GArray      *primed_hfids;  /* fields the tree has been primed with, if pruning */
     gboolean     visible;
     gboolean     fake_protocols;
     gint         count;
     struct _packet_info *pinfo;
+    proto_tree_arena_t  *arena;
 } tree_data_t;
 
 /** Each proto_tree, proto_item is one of these. */
@@ -926,6 +937,13 @@ proto_tree_set_visible(proto_tree *tree, gboolean visible);
 extern void
 proto_tree_set_fake_protocols(proto_tree *tree, gboolean fake_protocols);
 
+/** Indicate whether the tree should remember the fields it's primed with,
+ for dissection pruning (default = FALSE)
+ @param tree the tree to be set
+ @param record_primed TRUE if primed fields should be remembered */
+extern void
+proto_tree_set_record_primed(proto_tree *tree, gboolean record_primed);
+
 /** Mark a field/protocol ID as "interesting".
  @param tree the tree to be set (currently ignored)
  @param hfid the interesting field id
@@ -1941,7 +1959,11 @@ proto_item_append_string(proto_item *pi, const char *str);
 
 
 
-/** Fill given label_str with string representation of field
+/** Fill given label_str with string representation of field.
+ The text that dissectors append or prepend to labels made from the
+ field's value, and the value text of the _format_value() functions,
+ is kept aside and only rendered into a label here, so use this to
+ get the label of any item whose rep is NULL.
  @param fi the item to get the info from
  @param label_str the string to fill
  @todo think about changing the parameter profile */
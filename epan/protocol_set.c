@@ -0,0 +1,265 @@
+/* protocol_set.c
+ * Sets of the protocols that were in frames, for filtering on protocol
+ * presence without dissecting
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "protocol_set.h"
+
+/*
+ * A set is a bitset, with a bit for each protocol that's been seen in
+ * any frame, numbered in the order in which they were first seen; the
+ * trailing all-zero words are left out, so that a set doesn't change
+ * as more protocols are seen.
+ */
+typedef struct {
+  guint    n_words;
+  guint32 *words;
+} protocol_set_t;
+
+struct _protocol_set_table {
+  GHashTable *bit_of_proto;     /* protocol ID -> bit number + 1 */
+  guint       n_bits;
+  GPtrArray  *sets;             /* protocol_set_t *, by set number - 1 */
+  GHashTable *set_numbers;      /* protocol_set_t * -> set number */
+  GArray     *scratch;          /* words of the set being built */
+};
+
+#define FILTER_RESULT_UNKNOWN 0
+#define FILTER_RESULT_FAILED  1
+#define FILTER_RESULT_PASSED  2
+
+struct _protocol_set_filter {
+  protocol_set_table_t *table;
+  dfilter_t            *df;
+  GArray               *results;  /* FILTER_RESULT_ of each set, by set number - 1 */
+  guint16               set;      /* set being filtered */
+};
+
+static guint
+protocol_set_hash(gconstpointer key)
+{
+  const protocol_set_t *ps = (const protocol_set_t *)key;
+  guint hash = ps->n_words;
+  guint i;
+
+  for (i = 0; i < ps->n_words; i++)
+    hash = hash * 31 + ps->words[i];
+  return hash;
+}
+
+static gboolean
+protocol_set_equal(gconstpointer a, gconstpointer b)
+{
+  const protocol_set_t *psa = (const protocol_set_t *)a;
+  const protocol_set_t *psb = (const protocol_set_t *)b;
+
+  return psa->n_words == psb->n_words &&
+         memcmp(psa->words, psb->words, psa->n_words * sizeof (guint32)) == 0;
+}
+
+protocol_set_table_t *
+protocol_set_table_new(void)
+{
+  protocol_set_table_t *table;
+
+  table = g_new(protocol_set_table_t, 1);
+  table->bit_of_proto = g_hash_table_new(g_direct_hash, g_direct_equal);
+  table->n_bits = 0;
+  table->sets = g_ptr_array_new();
+  table->set_numbers = g_hash_table_new(protocol_set_hash, protocol_set_equal);
+  table->scratch = g_array_new(FALSE, TRUE, sizeof (guint32));
+  return table;
+}
+
+void
+protocol_set_table_clear(protocol_set_table_t *table)
+{
+  protocol_set_t *ps;
+  guint i;
+
+  g_hash_table_remove_all(table->set_numbers);
+  for (i = 0; i < table->sets->len; i++) {
+    ps = (protocol_set_t *)g_ptr_array_index(table->sets, i);
+    g_free(ps->words);
+    g_free(ps);
+  }
+  g_ptr_array_set_size(table->sets, 0);
+  g_hash_table_remove_all(table->bit_of_proto);
+  table->n_bits = 0;
+}
+
+void
+protocol_set_table_free(protocol_set_table_t *table)
+{
+  protocol_set_table_clear(table);
+  g_hash_table_destroy(table->bit_of_proto);
+  g_ptr_array_free(table->sets, TRUE);
+  g_hash_table_destroy(table->set_numbers);
+  g_array_free(table->scratch, TRUE);
+  g_free(table);
+}
+
+static void
+add_node_protocols(proto_node *node, gpointer data)
+{
+  protocol_set_table_t *table = (protocol_set_table_t *)data;
+  field_info *fi = PNODE_FINFO(node);
+  guint bit;
+
+  if (fi != NULL && fi->hfinfo->type == FT_PROTOCOL) {
+    bit = GPOINTER_TO_UINT(g_hash_table_lookup(table->bit_of_proto,
+                                               GINT_TO_POINTER(fi->hfinfo->id)));
+    if (bit == 0) {
+      bit = ++table->n_bits;
+      g_hash_table_insert(table->bit_of_proto, GINT_TO_POINTER(fi->hfinfo->id),
+                          GUINT_TO_POINTER(bit));
+    }
+    bit--;
+    if (bit / 32 >= table->scratch->len)
+      g_array_set_size(table->scratch, bit / 32 + 1);
+    g_array_index(table->scratch, guint32, bit / 32) |= 1U << (bit % 32);
+  }
+
+  /* Protocols can be anywhere in the tree, e.g. an IP header in an ICMP
+     error message; as the tree isn't visible, most of the other items
+     have been faked, so this doesn't visit many. */
+  proto_tree_children_foreach(node, add_node_protocols, data);
+}
+
+guint16
+protocol_set_table_add_tree(protocol_set_table_t *table, proto_tree *tree)
+{
+  protocol_set_t key, *ps;
+  guint set;
+
+  g_array_set_size(table->scratch, 0);
+  proto_tree_children_foreach(tree, add_node_protocols, table);
+
+  key.n_words = table->scratch->len;
+  key.words = (guint32 *)(void *)table->scratch->data;
+  while (key.n_words != 0 && key.words[key.n_words - 1] == 0)
+    key.n_words--;
+
+  set = GPOINTER_TO_UINT(g_hash_table_lookup(table->set_numbers, &key));
+  if (set != 0)
+    return (guint16)set;
+
+  if (table->sets->len == G_MAXUINT16)
+    return 0; /* full */
+
+  ps = g_new(protocol_set_t, 1);
+  ps->n_words = key.n_words;
+  ps->words = (guint32 *)g_memdup(key.words, key.n_words * sizeof (guint32));
+  g_ptr_array_add(table->sets, ps);
+  g_hash_table_insert(table->set_numbers, ps, GUINT_TO_POINTER(table->sets->len));
+  return (guint16)table->sets->len;
+}
+
+gboolean
+protocol_set_contains(const protocol_set_table_t *table, guint16 set,
+                      int proto_id)
+{
+  const protocol_set_t *ps;
+  guint bit;
+
+  if (set == 0 || set > table->sets->len)
+    return FALSE;
+  bit = GPOINTER_TO_UINT(g_hash_table_lookup(table->bit_of_proto,
+                                             GINT_TO_POINTER(proto_id)));
+  if (bit == 0)
+    return FALSE; /* never seen */
+  bit--;
+
+  ps = (const protocol_set_t *)g_ptr_array_index(table->sets, set - 1);
+  return bit / 32 < ps->n_words &&
+         (ps->words[bit / 32] & (1U << (bit % 32))) != 0;
+}
+
+protocol_set_filter_t *
+protocol_set_filter_new(protocol_set_table_t *table, dfilter_t *df)
+{
+  protocol_set_filter_t *psf;
+
+  if (!dfilter_tests_protocols_only(df))
+    return NULL;
+
+  psf = g_new(protocol_set_filter_t, 1);
+  psf->table = table;
+  psf->df = df;
+  psf->results = g_array_new(FALSE, TRUE, sizeof (guint8));
+  psf->set = 0;
+  return psf;
+}
+
+void
+protocol_set_filter_free(protocol_set_filter_t *psf)
+{
+  g_array_free(psf->results, TRUE);
+  g_free(psf);
+}
+
+static gboolean
+filter_set_has_protocol(int proto_id, gpointer user_data)
+{
+  protocol_set_filter_t *psf = (protocol_set_filter_t *)user_data;
+
+  return protocol_set_contains(psf->table, psf->set, proto_id);
+}
+
+gboolean
+protocol_set_filter_apply(protocol_set_filter_t *psf, guint16 set,
+                          gboolean *passed)
+{
+  guint8 *result;
+
+  if (set == 0 || set > psf->table->sets->len)
+    return FALSE;
+
+  if (set > psf->results->len)
+    g_array_set_size(psf->results, set);
+  result = &g_array_index(psf->results, guint8, set - 1);
+  if (*result == FILTER_RESULT_UNKNOWN) {
+    psf->set = set;
+    *result = dfilter_apply_protocols(psf->df, filter_set_has_protocol, psf) ?
+              FILTER_RESULT_PASSED : FILTER_RESULT_FAILED;
+  }
+  *passed = (*result == FILTER_RESULT_PASSED);
+  return TRUE;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 2
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=2 tabstop=8 expandtab:
+ * :indentSize=2:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,111 @@
+/* protocol_set.h
+ * Sets of the protocols that were in frames, for filtering on protocol
+ * presence without dissecting
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __PROTOCOL_SET_H__
+#define __PROTOCOL_SET_H__
+
+#include <glib.h>
+#include "ws_symbol_export.h"
+
+#include <epan/proto.h>
+#include <epan/dfilter/dfilter.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * A table of the distinct sets of protocols that frames had, as
+ * bitsets over the protocols seen so far.  A frame refers to its set
+ * by number, in the "proto_set" member of its frame_data; as most
+ * frames of a capture share a few sets, that takes two bytes a frame.
+ * Number 0 means that the frame's protocols aren't known.
+ */
+typedef struct _protocol_set_table protocol_set_table_t;
+
+/* Filter results for each set of a table. */
+typedef struct _protocol_set_filter protocol_set_filter_t;
+
+WS_DLL_PUBLIC protocol_set_table_t *protocol_set_table_new(void);
+
+WS_DLL_PUBLIC void protocol_set_table_free(protocol_set_table_t *table);
+
+/*
+ * Forget all the sets, e.g. because the frames are being dissected
+ * again from scratch; the caller has to forget the set numbers the
+ * frames have.
+ */
+WS_DLL_PUBLIC void protocol_set_table_clear(protocol_set_table_t *table);
+
+/*
+ * Return the number of the set of protocols in a dissected frame's
+ * tree, adding it if it's new; or 0 if the table is full.
+ *
+ * For the set to be right, protocols must not have been faked in the
+ * tree; see epan_dissect_fake_protocols().
+ */
+WS_DLL_PUBLIC guint16 protocol_set_table_add_tree(protocol_set_table_t *table,
+    proto_tree *tree);
+
+/*
+ * Was the protocol with the given ID in the frames of the given set?
+ */
+WS_DLL_PUBLIC gboolean protocol_set_contains(const protocol_set_table_t *table,
+    guint16 set, int proto_id);
+
+/*
+ * If the filter tests only whether protocols are present, return a
+ * protocol_set_filter_t for applying it to the sets of the table;
+ * otherwise return NULL.  The filter and the table must outlive it.
+ */
+WS_DLL_PUBLIC protocol_set_filter_t *protocol_set_filter_new(
+    protocol_set_table_t *table, dfilter_t *df);
+
+WS_DLL_PUBLIC void protocol_set_filter_free(protocol_set_filter_t *psf);
+
+/*
+ * Set "*passed" to whether frames with the given set pass the filter;
+ * the filter is applied once per set.  Return FALSE if the set is 0,
+ * in which case the frame has to be dissected.
+ */
+WS_DLL_PUBLIC gboolean protocol_set_filter_apply(protocol_set_filter_t *psf,
+    guint16 set, gboolean *passed);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __PROTOCOL_SET_H__ */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 2
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=2 tabstop=8 expandtab:
+ * :indentSize=2:tabSize=8:noTabs=true:
+ */
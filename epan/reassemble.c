@@ -405,6 +405,18 @@ free_fragments(gpointer data, gpointer user_data _U_)
 	g_slice_free(fragment_item, fd_head);
 }
 
+/*
+ * All the reassembly tables that exist, so that reassembly_expire()
+ * can go through them.
+ */
+static GList *reassembly_tables;
+
+/*
+ * Number of reassemblies freed by reassembly_expire().
+ */
+static guint64 expired_fragmented;
+static guint64 expired_reassembled;
+
 /*
  * Initialize a reassembly table, with specified functions.
  */
@@ -434,6 +446,7 @@ reassembly_table_init(reassembly_table *table,
 		/* The fragment table does not exist. Create it */
 		table->fragment_table = g_hash_table_new_full(funcs->hash_func,
 		    funcs->equal_func, funcs->free_persistent_key_func, NULL);
+		reassembly_tables = g_list_prepend(reassembly_tables, table);
 	}
 
 	if (table->reassembled_table != NULL) {
@@ -489,6 +502,7 @@ reassembly_table_destroy(reassembly_table *table)
 		 */
 		g_hash_table_destroy(table->fragment_table);
 		table->fragment_table = NULL;
+		reassembly_tables = g_list_remove(reassembly_tables, table);
 	}
 	if (table->reassembled_table != NULL) {
 		GPtrArray *allocated_fragments;
@@ -515,6 +529,116 @@ reassembly_table_destroy(reassembly_table *table)
 	}
 }
 
+typedef struct {
+	guint32 frame_num;		/* expire what's idle since before this */
+	guint64 count;			/* reassemblies freed */
+	GPtrArray *allocated_fragments;	/* for free_all_reassembled_fragments() */
+} expire_arg_t;
+
+/*
+ * For a fragment hash table entry, free the associated fragments if no
+ * fragment was added to it in or after the frame being expired from.
+ */
+static gboolean
+expire_fragments(gpointer key_arg, gpointer value, gpointer user_data)
+{
+	expire_arg_t *arg = (expire_arg_t *)user_data;
+	fragment_head *fd_head = (fragment_head *)value;
+	fragment_item *fd;
+	guint32 last_frame = 0;
+
+	/*
+	 * A reassembly with no fragments yet, e.g. one started with
+	 * fragment_start_seq_check(), has no data to free; keep it.
+	 */
+	if (fd_head->next == NULL)
+		return FALSE;
+
+	for (fd = fd_head->next; fd != NULL; fd = fd->next) {
+		if (fd->frame > last_frame)
+			last_frame = fd->frame;
+	}
+	if (last_frame >= arg->frame_num)
+		return FALSE;
+
+	arg->count++;
+	return free_all_fragments(key_arg, value, NULL);
+}
+
+/*
+ * For a reassembled-packet hash table entry, free the reassembled packet
+ * if it was reassembled before the frame being expired from; it's in the
+ * table once for each of its frames, which all come before that.
+ */
+static gboolean
+expire_reassembled_fragments(gpointer key_arg, gpointer value,
+			     gpointer user_data)
+{
+	expire_arg_t *arg = (expire_arg_t *)user_data;
+	fragment_head *fd_head = (fragment_head *)value;
+
+	if (fd_head->reassembled_in >= arg->frame_num)
+		return FALSE;
+
+	if (fd_head->flags != FD_VISITED_FREE)
+		arg->count++;
+	return free_all_reassembled_fragments(key_arg, value,
+	    arg->allocated_fragments);
+}
+
+/*
+ * Free the reassemblies, in all the reassembly tables, that have had no
+ * fragments added in or after the given frame.
+ */
+void
+reassembly_expire(const guint32 frame_num)
+{
+	reassembly_table *table;
+	expire_arg_t arg;
+	GList *item;
+
+	arg.frame_num = frame_num;
+	arg.allocated_fragments = g_ptr_array_new();
+	for (item = reassembly_tables; item != NULL; item = item->next) {
+		table = (reassembly_table *)item->data;
+
+		arg.count = 0;
+		g_hash_table_foreach_remove(table->fragment_table,
+		    expire_fragments, &arg);
+		expired_fragmented += arg.count;
+
+		if (table->reassembled_table != NULL) {
+			arg.count = 0;
+			g_hash_table_foreach_remove(table->reassembled_table,
+			    expire_reassembled_fragments, &arg);
+			expired_reassembled += arg.count;
+
+			g_ptr_array_foreach(arg.allocated_fragments,
+			    free_fragments, NULL);
+			g_ptr_array_set_size(arg.allocated_fragments, 0);
+		}
+	}
+	g_ptr_array_free(arg.allocated_fragments, TRUE);
+}
+
+void
+reassembly_get_expiry_stats(reassembly_expiry_stats_t *stats)
+{
+	reassembly_table *table;
+	GList *item;
+
+	stats->expired_fragmented = expired_fragmented;
+	stats->expired_reassembled = expired_reassembled;
+	stats->retained_fragmented = 0;
+	stats->retained_reassembled = 0;
+	for (item = reassembly_tables; item != NULL; item = item->next) {
+		table = (reassembly_table *)item->data;
+		stats->retained_fragmented += g_hash_table_size(table->fragment_table);
+		if (table->reassembled_table != NULL)
+			stats->retained_reassembled += g_hash_table_size(table->reassembled_table);
+	}
+}
+
 /*
  * Look up an fd_head in the fragment table, optionally returning the key
  * for it.
@@ -170,6 +170,31 @@ reassembly_table_init(reassembly_table *table,
 WS_DLL_PUBLIC void
 reassembly_table_destroy(reassembly_table *table);
 
+/*
+ * Free the reassemblies, in every reassembly table, that have had no
+ * fragment added in or after frame frame_num: unfinished ones, with the
+ * fragments they have so far, and finished ones, with their reassembled
+ * data.  That's only safe if frames are dissected once, in order, and
+ * never revisited, as a finished reassembly is looked up again when any
+ * of its frames is dissected again.
+ */
+WS_DLL_PUBLIC void
+reassembly_expire(const guint32 frame_num);
+
+typedef struct {
+	guint64	expired_fragmented;	/* unfinished reassemblies freed */
+	guint64	expired_reassembled;	/* finished reassemblies freed */
+	guint	retained_fragmented;	/* reassemblies in fragment tables */
+	guint	retained_reassembled;	/* frames in reassembled-packet tables */
+} reassembly_expiry_stats_t;
+
+/*
+ * Get the number of reassemblies that reassembly_expire() has freed
+ * since the program started, and the number that are being kept.
+ */
+WS_DLL_PUBLIC void
+reassembly_get_expiry_stats(reassembly_expiry_stats_t *stats);
+
 /*
  * This function adds a new fragment to the reassembly table
  * If this is the first fragment seen for this datagram, a new entry
@@ -1147,6 +1147,59 @@ test_fragment_add_seq_check_1(void)
     ASSERT(!tvb_memeql(fd_head->tvb_data,60,data+10,50));
 }
 
+/* Tests freeing reassemblies that have had no fragments since a given frame.
+ */
+static void
+test_fragment_expire(void)
+{
+    fragment_head *fd_head;
+    reassembly_expiry_stats_t before, after;
+
+    printf("Starting test test_fragment_expire\n");
+
+    reassembly_get_expiry_stats(&before);
+
+    /* datagram 12 is reassembled in frame 2 */
+    pinfo.fd->num = 1;
+    fd_head=fragment_add_seq_check(&test_reassembly_table, tvb, 10, &pinfo, 12, NULL,
+                                   1, 50, FALSE);
+    ASSERT_EQ(NULL,fd_head);
+    pinfo.fd->num = 2;
+    fd_head=fragment_add_seq_check(&test_reassembly_table, tvb, 5, &pinfo, 12, NULL,
+                                   0, 60, TRUE);
+    ASSERT_NE(NULL,fd_head);
+
+    /* datagram 13 is still being reassembled in frame 3 */
+    pinfo.fd->num = 3;
+    fd_head=fragment_add_seq_check(&test_reassembly_table, tvb, 15, &pinfo, 13, NULL,
+                                   1, 40, FALSE);
+    ASSERT_EQ(NULL,fd_head);
+
+    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(2,g_hash_table_size(test_reassembly_table.reassembled_table));
+
+    /* nothing has been idle since frame 2 */
+    reassembly_expire(2);
+    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(2,g_hash_table_size(test_reassembly_table.reassembled_table));
+
+    /* datagram 12 has */
+    reassembly_expire(3);
+    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.reassembled_table));
+
+    /* and both have since frame 4 */
+    reassembly_expire(4);
+    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.reassembled_table));
+
+    reassembly_get_expiry_stats(&after);
+    ASSERT(after.expired_fragmented == before.expired_fragmented + 1);
+    ASSERT(after.expired_reassembled == before.expired_reassembled + 1);
+    ASSERT_EQ(0,after.retained_fragmented);
+    ASSERT_EQ(0,after.retained_reassembled);
+}
+
 /**********************************************************************************
  *
  * fragment_add_seq_802_11
@@ -1536,6 +1589,7 @@ main(int argc _U_, char **argv _U_)
         test_fragment_add_seq_duplicate_conflict,
         test_fragment_add_seq_check,               /* frag + reassemble */
         test_fragment_add_seq_check_1,
+        test_fragment_expire,
         test_fragment_add_seq_802_11_0,
         test_fragment_add_seq_802_11_1,
         test_simple_fragment_add_seq_next,
@@ -68,6 +68,7 @@ typedef struct _tap_listener_t {
 	gboolean needs_redraw;
 	guint flags;
 	dfilter_t *code;
+	guint code_index; /* index of code in tap_filter_batch */
 	void *tapdata;
 	tap_reset_cb reset;
 	tap_packet_cb packet;
@@ -75,6 +76,17 @@ typedef struct _tap_listener_t {
 } tap_listener_t;
 static volatile tap_listener_t *tap_listener_queue=NULL;
 
+/*
+ * The filters of all the tap listeners, merged so that they're run
+ * once for each packet and share the fields they read, rather than
+ * once for each tapped packet for each listener.  It's built when it's
+ * first needed, and thrown away whenever a filter is added or removed.
+ */
+static dfilter_batch_t *tap_filter_batch=NULL;
+/* Bitmap of the filters in tap_filter_batch whose listeners have been
+   handed something for the current packet. */
+static guint32 *tap_filter_wanted=NULL;
+
 #ifdef HAVE_PLUGINS
 
 #include <gmodule.h>
@@ -258,6 +270,57 @@ tap_queue_packet(int tap_id, packet_info *pinfo, const void *tap_specific_data)
  * Functions used by file.c to drive the tap subsystem
  * ********************************************************************** */
 
+static void
+tap_filters_changed(void)
+{
+	dfilter_batch_free(tap_filter_batch);
+	tap_filter_batch=NULL;
+	g_free(tap_filter_wanted);
+	tap_filter_wanted=NULL;
+}
+
+/* Has anything been queued for this tap for the current packet? */
+static gboolean
+tap_packet_queued(int tap_id)
+{
+	guint i;
+
+	for(i=0;i<tap_packet_index;i++){
+		if(tap_packet_array[i].tap_id==tap_id){
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/* Run the filters of the tap listeners on a dissected packet; only the
+   listeners of taps that have had something queued for the packet
+   need theirs run. */
+static void
+tap_apply_filters(epan_dissect_t *edt)
+{
+	tap_listener_t *tl;
+
+	if(!tap_filter_batch){
+		tap_filter_batch=dfilter_batch_new(FALSE);
+		for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
+			if(tl->code){
+				tl->code_index=dfilter_batch_add(tap_filter_batch, tl->code);
+			}
+		}
+		tap_filter_wanted=g_new(guint32, (dfilter_batch_count(tap_filter_batch)+31)/32);
+	}
+
+	memset(tap_filter_wanted, 0, (dfilter_batch_count(tap_filter_batch)+31)/32*sizeof(guint32));
+	for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
+		if(tl->code && tap_packet_queued(tl->tap_id)){
+			tap_filter_wanted[tl->code_index/32]|=1U<<(tl->code_index%32);
+		}
+	}
+
+	dfilter_batch_apply_edt_wanted(tap_filter_batch, edt, tap_filter_wanted);
+}
+
 void tap_build_interesting (epan_dissect_t *edt)
 {
 	tap_listener_t *tl;
@@ -304,6 +367,7 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 	tap_packet_t *tp;
 	tap_listener_t *tl;
 	guint i;
+	gboolean filtered=FALSE;
 
 	/* nothing to do, just return */
 	if(!tapping_is_active){
@@ -325,7 +389,14 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 			if(tp->tap_id==tl->tap_id){
 				gboolean passed=TRUE;
 				if(tl->code){
-					passed=dfilter_apply_edt(tl->code, edt);
+					/* The filters only depend on the packet,
+					   so run all those that will be needed
+					   the first time one of them is. */
+					if(!filtered){
+						tap_apply_filters(edt);
+						filtered=TRUE;
+					}
+					passed=dfilter_batch_matched(tap_filter_batch, tl->code_index);
 				}
 				if(passed && tl->packet){
 					tl->needs_redraw|=tl->packet(tl->tapdata, tp->pinfo, edt, tp->tap_specific_data);
@@ -506,6 +577,10 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 
 	tap_listener_queue=tl;
 
+	if(tl->code){
+		tap_filters_changed();
+	}
+
 	return NULL;
 }
 
@@ -535,6 +610,7 @@ set_tap_dfilter(void *tapdata, const char *fstring)
 	}
 
 	if(tl){
+		tap_filters_changed();
 		if(tl->code){
 			dfilter_free(tl->code);
 			tl->code=NULL;
@@ -582,6 +658,7 @@ remove_tap_listener(void *tapdata)
 
 	if(tl){
 		if(tl->code){
+			tap_filters_changed();
 			dfilter_free(tl->code);
 		}
 		g_free(tl);
@@ -49,6 +49,10 @@ struct _wmem_allocator_t {
     /* Callback List */
     struct _wmem_user_cb_container_t *callbacks;
 
+    /* Memory freed by other threads, linked through its first bytes and
+     * freed by the owner in wmem_process_deferred_frees() */
+    volatile gpointer deferred_frees;
+
     /* Implementation details */
     void                        *private_data;
     enum _wmem_allocator_type_t  type;
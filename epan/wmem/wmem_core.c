@@ -87,6 +87,57 @@ wmem_free(wmem_allocator_t *allocator, void *ptr)
     allocator->free(allocator->private_data, ptr);
 }
 
+void
+wmem_free_deferred(wmem_allocator_t *allocator, void *ptr)
+{
+    gpointer head;
+
+    if (allocator == NULL) {
+        g_free(ptr);
+        return;
+    }
+
+    if (ptr == NULL) {
+        return;
+    }
+
+    do {
+        head = g_atomic_pointer_get(&allocator->deferred_frees);
+        *(gpointer *)ptr = head;
+    } while (!g_atomic_pointer_compare_and_exchange(&allocator->deferred_frees,
+                head, ptr));
+}
+
+/* Takes the whole list of deferred frees, leaving it empty. */
+static gpointer
+wmem_take_deferred_frees(wmem_allocator_t *allocator)
+{
+    gpointer head;
+
+    do {
+        head = g_atomic_pointer_get(&allocator->deferred_frees);
+    } while (head != NULL &&
+            !g_atomic_pointer_compare_and_exchange(&allocator->deferred_frees,
+                head, NULL));
+
+    return head;
+}
+
+guint
+wmem_process_deferred_frees(wmem_allocator_t *allocator)
+{
+    gpointer ptr, next;
+    guint    count = 0;
+
+    for (ptr = wmem_take_deferred_frees(allocator); ptr != NULL; ptr = next) {
+        next = *(gpointer *)ptr;
+        allocator->free(allocator->private_data, ptr);
+        count++;
+    }
+
+    return count;
+}
+
 void *
 wmem_realloc(wmem_allocator_t *allocator, void *ptr, const size_t size)
 {
@@ -111,6 +162,9 @@ wmem_realloc(wmem_allocator_t *allocator, void *ptr, const size_t size)
 static void
 wmem_free_all_real(wmem_allocator_t *allocator, gboolean final)
 {
+    /* the memory is all going anyway */
+    wmem_take_deferred_frees(allocator);
+
     wmem_call_callbacks(allocator,
             final ? WMEM_CB_DESTROY_EVENT : WMEM_CB_FREE_EVENT);
     allocator->free_all(allocator->private_data);
@@ -154,6 +208,7 @@ wmem_allocator_new(const wmem_allocator_type_t type)
     allocator->type      = real_type;
     allocator->callbacks = NULL;
     allocator->in_scope  = TRUE;
+    allocator->deferred_frees = NULL;
 
     switch (real_type) {
         case WMEM_ALLOCATOR_SIMPLE:
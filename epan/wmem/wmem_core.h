@@ -148,6 +148,32 @@ WS_DLL_PUBLIC
 void
 wmem_free(wmem_allocator_t *allocator, void *ptr);
 
+/** Returns memory to an allocator that belongs to another thread. Pools are
+ * not thread-safe, so the memory is only queued, without taking a lock, and is
+ * freed when the thread that owns the allocator calls
+ * wmem_process_deferred_frees(); wmem_leave_packet_scope() does that for the
+ * file scope of the thread's scope set. The memory block must be at least as
+ * large as a pointer, and must not be passed here after its pool has been
+ * emptied.
+ *
+ * @param allocator The allocator object used to originally allocate the memory.
+ * @param ptr The pointer to the memory block to free. After this function
+ * returns it no longer points to valid memory.
+ */
+WS_DLL_PUBLIC
+void
+wmem_free_deferred(wmem_allocator_t *allocator, void *ptr);
+
+/** Frees the memory that other threads have passed to wmem_free_deferred().
+ * Must only be called by the thread that owns the allocator.
+ *
+ * @param allocator The allocator to free the memory in.
+ * @return The number of memory blocks freed.
+ */
+WS_DLL_PUBLIC
+guint
+wmem_process_deferred_frees(wmem_allocator_t *allocator);
+
 /** Resizes a block of memory, potentially moving it if resizing it in place
  * is not possible.
  *
@@ -47,39 +47,82 @@
  * perfect, but it should stop most of the bad behaviour that emem permitted.
  */
 
-/* TODO: Make these thread-local */
-static wmem_allocator_t *packet_scope = NULL;
-static wmem_allocator_t *file_scope   = NULL;
-static wmem_allocator_t *epan_scope   = NULL;
+/* The packet and file scopes belong to a scope set. A thread uses the default
+ * set unless it binds one of its own with wmem_scope_set_bind(), so that
+ * dissection can run on more than one thread at a time, each thread with its
+ * own packet and file scopes. The epan scope is shared by every thread. */
+struct _wmem_scope_set_t {
+    wmem_allocator_t *packet_scope;
+    wmem_allocator_t *file_scope;
+};
+
+static wmem_scope_set_t *default_scopes = NULL;
+static wmem_allocator_t *epan_scope     = NULL;
+
+/* Set once any thread has bound a scope set; until then, every thread uses the
+ * default set, without looking up its binding. */
+static volatile gint scope_sets_bound = FALSE;
+
+#if GLIB_CHECK_VERSION(2,31,0)
+static GPrivate bound_scopes = G_PRIVATE_INIT(NULL);
+#define GET_BOUND_SCOPES()  ((wmem_scope_set_t *)g_private_get(&bound_scopes))
+#define SET_BOUND_SCOPES(s) g_private_set(&bound_scopes, (s))
+#else
+static GPrivate *bound_scopes = NULL;
+#define GET_BOUND_SCOPES()  ((wmem_scope_set_t *)g_private_get(bound_scopes))
+#define SET_BOUND_SCOPES(s) g_private_set(bound_scopes, (s))
+#endif
+
+static wmem_scope_set_t *
+current_scopes(void)
+{
+    wmem_scope_set_t *scopes;
+
+    if (!g_atomic_int_get(&scope_sets_bound)) {
+        return default_scopes;
+    }
+
+    scopes = GET_BOUND_SCOPES();
+    return scopes ? scopes : default_scopes;
+}
 
 /* Packet Scope */
 
 wmem_allocator_t *
 wmem_packet_scope(void)
 {
-    g_assert(packet_scope);
+    wmem_scope_set_t *scopes = current_scopes();
 
-    return packet_scope;
+    g_assert(scopes);
+
+    return scopes->packet_scope;
 }
 
 void
 wmem_enter_packet_scope(void)
 {
-    g_assert(packet_scope);
-    g_assert(file_scope->in_scope);
-    g_assert(!packet_scope->in_scope);
+    wmem_scope_set_t *scopes = current_scopes();
+
+    g_assert(scopes);
+    g_assert(scopes->file_scope->in_scope);
+    g_assert(!scopes->packet_scope->in_scope);
 
-    packet_scope->in_scope = TRUE;
+    scopes->packet_scope->in_scope = TRUE;
 }
 
 void
 wmem_leave_packet_scope(void)
 {
-    g_assert(packet_scope);
-    g_assert(packet_scope->in_scope);
+    wmem_scope_set_t *scopes = current_scopes();
 
-    wmem_free_all(packet_scope);
-    packet_scope->in_scope = FALSE;
+    g_assert(scopes);
+    g_assert(scopes->packet_scope->in_scope);
+
+    wmem_free_all(scopes->packet_scope);
+    scopes->packet_scope->in_scope = FALSE;
+
+    /* free the file-scope memory that other threads have let go of */
+    wmem_process_deferred_frees(scopes->file_scope);
 }
 
 /* File Scope */
@@ -87,33 +130,39 @@ wmem_leave_packet_scope(void)
 wmem_allocator_t *
 wmem_file_scope(void)
 {
-    g_assert(file_scope);
+    wmem_scope_set_t *scopes = current_scopes();
+
+    g_assert(scopes);
 
-    return file_scope;
+    return scopes->file_scope;
 }
 
 void
 wmem_enter_file_scope(void)
 {
-    g_assert(file_scope);
-    g_assert(!file_scope->in_scope);
+    wmem_scope_set_t *scopes = current_scopes();
 
-    file_scope->in_scope = TRUE;
+    g_assert(scopes);
+    g_assert(!scopes->file_scope->in_scope);
+
+    scopes->file_scope->in_scope = TRUE;
 }
 
 void
 wmem_leave_file_scope(void)
 {
-    g_assert(file_scope);
-    g_assert(file_scope->in_scope);
-    g_assert(!packet_scope->in_scope);
+    wmem_scope_set_t *scopes = current_scopes();
+
+    g_assert(scopes);
+    g_assert(scopes->file_scope->in_scope);
+    g_assert(!scopes->packet_scope->in_scope);
 
-    wmem_free_all(file_scope);
-    file_scope->in_scope = FALSE;
+    wmem_free_all(scopes->file_scope);
+    scopes->file_scope->in_scope = FALSE;
 
     /* this seems like a good time to do garbage collection */
-    wmem_gc(file_scope);
-    wmem_gc(packet_scope);
+    wmem_gc(scopes->file_scope);
+    wmem_gc(scopes->packet_scope);
 }
 
 /* Epan Scope */
@@ -126,41 +175,82 @@ wmem_epan_scope(void)
     return epan_scope;
 }
 
+/* Scope Sets */
+
+wmem_scope_set_t *
+wmem_scope_set_new(void)
+{
+    wmem_scope_set_t *scopes;
+
+    scopes = wmem_new(NULL, wmem_scope_set_t);
+    scopes->packet_scope = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK_FAST);
+    scopes->file_scope   = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
+
+    /* Scopes are initialized to TRUE by default on creation */
+    scopes->packet_scope->in_scope = FALSE;
+    scopes->file_scope->in_scope   = FALSE;
+
+    return scopes;
+}
+
+void
+wmem_scope_set_destroy(wmem_scope_set_t *scopes)
+{
+    g_assert(scopes);
+    g_assert(scopes != default_scopes);
+    g_assert(scopes->packet_scope->in_scope == FALSE);
+    g_assert(scopes->file_scope->in_scope   == FALSE);
+
+    wmem_destroy_allocator(scopes->packet_scope);
+    wmem_destroy_allocator(scopes->file_scope);
+    wmem_free(NULL, scopes);
+}
+
+wmem_scope_set_t *
+wmem_scope_set_bind(wmem_scope_set_t *scopes)
+{
+    wmem_scope_set_t *old_scopes;
+
+    g_assert(default_scopes);
+
+#if !GLIB_CHECK_VERSION(2,31,0)
+    if (g_once_init_enter((gsize *)&bound_scopes)) {
+        g_once_init_leave((gsize *)&bound_scopes, (gsize)g_private_new(NULL));
+    }
+#endif
+
+    old_scopes = GET_BOUND_SCOPES();
+    SET_BOUND_SCOPES(scopes);
+    g_atomic_int_set(&scope_sets_bound, TRUE);
+
+    return old_scopes;
+}
+
 /* Scope Management */
 
 void
 wmem_init_scopes(void)
 {
-    g_assert(packet_scope == NULL);
-    g_assert(file_scope   == NULL);
-    g_assert(epan_scope   == NULL);
+    g_assert(default_scopes == NULL);
+    g_assert(epan_scope     == NULL);
 
-    packet_scope = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK_FAST);
-    file_scope   = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
-    epan_scope   = wmem_allocator_new(WMEM_ALLOCATOR_SIMPLE);
-
-    /* Scopes are initialized to TRUE by default on creation */
-    packet_scope->in_scope = FALSE;
-    file_scope->in_scope   = FALSE;
+    default_scopes = wmem_scope_set_new();
+    epan_scope     = wmem_allocator_new(WMEM_ALLOCATOR_SIMPLE);
 }
 
 void
 wmem_cleanup_scopes(void)
 {
-    g_assert(packet_scope);
-    g_assert(file_scope);
-    g_assert(epan_scope);
+    wmem_scope_set_t *scopes = default_scopes;
 
-    g_assert(packet_scope->in_scope == FALSE);
-    g_assert(file_scope->in_scope   == FALSE);
+    g_assert(default_scopes);
+    g_assert(epan_scope);
 
-    wmem_destroy_allocator(packet_scope);
-    wmem_destroy_allocator(file_scope);
+    default_scopes = NULL;
+    wmem_scope_set_destroy(scopes);
     wmem_destroy_allocator(epan_scope);
 
-    packet_scope = NULL;
-    file_scope   = NULL;
-    epan_scope   = NULL;
+    epan_scope = NULL;
 }
 
 /*
@@ -64,6 +64,39 @@ WS_DLL_LOCAL
 void
 wmem_leave_file_scope(void);
 
+/* Scope Sets */
+
+/** A packet scope and a file scope, for one thread of dissection. */
+typedef struct _wmem_scope_set_t wmem_scope_set_t;
+
+/** Creates a scope set, with a block_fast packet scope and a block file
+ * scope, neither of them entered. */
+WS_DLL_PUBLIC
+wmem_scope_set_t *
+wmem_scope_set_new(void)
+G_GNUC_MALLOC;
+
+/** Destroys a scope set. It must not be bound to any thread, and neither of
+ * its scopes may be entered. */
+WS_DLL_PUBLIC
+void
+wmem_scope_set_destroy(wmem_scope_set_t *scopes);
+
+/** Binds a scope set to the calling thread, so that wmem_packet_scope(),
+ * wmem_file_scope() and entering and leaving those scopes in the thread use
+ * its scopes. Threads that haven't bound a set, or that bind NULL, use the
+ * default set that wmem_init() creates. Anything created with the default
+ * file scope, such as the autoreset trees that dissectors register, is only
+ * emptied with that scope, so it's not to be used from other scope sets.
+ * Threads must have been initialized before a set is bound.
+ *
+ * @param scopes The scope set for the thread, or NULL.
+ * @return The scope set that was bound to the thread, or NULL.
+ */
+WS_DLL_PUBLIC
+wmem_scope_set_t *
+wmem_scope_set_bind(wmem_scope_set_t *scopes);
+
 /* Scope Management */
 
 WS_DLL_LOCAL
@@ -37,6 +37,8 @@
 #define MAX_ALLOC_SIZE          (1024*64)
 #define MAX_SIMULTANEOUS_ALLOCS  1024
 #define CONTAINER_ITERS          10000
+#define THREAD_COUNT             4
+#define THREAD_ITERS             2000
 
 typedef void (*wmem_verify_func)(wmem_allocator_t *allocator);
 
@@ -52,6 +54,7 @@ wmem_allocator_force_new(const wmem_allocator_type_t type)
     allocator->type = type;
     allocator->callbacks = NULL;
     allocator->in_scope = TRUE;
+    allocator->deferred_frees = NULL;
 
     switch (type) {
         case WMEM_ALLOCATOR_SIMPLE:
@@ -942,6 +945,27 @@ wmem_test_tree(void)
     }
     wmem_free_all(allocator);
 
+    /* test destroying a tree along with its values */
+    tree = wmem_tree_new(allocator);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        wmem_tree_insert32(tree, g_test_rand_int(), wmem_new(allocator, guint32));
+    }
+    wmem_tree_destroy(tree, TRUE);
+    wmem_strict_check_canaries(allocator);
+
+    tree = wmem_tree_new(allocator);
+    keys[0].length = 1;
+    keys[0].key    = &i;
+    keys[1].length = 1;
+    keys[1].key    = &i;
+    keys[2].length = 0;
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        wmem_tree_insert32_array(tree, keys, wmem_new(allocator, guint32));
+    }
+    wmem_tree_destroy(tree, TRUE);
+    wmem_strict_check_canaries(allocator);
+    wmem_free_all(allocator);
+
     /* test for-each functionality */
     tree = wmem_tree_new(allocator);
     expected_user_data = GINT_TO_POINTER(g_test_rand_int());
@@ -982,11 +1006,186 @@ wmem_test_tree(void)
     wmem_destroy_allocator(allocator);
 }
 
+/* THREAD TESTING FUNCTIONS (/wmem/threads/) */
+
+static GThread *
+wmem_test_thread_new(GThreadFunc func, gpointer data)
+{
+#if GLIB_CHECK_VERSION(2,31,0)
+    return g_thread_new("wmem test", func, data);
+#else
+    return g_thread_create(func, data, TRUE, NULL);
+#endif
+}
+
+typedef struct {
+    guint32           id;
+    wmem_scope_set_t *scopes;
+    wmem_allocator_t *default_packet_scope;
+    wmem_allocator_t *default_file_scope;
+} wmem_test_scopes_thread_t;
+
+static gpointer
+wmem_test_scopes_thread(gpointer data)
+{
+    wmem_test_scopes_thread_t *t = (wmem_test_scopes_thread_t *)data;
+    wmem_scope_set_t          *old_scopes;
+    wmem_allocator_t          *packet_scope, *file_scope;
+    guint32                   *ints[64];
+    gchar                    **strs;
+    guint                      i, j;
+
+    old_scopes = wmem_scope_set_bind(t->scopes);
+    g_assert(old_scopes == NULL);
+
+    packet_scope = wmem_packet_scope();
+    file_scope   = wmem_file_scope();
+    g_assert(packet_scope != t->default_packet_scope);
+    g_assert(file_scope   != t->default_file_scope);
+
+    wmem_enter_file_scope();
+    strs = wmem_alloc_array(file_scope, gchar *, THREAD_ITERS);
+    for (i = 0; i < THREAD_ITERS; i++) {
+        wmem_enter_packet_scope();
+        g_assert(wmem_packet_scope() == packet_scope);
+        for (j = 0; j < 64; j++) {
+            ints[j] = wmem_new(wmem_packet_scope(), guint32);
+            *ints[j] = (t->id << 16) | j;
+        }
+        strs[i] = wmem_strdup_printf(wmem_file_scope(), "%u:%u", t->id, i);
+        for (j = 0; j < 64; j++) {
+            g_assert(*ints[j] == ((t->id << 16) | j));
+        }
+        wmem_leave_packet_scope();
+    }
+    for (i = 0; i < THREAD_ITERS; i++) {
+        gchar *str = wmem_strdup_printf(NULL, "%u:%u", t->id, i);
+        g_assert_cmpstr(strs[i], ==, str);
+        wmem_free(NULL, str);
+    }
+    wmem_leave_file_scope();
+
+    old_scopes = wmem_scope_set_bind(NULL);
+    g_assert(old_scopes == t->scopes);
+    g_assert(wmem_packet_scope() == t->default_packet_scope);
+
+    return NULL;
+}
+
+static void
+wmem_test_thread_scopes(void)
+{
+    wmem_test_scopes_thread_t threads[THREAD_COUNT];
+    GThread                  *ids[THREAD_COUNT];
+    wmem_allocator_t         *packet_scope, *file_scope;
+    guint32                   i;
+
+    packet_scope = wmem_packet_scope();
+    file_scope   = wmem_file_scope();
+
+    for (i = 0; i < THREAD_COUNT; i++) {
+        threads[i].id                   = i;
+        threads[i].scopes               = wmem_scope_set_new();
+        threads[i].default_packet_scope = packet_scope;
+        threads[i].default_file_scope   = file_scope;
+        ids[i] = wmem_test_thread_new(wmem_test_scopes_thread, &threads[i]);
+    }
+
+    /* the default scopes stay usable on this thread meanwhile */
+    wmem_enter_file_scope();
+    for (i = 0; i < THREAD_ITERS; i++) {
+        wmem_enter_packet_scope();
+        g_assert(wmem_packet_scope() == packet_scope);
+        wmem_strdup_printf(wmem_packet_scope(), "%u", i);
+        wmem_leave_packet_scope();
+    }
+    wmem_leave_file_scope();
+
+    for (i = 0; i < THREAD_COUNT; i++) {
+        g_thread_join(ids[i]);
+        wmem_scope_set_destroy(threads[i].scopes);
+    }
+
+    g_assert(wmem_packet_scope() == packet_scope);
+    g_assert(wmem_file_scope()   == file_scope);
+}
+
+typedef struct {
+    wmem_allocator_t  *allocator;
+    void             **ptrs;
+    guint              n_ptrs;
+} wmem_test_free_thread_t;
+
+static gpointer
+wmem_test_free_thread(gpointer data)
+{
+    wmem_test_free_thread_t *t = (wmem_test_free_thread_t *)data;
+    guint                    i;
+
+    for (i = 0; i < t->n_ptrs; i++) {
+        wmem_free_deferred(t->allocator, t->ptrs[i]);
+    }
+
+    return NULL;
+}
+
+static void
+wmem_test_thread_deferred_free(void)
+{
+    wmem_test_free_thread_t  threads[THREAD_COUNT];
+    GThread                 *ids[THREAD_COUNT];
+    wmem_allocator_t        *allocator;
+    void                   **ptrs;
+    guint                    i, freed;
+
+    allocator = wmem_allocator_force_new(WMEM_ALLOCATOR_STRICT);
+
+    ptrs = wmem_alloc_array(NULL, void *, THREAD_COUNT * THREAD_ITERS);
+    for (i = 0; i < THREAD_COUNT * THREAD_ITERS; i++) {
+        ptrs[i] = wmem_alloc(allocator,
+                g_test_rand_int_range((gint32)sizeof (void *), 256));
+    }
+
+    for (i = 0; i < THREAD_COUNT; i++) {
+        threads[i].allocator = allocator;
+        threads[i].ptrs      = ptrs + i * THREAD_ITERS;
+        threads[i].n_ptrs    = THREAD_ITERS;
+        ids[i] = wmem_test_thread_new(wmem_test_free_thread, &threads[i]);
+    }
+
+    /* free what the threads let go of while they're still at it, and keep
+     * allocating and freeing in the meantime */
+    freed = 0;
+    while (freed < THREAD_COUNT * THREAD_ITERS) {
+        wmem_free(allocator, wmem_alloc(allocator, 32));
+        freed += wmem_process_deferred_frees(allocator);
+    }
+    g_assert(freed == THREAD_COUNT * THREAD_ITERS);
+
+    for (i = 0; i < THREAD_COUNT; i++) {
+        g_thread_join(ids[i]);
+    }
+    g_assert(wmem_process_deferred_frees(allocator) == 0);
+    wmem_strict_check_canaries(allocator);
+
+    /* memory that's still queued when its pool is emptied is simply gone */
+    wmem_free_deferred(allocator, wmem_alloc(allocator, 32));
+    wmem_free_all(allocator);
+    g_assert(wmem_process_deferred_frees(allocator) == 0);
+
+    wmem_free(NULL, ptrs);
+    wmem_destroy_allocator(allocator);
+}
+
 int
 main(int argc, char **argv)
 {
     int ret;
 
+#if !GLIB_CHECK_VERSION(2,31,0)
+    g_thread_init(NULL);
+#endif
+
     wmem_init();
 
     g_test_init(&argc, &argv, NULL);
@@ -1008,6 +1207,9 @@ main(int argc, char **argv)
     g_test_add_func("/wmem/datastruct/strbuf", wmem_test_strbuf);
     g_test_add_func("/wmem/datastruct/tree",   wmem_test_tree);
 
+    g_test_add_func("/wmem/threads/scopes",        wmem_test_thread_scopes);
+    g_test_add_func("/wmem/threads/deferred_free", wmem_test_thread_deferred_free);
+
     ret = g_test_run();
 
     wmem_cleanup();
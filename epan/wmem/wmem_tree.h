@@ -72,6 +72,14 @@ wmem_tree_t *
 wmem_tree_new_autoreset(wmem_allocator_t *master, wmem_allocator_t *slave)
 G_GNUC_MALLOC;
 
+/** Frees the tree and all of its nodes right away, rather than when its scope
+ * is emptied. If free_values is TRUE, the values stored in the tree are freed
+ * as well, with the tree's allocator; every value must then be a distinct
+ * allocation from that scope. */
+WS_DLL_PUBLIC
+void
+wmem_tree_destroy(wmem_tree_t *tree, gboolean free_values);
+
 /** Returns true if the tree is empty (has no nodes). */
 WS_DLL_PUBLIC
 gboolean
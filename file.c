@@ -44,6 +44,7 @@
 #include <wsutil/ws_version_info.h>
 
 #include <wiretap/merge.h>
+#include <wiretap/wtap_index.h>
 
 #include <epan/exceptions.h>
 #include <epan/epan-int.h>
@@ -107,8 +108,12 @@ gboolean auto_scroll_live; /* GTK+ only? */
 
 static int read_packet(capture_file *cf, dfilter_t *dfcode, epan_dissect_t *edt,
     column_info *cinfo, gint64 offset);
+static gboolean read_packet_from_index(capture_file *cf, dfilter_t *dfcode,
+    epan_dissect_t *edt, const wtap_index_entry *entry, column_info *cinfo,
+    gboolean dissect);
 
 static void rescan_packets(capture_file *cf, const char *action, const char *action_item, gboolean redissect);
+static void dissect_listed_frames(capture_file *cf);
 
 typedef enum {
   MR_NOTMATCHED,
@@ -146,6 +151,8 @@ static void cf_open_failure_alert_box(const char *filename, int err,
 static void cf_rename_failure_alert_box(const char *filename, int err);
 static void cf_close_failure_alert_box(const char *filename, int err);
 static void ref_time_packets(capture_file *cf);
+static void cf_clear_filter_results(capture_file *cf);
+static void start_recording_protocols(capture_file *cf, epan_dissect_t *edt);
 /* Update the progress bar this many times when reading a file. */
 #define N_PROGBAR_UPDATES   100
 /* We read around 200k/100ms don't update the progress bar more often than that */
@@ -274,6 +281,17 @@ ws_get_frame_ts(void *data, guint32 frame_num)
   return NULL;
 }
 
+static const nstime_t *
+ws_get_frame_shift_offset(void *data, guint32 frame_num)
+{
+  capture_file *cf = (capture_file *) data;
+
+  if (cf->frames)
+    return frame_data_sequence_get_shift_offset(cf->frames, frame_num);
+
+  return NULL;
+}
+
 static const char *
 ws_get_user_comment(void *data, const frame_data *fd)
 {
@@ -289,6 +307,7 @@ ws_epan_new(capture_file *cf)
 
   epan->data = cf;
   epan->get_frame_ts = ws_get_frame_ts;
+  epan->get_frame_shift_offset = ws_get_frame_shift_offset;
   epan->get_interface_name = cap_file_get_interface_name;
   epan->get_user_comment = ws_get_user_comment;
 
@@ -446,10 +465,20 @@ cf_close(capture_file *cf)
 
   dfilter_free(cf->rfcode);
   cf->rfcode = NULL;
+  cf_clear_filter_results(cf);
+  if (cf->field_cache != NULL) {
+    dfcache_free(cf->field_cache);
+    cf->field_cache = NULL;
+  }
+  if (cf->protocol_sets != NULL) {
+    protocol_set_table_free(cf->protocol_sets);
+    cf->protocol_sets = NULL;
+  }
   if (cf->frames != NULL) {
     free_frame_data_sequence(cf->frames);
     cf->frames = NULL;
   }
+  cf->frames_undissected = FALSE;
 #ifdef WANT_PACKET_EDITOR
   if (cf->edited_frames) {
     g_tree_destroy(cf->edited_frames);
@@ -541,6 +570,10 @@ cf_read(capture_file *cf, gboolean reloading)
   volatile gboolean    create_proto_tree;
   guint                tap_flags;
   gboolean             compiled;
+  wtap_index          *pkt_index      = NULL;
+  wtap_index *volatile new_index      = NULL;
+  int                  index_err;
+  gboolean             dissect_indexed = TRUE;
 
   /* Compile the current display filter.
    * We assume this will not fail since cf->dfilter is only set in
@@ -556,6 +589,31 @@ cf_read(capture_file *cf, gboolean reloading)
 
   reset_tap_listeners();
 
+  /* If the file has an up-to-date packet index, list the packets from
+     the index rather than by reading through the file.  Unless a display
+     filter or a tap listener needs every packet dissected now, the
+     packets aren't even read: each one is read and dissected when its
+     row is drawn or it's selected, and they're all dissected in order,
+     building the state that dissectors keep (conversations, reassembly,
+     TCP analysis), the first time they're filtered, tapped, printed or
+     exported; see dissect_listed_frames().  Otherwise, if we're keeping
+     indices, write one as we read the file.  A read filter discards
+     packets, so we can neither use nor write an index with one. */
+  if (prefs.gui_use_packet_index && !cf->is_tempfile) {
+    if (cf->rfcode == NULL)
+      pkt_index = wtap_index_open(cf->wth, cf->filename);
+    if (pkt_index != NULL)
+      dissect_indexed = dfcode != NULL || tap_listeners_require_dissection();
+    else {
+      /* Seek points saved by an earlier read of a compressed file let
+         packets be fetched before this read has got to them, and let
+         the file be inflated on several threads at once. */
+      wtap_fast_seek_load(cf->wth, cf->filename);
+      if (cf->rfcode == NULL)
+        new_index = wtap_index_create(cf->wth, cf->filename, &index_err);
+    }
+  }
+
   name_ptr = g_filename_display_basename(cf->filename);
 
   if (reloading)
@@ -574,6 +632,7 @@ cf_read(capture_file *cf, gboolean reloading)
   g_get_current_time(&start_time);
 
   epan_dissect_init(&edt, cf->epan, create_proto_tree, FALSE);
+  start_recording_protocols(cf, &edt);
 
   TRY {
 #ifdef HAVE_LIBPCAP
@@ -584,6 +643,7 @@ cf_read(capture_file *cf, gboolean reloading)
     gint64  size;
     gint64  file_pos;
     gint64  data_offset;
+    wtap_index_entry entry;
 
     gint64  progbar_quantum;
     gint64  progbar_nextstep;
@@ -608,10 +668,12 @@ cf_read(capture_file *cf, gboolean reloading)
     }else
       progbar_quantum = 0;
 
-    while ((wtap_read(cf->wth, &err, &err_info, &data_offset))) {
+    while (pkt_index != NULL ?
+           wtap_index_read(pkt_index, &entry, &err) :
+           wtap_read(cf->wth, &err, &err_info, &data_offset)) {
       if (size >= 0) {
         count++;
-        file_pos = wtap_read_so_far(cf->wth);
+        file_pos = pkt_index != NULL ? entry.data_offset : wtap_read_so_far(cf->wth);
 
         /* Create the progress bar if necessary.
          * Check whether it should be created or not every MIN_NUMBER_OF_PACKET
@@ -658,6 +720,18 @@ cf_read(capture_file *cf, gboolean reloading)
            hours even on fast machines) just to see that it was the wrong file. */
         break;
       }
+      if (pkt_index != NULL) {
+        if (!read_packet_from_index(cf, dfcode, &edt, &entry, cinfo,
+                                    dissect_indexed))
+          break;    /* cf_read_record() has reported the error */
+        continue;
+      }
+      if (new_index != NULL &&
+          !wtap_index_add(new_index, wtap_phdr(cf->wth), data_offset, &index_err)) {
+        /* The index is only a convenience; just don't write it. */
+        wtap_index_close(new_index);
+        new_index = NULL;
+      }
       read_packet(cf, dfcode, &edt, cinfo, data_offset);
     }
   }
@@ -692,6 +766,26 @@ cf_read(capture_file *cf, gboolean reloading)
   /* We're done reading sequentially through the file. */
   cf->state = FILE_READ_DONE;
 
+  /* Set the file encapsulation type now; we don't know what it is until
+     we've looked at all the packets, as we don't know until then whether
+     there's more than one type (and thus whether it's
+     WTAP_ENCAP_PER_PACKET).  If we listed the packets from an index,
+     the index knows. */
+  if (pkt_index != NULL) {
+    cf->lnk_t = wtap_index_file_encap(pkt_index);
+    wtap_index_close(pkt_index);
+    cf->frames_undissected = !dissect_indexed;
+  } else
+    cf->lnk_t = wtap_file_encap(cf->wth);
+
+  /* Only keep an index of the whole file. */
+  if (new_index != NULL) {
+    if (!stop_flag && err == 0)
+      wtap_index_finish(new_index, cf->wth, &index_err);
+    else
+      wtap_index_close(new_index);
+  }
+
   /* Close the sequential I/O side, to free up memory it requires. */
   wtap_sequential_close(cf->wth);
 
@@ -702,12 +796,6 @@ cf_read(capture_file *cf, gboolean reloading)
   /* compute the time it took to load the file */
   compute_elapsed(cf, &start_time);
 
-  /* Set the file encapsulation type now; we don't know what it is until
-     we've looked at all the packets, as we don't know until then whether
-     there's more than one type (and thus whether it's
-     WTAP_ENCAP_PER_PACKET). */
-  cf->lnk_t = wtap_file_encap(cf->wth);
-
   cf->current_frame = frame_data_sequence_find(cf->frames, cf->first_displayed);
   cf->current_row = 0;
 
@@ -810,6 +898,7 @@ cf_continue_tail(capture_file *cf, volatile int to_read, int *err)
   /*g_log(NULL, G_LOG_LEVEL_MESSAGE, "cf_continue_tail: %u new: %u", cf->count, to_read);*/
 
   epan_dissect_init(&edt, cf->epan, create_proto_tree, FALSE);
+  start_recording_protocols(cf, &edt);
 
   TRY {
     gint64 data_offset = 0;
@@ -939,6 +1028,7 @@ cf_finish_tail(capture_file *cf, int *err)
   /*packet_list_freeze();*/
 
   epan_dissect_init(&edt, cf->epan, create_proto_tree, FALSE);
+  start_recording_protocols(cf, &edt);
 
   while ((wtap_read(cf->wth, err, &err_info, &data_offset))) {
     if (cf->state == FILE_READ_ABORTED) {
@@ -1112,10 +1202,38 @@ void cf_set_rfcode(capture_file *cf, dfilter_t *rfcode)
   cf->rfcode = rfcode;
 }
 
+/* Note that a frame that has been filtered is displayed. */
+static void
+set_frame_displayed(frame_data *fdata, capture_file *cf)
+{
+  frame_data_set_after_dissect(fdata, &cf->cum_bytes);
+  cf->prev_dis = fdata;
+
+  /* If we haven't yet seen the first frame, this is it.
+
+     XXX - we must do this before we add the row to the display,
+     as, if the display's GtkCList's selection mode is
+     GTK_SELECTION_BROWSE, when the first entry is added to it,
+     "cf_select_packet()" will be called, and it will fetch the row
+     data for the 0th row, and will get a null pointer rather than
+     "fdata", as "gtk_clist_append()" won't yet have returned and
+     thus "gtk_clist_set_row_data()" won't yet have been called.
+
+     We thus need to leave behind bread crumbs so that
+     "cf_select_packet()" can find this frame.  See the comment
+     in "cf_select_packet()". */
+  if (cf->first_displayed == 0)
+    cf->first_displayed = fdata->num;
+
+  /* This is the last frame we've seen so far. */
+  cf->last_displayed = fdata->num;
+}
+
 static int
 add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
-    epan_dissect_t *edt, dfilter_t *dfcode, column_info *cinfo,
-    struct wtap_pkthdr *phdr, const guint8 *buf, gboolean add_to_packet_list)
+    epan_dissect_t *edt, dfilter_t *dfcode, dfcache_t *field_cache,
+    column_info *cinfo, struct wtap_pkthdr *phdr, const guint8 *buf,
+    gboolean add_to_packet_list)
 {
   gint            row               = -1;
 
@@ -1126,10 +1244,26 @@ add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
   if (dfcode != NULL) {
       epan_dissect_prime_dfilter(edt, dfcode);
   }
+  if (field_cache != NULL) {
+      dfcache_prime(field_cache, edt);
+  }
 
   /* Dissect the frame. */
   epan_dissect_run_with_taps(edt, cf->cd_t, phdr, frame_tvbuff_new(fdata, buf), fdata, cinfo);
 
+  /* Keep the values of the fields the field cache wants, so that later
+     filters can be applied to the frame without dissecting it. */
+  if (field_cache != NULL) {
+      dfcache_store_frame(field_cache, fdata->num, edt);
+  }
+
+  /* Note which protocols the frame has, so that filters that only test
+     for protocols can be applied to it without dissecting it. */
+  if (prefs.gui_record_protocols && cf->protocol_sets != NULL && edt->tree != NULL) {
+    fdata->proto_set = protocol_set_table_add_tree(cf->protocol_sets, edt->tree);
+    fdata->flags.has_dependents = (edt->pi.dependent_frames != NULL);
+  }
+
   /* If we don't have a display filter, set "passed_dfilter" to 1. */
   if (dfcode != NULL) {
     fdata->flags.passed_dfilter = dfilter_apply_edt(dfcode, edt) ? 1 : 0;
@@ -1153,32 +1287,43 @@ add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
   }
 
   if (fdata->flags.passed_dfilter || fdata->flags.ref_time)
-  {
-    frame_data_set_after_dissect(fdata, &cf->cum_bytes);
-    cf->prev_dis = fdata;
+    set_frame_displayed(fdata, cf);
 
-    /* If we haven't yet seen the first frame, this is it.
+  epan_dissect_reset(edt);
+  return row;
+}
 
-       XXX - we must do this before we add the row to the display,
-       as, if the display's GtkCList's selection mode is
-       GTK_SELECTION_BROWSE, when the first entry is added to it,
-       "cf_select_packet()" will be called, and it will fetch the row
-       data for the 0th row, and will get a null pointer rather than
-       "fdata", as "gtk_clist_append()" won't yet have returned and
-       thus "gtk_clist_set_row_data()" won't yet have been called.
+/* If the protocols in each frame are to be recorded, make sure there's
+   a table for them, and that edt's tree will have every protocol in it
+   rather than only those that are referenced.  They're only recorded if
+   the frames are getting a tree anyway, e.g. for a display filter;
+   building one just for them would cost more than it saves. */
+static void
+start_recording_protocols(capture_file *cf, epan_dissect_t *edt)
+{
+  if (!prefs.gui_record_protocols || edt->tree == NULL)
+    return;
 
-       We thus need to leave behind bread crumbs so that
-       "cf_select_packet()" can find this frame.  See the comment
-       in "cf_select_packet()". */
-    if (cf->first_displayed == 0)
-      cf->first_displayed = fdata->num;
+  if (cf->protocol_sets == NULL)
+    cf->protocol_sets = protocol_set_table_new();
+  epan_dissect_fake_protocols(edt, FALSE);
+}
 
-    /* This is the last frame we've seen so far. */
-    cf->last_displayed = fdata->num;
-  }
+/* Add a frame to the packet list without dissecting it, when whether
+   it passes the display filter is already known; see rescan_packets(). */
+static void
+add_filtered_packet(frame_data *fdata, capture_file *cf, gboolean passed)
+{
+  frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+                                &cf->ref, cf->prev_dis);
+  cf->prev_cap = fdata;
 
-  epan_dissect_reset(edt);
-  return row;
+  fdata->flags.passed_dfilter = passed ? 1 : 0;
+
+  if (fdata->flags.passed_dfilter || fdata->flags.ref_time) {
+    cf->displayed_count++;
+    set_frame_displayed(fdata, cf);
+  }
 }
 
 /* read in a new packet */
@@ -1230,7 +1375,7 @@ read_packet(capture_file *cf, dfilter_t *dfcode, epan_dissect_t *edt,
     cf->f_datalen = offset + fdlocal.cap_len;
 
     if (!cf->redissecting) {
-      row = add_packet_to_packet_list(fdata, cf, edt, dfcode,
+      row = add_packet_to_packet_list(fdata, cf, edt, dfcode, NULL,
                                       cinfo, phdr, buf, TRUE);
     }
   }
@@ -1238,6 +1383,62 @@ read_packet(capture_file *cf, dfilter_t *dfcode, epan_dissect_t *edt,
   return row;
 }
 
+/* add a packet listed in a packet index; if "dissect" is FALSE, it's
+   added to the packet list without being read */
+static gboolean
+read_packet_from_index(capture_file *cf, dfilter_t *dfcode, epan_dissect_t *edt,
+                       const wtap_index_entry *entry, column_info *cinfo,
+                       gboolean dissect)
+{
+  struct wtap_pkthdr phdr;
+  frame_data   fdlocal;
+  frame_data  *fdata;
+
+  memset(&phdr, 0, sizeof phdr);
+  phdr.rec_type = REC_TYPE_PACKET;
+  phdr.presence_flags = WTAP_HAS_CAP_LEN;
+  if (entry->has_ts)
+    phdr.presence_flags |= WTAP_HAS_TS;
+  phdr.ts = entry->ts;
+  phdr.caplen = entry->caplen;
+  phdr.len = entry->len;
+  phdr.pkt_encap = entry->pkt_encap;
+  phdr.pkt_tsprec = entry->pkt_tsprec;
+
+  cf_add_encapsulation_type(cf, entry->pkt_encap);
+
+  frame_data_init(&fdlocal, cf->count + 1, &phdr, entry->data_offset, cf->cum_bytes);
+  fdlocal.flags.has_phdr_comment = entry->has_comment;
+
+  /* This does a shallow copy of fdlocal, which is good enough. */
+  fdata = frame_data_sequence_add(cf->frames, &fdlocal);
+
+  cf->count++;
+  if (entry->has_comment)
+    cf->packet_comment_count++;
+  cf->f_datalen = entry->data_offset + fdlocal.cap_len;
+
+  if (cf->redissecting)
+    return TRUE;
+
+  /* With nothing to filter it, the packet is displayed; its columns are
+     filled in when its row is drawn, as they are for any packet. */
+  if (!dissect) {
+    add_filtered_packet(fdata, cf, TRUE);
+    packet_list_append(cinfo, fdata);
+    return TRUE;
+  }
+
+  /* Fetch the packet and dissect it now, as read_packet() does, rather
+     than when its row is drawn, so that it's dissected before any later
+     packet is. */
+  if (!cf_read_record(cf, fdata))
+    return FALSE;
+  add_packet_to_packet_list(fdata, cf, edt, dfcode, NULL, cinfo, &cf->phdr,
+                            ws_buffer_start_ptr(&cf->buf), TRUE);
+  return TRUE;
+}
+
 cf_status_t
 cf_merge_files(char **out_filenamep, int in_file_count,
                char *const *in_filenames, int file_type, gboolean do_append)
@@ -1486,12 +1687,12 @@ cf_merge_files(char **out_filenamep, int in_file_count,
     if (fake_interface_ids) {
       struct wtap_pkthdr *phdr;
 
-      phdr = wtap_phdr(in_file->wth);
+      phdr = merge_in_file_phdr(in_file);
       phdr->interface_id = in_file->interface_id;
       phdr->presence_flags = phdr->presence_flags | WTAP_HAS_INTERFACE_ID;
     }
-    if (!wtap_dump(pdh, wtap_phdr(in_file->wth),
-                   wtap_buf_ptr(in_file->wth), &write_err, &write_err_info)) {
+    if (!wtap_dump(pdh, merge_in_file_phdr(in_file),
+                   merge_in_file_buf_ptr(in_file), &write_err, &write_err_info)) {
       got_write_error = TRUE;
       break;
     }
@@ -1725,6 +1926,17 @@ cf_redissect_packets(capture_file *cf)
   }
 }
 
+/* If the frames were listed from a packet index without being dissected,
+   dissect them all in order now, so that the state that dissectors keep
+   is what it would have been had the file been read through; see
+   cf_read(). */
+static void
+dissect_listed_frames(capture_file *cf)
+{
+  if (cf->frames_undissected)
+    rescan_packets(cf, "Dissecting", "all packets", TRUE);
+}
+
 gboolean
 cf_read_record_r(capture_file *cf, const frame_data *fdata,
                  struct wtap_pkthdr *phdr, Buffer *buf)
@@ -1779,6 +1991,135 @@ cf_read_record(capture_file *cf, frame_data *fdata)
   return cf_read_record_r(cf, fdata, &cf->phdr, &cf->buf);
 }
 
+/* Which of the frames passed one of the recently applied display
+   filters, so that applying it again, or a filter that narrows it down,
+   doesn't require every frame to be dissected again.  The entries are
+   kept in cf->filter_results, most recently applied first. */
+#define N_FILTER_RESULTS  4
+
+#define FILTER_RESULT_PASSED    0x1 /* frame passed the filter */
+#define FILTER_RESULT_DEPENDENT 0x2 /* a frame that passed it depends on this one */
+
+typedef struct {
+  dfilter_t *dfcode;  /* the filter */
+  guint32    count;   /* number of frames it was applied to */
+  guint8    *flags;   /* FILTER_RESULT_ flags of each frame, four to a byte */
+} filter_results_t;
+
+static void
+filter_results_free(filter_results_t *results)
+{
+  dfilter_free(results->dfcode);
+  g_free(results->flags);
+  g_free(results);
+}
+
+static guint8
+filter_result(const filter_results_t *results, guint32 framenum)
+{
+  guint32 i = framenum - 1;
+
+  return (results->flags[i / 4] >> ((i % 4) * 2)) & 0x3;
+}
+
+/* Forget the results of the display filters, because the frames
+   might not pass or fail them in the same way any more. */
+static void
+cf_clear_filter_results(capture_file *cf)
+{
+  GSList *entry;
+
+  for (entry = cf->filter_results; entry != NULL; entry = entry->next)
+    filter_results_free((filter_results_t *)entry->data);
+  g_slist_free(cf->filter_results);
+  cf->filter_results = NULL;
+}
+
+/* Can the results of a display filter be kept?  The fields of the
+   "frame" protocol, such as "frame.time_delta_displayed" or
+   "frame.marked", can have other values without the frame being
+   dissected again, so filters that use them aren't kept; nor are
+   filters that dfilter_refines() can't compare with others. */
+static gboolean
+filter_results_keepable(dfilter_t *dfcode)
+{
+  return dfcode != NULL &&
+         dfilter_refines(dfcode, dfcode) &&
+         !dfilter_uses_protocol(dfcode, proto_get_id_by_filter_name("frame"));
+}
+
+/* Find kept results of a filter that dfcode refines, preferring ones
+   of a filter that's the same as dfcode; "*same" is set if they're of
+   such a filter. */
+static filter_results_t *
+find_filter_results(capture_file *cf, dfilter_t *dfcode, gboolean *same)
+{
+  GSList           *entry;
+  filter_results_t *results, *found = NULL;
+
+  *same = FALSE;
+  if (!filter_results_keepable(dfcode))
+    return NULL;
+
+  for (entry = cf->filter_results; entry != NULL; entry = entry->next) {
+    results = (filter_results_t *)entry->data;
+    if (!dfilter_refines(dfcode, results->dfcode))
+      continue;
+    if (dfilter_refines(results->dfcode, dfcode)) {
+      *same = TRUE;
+      return results;
+    }
+    if (found == NULL)
+      found = results;
+  }
+  return found;
+}
+
+/* Keep the results of applying dfcode to the first "count" frames,
+   and take ownership of dfcode; or free it if they can't be kept. */
+static void
+keep_filter_results(capture_file *cf, dfilter_t *dfcode, guint32 count)
+{
+  GSList           *entry, *next;
+  filter_results_t *results;
+  frame_data       *fdata;
+  guint32           framenum, i;
+  guint             n_entries;
+
+  if (!filter_results_keepable(dfcode) || count == 0) {
+    dfilter_free(dfcode);
+    return;
+  }
+
+  /* Drop the results of the same filter, and the least recently
+     applied filter if there are too many. */
+  n_entries = 0;
+  for (entry = cf->filter_results; entry != NULL; entry = next) {
+    next = entry->next;
+    results = (filter_results_t *)entry->data;
+    if ((dfilter_refines(dfcode, results->dfcode) &&
+         dfilter_refines(results->dfcode, dfcode)) ||
+        ++n_entries >= N_FILTER_RESULTS) {
+      filter_results_free(results);
+      cf->filter_results = g_slist_delete_link(cf->filter_results, entry);
+    }
+  }
+
+  results = g_new(filter_results_t, 1);
+  results->dfcode = dfcode;
+  results->count = count;
+  results->flags = (guint8 *)g_malloc0((count + 3) / 4);
+  for (framenum = 1; framenum <= count; framenum++) {
+    fdata = frame_data_sequence_find(cf->frames, framenum);
+    i = framenum - 1;
+    if (fdata->flags.passed_dfilter)
+      results->flags[i / 4] |= FILTER_RESULT_PASSED << ((i % 4) * 2);
+    if (fdata->flags.dependent_of_displayed)
+      results->flags[i / 4] |= FILTER_RESULT_DEPENDENT << ((i % 4) * 2);
+  }
+  cf->filter_results = g_slist_prepend(cf->filter_results, results);
+}
+
 /* Rescan the list of packets, reconstructing the CList.
 
    "action" describes why we're doing this; it's used in the progress
@@ -1816,6 +2157,14 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
   gboolean    add_to_packet_list = FALSE;
   gboolean    compiled;
   guint32     frames_count;
+  gboolean    incremental;
+  filter_results_t *results = NULL;
+  gboolean    same_filter = FALSE;
+  gboolean    dissect, passed = FALSE;
+  guint8      result;
+  gboolean    use_field_cache = FALSE;
+  dfcache_t  *field_cache = NULL;
+  protocol_set_filter_t *protocol_filter = NULL;
 
   /* Compile the current display filter.
    * We assume this will not fail since cf->dfilter is only set in
@@ -1824,6 +2173,50 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
   compiled = dfilter_compile(cf->dfilter, &dfcode, NULL);
   g_assert(!cf->dfilter || (compiled && dfcode));
 
+  /* Frames listed from a packet index may have been dissected out of
+     order, when their rows were drawn; dissect them all from scratch. */
+  if (cf->frames_undissected)
+    redissect = TRUE;
+
+  /* Unless the frames are to be dissected from scratch, or a tap
+     listener wants to see them all, only the frames whose fate isn't
+     known already have to be dissected: with no filter, every frame
+     passes, and with one that we have the results of, or one that
+     narrows down one that we have the results of, only the frames that
+     passed that one, and those that have arrived since, have to be. */
+  if (redissect)
+    cf_clear_filter_results(cf);
+  incremental = !redissect && !tap_listeners_require_dissection();
+  if (incremental && dfcode != NULL)
+    results = find_filter_results(cf, dfcode, &same_filter);
+
+  /* The frames that have to be dissected anyway can fill the field
+     cache; if it has the values of every field the filter looks at,
+     the frames whose values it has don't have to be dissected. */
+  if (prefs.gui_field_cache_size == 0) {
+    if (cf->field_cache != NULL) {
+      dfcache_free(cf->field_cache);
+      cf->field_cache = NULL;
+    }
+  } else if (dfcode != NULL) {
+    if (cf->field_cache == NULL)
+      cf->field_cache = dfcache_new();
+    dfcache_set_memory_limit(cf->field_cache,
+                             (gsize)prefs.gui_field_cache_size * 1024 * 1024);
+    if (redissect)
+      dfcache_clear(cf->field_cache);
+    use_field_cache = dfcache_use_filter(cf->field_cache, dfcode) && incremental;
+    field_cache = cf->field_cache;
+  }
+
+  /* A filter that only tests for protocols can be applied to the sets
+     of protocols the frames were found to have; the sets are found
+     again if the frames are to be dissected from scratch. */
+  if (redissect && cf->protocol_sets != NULL)
+    protocol_set_table_clear(cf->protocol_sets);
+  if (incremental && dfcode != NULL && cf->protocol_sets != NULL)
+    protocol_filter = protocol_set_filter_new(cf->protocol_sets, dfcode);
+
   /* Get the union of the flags for all tap listeners. */
   tap_flags = union_of_tap_listener_flags();
   cinfo = (tap_flags & TL_REQUIRES_COLUMNS) ? &cf->cinfo : NULL;
@@ -1907,6 +2300,7 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
   frames_count = cf->count;
 
   epan_dissect_init(&edt, cf->epan, create_proto_tree, FALSE);
+  start_recording_protocols(cf, &edt);
 
   for (framenum = 1; framenum <= frames_count; framenum++) {
     fdata = frame_data_sequence_find(cf->frames, framenum);
@@ -1972,7 +2366,38 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
     /* Frame dependencies from the previous dissection/filtering are no longer valid. */
     fdata->flags.dependent_of_displayed = 0;
 
-    if (!cf_read_record(cf, fdata))
+    dissect = TRUE;
+    if (incremental) {
+      if (dfcode == NULL) {
+        dissect = FALSE;
+        passed = TRUE;
+      } else if (results != NULL && framenum <= results->count) {
+        result = filter_result(results, framenum);
+        if (same_filter) {
+          dissect = FALSE;
+          passed = (result & FILTER_RESULT_PASSED) != 0;
+          if (result & FILTER_RESULT_DEPENDENT)
+            fdata->flags.dependent_of_displayed = 1;
+        } else if (!(result & FILTER_RESULT_PASSED)) {
+          dissect = FALSE;
+          passed = FALSE;
+        }
+      }
+    }
+
+    /* A frame that passes has to be dissected anyway if other frames
+       have to be marked as depended upon. */
+    if (dissect && protocol_filter != NULL &&
+        protocol_set_filter_apply(protocol_filter, fdata->proto_set, &passed) &&
+        !(passed && fdata->flags.has_dependents))
+      dissect = FALSE;
+
+    if (dissect && use_field_cache &&
+        dfcache_apply(field_cache, framenum, dfcode,
+                      find_and_mark_frame_depended_upon, cf->frames, &passed))
+      dissect = FALSE;
+
+    if (dissect && !cf_read_record(cf, fdata))
       break; /* error reading the frame */
 
     /* If the previous frame is displayed, and we haven't yet seen the
@@ -1983,10 +2408,13 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
       preceding_frame = prev_frame;
     }
 
-    add_packet_to_packet_list(fdata, cf, &edt, dfcode,
-                                    cinfo, &cf->phdr,
-                                    ws_buffer_start_ptr(&cf->buf),
-                                    add_to_packet_list);
+    if (dissect)
+      add_packet_to_packet_list(fdata, cf, &edt, dfcode, field_cache,
+                                      cinfo, &cf->phdr,
+                                      ws_buffer_start_ptr(&cf->buf),
+                                      add_to_packet_list);
+    else
+      add_filtered_packet(fdata, cf, passed);
 
     /* If this frame is displayed, and this is the first frame we've
        seen displayed after the selected frame, remember this frame -
@@ -2013,6 +2441,19 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
   /* We are done redissecting the packet list. */
   cf->redissecting = FALSE;
 
+  if (protocol_filter != NULL)
+    protocol_set_filter_free(protocol_filter);
+
+  /* If every frame has been filtered, keep the results of the filter;
+     this takes over dfcode.  Every frame has also been dissected in
+     order by now. */
+  if (framenum > frames_count) {
+    keep_filter_results(cf, dfcode, frames_count);
+    cf->frames_undissected = FALSE;
+  } else
+    dfilter_free(dfcode);
+  dfcode = NULL;
+
   if (redissect) {
       frames_count = cf->count;
     /* Clear out what remains of the visited flags and per-frame data
@@ -2102,9 +2543,6 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
       }
     }
   }
-
-  /* Cleanup and release all dfilter resources */
-  dfilter_free(dfcode);
 }
 
 
@@ -2356,6 +2794,9 @@ cf_retap_packets(capture_file *cf)
     return CF_READ_ABORTED;
   }
 
+  /* The frames have to be dissected in order. */
+  dissect_listed_frames(cf);
+
   /* Do we have any tap listeners with filters? */
   filtering_tap_listeners = have_filtering_tap_listeners();
 
@@ -2688,6 +3129,9 @@ cf_print_packets(capture_file *cf, print_args_t *print_args)
       callback_args.print_args->print_dissections != print_dissections_none ||
       callback_args.print_args->print_hex ||
       have_custom_cols(&cf->cinfo);
+  /* The frames have to be dissected in order. */
+  dissect_listed_frames(cf);
+
   epan_dissect_init(&callback_args.edt, cf->epan, proto_tree_needed, proto_tree_needed);
 
   /* Iterate through the list of packets, printing the packets we were
@@ -2779,6 +3223,9 @@ cf_write_pdml_packets(capture_file *cf, print_args_t *print_args)
   }
 
   callback_args.fh = fh;
+  /* The frames have to be dissected in order. */
+  dissect_listed_frames(cf);
+
   epan_dissect_init(&callback_args.edt, cf->epan, TRUE, TRUE);
 
   /* Iterate through the list of packets, printing the packets we were
@@ -2861,6 +3308,9 @@ cf_write_psml_packets(capture_file *cf, print_args_t *print_args)
   /* Fill in the column information, only create the protocol tree
      if having custom columns. */
   proto_tree_needed = have_custom_cols(&cf->cinfo);
+  /* The frames have to be dissected in order. */
+  dissect_listed_frames(cf);
+
   epan_dissect_init(&callback_args.edt, cf->epan, proto_tree_needed, proto_tree_needed);
 
   /* Iterate through the list of packets, printing the packets we were
@@ -2941,6 +3391,9 @@ cf_write_csv_packets(capture_file *cf, print_args_t *print_args)
 
   /* only create the protocol tree if having custom columns. */
   proto_tree_needed = have_custom_cols(&cf->cinfo);
+  /* The frames have to be dissected in order. */
+  dissect_listed_frames(cf);
+
   epan_dissect_init(&callback_args.edt, cf->epan, proto_tree_needed, proto_tree_needed);
 
   /* Iterate through the list of packets, printing the packets we were
@@ -3892,6 +4345,11 @@ void
 cf_ignore_frame(capture_file *cf, frame_data *frame)
 {
   if (! frame->flags.ignored) {
+    /* An ignored frame isn't dissected, so it passes no filter. */
+    cf_clear_filter_results(cf);
+    if (cf->field_cache != NULL)
+      dfcache_forget_frame(cf->field_cache, frame->num);
+    frame->proto_set = 0;
     frame->flags.ignored = TRUE;
     if (cf->count > cf->ignored_count)
       cf->ignored_count++;
@@ -3905,6 +4363,10 @@ void
 cf_unignore_frame(capture_file *cf, frame_data *frame)
 {
   if (frame->flags.ignored) {
+    cf_clear_filter_results(cf);
+    if (cf->field_cache != NULL)
+      dfcache_forget_frame(cf->field_cache, frame->num);
+    frame->proto_set = 0;
     frame->flags.ignored = FALSE;
     if (cf->ignored_count > 0)
       cf->ignored_count--;
@@ -4026,6 +4488,12 @@ cf_set_user_packet_comment(capture_file *cf, frame_data *fd, const gchar *new_co
 
   fd->flags.has_user_comment = TRUE;
 
+  /* The comment is also added as an expert item, which filters may test. */
+  cf_clear_filter_results(cf);
+  if (cf->field_cache != NULL)
+    dfcache_forget_frame(cf->field_cache, fd->num);
+  fd->proto_set = 0;
+
   if (!cf->frames_user_comments)
     cf->frames_user_comments = g_tree_new_full(frame_cmp, NULL, NULL, g_free);
 
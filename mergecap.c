@@ -67,6 +67,9 @@
 #include <wsutil/unicode-utils.h>
 #endif /* _WIN32 */
 
+/* Long options without a corresponding single-character option */
+#define LONGOPT_READ_AHEAD 256
+
 /*
  * Show the usage
  */
@@ -87,6 +90,11 @@ print_usage(FILE *output)
   fprintf(output, "                    default is the same as the first input file.\n");
   fprintf(output, "                    an empty \"-T\" option will list the encapsulation types.\n");
   fprintf(output, "\n");
+  fprintf(output, "Input:\n");
+  fprintf(output, "  --read-ahead <records>\n");
+  fprintf(output, "                    read up to <records> records ahead from each input\n");
+  fprintf(output, "                    file on a pool of threads.\n");
+  fprintf(output, "\n");
   fprintf(output, "Miscellaneous:\n");
   fprintf(output, "  -h                display this help and exit.\n");
   fprintf(output, "  -v                verbose output.\n");
@@ -216,6 +224,7 @@ DIAG_OFF(cast-qual)
   static const struct option long_options[] = {
       {(char *)"help", no_argument, NULL, 'h'},
       {(char *)"version", no_argument, NULL, 'V'},
+      {(char *)"read-ahead", required_argument, NULL, LONGOPT_READ_AHEAD},
       {0, 0, 0, 0 }
   };
 DIAG_ON(cast-qual)
@@ -223,6 +232,7 @@ DIAG_ON(cast-qual)
   gboolean            verbose            = FALSE;
   int                 in_file_count      = 0;
   guint               snaplen            = 0;
+  guint               read_ahead_depth   = 0;
 #ifdef PCAP_NG_DEFAULT
   int                 file_type          = WTAP_FILE_TYPE_SUBTYPE_PCAPNG; /* default to pcap format */
 #else
@@ -293,6 +303,10 @@ DIAG_ON(cast-qual)
       snaplen = get_positive_int(optarg, "snapshot length");
       break;
 
+    case LONGOPT_READ_AHEAD:
+      read_ahead_depth = get_positive_int(optarg, "read-ahead depth");
+      break;
+
     case 'T':
       frame_type = wtap_short_string_to_encap(optarg);
       if (frame_type < 0) {
@@ -457,6 +471,9 @@ DIAG_ON(cast-qual)
     exit(1);
   }
 
+  /* From here on, we only look at the packets we read. */
+  merge_set_read_ahead(in_file_count, in_files, read_ahead_depth);
+
   /* do the merge (or append) */
   count = 1;
   for (;;) {
@@ -482,14 +499,14 @@ DIAG_ON(cast-qual)
 
     /* We simply write it, perhaps after truncating it; we could do other
      * things, like modify it. */
-    phdr = wtap_phdr(in_file->wth);
+    phdr = merge_in_file_phdr(in_file);
     if (snaplen != 0 && phdr->caplen > snaplen) {
       snap_phdr = *phdr;
       snap_phdr.caplen = snaplen;
       phdr = &snap_phdr;
     }
 
-    if (!wtap_dump(pdh, phdr, wtap_buf_ptr(in_file->wth), &write_err, &write_err_info)) {
+    if (!wtap_dump(pdh, phdr, merge_in_file_buf_ptr(in_file), &write_err, &write_err_info)) {
       got_write_error = TRUE;
       break;
     }
@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <glib.h>
 
 #ifdef HAVE_UNISTD_H
@@ -46,11 +47,16 @@
 #include "wsutil/wsgetopt.h"
 #endif
 
+#include <wsutil/clopts_common.h>
+#include <wsutil/cmdarg_err.h>
 #include <wsutil/crash_info.h>
 #include <wsutil/file_util.h>
+#include <wsutil/tempfile.h>
 #include <wsutil/ws_diag_control.h>
 #include <wsutil/ws_version_info.h>
 
+#include <wiretap/merge.h>
+
 /* Show command-line usage */
 static void
 print_usage(FILE *output)
@@ -60,9 +66,36 @@ print_usage(FILE *output)
     fprintf(output, "\n");
     fprintf(output, "Options:\n");
     fprintf(output, "  -n        don't write to output file if the input file is ordered.\n");
+    fprintf(output, "  -m <frames>\n");
+    fprintf(output, "            sort at most <frames> frames in memory at a time, writing\n");
+    fprintf(output, "            sorted runs to temporary files and merging them.\n");
+    fprintf(output, "  -w <frames>\n");
+    fprintf(output, "            sort in a single pass, assuming no frame is more than\n");
+    fprintf(output, "            <frames> frames away from where it belongs.\n");
     fprintf(output, "  -h        display this help and exit.\n");
 }
 
+/*
+ * Report an error in command-line arguments.
+ */
+static void
+reordercap_cmdarg_err(const char *fmt, va_list ap)
+{
+    fprintf(stderr, "reordercap: ");
+    vfprintf(stderr, fmt, ap);
+    fprintf(stderr, "\n");
+}
+
+/*
+ * Report additional information for an error in command-line arguments.
+ */
+static void
+reordercap_cmdarg_err_cont(const char *fmt, va_list ap)
+{
+    vfprintf(stderr, fmt, ap);
+    fprintf(stderr, "\n");
+}
+
 /* Remember where this frame was in the file */
 typedef struct FrameRecord_t {
     gint64       offset;
@@ -86,6 +119,36 @@ typedef struct FrameRecord_t {
 /**************************************************/
 
 
+static void
+dump_or_die(wtap_dumper *pdh, const struct wtap_pkthdr *phdr, const guint8 *pd)
+{
+    int    err;
+    gchar  *err_info;
+
+    if (!wtap_dump(pdh, phdr, pd, &err, &err_info)) {
+        fprintf(stderr, "reordercap: Error (%s) writing frame to outfile\n",
+                wtap_strerror(err));
+        if (err_info != NULL) {
+            fprintf(stderr, "(%s)\n", err_info);
+            g_free(err_info);
+        }
+        exit(1);
+    }
+}
+
+static void
+read_error(const char *infile, int err, gchar *err_info)
+{
+    /* Print a message noting that the read failed somewhere along the line. */
+    fprintf(stderr,
+            "reordercap: An error occurred while reading \"%s\": %s.\n",
+            infile, wtap_strerror(err));
+    if (err_info != NULL) {
+        fprintf(stderr, "(%s)\n", err_info);
+        g_free(err_info);
+    }
+}
+
 static void
 frame_write(FrameRecord_t *frame, wtap *wth, wtap_dumper *pdh,
             struct wtap_pkthdr *phdr, Buffer *buf, const char *infile)
@@ -118,15 +181,7 @@ frame_write(FrameRecord_t *frame, wtap *wth, wtap_dumper *pdh,
     phdr->ts = frame->time;
 
     /* Dump frame to outfile */
-    if (!wtap_dump(pdh, phdr, ws_buffer_start_ptr(buf), &err, &err_info)) {
-        fprintf(stderr, "reordercap: Error (%s) writing frame to outfile\n",
-                wtap_strerror(err));
-        if (err_info != NULL) {
-            fprintf(stderr, "(%s)\n", err_info);
-            g_free(err_info);
-        }
-        exit(1);
-    }
+    dump_or_die(pdh, phdr, ws_buffer_start_ptr(buf));
 }
 
 /* Comparing timestamps between 2 frames.
@@ -146,6 +201,466 @@ frames_compare(gconstpointer a, gconstpointer b)
     return nstime_cmp(time1, time2);
 }
 
+/*
+ * Sort the whole file in memory.
+ */
+static void
+reorder_in_memory(wtap *wth, wtap_dumper *pdh, const char *infile,
+                  gboolean write_output_regardless)
+{
+    struct wtap_pkthdr dump_phdr;
+    Buffer buf;
+    int err;
+    gchar *err_info;
+    gint64 data_offset;
+    const struct wtap_pkthdr *phdr;
+    guint wrong_order_count = 0;
+    guint i;
+
+    GPtrArray *frames;
+    FrameRecord_t *prevFrame = NULL;
+
+    /* Allocate the array of frame pointers. */
+    frames = g_ptr_array_new();
+
+    /* Read each frame from infile */
+    while (wtap_read(wth, &err, &err_info, &data_offset)) {
+        FrameRecord_t *newFrameRecord;
+
+        phdr = wtap_phdr(wth);
+
+        newFrameRecord = g_slice_new(FrameRecord_t);
+        newFrameRecord->num = frames->len + 1;
+        newFrameRecord->offset = data_offset;
+        if (phdr->presence_flags & WTAP_HAS_TS) {
+            newFrameRecord->time = phdr->ts;
+        } else {
+            nstime_set_unset(&newFrameRecord->time);
+        }
+
+        if (prevFrame && frames_compare(&newFrameRecord, &prevFrame) < 0) {
+           wrong_order_count++;
+        }
+
+        g_ptr_array_add(frames, newFrameRecord);
+        prevFrame = newFrameRecord;
+    }
+    if (err != 0) {
+        read_error(infile, err, err_info);
+    }
+
+    printf("%u frames, %u out of order\n", frames->len, wrong_order_count);
+
+    /* Sort the frames */
+    if (wrong_order_count > 0) {
+        g_ptr_array_sort(frames, frames_compare);
+    }
+
+    /* Write out each sorted frame in turn */
+    wtap_phdr_init(&dump_phdr);
+    ws_buffer_init(&buf, 1500);
+    for (i = 0; i < frames->len; i++) {
+        FrameRecord_t *frame = (FrameRecord_t *)frames->pdata[i];
+
+        /* Avoid writing if already sorted and configured to */
+        if (write_output_regardless || (wrong_order_count > 0)) {
+            frame_write(frame, wth, pdh, &dump_phdr, &buf, infile);
+        }
+        g_slice_free(FrameRecord_t, frame);
+    }
+    wtap_phdr_cleanup(&dump_phdr);
+    ws_buffer_free(&buf);
+
+    if (!write_output_regardless && (wrong_order_count == 0)) {
+        printf("Not writing output file because input file is already in order!\n");
+    }
+
+    /* Free the whole array */
+    g_ptr_array_free(frames, TRUE);
+}
+
+/* Most sorted runs we merge at once; each one is an open file. */
+#define MAX_MERGE_RUNS 256
+
+/*
+ * Create a temporary file for a sorted run, with the same type and
+ * headers as the input file, and add its name to run_files.
+ */
+static wtap_dumper *
+run_open(wtap *wth, wtapng_section_t *shb_hdr,
+         wtapng_iface_descriptions_t *idb_inf, GPtrArray *run_files)
+{
+    char *tmpname;
+    int fd;
+    int err;
+    wtap_dumper *run_pdh;
+
+    fd = create_tempfile(&tmpname, "reordercap");
+    if (fd == -1) {
+        fprintf(stderr, "reordercap: Can't create temporary file: %s\n",
+                g_strerror(errno));
+        exit(1);
+    }
+    /* create_tempfile() reuses its name buffer */
+    g_ptr_array_add(run_files, g_strdup(tmpname));
+    run_pdh = wtap_dump_fdopen_ng(fd, wtap_file_type_subtype(wth),
+                                  wtap_file_encap(wth), 65535, FALSE,
+                                  shb_hdr, idb_inf, &err);
+    if (run_pdh == NULL) {
+        fprintf(stderr, "reordercap: Can't write temporary file %s: %s\n",
+                tmpname, wtap_strerror(err));
+        exit(1);
+    }
+    return run_pdh;
+}
+
+static void
+run_close(wtap_dumper *run_pdh, GPtrArray *run_files)
+{
+    int err;
+
+    if (!wtap_dump_close(run_pdh, &err)) {
+        fprintf(stderr, "reordercap: Error closing temporary file %s: %s\n",
+                (char *)run_files->pdata[run_files->len - 1], wtap_strerror(err));
+        exit(1);
+    }
+}
+
+/*
+ * Merge count sorted runs, given in file order, into pdh, then remove
+ * them and free their names.
+ */
+static void
+merge_runs(char **run_names, guint count, wtap_dumper *pdh)
+{
+    char **names;
+    merge_in_file_t *in_files, *in_file;
+    int in_file_count = (int)count;
+    int err;
+    gchar *err_info;
+    int err_fileno;
+    guint i;
+
+    /*
+     * Of frames with the same time stamp, the merge picks the one from
+     * the last of the files first; hand it the runs last to first, so
+     * that those frames stay in their original order.
+     */
+    names = g_new(char *, count);
+    for (i = 0; i < count; i++) {
+        names[count - 1 - i] = run_names[i];
+    }
+    if (!merge_open_in_files(in_file_count, names, &in_files, &err,
+                             &err_info, &err_fileno)) {
+        fprintf(stderr, "reordercap: Can't open temporary file %s: %s\n",
+                names[err_fileno], wtap_strerror(err));
+        if (err_info != NULL) {
+            fprintf(stderr, "(%s)\n", err_info);
+            g_free(err_info);
+        }
+        exit(1);
+    }
+    while ((in_file = merge_read_packet(in_file_count, in_files, &err,
+                                        &err_info)) != NULL) {
+        if (err != 0) {
+            fprintf(stderr, "reordercap: An error occurred while reading temporary file \"%s\": %s.\n",
+                    in_file->filename, wtap_strerror(err));
+            if (err_info != NULL) {
+                fprintf(stderr, "(%s)\n", err_info);
+                g_free(err_info);
+            }
+            exit(1);
+        }
+        dump_or_die(pdh, merge_in_file_phdr(in_file),
+                    merge_in_file_buf_ptr(in_file));
+    }
+    merge_close_in_files(in_file_count, in_files);
+    g_free(in_files);
+
+    for (i = 0; i < count; i++) {
+        ws_unlink(run_names[i]);
+        g_free(run_names[i]);
+    }
+    g_free(names);
+}
+
+/*
+ * External merge sort, for files with more frames than we want to keep
+ * track of in memory.
+ *
+ * The input file is read in runs of up to run_frames frames; each run is
+ * sorted in memory and written to a temporary file of the same type as
+ * the input file.  The runs are then merged into the output file with
+ * the merge code Mergecap uses.  If everything fits in one run, it's
+ * written straight to the output file.
+ */
+static void
+reorder_external(wtap *wth, wtap_dumper *pdh, const char *infile,
+                 guint run_frames, gboolean write_output_regardless,
+                 wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf)
+{
+    FrameRecord_t *run;
+    GPtrArray *frames;
+    GPtrArray *run_files;
+    struct wtap_pkthdr dump_phdr;
+    Buffer buf;
+    const struct wtap_pkthdr *phdr;
+    gint64 data_offset;
+    int err;
+    gchar *err_info;
+    gboolean at_end = FALSE;
+    guint frame_count = 0;
+    guint wrong_order_count = 0;
+    nstime_t prev_time;
+    guint i;
+
+    run = g_new(FrameRecord_t, run_frames);
+    frames = g_ptr_array_sized_new(run_frames);
+    run_files = g_ptr_array_new();
+    wtap_phdr_init(&dump_phdr);
+    ws_buffer_init(&buf, 1500);
+
+    while (!at_end) {
+        /* Read the next run */
+        g_ptr_array_set_size(frames, 0);
+        while (frames->len < run_frames) {
+            FrameRecord_t *frame = &run[frames->len];
+
+            if (!wtap_read(wth, &err, &err_info, &data_offset)) {
+                if (err != 0)
+                    read_error(infile, err, err_info);
+                at_end = TRUE;
+                break;
+            }
+            phdr = wtap_phdr(wth);
+            frame->num = ++frame_count;
+            frame->offset = data_offset;
+            if (phdr->presence_flags & WTAP_HAS_TS) {
+                frame->time = phdr->ts;
+            } else {
+                nstime_set_unset(&frame->time);
+            }
+            if (frame_count > 1 && nstime_cmp(&frame->time, &prev_time) < 0) {
+                wrong_order_count++;
+            }
+            prev_time = frame->time;
+            g_ptr_array_add(frames, frame);
+        }
+        if (frames->len == 0)
+            break;
+
+        g_ptr_array_sort(frames, frames_compare);
+
+        if (at_end && run_files->len == 0) {
+            /* The whole file fit in one run. */
+            if (write_output_regardless || (wrong_order_count > 0)) {
+                for (i = 0; i < frames->len; i++) {
+                    frame_write((FrameRecord_t *)frames->pdata[i], wth, pdh,
+                                &dump_phdr, &buf, infile);
+                }
+            }
+        } else {
+            wtap_dumper *run_pdh = run_open(wth, shb_hdr, idb_inf, run_files);
+
+            for (i = 0; i < frames->len; i++) {
+                frame_write((FrameRecord_t *)frames->pdata[i], wth, run_pdh,
+                            &dump_phdr, &buf, infile);
+            }
+            run_close(run_pdh, run_files);
+        }
+    }
+
+    printf("%u frames, %u out of order\n", frame_count, wrong_order_count);
+
+    if (run_files->len > 0 &&
+        (write_output_regardless || (wrong_order_count > 0))) {
+        /*
+         * We need every run open at once to merge them; if there are too
+         * many, merge groups of neighbouring runs into bigger runs first.
+         */
+        while (run_files->len > MAX_MERGE_RUNS) {
+            GPtrArray *merged_files = g_ptr_array_new();
+
+            for (i = 0; i < run_files->len; i += MAX_MERGE_RUNS) {
+                wtap_dumper *run_pdh = run_open(wth, shb_hdr, idb_inf, merged_files);
+
+                merge_runs((char **)&run_files->pdata[i],
+                           MIN(run_files->len - i, MAX_MERGE_RUNS), run_pdh);
+                run_close(run_pdh, merged_files);
+            }
+            g_ptr_array_free(run_files, TRUE);
+            run_files = merged_files;
+        }
+        merge_runs((char **)run_files->pdata, run_files->len, pdh);
+    } else {
+        for (i = 0; i < run_files->len; i++) {
+            ws_unlink((char *)run_files->pdata[i]);
+            g_free(run_files->pdata[i]);
+        }
+    }
+    g_ptr_array_free(run_files, TRUE);
+
+    if (!write_output_regardless && (wrong_order_count == 0)) {
+        printf("Not writing output file because input file is already in order!\n");
+    }
+
+    wtap_phdr_cleanup(&dump_phdr);
+    ws_buffer_free(&buf);
+    g_ptr_array_free(frames, TRUE);
+    g_free(run);
+}
+
+/*
+ * Single-pass sort of a nearly-sorted file, with a bounded window.
+ *
+ * Frames are copied into a heap of at most window frames, ordered by time
+ * stamp and then by frame number; once the heap is full, each frame read
+ * pushes out the earliest frame in it, which is written.  A frame that's
+ * more than window frames away from where it belongs comes out too late
+ * to be put in order; those are counted, and the count is returned.
+ */
+typedef struct WindowRecord_t {
+    guint               num;
+    nstime_t            time;
+    struct wtap_pkthdr  phdr;
+    Buffer              buf;
+} WindowRecord_t;
+
+static gboolean
+window_before(const WindowRecord_t *a, const WindowRecord_t *b)
+{
+    int cmp = nstime_cmp(&a->time, &b->time);
+
+    return cmp < 0 || (cmp == 0 && a->num < b->num);
+}
+
+static void
+window_push(WindowRecord_t **heap, guint *count, WindowRecord_t *rec)
+{
+    guint pos = (*count)++;
+
+    while (pos > 0 && window_before(rec, heap[(pos - 1) / 2])) {
+        heap[pos] = heap[(pos - 1) / 2];
+        pos = (pos - 1) / 2;
+    }
+    heap[pos] = rec;
+}
+
+static WindowRecord_t *
+window_pop(WindowRecord_t **heap, guint *count)
+{
+    WindowRecord_t *top = heap[0];
+    WindowRecord_t *last = heap[--(*count)];
+    guint pos = 0, child;
+
+    for (;;) {
+        child = 2 * pos + 1;
+        if (child >= *count)
+            break;
+        if (child + 1 < *count && window_before(heap[child + 1], heap[child]))
+            child++;
+        if (!window_before(heap[child], last))
+            break;
+        heap[pos] = heap[child];
+        pos = child;
+    }
+    heap[pos] = last;
+    return top;
+}
+
+static void
+window_write(WindowRecord_t *rec, wtap_dumper *pdh, nstime_t *last_written,
+             guint *late_count)
+{
+    if (!nstime_is_unset(last_written) && nstime_cmp(&rec->time, last_written) < 0) {
+        (*late_count)++;
+    } else {
+        *last_written = rec->time;
+    }
+    dump_or_die(pdh, &rec->phdr, ws_buffer_start_ptr(&rec->buf));
+}
+
+static guint
+reorder_window(wtap *wth, wtap_dumper *pdh, const char *infile, guint window)
+{
+    WindowRecord_t *recs, *rec, **heap;
+    guint used, heap_count = 0;
+    const struct wtap_pkthdr *phdr;
+    gint64 data_offset;
+    int err;
+    gchar *err_info;
+    guint frame_count = 0;
+    guint wrong_order_count = 0;
+    guint late_count = 0;
+    nstime_t prev_time;
+    nstime_t last_written;
+    guint i;
+
+    /* The heap, plus the record being read into. */
+    recs = g_new(WindowRecord_t, window + 1);
+    heap = g_new(WindowRecord_t *, window + 1);
+    for (i = 0; i < window + 1; i++) {
+        wtap_phdr_init(&recs[i].phdr);
+        ws_buffer_init(&recs[i].buf, 1500);
+    }
+    rec = &recs[0];
+    used = 1;
+    nstime_set_unset(&last_written);
+
+    while (wtap_read(wth, &err, &err_info, &data_offset)) {
+        Buffer ft_specific_data = rec->phdr.ft_specific_data;
+
+        phdr = wtap_phdr(wth);
+        rec->num = ++frame_count;
+        if (phdr->presence_flags & WTAP_HAS_TS) {
+            rec->time = phdr->ts;
+        } else {
+            nstime_set_unset(&rec->time);
+        }
+        if (frame_count > 1 && nstime_cmp(&rec->time, &prev_time) < 0) {
+            wrong_order_count++;
+        }
+        prev_time = rec->time;
+
+        g_free(rec->phdr.opt_comment);
+        rec->phdr = *phdr;
+        rec->phdr.opt_comment = g_strdup(phdr->opt_comment);
+        rec->phdr.ft_specific_data = ft_specific_data;
+        ws_buffer_clean(&rec->phdr.ft_specific_data);
+        ws_buffer_append_buffer(&rec->phdr.ft_specific_data,
+                                (Buffer *)&phdr->ft_specific_data);
+        ws_buffer_clean(&rec->buf);
+        ws_buffer_append(&rec->buf, wtap_buf_ptr(wth), phdr->caplen);
+
+        window_push(heap, &heap_count, rec);
+        if (heap_count > window) {
+            /* The earliest frame can't be displaced any more; write it. */
+            rec = window_pop(heap, &heap_count);
+            window_write(rec, pdh, &last_written, &late_count);
+        } else {
+            rec = &recs[used++];
+        }
+    }
+    if (err != 0)
+        read_error(infile, err, err_info);
+
+    while (heap_count > 0) {
+        window_write(window_pop(heap, &heap_count), pdh, &last_written,
+                     &late_count);
+    }
+
+    printf("%u frames, %u out of order\n", frame_count, wrong_order_count);
+
+    for (i = 0; i < window + 1; i++) {
+        g_free(recs[i].phdr.opt_comment);
+        wtap_phdr_cleanup(&recs[i].phdr);
+        ws_buffer_free(&recs[i].buf);
+    }
+    g_free(heap);
+    g_free(recs);
+    return late_count;
+}
+
 static void
 get_reordercap_compiled_info(GString *str)
 {
@@ -182,21 +697,15 @@ main(int argc, char *argv[])
     GString *runtime_info_str;
     wtap *wth = NULL;
     wtap_dumper *pdh = NULL;
-    struct wtap_pkthdr dump_phdr;
-    Buffer buf;
     int err;
     gchar *err_info;
-    gint64 data_offset;
-    const struct wtap_pkthdr *phdr;
-    guint wrong_order_count = 0;
     gboolean write_output_regardless = TRUE;
-    guint i;
+    guint run_frames = 0;
+    guint window = 0;
+    guint late_count = 0;
     wtapng_section_t            *shb_hdr;
     wtapng_iface_descriptions_t *idb_inf;
 
-    GPtrArray *frames;
-    FrameRecord_t *prevFrame = NULL;
-
     int opt;
 DIAG_OFF(cast-qual)
     static const struct option long_options[] = {
@@ -209,6 +718,8 @@ DIAG_ON(cast-qual)
     char *infile;
     char *outfile;
 
+    cmdarg_err_init(reordercap_cmdarg_err, reordercap_cmdarg_err_cont);
+
     /* Get the compile-time version information string */
     comp_info_str = get_compiled_version_info(NULL, get_reordercap_compiled_info);
 
@@ -224,11 +735,17 @@ DIAG_ON(cast-qual)
       get_ws_vcs_version_info(), comp_info_str->str, runtime_info_str->str);
 
     /* Process the options first */
-    while ((opt = getopt_long(argc, argv, "hnv", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "hm:nvw:", long_options, NULL)) != -1) {
         switch (opt) {
+            case 'm':
+                run_frames = get_positive_int(optarg, "number of frames to sort in memory");
+                break;
             case 'n':
                 write_output_regardless = FALSE;
                 break;
+            case 'w':
+                window = get_positive_int(optarg, "reorder window");
+                break;
             case 'h':
                 printf("Reordercap (Wireshark) %s\n"
                        "Reorder timestamps of input file frames into output file.\n"
@@ -258,6 +775,16 @@ DIAG_ON(cast-qual)
         exit(1);
     }
 
+    if (run_frames != 0 && window != 0) {
+        fprintf(stderr, "reordercap: -m and -w can't be used together.\n");
+        exit(1);
+    }
+    if (window != 0 && !write_output_regardless) {
+        /* We write frames before we've seen the whole file. */
+        fprintf(stderr, "reordercap: -n can't be used with -w.\n");
+        exit(1);
+    }
+
     /* Open infile */
     /* TODO: if reordercap is ever changed to give the user a choice of which
        open_routine reader to use, then the following needs to change. */
@@ -279,78 +806,23 @@ DIAG_ON(cast-qual)
     /* Open outfile (same filetype/encap as input file) */
     pdh = wtap_dump_open_ng(outfile, wtap_file_type_subtype(wth), wtap_file_encap(wth),
                             65535, FALSE, shb_hdr, idb_inf, &err);
-    g_free(idb_inf);
     if (pdh == NULL) {
         fprintf(stderr, "reordercap: Failed to open output file: (%s) - error %s\n",
                 outfile, wtap_strerror(err));
+        g_free(idb_inf);
         g_free(shb_hdr);
         exit(1);
     }
 
-    /* Allocate the array of frame pointers. */
-    frames = g_ptr_array_new();
-
-    /* Read each frame from infile */
-    while (wtap_read(wth, &err, &err_info, &data_offset)) {
-        FrameRecord_t *newFrameRecord;
-
-        phdr = wtap_phdr(wth);
-
-        newFrameRecord = g_slice_new(FrameRecord_t);
-        newFrameRecord->num = frames->len + 1;
-        newFrameRecord->offset = data_offset;
-        if (phdr->presence_flags & WTAP_HAS_TS) {
-            newFrameRecord->time = phdr->ts;
-        } else {
-            nstime_set_unset(&newFrameRecord->time);
-        }
-
-        if (prevFrame && frames_compare(&newFrameRecord, &prevFrame) < 0) {
-           wrong_order_count++;
-        }
-
-        g_ptr_array_add(frames, newFrameRecord);
-        prevFrame = newFrameRecord;
-    }
-    if (err != 0) {
-      /* Print a message noting that the read failed somewhere along the line. */
-      fprintf(stderr,
-              "reordercap: An error occurred while reading \"%s\": %s.\n",
-              infile, wtap_strerror(err));
-      if (err_info != NULL) {
-          fprintf(stderr, "(%s)\n", err_info);
-          g_free(err_info);
-      }
-    }
-
-    printf("%u frames, %u out of order\n", frames->len, wrong_order_count);
-
-    /* Sort the frames */
-    if (wrong_order_count > 0) {
-        g_ptr_array_sort(frames, frames_compare);
-    }
-
-    /* Write out each sorted frame in turn */
-    wtap_phdr_init(&dump_phdr);
-    ws_buffer_init(&buf, 1500);
-    for (i = 0; i < frames->len; i++) {
-        FrameRecord_t *frame = (FrameRecord_t *)frames->pdata[i];
-
-        /* Avoid writing if already sorted and configured to */
-        if (write_output_regardless || (wrong_order_count > 0)) {
-            frame_write(frame, wth, pdh, &dump_phdr, &buf, infile);
-        }
-        g_slice_free(FrameRecord_t, frame);
-    }
-    wtap_phdr_cleanup(&dump_phdr);
-    ws_buffer_free(&buf);
-
-    if (!write_output_regardless && (wrong_order_count == 0)) {
-        printf("Not writing output file because input file is already in order!\n");
+    if (run_frames != 0) {
+        reorder_external(wth, pdh, infile, run_frames, write_output_regardless,
+                         shb_hdr, idb_inf);
+    } else if (window != 0) {
+        late_count = reorder_window(wth, pdh, infile, window);
+    } else {
+        reorder_in_memory(wth, pdh, infile, write_output_regardless);
     }
-
-    /* Free the whole array */
-    g_ptr_array_free(frames, TRUE);
+    g_free(idb_inf);
 
     /* Close outfile */
     if (!wtap_dump_close(pdh, &err)) {
@@ -364,6 +836,12 @@ DIAG_ON(cast-qual)
     /* Finally, close infile */
     wtap_fdclose(wth);
 
+    if (late_count > 0) {
+        fprintf(stderr, "reordercap: %u frames were more than %u frames out of place, "
+                "so the output isn't completely in order; use a larger -w.\n",
+                late_count, window);
+        return 1;
+    }
     return 0;
 }
 
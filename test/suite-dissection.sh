@@ -0,0 +1,186 @@
+#!/bin/bash
+#
+# Test the results of dissecting and filtering packets
+#
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 2005 Ulf Lamping
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#
+
+# common exit status values
+EXIT_OK=0
+EXIT_COMMAND_LINE=1
+EXIT_ERROR=2
+
+DISSECTION_FILTERS=(
+	"bootp"
+	"bootp.option.dhcp == 1"
+	"udp.srcport == 67"
+	"ip.src == 0.0.0.0 && udp.dstport == 67"
+	"frame.len > 320"
+	"!(bootp.option.dhcp in {1 3})"
+	"tcp"
+)
+
+# The filters of the tap listeners are run together as one batch; each
+# io,stat column is a listener of its own, so the frames counted in
+# each column must be those its filter matches when run on its own.
+dissection_step_tap_filter_batch() {
+	local zarg="io,stat,0"
+	local filter
+	local i=0
+	local batch_count
+	local count
+
+	for filter in "${DISSECTION_FILTERS[@]}" ; do
+		zarg="$zarg,$filter"
+	done
+	$TSHARK -r "${CAPTURE_DIR}dhcp.pcap" -q -z "$zarg" > ./testout.txt 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK: $RETURNVALUE"
+		cat ./testout.txt
+		return
+	fi
+
+	for filter in "${DISSECTION_FILTERS[@]}" ; do
+		i=$(( $i + 1 ))
+		batch_count=`grep '<>' ./testout.txt | awk -F'|' -v f=$(( 2 * $i + 1 )) '{ print $f + 0 }'`
+		count=`$TSHARK -r "${CAPTURE_DIR}dhcp.pcap" -Y "$filter" 2>&1 | wc -l`
+		if [ -z "$batch_count" -o "$batch_count" -ne "$count" ]; then
+			test_step_failed "\"$filter\" matched $count packets on its own, $batch_count as a tap filter"
+			cat ./testout.txt
+			return
+		fi
+	done
+	test_step_ok
+}
+
+# The second pass of -2 can skip the dissectors that don't lead to the
+# fields that are wanted; frame.protocols names every protocol in the
+# frame, so none of them may be skipped.
+dissection_step_prune_frame_protocols() {
+	$TSHARK -r "${CAPTURE_DIR}dhcp.pcap" -T fields -e frame.protocols > ./testout.txt 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK: $RETURNVALUE"
+		return
+	fi
+	$TSHARK -r "${CAPTURE_DIR}dhcp.pcap" -2 -T fields -e frame.protocols > ./testout2.txt 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK -2: $RETURNVALUE"
+		return
+	fi
+	diff -u --strip-trailing-cr ./testout.txt ./testout2.txt > $DIFF_OUT 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "frame.protocols differs in two-pass mode"
+		cat $DIFF_OUT
+		return
+	fi
+
+	$TSHARK -r "${CAPTURE_DIR}dhcp.pcap" -2 -T fields -e frame.number \
+		-Y "frame.protocols contains \"udp\"" > ./testout2.txt 2>&1
+	if [ `cat ./testout2.txt | wc -l` -ne `cat ./testout.txt | wc -l` ]; then
+		test_step_failed "frame.protocols filter doesn't match every packet in two-pass mode"
+		cat ./testout2.txt
+		return
+	fi
+	test_step_ok
+}
+
+# Every packet must be dissected in exactly one of the --flow-shard
+# shards, and both directions of a conversation in the same one.
+dissection_step_flow_shard() {
+	local shard
+	local capture="${CAPTURE_DIR}dns+icmp.pcapng.gz"
+
+	$TSHARK -r "$capture" -T fields -e frame.number > ./testout.txt 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK: $RETURNVALUE"
+		cat ./testout.txt
+		return
+	fi
+
+	rm -f ./testout2.txt ./testout3.txt
+	for shard in 0 1 2 3 ; do
+		$TSHARK -r "$capture" --flow-shard $shard/4 -T fields \
+			-e frame.number >> ./testout2.txt 2>&1
+		RETURNVALUE=$?
+		if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+			test_step_failed "exit status of $TSHARK --flow-shard $shard/4: $RETURNVALUE"
+			cat ./testout2.txt
+			return
+		fi
+		# The unordered outermost address pair of each IP packet,
+		# tagged with the shard it was dissected in.
+		$TSHARK -r "$capture" --flow-shard $shard/4 -Y ip -T fields \
+			-E occurrence=f -e ip.src -e ip.dst 2>&1 | \
+			awk -v shard=$shard '{ if ($1 < $2) print $1, $2, shard; else print $2, $1, shard }' \
+			>> ./testout3.txt
+	done
+
+	sort -n ./testout2.txt > ./testout2.sorted
+	sort -n ./testout.txt | diff -u --strip-trailing-cr - ./testout2.sorted > $DIFF_OUT 2>&1
+	RETURNVALUE=$?
+	rm -f ./testout2.sorted
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "the shards don't hold every packet exactly once"
+		cat $DIFF_OUT
+		return
+	fi
+
+	if [ `sort -u ./testout3.txt | awk '{ print $1, $2 }' | uniq -d | wc -l` -ne 0 ]; then
+		test_step_failed "a conversation was split between shards"
+		sort -u ./testout3.txt
+		return
+	fi
+	test_step_ok
+}
+
+tshark_dissection_suite() {
+	test_step_add "Tap filters match the filters run on their own" dissection_step_tap_filter_batch
+	test_step_add "frame.protocols in two-pass mode" dissection_step_prune_frame_protocols
+	test_step_add "Flow shards partition the packets" dissection_step_flow_shard
+}
+
+dissection_cleanup_step() {
+	rm -f ./testout.txt
+	rm -f ./testout2.txt
+	rm -f ./testout3.txt
+}
+
+dissection_suite() {
+	test_step_set_pre dissection_cleanup_step
+	test_step_set_post dissection_cleanup_step
+	test_suite_add "TShark dissection" tshark_dissection_suite
+}
+
+#
+# Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+#
+# Local variables:
+# c-basic-offset: 8
+# tab-width: 8
+# indent-tabs-mode: t
+# End:
+#
+# vi: set shiftwidth=8 tabstop=8 noexpandtab:
+# :indentSize=8:tabSize=8:noTabs=false:
+#
@@ -142,6 +142,109 @@ io_step_rawshark_pcap_stdin() {
 	test_step_ok
 }
 
+# Uncompressed files are memory-mapped; reading one sequentially must
+# give the same result as reading it through a pipe, which isn't.
+io_step_mapped_read() {
+	$DUT -r "${CAPTURE_DIR}dhcp.pcap" -V > ./testout.txt 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $DUT: $RETURNVALUE"
+		return
+	fi
+	cat "${CAPTURE_DIR}dhcp.pcap" | $DUT -r - -V > ./testout2.txt 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $DUT reading a pipe: $RETURNVALUE"
+		return
+	fi
+	diff -u --strip-trailing-cr ./testout2.txt ./testout.txt > $DIFF_OUT 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "Reading a mapped file differs from reading a pipe"
+		cat $DIFF_OUT
+		return
+	fi
+	test_step_ok
+}
+
+# The second pass of -2 seeks to every packet; on a mapped file that
+# must give the same result as on a gzipped copy of it, which isn't.
+io_step_mapped_seek() {
+	which gzip > /dev/null 2>&1
+	if [ $? -ne 0 ]; then
+		test_step_skipped
+		return
+	fi
+	gzip -c "${CAPTURE_DIR}dhcp.pcap" > ./testout.pcap.gz
+	$DUT -2 -r "${CAPTURE_DIR}dhcp.pcap" -V > ./testout.txt 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $DUT: $RETURNVALUE"
+		return
+	fi
+	$DUT -2 -r ./testout.pcap.gz -V > ./testout2.txt 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $DUT reading a gzipped file: $RETURNVALUE"
+		return
+	fi
+	diff -u --strip-trailing-cr ./testout2.txt ./testout.txt > $DIFF_OUT 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "Seeking in a mapped file differs from seeking in a gzipped file"
+		cat $DIFF_OUT
+		return
+	fi
+	test_step_ok
+}
+
+# Once a read has saved the seek points of a gzipped file, later reads
+# inflate the stretches between them in parallel; that must give the
+# same result as reading the uncompressed file.  The gzipped file is
+# made of several members, so that there are stretches to inflate even
+# after the first member has been read, when the points are loaded.
+io_step_gzip_seek_points() {
+	which gzip > /dev/null 2>&1
+	if [ $? -ne 0 ]; then
+		test_step_skipped
+		return
+	fi
+	rm -f ./testout.pcap.gz
+	for i in 0 1 2 3 4 5 ; do
+		dd if="${CAPTURE_DIR}rsasnakeoil2.pcap" bs=5000 skip=$i count=1 2> /dev/null |
+			gzip -c >> ./testout.pcap.gz
+	done
+	$DUT -2 -r "${CAPTURE_DIR}rsasnakeoil2.pcap" -V > ./testout.txt 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $DUT: $RETURNVALUE"
+		return
+	fi
+	$DUT --write-index -r ./testout.pcap.gz > /dev/null 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $DUT writing the index: $RETURNVALUE"
+		return
+	fi
+	if [ ! -f ./testout.pcap.gz.wtfsk ]; then
+		test_step_failed "No seek points were saved for the gzipped file"
+		return
+	fi
+	$DUT -2 -r ./testout.pcap.gz -V > ./testout2.txt 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $DUT reading a gzipped file: $RETURNVALUE"
+		return
+	fi
+	diff -u --strip-trailing-cr ./testout2.txt ./testout.txt > $DIFF_OUT 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "Reading a gzipped file from its seek points differs from reading it uncompressed"
+		cat $DIFF_OUT
+		return
+	fi
+	test_step_ok
+}
 
 wireshark_io_suite() {
 	# Q: quit after cap, k: start capture immediately
@@ -159,6 +262,9 @@ tshark_io_suite() {
 	DUT=$TSHARK
 	test_step_add "Input file" io_step_input_file
 	test_step_add "Output piping" io_step_output_piping
+	test_step_add "Mapped file read" io_step_mapped_read
+	test_step_add "Mapped file seek" io_step_mapped_seek
+	test_step_add "Gzip seek points" io_step_gzip_seek_points
 	#test_step_add "Piping" io_step_input_piping
 }
 
@@ -178,6 +284,8 @@ io_cleanup_step() {
 	rm -f ./testout2.txt
 	rm -f ./testout.pcap
 	rm -f ./testout2.pcap
+	rm -f ./testout.pcap.gz
+	rm -f ./testout.pcap.gz.wtidx ./testout.pcap.gz.wtfsk
 	rm -f $IO_RAWSHARK_DHCP_PCAP_TESTOUT
 }
 
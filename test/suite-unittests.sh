@@ -60,9 +60,10 @@ unittests_step_test() {
 	test_step_ok
 }
 
+# set_dut <program> [<directory, if not epan>]
 set_dut() {
 	if [ "$SOURCE_DIR" = "$WS_BIN_PATH" -o "$WS_SYSTEM" = "Windows" ]; then
-		DUT=$SOURCE_DIR/epan/$1
+		DUT=$SOURCE_DIR/${2:-epan}/$1
 	else
 		# In out-of-tree builds, all binaries end up in the same folder
 		# regardless of their path during in-tree builds, so we strip
@@ -71,6 +72,12 @@ set_dut() {
 	fi
 }
 
+unittests_step_dfilter_test() {
+	set_dut dfilter_test
+	ARGS="--verbose ${CAPTURE_DIR}dhcp.pcap"
+	unittests_step_test
+}
+
 unittests_step_exntest() {
 	set_dut exntest
 	ARGS=
@@ -101,6 +108,12 @@ unittests_step_wmem_test() {
 	unittests_step_test
 }
 
+unittests_step_wtap_index_test() {
+	set_dut wtap_index_test wiretap
+	ARGS=--verbose
+	unittests_step_test
+}
+
 unittests_cleanup_step() {
 	rm -f ./testout.txt
 }
@@ -108,11 +121,13 @@ unittests_cleanup_step() {
 unittests_suite() {
 	test_step_set_pre unittests_cleanup_step
 	test_step_set_post unittests_cleanup_step
+	test_step_add "dfilter_test" unittests_step_dfilter_test
 	test_step_add "exntest" unittests_step_exntest
 	test_step_add "oids_test" unittests_step_oids_test
 	test_step_add "reassemble_test" unittests_step_reassemble_test
 	test_step_add "tvbtest" unittests_step_tvbtest
 	test_step_add "wmem_test" unittests_step_wmem_test
+	test_step_add "wtap_index_test" unittests_step_wtap_index_test
 }
 #
 # Editor modelines  -  http://www.wireshark.org/tools/modelines.html
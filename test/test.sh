@@ -56,6 +56,7 @@ Usage: $THIS [-c] [-h] [-s <suite>]
       capture
       clopts
       decryption
+      dissection
       fileformats
       io
       nameres
@@ -106,6 +107,7 @@ source $TESTS_DIR/suite-capture.sh
 source $TESTS_DIR/suite-unittests.sh
 source $TESTS_DIR/suite-fileformats.sh
 source $TESTS_DIR/suite-decryption.sh
+source $TESTS_DIR/suite-dissection.sh
 source $TESTS_DIR/suite-nameres.sh
 source $TESTS_DIR/suite-wslua.sh
 
@@ -166,6 +168,7 @@ test_suite() {
 	test_suite_add "Unit tests" unittests_suite
 	test_suite_add "File formats" fileformats_suite
 	test_suite_add "Decryption" decryption_suite
+	test_suite_add "Dissection" dissection_suite
 	test_suite_add "Name Resolution" name_resolution_suite
 	test_suite_add "Lua API" wslua_suite
 }
@@ -198,6 +201,9 @@ if [ -n "$RUN_SUITE" ] ; then
 		"decryption")
 			test_suite_run "Decryption" decryption_suite
 			exit $? ;;
+		"dissection")
+			test_suite_run "Dissection" dissection_suite
+			exit $? ;;
 		"fileformats")
 			test_suite_run "File formats" fileformats_suite
 			exit $? ;;
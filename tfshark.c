@@ -1574,6 +1574,7 @@ tfshark_epan_new(capture_file *cf)
 
   epan->data = cf;
   epan->get_frame_ts = tfshark_get_frame_ts;
+  epan->get_frame_shift_offset = NULL;
   epan->get_interface_name = no_interface_name;
   epan->get_user_comment = NULL;
 
@@ -0,0 +1,114 @@
+#!/bin/bash
+
+# Measure the cost of display filter evaluation: for each of a set of
+# filters, show the program that dftest compiles it to, and time a
+# TShark run over a capture file with and without the filter.  Run it
+# against two builds (-b) to compare their display filter engines, or
+# with -i to compare the specialized code that filters are run as with
+# the DFVM interpreter.  With no files, it runs over test/captures.
+#
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 1998 Gerald Combs
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+TEST_TYPE="bench"
+. `dirname $0`/test-common.sh || exit 1
+
+# Filters to time, one per line (-f replaces them).  They refer to fields that occur more
+# than once in most packets, and to slices and functions, so that they
+# exercise the filter engine's registers.
+FILTERS="ip.addr == 10.0.0.1 || ip.addr == 10.0.0.2 || ip.addr == 10.0.0.3
+tcp.port == 80 || udp.port == 53 || tcp.port == 443
+eth.addr[0:3] == 00:00:0c || eth.addr[0:3] == 00:50:56
+len(frame.protocols) > 20 && ip.ttl < 64
+count(ip.addr) >= 2 && !(tcp.flags.reset == 1)
+ip.src == 10.0.0.0/8 || ip.src == 172.16.0.0/12 || ip.src == 192.168.0.0/16
+ip.dst > 224.0.0.0 && !(ip.dst == 255.255.255.255)
+tcp.port in {22, 23, 445, 3389, 5900} && tcp.flags.syn == 1 && tcp.flags.ack == 0
+tcp.flags & 0x02 && tcp.window_size < 1024
+eth.src[0:3] == 00:0c:29 || eth.src[0:3] == 08:00:27 || eth.dst[0:3] == 00:50:56
+frame.len > 1400 && udp.dstport == 53
+dns.flags.rcode != 0 || dns.qry.type == 255
+http.request.method == \"POST\" && tcp.dstport != 80"
+# Number of times to run TShark for each filter; the fastest run counts.
+RUNS=3
+# Time the DFVM interpreter as well (-i)?
+INTERPRET=0
+
+while getopts ":b:f:ir:" OPTCHAR ; do
+    case $OPTCHAR in
+        b) BIN_DIR=$OPTARG ;;
+        f) FILTERS=$OPTARG ;;
+        i) INTERPRET=1 ;;
+        r) RUNS=$OPTARG ;;
+        *)
+            printf "Usage: $(basename $0) [-b bin_dir] [-f filters] [-i] [-r runs] [/path/to/file[s].pcap]\n"
+            exit 1
+            ;;
+    esac
+done
+shift $(($OPTIND - 1))
+
+if [ $# -lt 1 ]
+then
+	set -- `dirname $0`/../test/captures/*.pcap*
+fi
+
+ws_bind_exec_paths
+ws_check_exec "$TSHARK" "$DFTEST" "$CAPINFOS"
+
+TIMEFORMAT=%R
+
+# Run TShark RUNS times over a file, with the given arguments, and print
+# the shortest time it took.
+function best_time() {
+	local best=""
+	local secs
+	for i in `seq $RUNS`
+	do
+		secs=`{ time $TSHARK -n -r "$@" > /dev/null ; } 2>&1`
+		best=`awk -v a="$best" -v b=$secs 'BEGIN { print (a == "" || b < a) ? b : a }'`
+	done
+	echo $best
+}
+
+for file in "$@"
+do
+	FRAMES=`$CAPINFOS -c -M "$file" | awk '/^Number of packets/ { print $NF }'`
+	echo "$file: $FRAMES frames"
+
+	# Filtering makes TShark build a tree, so the baseline filters too,
+	# with a filter that costs next to nothing.
+	BASE_SECS=`best_time "$file" -Y frame`
+	awk -v secs=$BASE_SECS \
+		'BEGIN { printf " - %-60s           %8.3f s\n", "frame", secs }'
+
+	echo "$FILTERS" | while read -r filter
+	do
+		[ -z "$filter" ] && continue
+		INSNS=`$DFTEST "$filter" 2>/dev/null | grep -c '^[0-9][0-9]*  *[A-Z]'`
+		SECS=`best_time "$file" -Y "$filter"`
+		awk -v frames=$FRAMES -v secs=$SECS -v base=$BASE_SECS -v insns=$INSNS -v filter="$filter" \
+			'BEGIN { printf " - %-60s %3d insns: %8.3f s, %8.0f ns/frame over \"frame\"\n", filter, insns, secs, frames > 0 ? (secs - base) * 1e9 / frames : 0 }'
+		if [ $INTERPRET -eq 1 ]
+		then
+			SECS=`WIRESHARK_DFILTER_INTERPRET=1 best_time "$file" -Y "$filter"`
+			awk -v frames=$FRAMES -v secs=$SECS -v base=$BASE_SECS \
+				'BEGIN { printf "   %-60s  interpreted: %8.3f s, %8.0f ns/frame over \"frame\"\n", "", secs, frames > 0 ? (secs - base) * 1e9 / frames : 0 }'
+		fi
+	done
+done
@@ -24,6 +24,7 @@ from dftestlib import util
 # The binaries to use. We assume we are running
 # from the top of the wireshark distro
 TSHARK = os.path.join(".", "tshark")
+DFTEST = os.path.join(".", "dftest")
 
 class DFTest(unittest.TestCase):
     """Base class for all tests in this dfilter-test collection."""
@@ -54,7 +55,7 @@ class DFTest(unittest.TestCase):
                     pass
 
 
-    def runDFilter(self, dfilter):
+    def runDFilter(self, dfilter, env=None):
         # Create the tshark command
         cmdv = [TSHARK,
                 "-n",       # No name resolution
@@ -63,13 +64,15 @@ class DFTest(unittest.TestCase):
                 "-Y",       # packet display filter (used to be -R)
                 dfilter]
 
-        (status, output) = util.exec_cmdv(cmdv)
+        (status, output) = util.exec_cmdv(cmdv, env=env)
         return status, output
 
 
     def assertDFilterCount(self, dfilter, expected_count):
-        """Run a display filter and expect a certain number of packets."""
-        
+        """Run a display filter and expect a certain number of packets.
+        The filter is run both as specialized code and in the DFVM
+        interpreter, and must give the same packets either way."""
+
         (status, output) = self.runDFilter(dfilter)
 
         # tshark must succeed
@@ -82,6 +85,43 @@ class DFTest(unittest.TestCase):
         msg = "Expected %d, got: %s" % (expected_count, output)
         self.assertEqual(len(lines), expected_count, msg)
 
+        (status, interp_output) = self.runDFilter(dfilter,
+                env={"WIRESHARK_DFILTER_INTERPRET": "1"})
+        self.assertEqual(status, util.SUCCESS, interp_output)
+
+        self.assertEqual(output, interp_output,
+                "Specialized:\n%s\nInterpreted:\n%s" % (output, interp_output))
+
+    def assertDFilterOptimized(self, dfilter, expected_count):
+        """Run a display filter with and without the optimizer, and
+        expect the same packets, and a certain number of them, either
+        way."""
+
+        (status, output) = self.runDFilter(dfilter)
+        self.assertEqual(status, util.SUCCESS, output)
+
+        (status, unopt_output) = self.runDFilter(dfilter,
+                env={"WIRESHARK_DFILTER_NO_OPTIMIZE": "1"})
+        self.assertEqual(status, util.SUCCESS, unopt_output)
+
+        self.assertEqual(output, unopt_output,
+                "Optimized:\n%s\nUnoptimized:\n%s" % (output, unopt_output))
+
+        lines = [L for L in output.split("\n") if L != ""]
+        msg = "Expected %d, got: %s" % (expected_count, output)
+        self.assertEqual(len(lines), expected_count, msg)
+
+    def assertOptimization(self, dfilter, optimization):
+        """Compile a display filter with dftest, and expect the
+        optimizer to report having done something."""
+
+        if not os.path.exists(DFTEST):
+            self.skipTest("dftest hasn't been built")
+
+        (status, output) = util.exec_cmdv([DFTEST, dfilter])
+        self.assertEqual(status, util.SUCCESS, output)
+        self.assertIn(optimization, output)
+
     def assertDFilterFail(self, dfilter):
         """Run a display filter and expect tshark to fail"""
 
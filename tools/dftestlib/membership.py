@@ -0,0 +1,96 @@
+# Copyright (c) 2013 by Gilbert Ramirez <gram@alumni.rice.edu>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+import os
+import tempfile
+
+from dftestlib import dftest
+
+class testMembership(dftest.DFTest):
+    trace_file = "nfs.pcap"
+
+    def setFile(self, lines):
+        (fd, filename) = tempfile.mkstemp(suffix=".txt")
+        os.write(fd, "\n".join(lines) + "\n")
+        os.close(fd)
+        self.files_to_remove.append(filename)
+        return filename
+
+    def test_in_1(self):
+        dfilter = "ip.src in {172.25.100.14}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_in_2(self):
+        dfilter = "ip.src in {10.1.1.1, 172.25.100.14, 10.1.1.2}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_in_3(self):
+        dfilter = "ip.src in {10.1.1.1, 10.1.1.2}"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_in_4(self):
+        dfilter = "ip.addr in {172.25.100.14, 198.95.230.20}"
+        self.assertDFilterCount(dfilter, 2)
+
+    def test_in_cidr_1(self):
+        dfilter = "ip.src in {10.0.0.0/8, 172.25.0.0/16}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_in_cidr_2(self):
+        dfilter = "ip.src in {10.0.0.0/8, 172.26.0.0/16}"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_in_slice_1(self):
+        dfilter = "ip[12] in {0x0a, 0xac}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_in_not_1(self):
+        dfilter = "!(ip.src in {172.25.100.14})"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_in_file_1(self):
+        filename = self.setFile(["# blocklist", "10.1.1.1", "", "172.25.100.14"])
+        dfilter = 'ip.src in {@"%s"}' % (filename,)
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_in_file_2(self):
+        filename = self.setFile(["10.1.1.1", "10.1.1.2"])
+        dfilter = 'ip.src in {198.95.230.20, @"%s"}' % (filename,)
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_in_file_long_1(self):
+        # Lines longer than the set file reader's buffer
+        filename = self.setFile(["# " + "x" * 5000, " " * 3000 + "172.25.100.14"])
+        dfilter = 'ip.src in {@"%s"}' % (filename,)
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_in_file_long_2(self):
+        filename = self.setFile(["10.1.1.1 " + "x" * 5000])
+        dfilter = 'ip.src in {@"%s"}' % (filename,)
+        self.assertDFilterFail(dfilter)
+
+    def test_in_file_3(self):
+        dfilter = 'ip.src in {@"%s"}' % ("no-such-file.txt",)
+        self.assertDFilterFail(dfilter)
+
+    def test_in_bad_1(self):
+        dfilter = "ip.src in {172.25.100.14, not-an-address}"
+        self.assertDFilterFail(dfilter)
+
+    def test_in_bad_2(self):
+        dfilter = '"abc" in {"abc"}'
+        self.assertDFilterFail(dfilter)
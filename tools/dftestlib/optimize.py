@@ -0,0 +1,135 @@
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+# Each filter here is one the optimizer (epan/dfilter/optimize.c)
+# rewrites; it must match the same packets with the optimizer turned
+# off by WIRESHARK_DFILTER_NO_OPTIMIZE.
+
+from dftestlib import dftest
+
+class testOptimize(dftest.DFTest):
+    trace_file = "nfs.pcap"
+
+    # Duplicate tests
+
+    def test_dup_and_1(self):
+        dfilter = "ip.src == 172.25.100.14 && ip.src == 172.25.100.14"
+        self.assertDFilterOptimized(dfilter, 1)
+        self.assertOptimization(dfilter, "1 duplicate test removed")
+
+    def test_dup_or_1(self):
+        dfilter = "ip.src == 172.25.100.14 || nfs || ip.src == 172.25.100.14"
+        self.assertDFilterOptimized(dfilter, 2)
+        self.assertOptimization(dfilter, "1 duplicate test removed")
+
+    def test_dup_netmask_1(self):
+        # Same address, different netmasks: not duplicates
+        dfilter = "ip.src == 172.25.100.0/24 && ip.src == 172.25.100.0/32"
+        self.assertDFilterOptimized(dfilter, 0)
+
+    def test_dup_netmask_2(self):
+        dfilter = "ip.src == 172.25.100.0/24 && ip.src == 172.25.100.0/24"
+        self.assertDFilterOptimized(dfilter, 1)
+        self.assertOptimization(dfilter, "1 duplicate test removed")
+
+    def test_dup_slice_1(self):
+        # Slices are never treated as duplicates, but must still work
+        dfilter = "ip[12] == 0xac && ip[12] == 0xac"
+        self.assertDFilterOptimized(dfilter, 1)
+
+    def test_dup_negation_1(self):
+        dfilter = "not not ip.src == 172.25.100.14"
+        self.assertDFilterOptimized(dfilter, 1)
+        self.assertOptimization(dfilter, "1 double negation removed")
+
+    # "||" chains lowered to set tests
+
+    def test_in_lower_1(self):
+        dfilter = "ip.src == 10.1.1.1 || ip.src == 172.25.100.14 || ip.src == 10.1.1.2"
+        self.assertDFilterOptimized(dfilter, 1)
+        self.assertOptimization(dfilter, "3 tests merged into 1 set test")
+
+    def test_in_lower_2(self):
+        dfilter = "ip.src in {10.1.1.1, 10.1.1.2} || ip.src == 198.95.230.20"
+        self.assertDFilterOptimized(dfilter, 1)
+        self.assertOptimization(dfilter, "set test")
+
+    def test_in_lower_3(self):
+        dfilter = "ip.src == 10.1.1.1 || ip.src == 10.1.1.2"
+        self.assertDFilterOptimized(dfilter, 0)
+
+    def test_in_lower_fields_1(self):
+        # Tests of different fields aren't merged
+        dfilter = "ip.src == 10.1.1.1 || ip.dst == 172.25.100.14"
+        self.assertDFilterOptimized(dfilter, 1)
+
+    def test_in_lower_netmask_1(self):
+        dfilter = "ip.src == 10.0.0.0/8 || ip.src == 172.25.0.0/16"
+        self.assertDFilterOptimized(dfilter, 1)
+        self.assertOptimization(dfilter, "2 tests merged into 1 set test")
+
+    def test_in_lower_netmask_2(self):
+        dfilter = "ip.src == 172.25.100.0/24 || ip.src == 198.95.0.0/16"
+        self.assertDFilterOptimized(dfilter, 2)
+
+    def test_in_lower_netmask_3(self):
+        dfilter = "ip.src == 172.25.100.0/32 || ip.src == 198.95.230.0/32"
+        self.assertDFilterOptimized(dfilter, 0)
+
+    def test_in_lower_slice_1(self):
+        # Slices aren't lowered, but a chain with them must still work
+        dfilter = "ip[12] == 0xac || ip[12] == 0xc6 || ip.src == 10.1.1.1"
+        self.assertDFilterOptimized(dfilter, 2)
+
+    def test_in_lower_slice_2(self):
+        dfilter = "ip[12:2] == ac:19 || ip.src == 10.1.1.1 || ip.src == 10.1.1.2"
+        self.assertDFilterOptimized(dfilter, 1)
+
+    # Tests reordered by cost
+
+    def test_reorder_1(self):
+        dfilter = "ip.src == 172.25.100.14 && nfs"
+        self.assertDFilterOptimized(dfilter, 1)
+        self.assertOptimization(dfilter, "reordered by cost")
+
+    def test_reorder_2(self):
+        dfilter = "ip[12] == 0xc6 && ip.dst == 172.25.100.14 && ip"
+        self.assertDFilterOptimized(dfilter, 1)
+        self.assertOptimization(dfilter, "reordered by cost")
+
+    def test_reorder_3(self):
+        dfilter = "ip.src == 172.25.100.0/24 || ip"
+        self.assertDFilterOptimized(dfilter, 2)
+
+    def test_reorder_4(self):
+        dfilter = "(ip.src == 10.1.1.1 || ip.dst == 198.95.230.20) && not ip.src == 198.95.230.20 && nfs"
+        self.assertDFilterOptimized(dfilter, 1)
+
+
+class testOptimizeSearch(dftest.DFTest):
+    trace_file = "http.pcap"
+
+    def test_contains_lower_1(self):
+        dfilter = 'http.request.method contains "ZZ" || http.request.method contains "EA"'
+        self.assertDFilterOptimized(dfilter, 1)
+        self.assertOptimization(dfilter, "multiple-string search")
+
+    def test_contains_lower_2(self):
+        dfilter = 'http.request.method contains "ZZ" || http.request.method contains "YY"'
+        self.assertDFilterOptimized(dfilter, 0)
+
+    def test_reorder_matches_1(self):
+        dfilter = 'http.request.method matches "^HE" && http'
+        self.assertDFilterOptimized(dfilter, 1)
+        self.assertOptimization(dfilter, "reordered by cost")
@@ -140,6 +140,18 @@ class testString(dftest.DFTest):
         dfilter = 'http.request.method contains 48:45:41:44' # "HEAD"
         self.assertDFilterCount(dfilter, 1)
 
+    def test_contains_any_1(self):
+        dfilter = 'http.request.method contains "POST" || http.request.method contains "EA"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_contains_any_2(self):
+        dfilter = 'http.request.method contains "POST" || http.request.method contains "GET" || http.request.method contains "PUT"'
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_contains_any_3(self):
+        dfilter = 'http.request.method contains "POST" || http.request.method contains 48:45:41:44'
+        self.assertDFilterCount(dfilter, 1)
+
     def test_contains_fail_0(self):
         dfilter = 'http.user_agent contains "update"'
         self.assertDFilterCount(dfilter, 0)
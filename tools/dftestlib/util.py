@@ -15,19 +15,26 @@
 # Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
 
+import os
 import subprocess
 
 SUCCESS = 0
-def exec_cmdv(cmdv, cwd=None, stdin=None):
+def exec_cmdv(cmdv, cwd=None, stdin=None, env=None):
     """Run the commands in cmdv, returning (retval, output),
     where output is stdout and stderr combined.
     If cwd is given, the child process runs in that directory.
     If a filehandle is passed as stdin, it is used as stdin.
+    If env is given, its variables are added to the child's environment.
     If there is an OS-level error, None is the retval."""
 
+    child_env = None
+    if env:
+        child_env = os.environ.copy()
+        child_env.update(env)
+
     try:
         output = subprocess.check_output(cmdv, stderr=subprocess.STDOUT,
-                cwd=cwd, stdin=stdin)
+                cwd=cwd, stdin=stdin, env=child_env)
         retval = SUCCESS
 
     # If file isn't executable
@@ -0,0 +1,106 @@
+#!/bin/bash
+
+# Measure Mergecap's throughput when merging a capture file that's been
+# split into many files, as with the files of a ring buffer, for a set of
+# input file counts and --read-ahead depths, and check that read-ahead
+# doesn't change the output.
+#
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 1998 Gerald Combs
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+TEST_TYPE="bench"
+. `dirname $0`/test-common.sh || exit 1
+
+# Numbers of input files to split each capture file into.
+COUNTS="10 100 1000"
+# Read-ahead depths to try; 0 means "read as we merge".
+DEPTHS="0 64"
+# Extra Mergecap arguments, e.g. "-F pcap".
+MERGECAP_ARGS=""
+
+while getopts ":b:n:d:a:" OPTCHAR ; do
+    case $OPTCHAR in
+        b) BIN_DIR=$OPTARG ;;
+        n) COUNTS=$OPTARG ;;
+        d) DEPTHS=$OPTARG ;;
+        a) MERGECAP_ARGS=$OPTARG ;;
+    esac
+done
+shift $(($OPTIND - 1))
+
+if [ $# -lt 1 ]
+then
+	printf "Usage: $(basename $0) [-b bin_dir] [-n \"count ...\"] [-d \"depth ...\"] [-a \"mergecap args\"] /path/to/file[s].pcap\n"
+	exit 1
+fi
+
+ws_bind_exec_paths
+ws_check_exec "$MERGECAP" "$EDITCAP" "$CAPINFOS"
+
+# Every input file is open at once.
+ulimit -n 4096 2> /dev/null
+
+SPLIT_DIR=$TMP_DIR/$BASE_NAME-split
+REF_OUT=$TMP_DIR/$BASE_NAME-ref.pcapng
+RUN_OUT=$TMP_DIR/$BASE_NAME-run.pcapng
+TIMEFORMAT=%R
+
+for file in "$@"
+do
+	FRAMES=`$CAPINFOS -c -M "$file" | awk '/^Number of packets/ { print $NF }'`
+	echo "$file: $FRAMES frames"
+
+	for count in $COUNTS
+	do
+		PER_FILE=$(( ($FRAMES + $count - 1) / $count ))
+		if [ $PER_FILE -lt 1 ]
+		then
+			PER_FILE=1
+		fi
+		rm -rf $SPLIT_DIR
+		mkdir -p $SPLIT_DIR
+		$EDITCAP -c $PER_FILE "$file" $SPLIT_DIR/part.pcapng || exit 1
+		N_FILES=`ls $SPLIT_DIR | wc -l`
+
+		for depth in $DEPTHS
+		do
+			if [ $depth -eq 0 ]
+			then
+				RA_ARGS=""
+			else
+				RA_ARGS="--read-ahead $depth"
+			fi
+			SECS=`{ time $MERGECAP $MERGECAP_ARGS $RA_ARGS -w $RUN_OUT $SPLIT_DIR/* ; } 2>&1`
+
+			if [ ! -f $REF_OUT ]
+			then
+				mv $RUN_OUT $REF_OUT
+				RESULT="reference"
+			elif cmp -s $REF_OUT $RUN_OUT
+			then
+				RESULT="output matches"
+			else
+				RESULT="OUTPUT DIFFERS"
+			fi
+			awk -v frames=$FRAMES -v secs=$SECS -v files=$N_FILES -v depth=$depth -v result="$RESULT" \
+				'BEGIN { printf " - %5d files, read-ahead %5d: %8.3f s, %10.0f frames/s (%s)\n", files, depth, secs, secs > 0 ? frames / secs : 0, result }'
+		done
+		rm -f $REF_OUT $RUN_OUT
+	done
+	rm -rf $SPLIT_DIR
+done
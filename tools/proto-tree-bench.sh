@@ -0,0 +1,120 @@
+#!/bin/bash
+
+# Measure the cost of building protocol trees: time TShark over capture
+# files in modes that build an invisible tree (-Y), a visible tree that
+# is only filtered (-T fields), and a visible tree that is printed with
+# all of its labels (-V and -T pdml).  Give a second build's directory
+# with -c to compare the two, and to check that their -V output is the
+# same.  With no files, it runs over test/captures.
+#
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 1998 Gerald Combs
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+TEST_TYPE="bench"
+. `dirname $0`/test-common.sh || exit 1
+
+# Directory of the build to compare against (-c).
+COMPARE_DIR=
+# Number of times to run TShark for each mode; the fastest run counts.
+RUNS=3
+
+while getopts ":b:c:r:" OPTCHAR ; do
+    case $OPTCHAR in
+        b) BIN_DIR=$OPTARG ;;
+        c) COMPARE_DIR=$OPTARG ;;
+        r) RUNS=$OPTARG ;;
+        *)
+            printf "Usage: $(basename $0) [-b bin_dir] [-c compare_bin_dir] [-r runs] [/path/to/file[s].pcap]\n"
+            exit 1
+            ;;
+    esac
+done
+shift $(($OPTIND - 1))
+
+if [ $# -lt 1 ]
+then
+	set -- `dirname $0`/../test/captures/*.pcap*
+fi
+
+ws_bind_exec_paths
+ws_check_exec "$TSHARK" "$CAPINFOS"
+
+COMPARE_TSHARK=
+if [ -n "$COMPARE_DIR" ]
+then
+	COMPARE_TSHARK="$COMPARE_DIR/tshark"
+	ws_check_exec "$COMPARE_TSHARK"
+fi
+
+# The modes to time, one set of TShark arguments per line.
+MODES="-Y frame
+-T fields -e frame.number -Y frame
+-V
+-T pdml"
+
+REF_OUT=$TMP_DIR/$BASE_NAME-ref.txt
+RUN_OUT=$TMP_DIR/$BASE_NAME-run.txt
+TIMEFORMAT=%R
+
+# Run a TShark RUNS times over a file, with the given arguments, and
+# print the shortest time it took.
+function best_time() {
+	local tshark=$1
+	local best=""
+	local secs
+	shift
+	for i in `seq $RUNS`
+	do
+		secs=`{ time $tshark -n -r "$@" > /dev/null ; } 2>&1`
+		best=`awk -v a="$best" -v b=$secs 'BEGIN { print (a == "" || b < a) ? b : a }'`
+	done
+	echo $best
+}
+
+for file in "$@"
+do
+	FRAMES=`$CAPINFOS -c -M "$file" | awk '/^Number of packets/ { print $NF }'`
+	echo "$file: $FRAMES frames"
+
+	echo "$MODES" | while read -r mode
+	do
+		SECS=`best_time "$TSHARK" "$file" $mode`
+		if [ -z "$COMPARE_TSHARK" ]
+		then
+			awk -v frames=$FRAMES -v secs=$SECS -v mode="$mode" \
+				'BEGIN { printf " - %-36s %8.3f s, %8.0f ns/frame\n", mode, secs, frames > 0 ? secs * 1e9 / frames : 0 }'
+			continue
+		fi
+		COMPARE_SECS=`best_time "$COMPARE_TSHARK" "$file" $mode`
+		awk -v frames=$FRAMES -v secs=$SECS -v cmp=$COMPARE_SECS -v mode="$mode" \
+			'BEGIN { printf " - %-36s %8.3f s, %8.0f ns/frame; compared build %8.3f s (%+.1f%%)\n", mode, secs, frames > 0 ? secs * 1e9 / frames : 0, cmp, cmp > 0 ? (secs - cmp) * 100 / cmp : 0 }'
+	done
+
+	if [ -n "$COMPARE_TSHARK" ]
+	then
+		$TSHARK -n -V -r "$file" > $RUN_OUT 2>&1
+		$COMPARE_TSHARK -n -V -r "$file" > $REF_OUT 2>&1
+		if cmp -s $REF_OUT $RUN_OUT
+		then
+			echo " - -V output matches the compared build"
+		else
+			echo " - -V OUTPUT DIFFERS from the compared build"
+		fi
+		rm -f $REF_OUT $RUN_OUT
+	fi
+done
@@ -66,6 +66,8 @@ function ws_bind_exec_paths() {
 # Tweak the following to your liking.  Editcap must support "-E".
 TSHARK="$BIN_DIR/tshark"
 EDITCAP="$BIN_DIR/editcap"
+MERGECAP="$BIN_DIR/mergecap"
+DFTEST="$BIN_DIR/dftest"
 CAPINFOS="$BIN_DIR/capinfos"
 RANDPKT="$BIN_DIR/randpkt"
 
@@ -0,0 +1,90 @@
+#!/bin/bash
+
+# Measure how TShark's single-pass read throughput scales with the
+# --read-ahead depth, and check that read-ahead doesn't change the output.
+#
+# --read-ahead only moves reading and decompressing records onto a
+# separate thread; dissection still runs on one thread, in file order.
+# The numbers below therefore measure how much I/O overlaps with
+# dissection, not parallel dissection.
+#
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 1998 Gerald Combs
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+TEST_TYPE="bench"
+. `dirname $0`/test-common.sh || exit 1
+
+# Read-ahead depths to try; 0 means "read on the dissection thread".
+DEPTHS="0 16 256 4096"
+# Extra TShark arguments, e.g. "-Y tcp" or "-T fields -e ip.src".
+TSHARK_ARGS="-n"
+
+while getopts ":b:d:a:" OPTCHAR ; do
+    case $OPTCHAR in
+        b) BIN_DIR=$OPTARG ;;
+        d) DEPTHS=$OPTARG ;;
+        a) TSHARK_ARGS=$OPTARG ;;
+    esac
+done
+shift $(($OPTIND - 1))
+
+if [ $# -lt 1 ]
+then
+	printf "Usage: $(basename $0) [-b bin_dir] [-d \"depth ...\"] [-a \"tshark args\"] /path/to/file[s].pcap\n"
+	exit 1
+fi
+
+ws_bind_exec_paths
+ws_check_exec "$TSHARK" "$CAPINFOS"
+
+REF_OUT=$TMP_DIR/$BASE_NAME-ref.txt
+RUN_OUT=$TMP_DIR/$BASE_NAME-run.txt
+TIMEFORMAT=%R
+
+for file in "$@"
+do
+	FRAMES=`$CAPINFOS -c -M "$file" | awk '/^Number of packets/ { print $NF }'`
+	echo "$file: $FRAMES frames (I/O overlap only; dissection is single-threaded)"
+
+	for depth in $DEPTHS
+	do
+		if [ $depth -eq 0 ]
+		then
+			RA_ARGS=""
+		else
+			RA_ARGS="--read-ahead $depth"
+		fi
+		# Only the output of "time" may end up in SECS; TShark's own
+		# warnings would make it unreadable.
+		SECS=`{ time $TSHARK $TSHARK_ARGS $RA_ARGS -r "$file" > $RUN_OUT 2> /dev/null ; } 2>&1`
+
+		if [ ! -f $REF_OUT ]
+		then
+			mv $RUN_OUT $REF_OUT
+			RESULT="reference"
+		elif cmp -s $REF_OUT $RUN_OUT
+		then
+			RESULT="output matches"
+		else
+			RESULT="OUTPUT DIFFERS"
+		fi
+		awk -v frames=$FRAMES -v secs=$SECS -v depth=$depth -v result="$RESULT" \
+			'BEGIN { printf " - read-ahead %5d (I/O overlap): %8.3f s, %10.0f frames/s (%s)\n", depth, secs, secs > 0 ? frames / secs : 0, result }'
+	done
+	rm -f $REF_OUT $RUN_OUT
+done
@@ -80,6 +80,8 @@
 #include <wsutil/ws_diag_control.h>
 #include <wsutil/ws_version_info.h>
 
+#include <wiretap/wtap_index.h>
+
 #include "globals.h"
 #include <epan/timestamp.h>
 #include <epan/packet.h>
@@ -98,12 +100,15 @@
 #endif
 #include "ui/util.h"
 #include "ui/ui_util.h"
+#include "ui/flow_shard.h"
 #include "ui/cli/tshark-tap.h"
 #include "register.h"
 #include <epan/epan_dissect.h>
 #include <epan/tap.h>
 #include <epan/stat_tap_ui.h>
 #include <epan/conversation_table.h>
+#include <epan/conversation.h>
+#include <epan/reassemble.h>
 #include <epan/ex-opt.h>
 
 #if defined(HAVE_HEIMDAL_KERBEROS) || defined(HAVE_MIT_KERBEROS)
@@ -138,6 +143,12 @@
  */
 static const gchar decode_as_arg_template[] = "<layer_type>==<selector>,<decode_as_protocol>";
 
+/* Long-only options; see the comment in capture_opts.h */
+#define LONGOPT_READ_AHEAD (MIN_NON_CAPTURE_LONGOPT+0)
+#define LONGOPT_FLOW_SHARD (MIN_NON_CAPTURE_LONGOPT+1)
+#define LONGOPT_WRITE_INDEX (MIN_NON_CAPTURE_LONGOPT+2)
+#define LONGOPT_EXPIRE_IDLE (MIN_NON_CAPTURE_LONGOPT+3)
+
 static guint32 cum_bytes;
 static const frame_data *ref;
 static frame_data ref_frame;
@@ -149,6 +160,11 @@ static frame_data prev_cap_frame;
 static const char* prev_display_dissector_name = NULL;
 
 static gboolean perform_two_pass_analysis;
+static guint read_ahead_depth; /* 0 if we're not reading ahead on a separate thread */
+static guint flow_shard;       /* shard of the file we're to dissect... */
+static guint flow_shard_count; /* ...out of this many; 0 if we're dissecting all of it */
+static gboolean write_index;   /* write a packet index for the file we read */
+static guint expire_idle_secs; /* 0 if we're keeping conversation state until the end */
 
 /*
  * The way the packet decode is to be written.
@@ -162,6 +178,7 @@ typedef enum {
 
 static output_action_e output_action;
 static gboolean do_dissection;     /* TRUE if we have to dissect each packet */
+static gboolean prune_dissection;  /* TRUE if the second pass only dissects what leads to the wanted fields */
 static gboolean print_packet_info; /* TRUE if we're to print packet information */
 static gint print_summary = -1;    /* TRUE if we're to print packet summary information */
 static gboolean print_details;     /* TRUE if we're to print packet details information */
@@ -349,6 +366,14 @@ print_usage(FILE *output)
   fprintf(output, "                           Example: tcp.port==8888,http\n");
   fprintf(output, "  -H <hosts file>          read a list of entries from a hosts file, which will\n");
   fprintf(output, "                           then be written to a capture file. (Implies -W n)\n");
+  fprintf(output, "  --read-ahead <records>   read up to this many records ahead of dissection on\n");
+  fprintf(output, "                           a separate thread (single-pass file reads only)\n");
+  fprintf(output, "  --flow-shard <shard>/<count>\n");
+  fprintf(output, "                           only dissect packets whose IP address pair hashes to\n");
+  fprintf(output, "                           shard <shard> (0-based) of <count>\n");
+  fprintf(output, "  --write-index            write a packet index next to the file being read\n");
+  fprintf(output, "  --expire-idle <seconds>  free conversation and reassembly state that's been\n");
+  fprintf(output, "                           idle this long (single-pass only)\n");
 
   /*fprintf(output, "\n");*/
   fprintf(output, "Output:\n");
@@ -942,6 +967,26 @@ get_tshark_runtime_version_info(GString *str)
     epan_get_runtime_version_info(str);
 }
 
+static void
+report_state_expiry(void)
+{
+  conversation_expiry_stats_t conv_stats;
+  reassembly_expiry_stats_t reas_stats;
+
+  conversation_get_expiry_stats(&conv_stats);
+  reassembly_get_expiry_stats(&reas_stats);
+  fprintf(stderr, "Idle state expired: %" G_GINT64_MODIFIER "u conversation%s, "
+          "%" G_GINT64_MODIFIER "u unfinished and %" G_GINT64_MODIFIER "u finished reassembl%s\n",
+          conv_stats.expired, plurality(conv_stats.expired, "", "s"),
+          reas_stats.expired_fragmented, reas_stats.expired_reassembled,
+          plurality(reas_stats.expired_reassembled, "y", "ies"));
+  fprintf(stderr, "State retained: %u conversation%s, %u unfinished reassembl%s, "
+          "%u frame%s of finished reassemblies\n",
+          conv_stats.retained, plurality(conv_stats.retained, "", "s"),
+          reas_stats.retained_fragmented, plurality(reas_stats.retained_fragmented, "y", "ies"),
+          reas_stats.retained_reassembled, plurality(reas_stats.retained_reassembled, "", "s"));
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -953,6 +998,10 @@ DIAG_OFF(cast-qual)
   static const struct option long_options[] = {
     {(char *)"help", no_argument, NULL, 'h'},
     {(char *)"version", no_argument, NULL, 'v'},
+    {(char *)"read-ahead", required_argument, NULL, LONGOPT_READ_AHEAD},
+    {(char *)"flow-shard", required_argument, NULL, LONGOPT_FLOW_SHARD},
+    {(char *)"write-index", no_argument, NULL, LONGOPT_WRITE_INDEX},
+    {(char *)"expire-idle", required_argument, NULL, LONGOPT_EXPIRE_IDLE},
     LONGOPT_CAPTURE_COMMON
     {0, 0, 0, 0 }
   };
@@ -1361,6 +1410,22 @@ DIAG_ON(cast-qual)
     case '2':        /* Perform two pass analysis */
       perform_two_pass_analysis = TRUE;
       break;
+    case LONGOPT_READ_AHEAD: /* Read records ahead on a separate thread */
+      read_ahead_depth = get_positive_int(optarg, "read-ahead depth");
+      break;
+    case LONGOPT_FLOW_SHARD: /* Only dissect one shard of the flows */
+      if (!flow_shard_parse(optarg, &flow_shard, &flow_shard_count)) {
+        cmdarg_err("Invalid flow shard \"%s\"; it must be <shard>/<count>, with <shard> less than <count>.",
+                   optarg);
+        return 1;
+      }
+      break;
+    case LONGOPT_WRITE_INDEX: /* Write a packet index for the file */
+      write_index = TRUE;
+      break;
+    case LONGOPT_EXPIRE_IDLE: /* Free idle conversation state */
+      expire_idle_secs = get_positive_int(optarg, "idle time");
+      break;
     case 'a':        /* autostop criteria */
     case 'b':        /* Ringbuffer option */
     case 'c':        /* Capture x packets */
@@ -1819,6 +1884,29 @@ DIAG_ON(cast-qual)
     return 1;
   }
 
+  if (read_ahead_depth != 0 && perform_two_pass_analysis) {
+    /* The second pass seeks in the file, and frame tvbuffs may read
+       from it while we're dissecting; keep all reads on one thread. */
+    cmdarg_err("--read-ahead can't be used with -2.");
+    return 1;
+  }
+
+  if (flow_shard_count != 0 && perform_two_pass_analysis) {
+    cmdarg_err("--flow-shard can't be used with -2.");
+    return 1;
+  }
+
+  if (write_index && perform_two_pass_analysis) {
+    cmdarg_err("--write-index can't be used with -2.");
+    return 1;
+  }
+
+  if (expire_idle_secs != 0 && perform_two_pass_analysis) {
+    /* The second pass needs the state of every frame of the first. */
+    cmdarg_err("--expire-idle can't be used with -2.");
+    return 1;
+  }
+
 #ifdef HAVE_LIBPCAP
   if (list_link_layer_types) {
     /* We're supposed to list the link-layer types for an interface;
@@ -2254,6 +2342,9 @@ DIAG_ON(cast-qual)
     cfile.frames = NULL;
   }
 
+  if (expire_idle_secs != 0 && !really_quiet)
+    report_state_expiry();
+
   draw_tap_listeners(TRUE);
   funnel_dump_all_text_windows();
   epan_free(cfile.epan);
@@ -2399,6 +2490,315 @@ tshark_get_frame_ts(void *data, guint32 frame_num)
   return NULL;
 }
 
+/*
+ * Read-ahead for single-pass reading of a capture file.
+ *
+ * With --read-ahead, a separate thread calls wtap_read() and hands copies
+ * of the records it reads to the main thread, so that reading and
+ * decompressing the file overlaps with dissection and output.  At most
+ * "depth" records are in flight at any time; they cycle between a queue
+ * of free records and a queue of records waiting to be dissected.
+ *
+ * Dissection, taps and printing still happen one record at a time, in
+ * file order, on the main thread, so conversation, reassembly and
+ * analysis state is built exactly as it is without read-ahead, and the
+ * output is the same.  Name resolution records that Wiretap reports while
+ * reading are attached to the record that follows them and are added on
+ * the main thread, just before that record is dissected.
+ */
+typedef struct {
+  gboolean           is_ipv6;
+  guint              addr;
+  struct e_in6_addr  addr6;
+  gchar             *name;
+} read_ahead_name;
+
+typedef struct {
+  struct wtap_pkthdr phdr;
+  Buffer             buf;
+  gint64             data_offset;
+  GSList            *names;     /* read_ahead_name entries, in file order */
+} read_ahead_rec;
+
+typedef struct {
+  wtap           *wth;
+  GThread        *thread;
+  GMutex         *wth_mtx;      /* held while the reader thread is in wtap_read() */
+  GAsyncQueue    *free_q;       /* records the reader thread can fill */
+  GAsyncQueue    *full_q;       /* records waiting to be dissected */
+  read_ahead_rec *recs;
+  guint           n_recs;
+  read_ahead_rec  end_rec;      /* pushed by the reader thread at EOF or on error */
+  read_ahead_rec *cur_rec;      /* record being dissected by the main thread */
+  volatile gint   stop;
+  int             err;
+  gchar          *err_info;
+  GPtrArray      *if_names;     /* main thread's cache of interface names */
+} read_ahead_t;
+
+static read_ahead_t *read_ahead;
+
+/* Only the reader thread calls these, from within wtap_read(). */
+static GSList *read_ahead_pending_names;
+
+static void
+read_ahead_add_ipv4_name(const guint addr, const gchar *name)
+{
+  read_ahead_name *rn = g_new0(read_ahead_name, 1);
+
+  rn->addr = addr;
+  rn->name = g_strdup(name);
+  read_ahead_pending_names = g_slist_prepend(read_ahead_pending_names, rn);
+}
+
+static void
+read_ahead_add_ipv6_name(const void *addrp, const gchar *name)
+{
+  read_ahead_name *rn = g_new0(read_ahead_name, 1);
+
+  rn->is_ipv6 = TRUE;
+  memcpy(&rn->addr6, addrp, sizeof rn->addr6);
+  rn->name = g_strdup(name);
+  read_ahead_pending_names = g_slist_prepend(read_ahead_pending_names, rn);
+}
+
+static void
+read_ahead_free_names(GSList *names)
+{
+  GSList *l;
+
+  for (l = names; l != NULL; l = g_slist_next(l)) {
+    read_ahead_name *rn = (read_ahead_name *) l->data;
+
+    g_free(rn->name);
+    g_free(rn);
+  }
+  g_slist_free(names);
+}
+
+static void
+read_ahead_rec_fill(read_ahead_rec *rec, wtap *wth, gint64 data_offset)
+{
+  struct wtap_pkthdr *phdr = wtap_phdr(wth);
+  Buffer              ft_specific_data = rec->phdr.ft_specific_data;
+
+  g_free(rec->phdr.opt_comment);
+  rec->phdr = *phdr;
+  rec->phdr.opt_comment = g_strdup(phdr->opt_comment);
+  rec->phdr.ft_specific_data = ft_specific_data;
+  ws_buffer_clean(&rec->phdr.ft_specific_data);
+  ws_buffer_append_buffer(&rec->phdr.ft_specific_data, &phdr->ft_specific_data);
+
+  ws_buffer_clean(&rec->buf);
+  ws_buffer_append(&rec->buf, wtap_buf_ptr(wth), phdr->caplen);
+  rec->data_offset = data_offset;
+
+  rec->names = g_slist_reverse(read_ahead_pending_names);
+  read_ahead_pending_names = NULL;
+}
+
+static gpointer
+read_ahead_thread(gpointer data)
+{
+  read_ahead_t   *ra = (read_ahead_t *) data;
+  read_ahead_rec *rec;
+  gint64          data_offset;
+  gboolean        ok;
+
+  for (;;) {
+    rec = (read_ahead_rec *) g_async_queue_pop(ra->free_q);
+    if (g_atomic_int_get(&ra->stop))
+      break;
+
+    g_mutex_lock(ra->wth_mtx);
+    ok = wtap_read(ra->wth, &ra->err, &ra->err_info, &data_offset);
+    if (ok)
+      read_ahead_rec_fill(rec, ra->wth, data_offset);
+    g_mutex_unlock(ra->wth_mtx);
+
+    if (!ok) {
+      /* EOF or error; ra->err and ra->err_info say which. */
+      g_async_queue_push(ra->full_q, &ra->end_rec);
+      break;
+    }
+    g_async_queue_push(ra->full_q, rec);
+  }
+  return NULL;
+}
+
+static read_ahead_t *
+read_ahead_start(wtap *wth, guint depth)
+{
+  read_ahead_t *ra = g_new0(read_ahead_t, 1);
+  guint         i;
+
+#if !GLIB_CHECK_VERSION(2,31,0)
+  if (!g_thread_supported())
+    g_thread_init(NULL);
+#endif
+
+  ra->wth = wth;
+#if GLIB_CHECK_VERSION(2,31,0)
+  ra->wth_mtx = g_new(GMutex, 1);
+  g_mutex_init(ra->wth_mtx);
+#else
+  ra->wth_mtx = g_mutex_new();
+#endif
+  ra->free_q = g_async_queue_new();
+  ra->full_q = g_async_queue_new();
+  ra->if_names = g_ptr_array_new();
+
+  ra->n_recs = depth;
+  ra->recs = g_new0(read_ahead_rec, depth);
+  for (i = 0; i < depth; i++) {
+    wtap_phdr_init(&ra->recs[i].phdr);
+    ws_buffer_init(&ra->recs[i].buf, 1500);
+    g_async_queue_push(ra->free_q, &ra->recs[i]);
+  }
+
+  wtap_set_cb_new_ipv4(wth, read_ahead_add_ipv4_name);
+  wtap_set_cb_new_ipv6(wth, read_ahead_add_ipv6_name);
+
+#if GLIB_CHECK_VERSION(2,31,0)
+  ra->thread = g_thread_new("Read ahead", read_ahead_thread, ra);
+#else
+  ra->thread = g_thread_create(read_ahead_thread, ra, TRUE, NULL);
+#endif
+  return ra;
+}
+
+/*
+ * Get the next record read by the reader thread; the record handed out by
+ * the previous call is given back to the reader thread.  Returns FALSE at
+ * EOF or on a read error, with *err and *err_info set as by wtap_read().
+ */
+static gboolean
+read_ahead_next(read_ahead_t *ra, int *err, gchar **err_info,
+                gint64 *data_offset, struct wtap_pkthdr **phdr, guint8 **pd)
+{
+  read_ahead_rec *rec;
+  GSList         *l;
+
+  if (ra->cur_rec != NULL) {
+    g_async_queue_push(ra->free_q, ra->cur_rec);
+    ra->cur_rec = NULL;
+  }
+
+  rec = (read_ahead_rec *) g_async_queue_pop(ra->full_q);
+  if (rec == &ra->end_rec) {
+    /* Leave it there, in case we're called again. */
+    g_async_queue_push(ra->full_q, rec);
+    *err = ra->err;
+    *err_info = ra->err_info;
+    ra->err_info = NULL;
+    return FALSE;
+  }
+
+  for (l = rec->names; l != NULL; l = g_slist_next(l)) {
+    read_ahead_name *rn = (read_ahead_name *) l->data;
+
+    if (rn->is_ipv6)
+      add_ipv6_name(&rn->addr6, rn->name);
+    else
+      add_ipv4_name(rn->addr, rn->name);
+  }
+  read_ahead_free_names(rec->names);
+  rec->names = NULL;
+
+  ra->cur_rec = rec;
+  *data_offset = rec->data_offset;
+  *phdr = &rec->phdr;
+  *pd = ws_buffer_start_ptr(&rec->buf);
+  return TRUE;
+}
+
+static void
+read_ahead_stop(read_ahead_t *ra)
+{
+  read_ahead_rec *rec;
+  guint           i;
+
+  /* Wake the reader thread if it's waiting for a free record. */
+  g_atomic_int_set(&ra->stop, 1);
+  g_async_queue_push(ra->free_q, ra->cur_rec != NULL ? ra->cur_rec : &ra->end_rec);
+  g_thread_join(ra->thread);
+
+  while ((rec = (read_ahead_rec *) g_async_queue_try_pop(ra->full_q)) != NULL) {
+    if (rec != &ra->end_rec) {
+      read_ahead_free_names(rec->names);
+      rec->names = NULL;
+    }
+  }
+  read_ahead_free_names(read_ahead_pending_names);
+  read_ahead_pending_names = NULL;
+
+  wtap_set_cb_new_ipv4(ra->wth, add_ipv4_name);
+  wtap_set_cb_new_ipv6(ra->wth, (wtap_new_ipv6_callback_t) add_ipv6_name);
+
+  for (i = 0; i < ra->n_recs; i++) {
+    g_free(ra->recs[i].phdr.opt_comment);
+    wtap_phdr_cleanup(&ra->recs[i].phdr);
+    ws_buffer_free(&ra->recs[i].buf);
+  }
+  g_free(ra->recs);
+  g_free(ra->err_info);
+  g_async_queue_unref(ra->free_q);
+  g_async_queue_unref(ra->full_q);
+#if GLIB_CHECK_VERSION(2,31,0)
+  g_mutex_clear(ra->wth_mtx);
+  g_free(ra->wth_mtx);
+#else
+  g_mutex_free(ra->wth_mtx);
+#endif
+  g_ptr_array_free(ra->if_names, TRUE);
+  g_free(ra);
+}
+
+/*
+ * Read the next record, either directly or from the read-ahead thread.
+ */
+static gboolean
+tshark_read(capture_file *cf, int *err, gchar **err_info, gint64 *data_offset,
+            struct wtap_pkthdr **phdr, guint8 **pd)
+{
+  if (read_ahead != NULL)
+    return read_ahead_next(read_ahead, err, err_info, data_offset, phdr, pd);
+
+  if (!wtap_read(cf->wth, err, err_info, data_offset))
+    return FALSE;
+  *phdr = wtap_phdr(cf->wth);
+  *pd = wtap_buf_ptr(cf->wth);
+  return TRUE;
+}
+
+static const char *
+tshark_get_interface_name(void *data, guint32 interface_id)
+{
+  const char *name;
+
+  if (read_ahead == NULL)
+    return cap_file_get_interface_name(data, interface_id);
+
+  /*
+   * The reader thread adds interfaces as it finds them, so look them up
+   * under the lock.  An interface's name doesn't change once its
+   * description has been read, and the description is always read
+   * before the packets that refer to it, so cache what we get.
+   */
+  if (interface_id < read_ahead->if_names->len &&
+      g_ptr_array_index(read_ahead->if_names, interface_id) != NULL)
+    return (const char *) g_ptr_array_index(read_ahead->if_names, interface_id);
+
+  g_mutex_lock(read_ahead->wth_mtx);
+  name = cap_file_get_interface_name(data, interface_id);
+  g_mutex_unlock(read_ahead->wth_mtx);
+
+  if (interface_id >= read_ahead->if_names->len)
+    g_ptr_array_set_size(read_ahead->if_names, interface_id + 1);
+  g_ptr_array_index(read_ahead->if_names, interface_id) = (gpointer) name;
+  return name;
+}
+
 static epan_t *
 tshark_epan_new(capture_file *cf)
 {
@@ -2406,8 +2806,11 @@ tshark_epan_new(capture_file *cf)
 
   epan->data = cf;
   epan->get_frame_ts = tshark_get_frame_ts;
-  epan->get_interface_name = cap_file_get_interface_name;
+  epan->get_frame_shift_offset = NULL;
+  epan->get_interface_name = tshark_get_interface_name;
   epan->get_user_comment = NULL;
+  if (expire_idle_secs != 0)
+    epan_set_state_expiry(epan, expire_idle_secs);
 
   return epan;
 }
@@ -2665,6 +3068,17 @@ capture_input_new_file(capture_session *cap_session, gchar *new_file)
     /* Attempt to open the capture file and set up to read from it. */
     switch(cf_open((capture_file *)cap_session->cf, capture_opts->save_file, WTAP_TYPE_AUTO, is_tempfile, &err)) {
     case CF_OK:
+      /* dumpcap is still writing to the file, so we mustn't memory-map it. */
+      if (!wtap_set_tailing(cf->wth, &err)) {
+        cmdarg_err("An error occurred while reading the capture file \"%s\": %s.",
+                   capture_opts->save_file, g_strerror(err));
+        wtap_close(cf->wth);
+        cf->wth = NULL;
+        cf->state = FILE_CLOSED;
+        g_free(capture_opts->save_file);
+        capture_opts->save_file = NULL;
+        return FALSE;
+      }
       break;
     case CF_ERROR:
       /* Don't unlink (delete) the save file - leave it around,
@@ -2941,6 +3355,11 @@ process_packet_first_pass(capture_file *cf, epan_dissect_t *edt,
     if (cf->dfcode)
       epan_dissect_prime_dfilter(edt, cf->dfcode);
 
+    /* If we're pruning the second pass, this pass learns what leads to
+       the fields it will want. */
+    if (prune_dissection && print_packet_info)
+      output_fields_prime_edt(output_fields, edt);
+
     frame_data_set_before_dissect(&fdlocal, &cf->elapsed_time,
                                   &ref, prev_dis);
     if (ref == &fdlocal) {
@@ -3011,7 +3430,14 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt, frame_data *fd
     if (cf->dfcode)
       epan_dissect_prime_dfilter(edt, cf->dfcode);
 
-    col_custom_prime_edt(edt, &cf->cinfo);
+    /* If we're pruning, the columns aren't wanted, and priming the tree
+       with fields the first pass didn't learn about would stop us from
+       pruning. */
+    if (prune_dissection) {
+      if (print_packet_info)
+        output_fields_prime_edt(output_fields, edt);
+    } else
+      col_custom_prime_edt(edt, &cf->cinfo);
 
     /* We only need the columns if either
          1) some tap needs the columns
@@ -3103,7 +3529,11 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
   char         *appname = NULL;
   struct wtap_pkthdr phdr;
   Buffer       buf;
+  struct wtap_pkthdr *whdr;
+  guint8      *pd;
   epan_dissect_t *edt = NULL;
+  wtap_index  *pkt_index = NULL;
+  int          index_err;
 
   wtap_phdr_init(&phdr);
 
@@ -3201,17 +3631,30 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
     /* Allocate a frame_data_sequence for all the frames. */
     cf->frames = new_frame_data_sequence();
 
+    /* If all we want from each packet on the second pass is whether it
+       matches the display filter and the values of the fields we're
+       printing, the dissectors that can't lead to any of them needn't
+       be called; the first pass learns which those are.  Anything that
+       looks at the rest of the packet (taps, columns, the full tree,
+       the hex dump) rules that out. */
+    prune_dissection = do_dissection && !tap_listeners_require_dissection() &&
+      (!print_packet_info ||
+       (output_action == WRITE_FIELDS && !output_fields_has_cols(output_fields) &&
+        !print_hex));
+
     if (do_dissection) {
        gboolean create_proto_tree = FALSE;
 
       /* If we're going to be applying a filter, we'll need to
-         create a protocol tree against which to apply the filter. */
-      if (cf->rfcode || cf->dfcode)
+         create a protocol tree against which to apply the filter.
+         If we're pruning, we need one to learn from. */
+      if (cf->rfcode || cf->dfcode || prune_dissection)
         create_proto_tree = TRUE;
 
       /* We're not going to display the protocol tree on this pass,
          so it's not going to be "visible". */
       edt = epan_dissect_new(cf->epan, create_proto_tree, FALSE);
+      epan_dissect_prune_dissection(edt, prune_dissection);
     }
 
     while (wtap_read(cf->wth, &err, &err_info, &data_offset)) {
@@ -3259,6 +3702,7 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
          ("print_packet_info" is true) and we're in verbose mode
          ("packet_details" is true). */
       edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+      epan_dissect_prune_dissection(edt, prune_dissection);
     }
 
     for (framenum = 1; err == 0 && framenum <= cf->count; framenum++) {
@@ -3377,17 +3821,37 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
       edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
     }
 
-    while (wtap_read(cf->wth, &err, &err_info, &data_offset)) {
+    if (write_index) {
+      pkt_index = wtap_index_create(cf->wth, cf->filename, &index_err);
+      if (pkt_index == NULL) {
+        if (index_err != 0)
+          cmdarg_err("The packet index for \"%s\" can't be written: %s.",
+                     cf->filename, wtap_strerror(index_err));
+        else
+          cmdarg_err("Packet indices aren't supported for \"%s\".", cf->filename);
+      }
+    }
+
+    if (read_ahead_depth != 0)
+      read_ahead = read_ahead_start(cf->wth, read_ahead_depth);
+
+    while (tshark_read(cf, &err, &err_info, &data_offset, &whdr, &pd)) {
       framenum++;
 
-      if (process_packet(cf, edt, data_offset, wtap_phdr(cf->wth),
-                         wtap_buf_ptr(cf->wth),
-                         tap_flags)) {
+      if (pkt_index != NULL &&
+          !wtap_index_add(pkt_index, whdr, data_offset, &index_err)) {
+        cmdarg_err("The packet index for \"%s\" can't be written: %s.",
+                   cf->filename, wtap_strerror(index_err));
+        wtap_index_close(pkt_index);
+        pkt_index = NULL;
+      }
+
+      if (process_packet(cf, edt, data_offset, whdr, pd, tap_flags)) {
         /* Either there's no read filtering or this packet passed the
            filter, so, if we're writing to a capture file, write
            this packet out. */
         if (pdh != NULL) {
-          if (!wtap_dump(pdh, wtap_phdr(cf->wth), wtap_buf_ptr(cf->wth), &err, &err_info)) {
+          if (!wtap_dump(pdh, whdr, pd, &err, &err_info)) {
             /* Error writing to a capture file */
             switch (err) {
 
@@ -3459,10 +3923,29 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
        */
       if ( (--max_packet_count == 0) || (max_byte_count != 0 && data_offset >= max_byte_count)) {
         err = 0; /* This is not an error */
+        if (pkt_index != NULL) {
+          /* An index of part of the file is of no use. */
+          wtap_index_close(pkt_index);
+          pkt_index = NULL;
+        }
         break;
       }
     }
 
+    if (read_ahead != NULL) {
+      read_ahead_stop(read_ahead);
+      read_ahead = NULL;
+    }
+
+    if (pkt_index != NULL) {
+      if (err != 0)
+        wtap_index_close(pkt_index);
+      else if (!wtap_index_finish(pkt_index, cf->wth, &index_err))
+        cmdarg_err("The packet index for \"%s\" can't be written: %s.",
+                   cf->filename, wtap_strerror(index_err));
+      pkt_index = NULL;
+    }
+
     if (edt) {
       epan_dissect_free(edt);
       edt = NULL;
@@ -3577,13 +4060,35 @@ process_packet(capture_file *cf, epan_dissect_t *edt, gint64 offset, struct wtap
   /* Count this packet. */
   cf->count++;
 
+  frame_data_init(&fdata, cf->count, whdr, offset, cum_bytes);
+
+  if (flow_shard_count > 1 &&
+      flow_shard_of_packet(whdr, pd, flow_shard_count) != flow_shard) {
+    /* This packet belongs to another shard.  Don't dissect it, but
+       keep track of it so that frame numbers, time references and
+       cumulative byte counts are the same as they'd be if we were
+       dissecting the whole file.  (With a display filter, we can't
+       tell whether the packet would have passed it, so frame.cum_bytes
+       counts it as if it had.) */
+    if (edt) {
+      frame_data_set_before_dissect(&fdata, &cf->elapsed_time,
+                                    &ref, prev_dis);
+      if (ref == &fdata) {
+        ref_frame = fdata;
+        ref = &ref_frame;
+      }
+    }
+    frame_data_set_after_dissect(&fdata, &cum_bytes);
+    prev_cap_frame = fdata;
+    prev_cap = &prev_cap_frame;
+    return FALSE;
+  }
+
   /* If we're not running a display filter and we're not printing any
      packet information, we don't need to do a dissection. This means
      that all packets can be marked as 'passed'. */
   passed = TRUE;
 
-  frame_data_init(&fdata, cf->count, whdr, offset, cum_bytes);
-
   /* If we're going to print packet information, or we're going to
      run a read filter, or we're going to process taps, set up to
      do a dissection and do so. */
@@ -4084,10 +4589,17 @@ cf_open(capture_file *cf, const char *fname, unsigned int type, gboolean is_temp
   gchar *err_info;
   char   err_msg[2048+1];
 
-  wth = wtap_open_offline(fname, type, err, &err_info, perform_two_pass_analysis);
+  /* The fast seek points of a compressed file, which go with its index,
+     are only collected if it's opened for random access. */
+  wth = wtap_open_offline(fname, type, err, &err_info,
+                          perform_two_pass_analysis || write_index);
   if (wth == NULL)
     goto fail;
 
+  /* Seek points saved by an earlier read of a compressed file let it be
+     inflated on several threads at once. */
+  wtap_fast_seek_load(wth, fname);
+
   /* The open succeeded.  Fill in the information for this file. */
 
   /* Create new epan session for dissection. */
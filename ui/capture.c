@@ -362,6 +362,17 @@ capture_input_new_file(capture_session *cap_session, gchar *new_file)
     /* Attempt to open the capture file and set up to read from it. */
     switch(cf_open((capture_file *)cap_session->cf, capture_opts->save_file, WTAP_TYPE_AUTO, is_tempfile, &err)) {
     case CF_OK:
+      /* The capture child is still writing to the file, so we mustn't
+         memory-map it. */
+      if (!wtap_set_tailing(((capture_file *)cap_session->cf)->wth, &err)) {
+        simple_dialog(ESD_TYPE_ERROR, ESD_BTN_OK,
+                      "An error occurred while reading the capture file \"%s\": %s.",
+                      capture_opts->save_file, g_strerror(err));
+        cf_close((capture_file *)cap_session->cf);
+        g_free(capture_opts->save_file);
+        capture_opts->save_file = NULL;
+        return FALSE;
+      }
       break;
     case CF_ERROR:
       /* Don't unlink (delete) the save file - leave it around,
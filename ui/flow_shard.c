@@ -0,0 +1,194 @@
+/* flow_shard.c
+ * Assign packets to shards by flow, so that several processes can each
+ * dissect a share of a capture file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <wsutil/pint.h>
+
+#include "ui/flow_shard.h"
+
+#define ETHERTYPE_IP        0x0800
+#define ETHERTYPE_IPv6      0x86dd
+#define ETHERTYPE_VLAN      0x8100
+#define ETHERTYPE_IEEE_8021AD 0x88a8
+#define ETHERTYPE_QINQ_OLD  0x9100
+
+#define ETH_HDR_LEN   14
+#define VLAN_TAG_LEN  4
+#define SLL_HDR_LEN   16
+#define IPV4_ADDR_OFF 12
+#define IPV6_ADDR_OFF 8
+
+gboolean
+flow_shard_parse(const char *spec, guint *shard, guint *count)
+{
+    char          *p;
+    unsigned long  s, c;
+
+    s = strtoul(spec, &p, 10);
+    if (p == spec || *p != '/')
+        return FALSE;
+    spec = p + 1;
+    c = strtoul(spec, &p, 10);
+    if (p == spec || *p != '\0')
+        return FALSE;
+    if (c == 0 || c > G_MAXUINT || s >= c)
+        return FALSE;
+
+    *shard = (guint)s;
+    *count = (guint)c;
+    return TRUE;
+}
+
+/*
+ * Find the start of the IP header and its version, or return NULL
+ * if this isn't an IP packet we know how to find the header of.
+ */
+static const guint8 *
+find_ip_header(const struct wtap_pkthdr *phdr, const guint8 *pd, guint *version)
+{
+    guint32  caplen = phdr->caplen;
+    guint32  off;
+    guint16  etype;
+
+    switch (phdr->pkt_encap) {
+
+    case WTAP_ENCAP_ETHERNET:
+        if (caplen < ETH_HDR_LEN)
+            return NULL;
+        off = ETH_HDR_LEN - 2;
+        etype = pntoh16(pd + off);
+        while (etype == ETHERTYPE_VLAN || etype == ETHERTYPE_IEEE_8021AD ||
+               etype == ETHERTYPE_QINQ_OLD) {
+            off += VLAN_TAG_LEN;
+            if (caplen < off + 2)
+                return NULL;
+            etype = pntoh16(pd + off);
+        }
+        off += 2;
+        break;
+
+    case WTAP_ENCAP_SLL:
+        if (caplen < SLL_HDR_LEN)
+            return NULL;
+        etype = pntoh16(pd + SLL_HDR_LEN - 2);
+        off = SLL_HDR_LEN;
+        break;
+
+    case WTAP_ENCAP_RAW_IP:
+    case WTAP_ENCAP_RAW_IP4:
+    case WTAP_ENCAP_RAW_IP6:
+        if (caplen < 1)
+            return NULL;
+        off = 0;
+        etype = (pd[0] >> 4) == 6 ? ETHERTYPE_IPv6 : ETHERTYPE_IP;
+        break;
+
+    default:
+        return NULL;
+    }
+
+    switch (etype) {
+
+    case ETHERTYPE_IP:
+        if (caplen < off + IPV4_ADDR_OFF + 2*4 || (pd[off] >> 4) != 4)
+            return NULL;
+        *version = 4;
+        break;
+
+    case ETHERTYPE_IPv6:
+        if (caplen < off + IPV6_ADDR_OFF + 2*16 || (pd[off] >> 4) != 6)
+            return NULL;
+        *version = 6;
+        break;
+
+    default:
+        return NULL;
+    }
+    return pd + off;
+}
+
+/* FNV-1a, so that every process computes the same value. */
+static guint32
+flow_shard_hash_bytes(guint32 hash, const guint8 *p, size_t len)
+{
+    while (len--) {
+        hash ^= *p++;
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+guint
+flow_shard_of_packet(const struct wtap_pkthdr *phdr, const guint8 *pd, guint count)
+{
+    const guint8 *ip, *a, *b, *tmp;
+    guint         version;
+    size_t        alen;
+    guint32       hash;
+
+    if (count <= 1 || phdr->rec_type != REC_TYPE_PACKET)
+        return 0;
+
+    ip = find_ip_header(phdr, pd, &version);
+    if (ip == NULL)
+        return 0;
+
+    if (version == 4) {
+        a = ip + IPV4_ADDR_OFF;
+        alen = 4;
+    } else {
+        a = ip + IPV6_ADDR_OFF;
+        alen = 16;
+    }
+    b = a + alen;
+
+    /* Order the addresses so that both directions hash the same. */
+    if (memcmp(a, b, alen) > 0) {
+        tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    hash = flow_shard_hash_bytes(2166136261U, a, alen);
+    hash = flow_shard_hash_bytes(hash, b, alen);
+    return hash % count;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
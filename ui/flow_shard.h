@@ -0,0 +1,69 @@
+/* flow_shard.h
+ * Assign packets to shards by flow, so that several processes can each
+ * dissect a share of a capture file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __FLOW_SHARD_H__
+#define __FLOW_SHARD_H__
+
+#include <wiretap/wtap.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** @file
+ *
+ * A packet's shard is chosen from the unordered pair of its outermost IPv4
+ * or IPv6 source and destination addresses, read straight from the packet
+ * data without dissecting it.  Both directions of a conversation, and all
+ * fragments of a datagram, therefore land in the same shard, which means
+ * that conversation, reassembly and TCP analysis state for a flow is only
+ * ever needed in one shard.  Packets that aren't IP, or whose link-layer
+ * header we don't know how to skip, all go to shard 0.
+ *
+ * The hash doesn't depend on anything but the packet data, so independent
+ * processes sharding the same file agree on where each packet goes.
+ */
+
+/** Parse a "<shard>/<count>" specification, e.g. "2/8".
+ *
+ * @param spec The specification.
+ * @param shard Set to the zero-based shard number.
+ * @param count Set to the number of shards.
+ * @return TRUE if the specification is valid.
+ */
+extern gboolean flow_shard_parse(const char *spec, guint *shard, guint *count);
+
+/** Get the shard a packet belongs to.
+ *
+ * @param phdr The packet's header.
+ * @param pd The packet's data.
+ * @param count The number of shards.
+ * @return The zero-based shard number.
+ */
+extern guint flow_shard_of_packet(const struct wtap_pkthdr *phdr, const guint8 *pd, guint count);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __FLOW_SHARD_H__ */
@@ -115,63 +115,45 @@ conversation_hash_exact_old(gconstpointer v)
 }
 
 static void
-conversation_hashtable_exact_to_texbuff(gpointer key, gpointer value _U_, gpointer user_data)
+conversation_key_to_texbuff(const conversation_key *conv_key, guint hash _U_, guint count, gpointer user_data)
 {
     gchar string_buff[CONV_STR_BUF_MAX];
     GtkTextBuffer *buffer = (GtkTextBuffer*)user_data;
-    /*conversation_t *conversation = (conversation_t *)value;*/
-    conversation_key *conv_key = (conversation_key*)key;
 
-    g_snprintf(string_buff, CONV_STR_BUF_MAX, "Key:0x%x  old key:0x%x\n",conversation_hash_exact(conv_key),conversation_hash_exact_old(conv_key));
+    g_snprintf(string_buff, CONV_STR_BUF_MAX, "Key:0x%x  old key:0x%x  conversations:%u\n",
+        conversation_hash_exact(conv_key), conversation_hash_exact_old(conv_key), count);
 
     gtk_text_buffer_insert_at_cursor (buffer, string_buff, -1);
 
 }
 
 static void
-conversation_info_to_texbuff(GtkTextBuffer *buffer)
+conversation_index_to_texbuff(GtkTextBuffer *buffer, const char *name, conversation_index_e which)
 {
     gchar string_buff[CONV_STR_BUF_MAX];
-    GHashTable *conversation_hashtable_exact;
-    GHashTable *conversation_hashtable_no_addr2;
-    GHashTable *conversation_hashtable_no_port2;
-    GHashTable *conversation_hashtable_no_addr2_or_port2;
+    conversation_index_stats_t stats;
 
-    g_snprintf(string_buff, CONV_STR_BUF_MAX, "Conversation hastables info:\n");
+    conversation_get_index_stats(which, &stats);
+    g_snprintf(string_buff, CONV_STR_BUF_MAX,
+        "%s %u entries, %u conversations, %u slots, %lu bytes\n#\n",
+        name, stats.keys, stats.conversations, stats.slots, (unsigned long)stats.bytes);
     gtk_text_buffer_insert_at_cursor (buffer, string_buff, -1);
+}
 
-    conversation_hashtable_exact = get_conversation_hashtable_exact();
-    if(conversation_hashtable_exact){
-        g_snprintf(string_buff, CONV_STR_BUF_MAX, "conversation_hashtable_exact %i entries\n#\n",
-            g_hash_table_size(conversation_hashtable_exact));
-        gtk_text_buffer_insert_at_cursor (buffer, string_buff, -1);
-        g_hash_table_foreach( conversation_hashtable_exact, conversation_hashtable_exact_to_texbuff, buffer);
-    }
-
-    conversation_hashtable_no_addr2 = get_conversation_hashtable_no_addr2();
-    if(conversation_hashtable_no_addr2){
-        g_snprintf(string_buff, CONV_STR_BUF_MAX, "conversation_hashtable_no_addr2 %i entries\n#\n",
-            g_hash_table_size(conversation_hashtable_no_addr2));
-        gtk_text_buffer_insert_at_cursor (buffer, string_buff, -1);
-
-    }
-
-    conversation_hashtable_no_port2 = get_conversation_hashtable_no_port2();
-    if(conversation_hashtable_no_port2){
-        g_snprintf(string_buff, CONV_STR_BUF_MAX, "conversation_hashtable_no_port2 %i entries\n#\n",
-            g_hash_table_size(conversation_hashtable_no_port2));
-        gtk_text_buffer_insert_at_cursor (buffer, string_buff, -1);
-
-    }
+static void
+conversation_info_to_texbuff(GtkTextBuffer *buffer)
+{
+    gchar string_buff[CONV_STR_BUF_MAX];
 
-    conversation_hashtable_no_addr2_or_port2 = get_conversation_hashtable_no_addr2_or_port2();
-    if(conversation_hashtable_no_addr2_or_port2){
-        g_snprintf(string_buff, CONV_STR_BUF_MAX, "conversation_hashtable_no_addr2_or_port2 %i entries\n#\n",
-            g_hash_table_size(conversation_hashtable_no_addr2_or_port2));
-        gtk_text_buffer_insert_at_cursor (buffer, string_buff, -1);
+    g_snprintf(string_buff, CONV_STR_BUF_MAX, "Conversation hastables info:\n");
+    gtk_text_buffer_insert_at_cursor (buffer, string_buff, -1);
 
-    }
+    conversation_index_to_texbuff(buffer, "conversation_hashtable_exact", CONVERSATION_INDEX_EXACT);
+    conversation_index_foreach(CONVERSATION_INDEX_EXACT, conversation_key_to_texbuff, buffer);
 
+    conversation_index_to_texbuff(buffer, "conversation_hashtable_no_addr2", CONVERSATION_INDEX_NO_ADDR2);
+    conversation_index_to_texbuff(buffer, "conversation_hashtable_no_port2", CONVERSATION_INDEX_NO_PORT2);
+    conversation_index_to_texbuff(buffer, "conversation_hashtable_no_addr2_or_port2", CONVERSATION_INDEX_NO_ADDR2_OR_PORT2);
 }
 
 void
@@ -677,6 +677,9 @@ copy_selected_plist_cb(GtkWidget *w _U_, gpointer data _U_, COPY_SELECTED_E acti
         if (cfile.finfo_selected->rep &&
             strlen (cfile.finfo_selected->rep->representation) > 0) {
             g_string_append(gtk_text_str, cfile.finfo_selected->rep->representation);
+        } else {
+            proto_item_fill_label(cfile.finfo_selected, labelstring);
+            g_string_append(gtk_text_str, labelstring);
         }
         break;
     case COPY_SELECTED_FIELDNAME:
@@ -1677,6 +1677,9 @@ void MainWindow::actionEditCopyTriggered(MainWindow::CopySelected selection_type
         if (capture_file_.capFile()->finfo_selected->rep &&
                 strlen (capture_file_.capFile()->finfo_selected->rep->representation) > 0) {
             clip.append(capture_file_.capFile()->finfo_selected->rep->representation);
+        } else {
+            proto_item_fill_label(capture_file_.capFile()->finfo_selected, label_str);
+            clip.append(label_str);
         }
         break;
     case CopySelectedFieldName:
@@ -2063,7 +2063,7 @@ wtap_dump_can_open(int file_type_subtype)
 	return TRUE;
 }
 
-#ifdef HAVE_LIBZ
+#if defined(HAVE_LIBZ) || defined(HAVE_ZSTD) || defined(HAVE_LZ4)
 gboolean
 wtap_dump_can_compress(int file_type_subtype)
 {
@@ -2086,6 +2086,34 @@ wtap_dump_can_compress(int file_type_subtype _U_)
 }
 #endif
 
+gboolean
+wtap_can_write_compression_type(wtap_compression_type compression_type)
+{
+	switch (compression_type) {
+
+	case WTAP_UNCOMPRESSED:
+		return TRUE;
+
+#ifdef HAVE_LIBZ
+	case WTAP_GZIP_COMPRESSED:
+		return TRUE;
+#endif
+
+#ifdef HAVE_ZSTD
+	case WTAP_ZSTD_COMPRESSED:
+		return TRUE;
+#endif
+
+#ifdef HAVE_LZ4
+	case WTAP_LZ4_COMPRESSED:
+		return TRUE;
+#endif
+
+	default:
+		return FALSE;
+	}
+}
+
 gboolean
 wtap_dump_has_name_resolution(int file_type_subtype)
 {
@@ -2111,9 +2139,10 @@ wtap_dump_supports_comment_types(int file_type_subtype, guint32 comment_types)
 	return FALSE;
 }
 
-static gboolean wtap_dump_open_check(int file_type_subtype, int encap, gboolean comressed, int *err);
+static gboolean wtap_dump_open_check(int file_type_subtype, int encap,
+					wtap_compression_type compression_type, int *err);
 static wtap_dumper* wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen,
-					gboolean compressed, int *err);
+					wtap_compression_type compression_type, int *err);
 static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, gboolean compressed, int *err);
 
 static WFILE_T wtap_dump_file_open(wtap_dumper *wdh, const char *filename);
@@ -2128,13 +2157,14 @@ wtap_dump_open(const char *filename, int file_type_subtype, int encap,
 }
 
 static wtap_dumper *
-wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, gboolean compressed,
+wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen,
+    wtap_compression_type compression_type,
     wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
 {
 	wtap_dumper *wdh;
 
 	/* Allocate a data structure for the output stream. */
-	wdh = wtap_dump_alloc_wdh(file_type_subtype, encap, snaplen, compressed, err);
+	wdh = wtap_dump_alloc_wdh(file_type_subtype, encap, snaplen, compression_type, err);
 	if (wdh == NULL)
 		return NULL;	/* couldn't allocate it */
 
@@ -2171,17 +2201,28 @@ wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, gboolean co
 wtap_dumper *
 wtap_dump_open_ng(const char *filename, int file_type_subtype, int encap,
 		  int snaplen, gboolean compressed, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
+{
+	return wtap_dump_open_compressed(filename, file_type_subtype, encap,
+	    snaplen, compressed ? WTAP_GZIP_COMPRESSED : WTAP_UNCOMPRESSED,
+	    shb_hdr, idb_inf, err);
+}
+
+wtap_dumper *
+wtap_dump_open_compressed(const char *filename, int file_type_subtype, int encap,
+			  int snaplen, wtap_compression_type compression_type,
+			  wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
 {
 	wtap_dumper *wdh;
 	WFILE_T fh;
+	gboolean compressed = (compression_type != WTAP_UNCOMPRESSED);
 
 	/* Check whether we can open a capture file with that file type
 	   and that encapsulation. */
-	if (!wtap_dump_open_check(file_type_subtype, encap, compressed, err))
+	if (!wtap_dump_open_check(file_type_subtype, encap, compression_type, err))
 		return NULL;
 
 	/* Allocate and initialize a data structure for the output stream. */
-	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compressed,
+	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compression_type,
 	    shb_hdr, idb_inf, err);
 	if (wdh == NULL)
 		return NULL;
@@ -2241,14 +2282,16 @@ wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int snaplen,
 {
 	wtap_dumper *wdh;
 	WFILE_T fh;
+	wtap_compression_type compression_type =
+	    compressed ? WTAP_GZIP_COMPRESSED : WTAP_UNCOMPRESSED;
 
 	/* Check whether we can open a capture file with that file type
 	   and that encapsulation. */
-	if (!wtap_dump_open_check(file_type_subtype, encap, compressed, err))
+	if (!wtap_dump_open_check(file_type_subtype, encap, compression_type, err))
 		return NULL;
 
 	/* Allocate and initialize a data structure for the output stream. */
-	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compressed,
+	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compression_type,
 	    shb_hdr, idb_inf, err);
 	if (wdh == NULL)
 		return NULL;
@@ -2284,7 +2327,8 @@ wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int snaplen,
 }
 
 static gboolean
-wtap_dump_open_check(int file_type_subtype, int encap, gboolean compressed, int *err)
+wtap_dump_open_check(int file_type_subtype, int encap,
+		     wtap_compression_type compression_type, int *err)
 {
 	if (!wtap_dump_can_open(file_type_subtype)) {
 		/* Invalid type, or type we don't know how to write. */
@@ -2307,8 +2351,11 @@ wtap_dump_open_check(int file_type_subtype, int encap, gboolean compressed, int
 	if (*err != 0)
 		return FALSE;
 
-	/* if compression is wanted, do we support this for this file_type_subtype? */
-	if(compressed && !wtap_dump_can_compress(file_type_subtype)) {
+	/* if compression is wanted, do we support this for this file_type_subtype,
+	   and this type of compression at all? */
+	if (compression_type != WTAP_UNCOMPRESSED &&
+	    (!wtap_dump_can_compress(file_type_subtype) ||
+	     !wtap_can_write_compression_type(compression_type))) {
 		*err = WTAP_ERR_COMPRESSION_NOT_SUPPORTED;
 		return FALSE;
 	}
@@ -2318,7 +2365,8 @@ wtap_dump_open_check(int file_type_subtype, int encap, gboolean compressed, int
 }
 
 static wtap_dumper *
-wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen, gboolean compressed, int *err)
+wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen,
+		    wtap_compression_type compression_type, int *err)
 {
 	wtap_dumper *wdh;
 
@@ -2331,7 +2379,8 @@ wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen, gboolean comp
 	wdh->file_type_subtype = file_type_subtype;
 	wdh->snaplen = snaplen;
 	wdh->encap = encap;
-	wdh->compressed = compressed;
+	wdh->compressed = (compression_type != WTAP_UNCOMPRESSED);
+	wdh->compression_type = compression_type;
 	wdh->wslua_data = NULL;
 	return wdh;
 }
@@ -2389,13 +2438,29 @@ wtap_dump(wtap_dumper *wdh, const struct wtap_pkthdr *phdr,
 void
 wtap_dump_flush(wtap_dumper *wdh)
 {
+	switch (wdh->compression_type) {
+
 #ifdef HAVE_LIBZ
-	if(wdh->compressed) {
+	case WTAP_GZIP_COMPRESSED:
 		gzwfile_flush((GZWFILE_T)wdh->fh);
-	} else
+		break;
 #endif
-	{
+
+#ifdef HAVE_ZSTD
+	case WTAP_ZSTD_COMPRESSED:
+		zstdwfile_flush((ZSTDWFILE_T)wdh->fh);
+		break;
+#endif
+
+#ifdef HAVE_LZ4
+	case WTAP_LZ4_COMPRESSED:
+		lz4wfile_flush((LZ4WFILE_T)wdh->fh);
+		break;
+#endif
+
+	default:
 		fflush((FILE *)wdh->fh);
+		break;
 	}
 }
 
@@ -2455,42 +2520,56 @@ wtap_dump_set_addrinfo_list(wtap_dumper *wdh, addrinfo_lists_t *addrinfo_lists)
 }
 
 /* internally open a file for writing (compressed or not) */
-#ifdef HAVE_LIBZ
 static WFILE_T
 wtap_dump_file_open(wtap_dumper *wdh, const char *filename)
 {
-	if(wdh->compressed) {
+	switch (wdh->compression_type) {
+
+#ifdef HAVE_LIBZ
+	case WTAP_GZIP_COMPRESSED:
 		return gzwfile_open(filename);
-	} else {
+#endif
+
+#ifdef HAVE_ZSTD
+	case WTAP_ZSTD_COMPRESSED:
+		return zstdwfile_open(filename);
+#endif
+
+#ifdef HAVE_LZ4
+	case WTAP_LZ4_COMPRESSED:
+		return lz4wfile_open(filename);
+#endif
+
+	default:
 		return ws_fopen(filename, "wb");
 	}
 }
-#else
-static WFILE_T
-wtap_dump_file_open(wtap_dumper *wdh _U_, const char *filename)
-{
-	return ws_fopen(filename, "wb");
-}
-#endif
 
 /* internally open a file for writing (compressed or not) */
-#ifdef HAVE_LIBZ
 static WFILE_T
 wtap_dump_file_fdopen(wtap_dumper *wdh, int fd)
 {
-	if(wdh->compressed) {
+	switch (wdh->compression_type) {
+
+#ifdef HAVE_LIBZ
+	case WTAP_GZIP_COMPRESSED:
 		return gzwfile_fdopen(fd);
-	} else {
+#endif
+
+#ifdef HAVE_ZSTD
+	case WTAP_ZSTD_COMPRESSED:
+		return zstdwfile_fdopen(fd);
+#endif
+
+#ifdef HAVE_LZ4
+	case WTAP_LZ4_COMPRESSED:
+		return lz4wfile_fdopen(fd);
+#endif
+
+	default:
 		return fdopen(fd, "wb");
 	}
 }
-#else
-static WFILE_T
-wtap_dump_file_fdopen(wtap_dumper *wdh _U_, int fd)
-{
-	return fdopen(fd, "wb");
-}
-#endif
 
 /* internally writing raw bytes (compressed or not) */
 gboolean
@@ -2498,8 +2577,10 @@ wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err
 {
 	size_t nwritten;
 
+	switch (wdh->compression_type) {
+
 #ifdef HAVE_LIBZ
-	if (wdh->compressed) {
+	case WTAP_GZIP_COMPRESSED:
 		nwritten = gzwfile_write((GZWFILE_T)wdh->fh, buf, (unsigned int) bufsize);
 		/*
 		 * gzwfile_write() returns 0 on error.
@@ -2508,9 +2589,30 @@ wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err
 			*err = gzwfile_geterr((GZWFILE_T)wdh->fh);
 			return FALSE;
 		}
-	} else
+		break;
 #endif
-	{
+
+#ifdef HAVE_ZSTD
+	case WTAP_ZSTD_COMPRESSED:
+		nwritten = zstdwfile_write((ZSTDWFILE_T)wdh->fh, buf, (unsigned int) bufsize);
+		if (nwritten == 0) {
+			*err = zstdwfile_geterr((ZSTDWFILE_T)wdh->fh);
+			return FALSE;
+		}
+		break;
+#endif
+
+#ifdef HAVE_LZ4
+	case WTAP_LZ4_COMPRESSED:
+		nwritten = lz4wfile_write((LZ4WFILE_T)wdh->fh, buf, (unsigned int) bufsize);
+		if (nwritten == 0) {
+			*err = lz4wfile_geterr((LZ4WFILE_T)wdh->fh);
+			return FALSE;
+		}
+		break;
+#endif
+
+	default:
 		errno = WTAP_ERR_CANT_WRITE;
 		nwritten = fwrite(buf, 1, bufsize, (FILE *)wdh->fh);
 		/*
@@ -2524,6 +2626,7 @@ wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err
 				*err = WTAP_ERR_SHORT_WRITE;
 			return FALSE;
 		}
+		break;
 	}
 	return TRUE;
 }
@@ -2532,12 +2635,24 @@ wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err
 static int
 wtap_dump_file_close(wtap_dumper *wdh)
 {
+	switch (wdh->compression_type) {
+
 #ifdef HAVE_LIBZ
-	if(wdh->compressed) {
+	case WTAP_GZIP_COMPRESSED:
 		return gzwfile_close((GZWFILE_T)wdh->fh);
-	} else
 #endif
-	{
+
+#ifdef HAVE_ZSTD
+	case WTAP_ZSTD_COMPRESSED:
+		return zstdwfile_close((ZSTDWFILE_T)wdh->fh);
+#endif
+
+#ifdef HAVE_LZ4
+	case WTAP_LZ4_COMPRESSED:
+		return lz4wfile_close((LZ4WFILE_T)wdh->fh);
+#endif
+
+	default:
 		return fclose((FILE *)wdh->fh);
 	}
 }
@@ -2545,7 +2660,7 @@ wtap_dump_file_close(wtap_dumper *wdh)
 gint64
 wtap_dump_file_seek(wtap_dumper *wdh, gint64 offset, int whence, int *err)
 {
-#ifdef HAVE_LIBZ
+#if defined(HAVE_LIBZ) || defined(HAVE_ZSTD) || defined(HAVE_LZ4)
 	if(wdh->compressed) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
 		return -1;
@@ -2566,7 +2681,7 @@ gint64
 wtap_dump_file_tell(wtap_dumper *wdh, int *err)
 {
 	gint64 rval;
-#ifdef HAVE_LIBZ
+#if defined(HAVE_LIBZ) || defined(HAVE_ZSTD) || defined(HAVE_LZ4)
 	if(wdh->compressed) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
 		return -1;
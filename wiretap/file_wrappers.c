@@ -51,17 +51,34 @@
 #include <fcntl.h>
 #endif /* HAVE_FCNTL_H */
 #include <string.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif /* HAVE_MMAP */
 #include "wtap-int.h"
 #include "file_wrappers.h"
 #include <wsutil/file_util.h>
+#include <wsutil/pint.h>
 
 #ifdef HAVE_LIBZ
 #include <zlib.h>
 #endif /* HAVE_LIBZ */
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif /* HAVE_ZSTD */
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif /* HAVE_LZ4 */
 
 /*
  * See RFC 1952 for a description of the gzip file format.
  *
+ * See RFC 8478 for a description of the Zstandard frame format, and
+ * https://github.com/facebook/zstd/blob/dev/contrib/seekable_format/zstd_seekable_compression_format.md
+ * for the seek table that can follow the frames of a Zstandard file.
+ *
+ * See https://github.com/lz4/lz4/blob/dev/doc/lz4_Frame_format.md for a
+ * description of the LZ4 frame format.
+ *
  * Some other compressed file formats we might want to support:
  *
  *      XZ format: http://tukaani.org/xz/
@@ -78,6 +95,12 @@
 static const char *compressed_file_extensions[] = {
 #ifdef HAVE_LIBZ
     "gz",
+#endif
+#ifdef HAVE_ZSTD
+    "zst",
+#endif
+#ifdef HAVE_LZ4
+    "lz4",
 #endif
     NULL
 };
@@ -109,10 +132,37 @@ typedef enum {
     UNCOMPRESSED,  /* uncompressed - copy input directly */
 #ifdef HAVE_LIBZ
     ZLIB,          /* decompress a zlib stream */
-    GZIP_AFTER_HEADER
+    GZIP_AFTER_HEADER,
+    GZIP_PARALLEL, /* inflate whole gzip members on a thread pool */
 #endif
+#ifdef HAVE_ZSTD
+    ZSTD,          /* decompress a Zstandard frame */
+#endif
+#ifdef HAVE_LZ4
+    LZ4,           /* decompress an LZ4 frame */
+#endif
+    NUM_COMPRESSION_TYPES
 } compression_t;
 
+/*
+ * Magic numbers, as little-endian 32-bit values, at the start of
+ * Zstandard and LZ4 frames, and of the skippable frames that can be
+ * mixed in with them.
+ */
+#define ZSTD_FRAME_MAGIC        0xFD2FB528U
+#define LZ4_FRAME_MAGIC         0x184D2204U
+#define SKIPPABLE_FRAME_MAGIC   0x184D2A50U /* low 4 bits can be anything */
+#define SKIPPABLE_FRAME_MASK    0xFFFFFFF0U
+
+/* Skippable frame holding a Zstandard seek table, and its footer. */
+#define ZSTD_SEEK_TABLE_MAGIC   0x184D2A5EU
+#define ZSTD_SEEKABLE_MAGIC     0x8F92EAB1U
+#define ZSTD_SEEK_FOOTER_LEN    9
+
+#ifdef HAVE_LIBZ
+struct gz_par;
+#endif
+
 struct wtap_reader {
     int fd;                    /* file descriptor */
     gint64 raw_pos;            /* current position in file (just to not call lseek()) */
@@ -141,10 +191,28 @@ struct wtap_reader {
     /* zlib inflate stream */
     z_stream strm;             /* stream structure in-place (not a pointer) */
     gboolean dont_check_crc;   /* TRUE if we aren't supposed to check the CRC */
+    /* parallel inflation of multi-member files */
+    struct gz_par *par;        /* members in flight, if we're doing that */
+    gint64 par_give_up;        /* offset of a member we couldn't do that with */
+    gint64 par_point_tried;    /* offset in uncompressed data of the last seek
+                                  point we tried to inflate in parallel from */
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD_DStream *zstd_dctx;   /* Zstandard decompression context, once we need one */
 #endif
+#ifdef HAVE_LZ4
+    LZ4F_decompressionContext_t lz4_dctx;  /* LZ4 decompression context, once we need one */
+#endif
+    gboolean is_random;        /* TRUE if this is the random access stream */
     /* fast seeking */
     GPtrArray *fast_seek;
     void *fast_seek_cur;
+#ifdef HAVE_MMAP
+    /* memory-mapped uncompressed file */
+    unsigned char *map;        /* the file's contents, or NULL if not mapped */
+    gint64 map_size;           /* size of the mapping */
+    gboolean no_map;           /* TRUE if the file mustn't be mapped */
+#endif
 };
 
 static int     /* gz_load */
@@ -183,6 +251,110 @@ fill_in_buffer(FILE_T state)
     return 0;
 }
 
+#ifdef HAVE_MMAP
+/*
+ * Uncompressed regular files are memory-mapped, so that the data is
+ * copied once, from the page cache straight into the caller's buffer,
+ * rather than first being read() into our output buffer; that also
+ * makes seeking a matter of setting raw_pos.
+ *
+ * While a file is mapped, the file descriptor's offset isn't kept up
+ * to date; raw_pos is the offset, in the file, of the next byte we'll
+ * hand out, and, as the data is uncompressed, the byte at uncompressed
+ * offset pos is at file offset start + pos.
+ *
+ * If a mapped file is truncated, touching a page past its new end
+ * raises SIGBUS, so files that are being written to while we read
+ * them, such as a live capture we're tailing, aren't mapped; see
+ * file_set_no_map().
+ */
+#define MAP_CHUNK 0x40000000    /* most we hand out per fill_out_buffer() */
+
+/* Is next pointing into the mapping? */
+#define NEXT_IN_MAP(state) \
+    ((state)->map != NULL && (state)->next >= (state)->map && \
+     (state)->next < (state)->map + (state)->map_size)
+
+static void
+map_file(FILE_T state)
+{
+    ws_statb64 st;
+    void *map;
+
+    if (state->no_map)
+        return;
+
+    /*
+     * Uncompressed data that follows a compressed member isn't at
+     * file offset start + pos, so only map files that have been
+     * uncompressed from the start.
+     */
+    if (state->is_compressed)
+        return;
+
+    if (ws_fstat64(state->fd, &st) == -1 || !S_ISREG(st.st_mode) ||
+        st.st_size <= state->map_size || (guint64)st.st_size > G_MAXSIZE)
+        return;
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, state->fd, 0);
+    if (map == MAP_FAILED)
+        return;     /* just use read() */
+
+    if (state->map != NULL) {
+        if (NEXT_IN_MAP(state))
+            state->next = (unsigned char *)map + (state->next - state->map);
+        munmap(state->map, (size_t)state->map_size);
+    }
+    state->map = (unsigned char *)map;
+    state->map_size = st.st_size;
+}
+
+/*
+ * Drop the mapping.  Any data we've handed out of it but that hasn't
+ * been consumed yet is given back, by moving raw_pos back to it, so
+ * that the next read(), or the next mapping, picks it up again and
+ * nothing is left pointing into the old mapping.  The file descriptor's
+ * offset is *not* set to raw_pos; our caller must do that if it's going
+ * to read() from the descriptor.
+ */
+static void
+unmap_file(FILE_T state)
+{
+    if (state->map != NULL) {
+        if (NEXT_IN_MAP(state)) {
+            state->raw_pos -= state->have;
+            state->have = 0;
+            state->next = state->out;
+        }
+        munmap(state->map, (size_t)state->map_size);
+        state->map = NULL;
+        state->map_size = 0;
+    }
+}
+
+/* Hand out the next chunk of the mapping, as raw_read() would read it. */
+static void
+map_fill(FILE_T state)
+{
+    gint64 left;
+
+    if (state->raw_pos >= state->map_size) {
+        /* We've run off the end; if the file has grown, remap it. */
+        map_file(state);
+    }
+
+    left = state->map_size - state->raw_pos;
+    if (left <= 0) {
+        state->have = 0;
+        state->eof = TRUE;
+        return;
+    }
+    state->next = state->map + state->raw_pos;
+    state->have = left > MAP_CHUNK ? MAP_CHUNK : (guint)left;
+    state->raw_pos += state->have;
+}
+#endif /* HAVE_MMAP */
+
 #define ZLIB_WINSIZE 32768
 
 struct fast_seek_point {
@@ -572,169 +744,1217 @@ zlib_read(FILE_T state, unsigned char *buf, unsigned int count)
         state->fast_seek_cur = NULL;
     }
 }
-#endif
 
+/*
+ * Set up the inflate stream to carry on from a fast seek point in the
+ * middle of a member, or just after a member's header, with the input
+ * positioned at the point's first full byte, less one if it has bits
+ * left over.  Return -1, and set state->err, on failure; return 0 on
+ * success.
+ */
 static int
-gz_head(FILE_T state)
+zlib_restore(FILE_T state, const struct fast_seek_point *here)
 {
-    /* get some data in the input buffer */
-    if (state->avail_in == 0) {
-        if (fill_in_buffer(state) == -1)
-            return -1;
-        if (state->avail_in == 0)
-            return 0;
+    z_stream *strm = &state->strm;
+
+    inflateReset(strm);
+    if (here->compression == GZIP_AFTER_HEADER) {
+        strm->adler = crc32(0L, Z_NULL, 0);
+    } else {
+        strm->adler = here->data.zlib.adler;
+        strm->total_out = here->data.zlib.total_out;
+#ifdef HAVE_INFLATEPRIME
+        if (here->data.zlib.bits) {
+            int ret = GZ_GETC();
+
+            if (ret == -1) {
+                if (state->err == 0) {
+                    /* EOF */
+                    state->err = WTAP_ERR_SHORT_READ;
+                    state->err_info = NULL;
+                }
+                return -1;
+            }
+            (void)inflatePrime(strm, here->data.zlib.bits, ret >> (8 - here->data.zlib.bits));
+        }
+#endif
+        (void)inflateSetDictionary(strm, here->data.zlib.window, ZLIB_WINSIZE);
     }
+    state->compression = ZLIB;
+    return 0;
+}
 
-    /* look for the gzip magic header bytes 31 and 139 */
-#ifdef HAVE_LIBZ
-    if (state->next_in[0] == 31) {
-        state->avail_in--;
-        state->next_in++;
-        if (state->avail_in == 0 && fill_in_buffer(state) == -1)
-            return -1;
-        if (state->avail_in && state->next_in[0] == 139) {
-            guint8 cm;
-            guint8 flags;
-            guint16 len;
-            guint16 hcrc;
-
-            /* we have a gzip header, woo hoo! */
-            state->avail_in--;
-            state->next_in++;
+/*
+ * The sequential stream of a gzip file can be inflated on a pool of
+ * threads, with the results handed out in order, in two ways:
+ *
+ *  - If fast seek points saved by an earlier read have been loaded,
+ *    the stretches between them are inflated separately, starting from
+ *    the window, CRC and bit offset saved with each point, as zran.c
+ *    in the zlib distribution does.  This works for any gzip file,
+ *    including single-member ones, such as the ones pigz writes.
+ *
+ *  - Otherwise, BGZF files, whose members have a "BC" extra subfield
+ *    giving the member length less 1, have their members inflated
+ *    separately.  That's what we write on machines with more than one
+ *    processor.
+ *
+ * Anything else is inflated serially the first time it's read; the
+ * boundaries of the members of an ordinary multi-member file, and the
+ * places where the stream can be picked up in the middle of one, can
+ * only be found by inflating everything before them.
+ *
+ * The random access stream always uses the fast seek points, one of
+ * which is added at the start of each member.
+ */
+#define GZ_PAR_MAX_MEMBER   (16*1024*1024)  /* biggest member or span, compressed or not, we'll take */
+#define GZ_PAR_MAX_JOBS     64              /* most members or spans in flight */
+#define GZ_PAR_BLOCK        0xff00          /* uncompressed data per BGZF member we write */
+#define GZ_PAR_HDR_LEN      18              /* length of the header of a BGZF member */
+#define GZ_PAR_MAX_BSIZE    65536           /* biggest BGZF member */
+
+struct gz_par_job {
+    struct gz_par_job *next;
+    gint64 raw_start;           /* offset of the member or span in the file */
+    guint raw_len;              /* length of the member or span */
+    guint hdr_len;              /* length of the member's gzip header */
+    const struct fast_seek_point *point;    /* where the span starts, or NULL for a member */
+    gboolean member_end;        /* the span runs to the end of its member */
+    guint32 end_crc;            /* the member's CRC where the span ends, if it doesn't */
+    unsigned char *in;          /* data to inflate or deflate */
+    guint in_len;
+    unsigned char *out;         /* the result */
+    guint out_len;
+    int level;                  /* compression level, when deflating */
+    gboolean done;              /* TRUE once a thread is done with it */
+    int err;
+    const char *err_info;
+};
 
-            /* read rest of header */
+struct gz_par {
+    GThreadPool *pool;
+    GMutex *mtx;                /* protects "done" in the jobs */
+    GCond *cond;                /* signalled when a job is done */
+    struct gz_par_job *head;    /* jobs in flight, in file order */
+    struct gz_par_job *tail;
+    guint n_jobs;
+    guint max_jobs;
+    volatile gboolean cancel;   /* skip the work in jobs not yet started */
+
+    /* reading */
+    struct gz_par_job *cur;     /* member or span whose data we're handing out */
+    guint depth;                /* jobs to keep in flight; ramps up to max_jobs */
+    gint64 raw_next;            /* offset of the next member to read */
+    gboolean raw_done;          /* no more members or spans we can read this way */
+    gboolean spans;             /* TRUE if we're going from fast seek point to point */
+    guint next_point;           /* index of the point the next span starts at */
+    guint discard;              /* data from the first span that we'd already handed out */
+    gboolean handed_out;        /* TRUE once we've handed out some data */
+
+    /* writing */
+    struct gz_par_job *fill;    /* block being filled, to be deflated */
+};
 
-            /* compression method (CM) */
-            if (gz_next1(state, &cm) == -1)
-                return -1;
-            if (cm != 8) {
-                state->err = WTAP_ERR_DECOMPRESS;
-                state->err_info = "unknown compression method";
-                return -1;
-            }
+static struct gz_par *
+gz_par_new(GFunc func)
+{
+    struct gz_par *par;
+    guint threads;
 
-            /* flags (FLG) */
-            if (gz_next1(state, &flags) == -1)
-                return -1;
-            if (flags & 0xe0) {     /* reserved flag bits */
-                state->err = WTAP_ERR_DECOMPRESS;
-                state->err_info = "reserved flag bits set";
-                return -1;
-            }
+#if !GLIB_CHECK_VERSION(2,31,0)
+    /* It's too late for us to initialize threads. */
+    if (!g_thread_supported())
+        return NULL;
+#endif
+    threads = wtap_num_processors();
+    if (threads < 2)
+        return NULL;        /* nothing to be gained */
+
+    par = g_new0(struct gz_par, 1);
+    par->pool = g_thread_pool_new(func, par, (gint)threads, FALSE, NULL);
+    if (par->pool == NULL) {
+        g_free(par);
+        return NULL;
+    }
+#if GLIB_CHECK_VERSION(2,31,0)
+    par->mtx = g_new(GMutex, 1);
+    g_mutex_init(par->mtx);
+    par->cond = g_new(GCond, 1);
+    g_cond_init(par->cond);
+#else
+    par->mtx = g_mutex_new();
+    par->cond = g_cond_new();
+#endif
+    par->max_jobs = MIN(2 * threads, GZ_PAR_MAX_JOBS);
+    par->depth = 1;
+    return par;
+}
 
-            /* modification time (MTIME) */
-            if (gz_skipn(state, 4) == -1)
-                return -1;
+static void
+gz_par_job_free(struct gz_par_job *job)
+{
+    g_free(job->in);
+    g_free(job->out);
+    g_free(job);
+}
 
-            /* extra flags (XFL) */
-            if (gz_skipn(state, 1) == -1)
-                return -1;
+static void
+gz_par_submit(struct gz_par *par, struct gz_par_job *job)
+{
+    job->next = NULL;
+    if (par->tail != NULL)
+        par->tail->next = job;
+    else
+        par->head = job;
+    par->tail = job;
+    par->n_jobs++;
+    g_thread_pool_push(par->pool, job, NULL);
+}
 
-            /* operating system (OS) */
-            if (gz_skipn(state, 1) == -1)
-                return -1;
+/* Called by a thread when it's done with a job. */
+static void
+gz_par_job_done(struct gz_par *par, struct gz_par_job *job)
+{
+    g_mutex_lock(par->mtx);
+    job->done = TRUE;
+    g_cond_broadcast(par->cond);
+    g_mutex_unlock(par->mtx);
+}
 
-            if (flags & 4) {
-                /* extra field - get XLEN */
-                if (gz_next2(state, &len) == -1)
-                    return -1;
+static gboolean
+gz_par_head_done(struct gz_par *par)
+{
+    gboolean done;
 
-                /* skip the extra field */
-                if (gz_skipn(state, len) == -1)
-                    return -1;
-            }
-            if (flags & 8) {
-                /* file name */
-                if (gz_skipzstr(state) == -1)
-                    return -1;
-            }
-            if (flags & 16) {
-                /* comment */
-                if (gz_skipzstr(state) == -1)
-                    return -1;
-            }
-            if (flags & 2) {
-                /* header crc */
-                if (gz_next2(state, &hcrc) == -1)
-                    return -1;
-                /* XXX - check the CRC? */
-            }
+    g_mutex_lock(par->mtx);
+    done = par->head->done;
+    g_mutex_unlock(par->mtx);
+    return done;
+}
 
-            /* set up for decompression */
-            inflateReset(&(state->strm));
-            state->strm.adler = crc32(0L, Z_NULL, 0);
-            state->compression = ZLIB;
-            state->is_compressed = TRUE;
-#ifdef Z_BLOCK
-            if (state->fast_seek) {
-                struct zlib_cur_seek_point *cur = g_new(struct zlib_cur_seek_point,1);
+/* Wait for the oldest job to be done, and take it off the list. */
+static struct gz_par_job *
+gz_par_next_done(struct gz_par *par)
+{
+    struct gz_par_job *job = par->head;
+
+    g_mutex_lock(par->mtx);
+    while (!job->done)
+        g_cond_wait(par->cond, par->mtx);
+    g_mutex_unlock(par->mtx);
+
+    par->head = job->next;
+    if (par->head == NULL)
+        par->tail = NULL;
+    par->n_jobs--;
+    return job;
+}
 
-                cur->pos = cur->have = 0;
-                g_free(state->fast_seek_cur);
-                state->fast_seek_cur = cur;
-                fast_seek_header(state, state->raw_pos - state->avail_in, state->pos, GZIP_AFTER_HEADER);
-            }
-#endif
-            return 0;
-        }
-        else {
-            /* not a gzip file -- save first byte (31) and fall to raw i/o */
-            state->out[0] = 31;
-            state->have = 1;
-        }
-    }
-#endif
-#ifdef HAVE_LIBXZ
-    /* { 0xFD, '7', 'z', 'X', 'Z', 0x00 } */
-    /* FD 37 7A 58 5A 00 */
+static void
+gz_par_free(struct gz_par *par)
+{
+    par->cancel = TRUE;
+    while (par->head != NULL)
+        gz_par_job_free(gz_par_next_done(par));
+    if (par->cur != NULL)
+        gz_par_job_free(par->cur);
+    if (par->fill != NULL)
+        gz_par_job_free(par->fill);
+    g_thread_pool_free(par->pool, FALSE, TRUE);
+#if GLIB_CHECK_VERSION(2,31,0)
+    g_mutex_clear(par->mtx);
+    g_free(par->mtx);
+    g_cond_clear(par->cond);
+    g_free(par->cond);
+#else
+    g_mutex_free(par->mtx);
+    g_cond_free(par->cond);
 #endif
-    if (state->fast_seek)
-        fast_seek_header(state, state->raw_pos - state->avail_in - state->have, state->pos, UNCOMPRESSED);
+    g_free(par);
+}
 
-    /* doing raw i/o, save start of raw data for seeking, copy any leftover
-       input to output -- this assumes that the output buffer is larger than
-       the input buffer, which also assures space for gzungetc() */
-    state->raw = state->pos;
-    state->next = state->out;
-    if (state->avail_in) {
-        memcpy(state->next + state->have, state->next_in, state->avail_in);
-        state->have += state->avail_in;
-        state->avail_in = 0;
+static void
+gz_par_inflate_member(struct gz_par_job *job)
+{
+    z_stream strm;
+    int ret;
+
+    memset(&strm, 0, sizeof strm);
+    if (inflateInit2(&strm, 15 + 16) != Z_OK) {     /* gzip wrapper */
+        job->err = ENOMEM;
+        return;
     }
-    state->compression = UNCOMPRESSED;
-    return 0;
+    strm.next_in = job->in;
+    strm.avail_in = job->in_len;
+    strm.next_out = job->out;
+    strm.avail_out = job->out_len + 1;  /* so we notice if there's too much */
+    ret = inflate(&strm, Z_FINISH);
+    if (ret != Z_STREAM_END) {
+        job->err = WTAP_ERR_DECOMPRESS;
+        job->err_info = strm.msg != NULL ? strm.msg : "gzip member is bad";
+    } else if (strm.total_out != job->out_len || strm.avail_in != 0) {
+        job->err = WTAP_ERR_DECOMPRESS;
+        job->err_info = "length field wrong";
+    }
+    inflateEnd(&strm);
 }
 
-static int /* gz_make */
-fill_out_buffer(FILE_T state)
+/*
+ * Inflate the data from one fast seek point to the next.  The CRC saved
+ * with the next point, or the member's trailer if the span runs to the
+ * end of the member, is checked, so seek points that don't go with the
+ * file are caught.
+ */
+static void
+gz_par_inflate_span(struct gz_par_job *job)
 {
-    if (state->compression == UNKNOWN) {           /* look for gzip header */
-        if (gz_head(state) == -1)
-            return -1;
-        if (state->have)                /* got some data from gz_head() */
-            return 0;
+    const struct fast_seek_point *here = job->point;
+    z_stream strm;
+    guint32 crc, len;
+    int ret;
+
+    memset(&strm, 0, sizeof strm);
+    if (inflateInit2(&strm, -15) != Z_OK) {         /* raw deflate */
+        job->err = ENOMEM;
+        return;
     }
-    if (state->compression == UNCOMPRESSED) {           /* straight copy */
-        if (raw_read(state, state->out, state->size /* << 1 */, &(state->have)) == -1)
-            return -1;
-        state->next = state->out;
+    strm.next_in = job->in;
+    strm.avail_in = job->in_len;
+    if (here->compression == GZIP_AFTER_HEADER) {
+        crc = (guint32)crc32(0L, Z_NULL, 0);
+        len = 0;
+    } else {
+#ifdef HAVE_INFLATEPRIME
+        if (here->data.zlib.bits) {
+            (void)inflatePrime(&strm, here->data.zlib.bits,
+                               strm.next_in[0] >> (8 - here->data.zlib.bits));
+            strm.next_in++;
+            strm.avail_in--;
+        }
+#endif
+        (void)inflateSetDictionary(&strm, here->data.zlib.window, ZLIB_WINSIZE);
+        crc = here->data.zlib.adler;
+        len = here->data.zlib.total_out;
     }
-#ifdef HAVE_LIBZ
-    else if (state->compression == ZLIB) {      /* decompress */
-        zlib_read(state, state->out, state->size << 1);
+    strm.next_out = job->out;
+    strm.avail_out = job->out_len;
+    if (job->member_end)
+        strm.avail_out++;       /* room to see the end of the stream */
+    ret = inflate(&strm, Z_NO_FLUSH);
+    if (ret == Z_DATA_ERROR || ret == Z_NEED_DICT) {
+        job->err = WTAP_ERR_DECOMPRESS;
+        job->err_info = strm.msg != NULL ? strm.msg : "gzip data is bad";
+    } else if (ret == Z_MEM_ERROR) {
+        job->err = ENOMEM;
+    } else if (strm.total_out != job->out_len ||
+               (ret == Z_STREAM_END) != job->member_end ||
+               (job->member_end && strm.avail_in < 8)) {
+        job->err = WTAP_ERR_DECOMPRESS;
+        job->err_info = "fast seek points don't match the file";
+    } else {
+        crc = (guint32)crc32(crc, job->out, job->out_len);
+        len += job->out_len;
+        if (!job->member_end) {
+            if (crc != job->end_crc) {
+                job->err = WTAP_ERR_DECOMPRESS;
+                job->err_info = "bad CRC";
+            }
+        } else if (crc != pletoh32(strm.next_in)) {
+            job->err = WTAP_ERR_DECOMPRESS;
+            job->err_info = "bad CRC";
+        } else if (len != pletoh32(strm.next_in + 4)) {
+            job->err = WTAP_ERR_DECOMPRESS;
+            job->err_info = "length field wrong";
+        }
     }
-#endif
-    return 0;
+    inflateEnd(&strm);
+}
+
+/* Runs on a pool thread. */
+static void
+gz_par_inflate(gpointer data, gpointer user_data)
+{
+    struct gz_par_job *job = (struct gz_par_job *)data;
+    struct gz_par *par = (struct gz_par *)user_data;
+
+    if (!par->cancel) {
+        if (job->point != NULL)
+            gz_par_inflate_span(job);
+        else
+            gz_par_inflate_member(job);
+    }
+    g_free(job->in);
+    job->in = NULL;
+    gz_par_job_done(par, job);
 }
 
+/* Read exactly count bytes, unless we get an error or reach the end
+   of the file; return the number read, or -1 on an error. */
 static int
-gz_skip(FILE_T state, gint64 len)
+gz_par_read(int fd, unsigned char *buf, guint count)
 {
-    guint n;
+    guint got = 0;
+    int ret;
 
-    /* skip over len bytes or reach end-of-file, whichever comes first */
-    while (len)
-        if (state->have) {
+    while (got < count) {
+        ret = ws_read(fd, buf + got, count - got);
+        if (ret <= 0)
+            return ret < 0 ? -1 : (int)got;
+        got += ret;
+    }
+    return (int)got;
+}
+
+/*
+ * Read the member at raw_next and set a thread inflating it.  If it
+ * isn't one we can handle that way, or we're at the end of the file or
+ * get an error, set raw_done; the sequential code picks up from there.
+ */
+static void
+gz_par_read_member(FILE_T state)
+{
+    struct gz_par *par = state->par;
+    struct gz_par_job *job;
+    unsigned char fixed[12];
+    guint xlen, sublen, pos, member_len, hdr_len;
+    guint32 isize;
+
+    if (gz_par_read(state->fd, fixed, sizeof fixed) != (int)sizeof fixed ||
+        fixed[0] != 31 || fixed[1] != 139 || fixed[2] != 8 ||
+        fixed[3] != 4) {        /* only an extra field in the header */
+        par->raw_done = TRUE;
+        return;
+    }
+    xlen = pletoh16(&fixed[10]);
+    hdr_len = 12 + xlen;
+
+    job = g_new0(struct gz_par_job, 1);
+    job->in = (unsigned char *)g_malloc(hdr_len);
+    memcpy(job->in, fixed, sizeof fixed);
+    if (gz_par_read(state->fd, job->in + 12, xlen) != (int)xlen) {
+        gz_par_job_free(job);
+        par->raw_done = TRUE;
+        return;
+    }
+
+    member_len = 0;
+    for (pos = 12; pos + 4 <= hdr_len; pos += 4 + sublen) {
+        sublen = pletoh16(&job->in[pos + 2]);
+        if (pos + 4 + sublen > hdr_len)
+            break;
+        if (job->in[pos] == 'B' && job->in[pos + 1] == 'C' && sublen == 2)
+            member_len = pletoh16(&job->in[pos + 4]) + 1;
+    }
+    if (member_len < hdr_len + 8 || member_len > GZ_PAR_MAX_MEMBER) {
+        gz_par_job_free(job);
+        par->raw_done = TRUE;
+        return;
+    }
+
+    job->in = (unsigned char *)g_realloc(job->in, member_len);
+    if (gz_par_read(state->fd, job->in + hdr_len, member_len - hdr_len) !=
+        (int)(member_len - hdr_len)) {
+        gz_par_job_free(job);
+        par->raw_done = TRUE;
+        return;
+    }
+    isize = pletoh32(&job->in[member_len - 4]);
+    if (isize > GZ_PAR_MAX_MEMBER) {
+        gz_par_job_free(job);
+        par->raw_done = TRUE;
+        return;
+    }
+
+    job->raw_start = par->raw_next;
+    job->raw_len = member_len;
+    job->hdr_len = hdr_len;
+    job->in_len = member_len;
+    job->out = (unsigned char *)g_malloc(isize + 1);
+    job->out_len = isize;
+    par->raw_next += member_len;
+    gz_par_submit(par, job);
+}
+
+/*
+ * Read the span from the fast seek point at next_point to the one after
+ * it and set a thread inflating it.  If there's no point after it, or
+ * the span isn't one we can handle that way, or we get an error, set
+ * raw_done; gz_par_resume() picks up from that point.
+ */
+static void
+gz_par_read_span(FILE_T state)
+{
+    struct gz_par *par = state->par;
+    struct gz_par_job *job;
+    const struct fast_seek_point *here, *next;
+    gint64 start, in_len, out_len;
+
+    if (par->next_point + 1 >= state->fast_seek->len) {
+        par->raw_done = TRUE;
+        return;
+    }
+    here = (const struct fast_seek_point *)state->fast_seek->pdata[par->next_point];
+    next = (const struct fast_seek_point *)state->fast_seek->pdata[par->next_point + 1];
+    if (next->compression != ZLIB && next->compression != GZIP_AFTER_HEADER) {
+        par->raw_done = TRUE;
+        return;
+    }
+
+    start = here->in;
+#ifdef HAVE_INFLATEPRIME
+    if (here->compression == ZLIB && here->data.zlib.bits)
+        start--;
+#endif
+    in_len = next->in - start;
+    out_len = next->out - here->out;
+    if (in_len <= 0 || in_len > GZ_PAR_MAX_MEMBER || out_len > GZ_PAR_MAX_MEMBER) {
+        par->raw_done = TRUE;
+        return;
+    }
+
+    job = g_new0(struct gz_par_job, 1);
+    job->in = (unsigned char *)g_malloc((gsize)in_len);
+    if (ws_lseek64(state->fd, start, SEEK_SET) == -1 ||
+        gz_par_read(state->fd, job->in, (guint)in_len) != (int)in_len) {
+        gz_par_job_free(job);
+        par->raw_done = TRUE;
+        return;
+    }
+
+    job->raw_start = start;
+    job->raw_len = (guint)in_len;
+    job->in_len = (guint)in_len;
+    job->point = here;
+    job->member_end = next->compression == GZIP_AFTER_HEADER;
+    if (!job->member_end)
+        job->end_crc = next->data.zlib.adler;
+    job->out = (unsigned char *)g_malloc((gsize)out_len + 1);
+    job->out_len = (guint)out_len;
+    par->next_point++;
+    gz_par_submit(par, job);
+}
+
+/*
+ * If fast seek points saved by an earlier read have been loaded, and
+ * they go past where we are, carry on inflating from the last one at or
+ * before here in parallel, if we can.
+ */
+static gboolean
+gz_par_start_points(FILE_T state)
+{
+    const struct fast_seek_point *item;
+    guint low, i, max;
+
+    if (state->is_random || state->fast_seek == NULL || state->fast_seek->len < 2)
+        return FALSE;
+    item = (const struct fast_seek_point *)state->fast_seek->pdata[state->fast_seek->len - 1];
+    if (item->out <= state->pos)
+        return FALSE;       /* we're adding them as we go */
+
+    for (low = 0, max = state->fast_seek->len; low < max; ) {
+        i = (low + max) / 2;
+        item = (const struct fast_seek_point *)state->fast_seek->pdata[i];
+
+        if (item->out <= state->pos)
+            low = i + 1;
+        else
+            max = i;
+    }
+    if (low == 0)
+        return FALSE;
+    item = (const struct fast_seek_point *)state->fast_seek->pdata[low - 1];
+    if (item->out == state->par_point_tried ||
+        (item->compression != ZLIB && item->compression != GZIP_AFTER_HEADER))
+        return FALSE;
+
+    /* Try each point only once, so that we don't keep coming back to
+       one we can't read spans from. */
+    state->par_point_tried = item->out;
+    state->par = gz_par_new(gz_par_inflate);
+    if (state->par == NULL)
+        return FALSE;
+    state->par->spans = TRUE;
+    state->par->next_point = low - 1;
+    state->par->discard = (guint)(state->pos - item->out);
+    state->next = state->out;
+    state->have = 0;
+    state->compression = GZIP_PARALLEL;
+    return TRUE;
+}
+
+/*
+ * Start reading a file whose first member starts at member_start in
+ * parallel, if we can.
+ */
+static gboolean
+gz_par_start(FILE_T state, gint64 member_start)
+{
+    ws_statb64 st;
+
+    if (state->is_random || member_start == state->par_give_up)
+        return FALSE;
+
+    /* We read the members ourselves, starting with this one again. */
+    if (ws_fstat64(state->fd, &st) == -1 || !S_ISREG(st.st_mode))
+        return FALSE;
+    state->par = gz_par_new(gz_par_inflate);
+    if (state->par == NULL)
+        return FALSE;
+    if (ws_lseek64(state->fd, member_start, SEEK_SET) == -1) {
+        gz_par_free(state->par);
+        state->par = NULL;
+        return FALSE;
+    }
+
+    state->par->raw_next = member_start;
+    state->raw_pos = member_start;
+    state->avail_in = 0;
+    state->next = state->out;
+    state->have = 0;
+    state->compression = GZIP_PARALLEL;
+    state->is_compressed = TRUE;
+    return TRUE;
+}
+
+/* Stop reading in parallel, and forget about the members in flight. */
+static void
+gz_par_stop(FILE_T state)
+{
+    if (state->par != NULL) {
+        gz_par_free(state->par);
+        state->par = NULL;
+        state->next = state->out;
+        state->have = 0;
+    }
+}
+
+/*
+ * Carry on inflating serially, from where we were if we haven't handed
+ * out any spans, or from the fast seek point we couldn't read a span
+ * from.
+ */
+static int
+gz_par_resume(FILE_T state)
+{
+    const struct fast_seek_point *here;
+    gint64 off;
+
+    if (!state->par->handed_out) {
+        /* The inflate stream and input buffer are as we left them. */
+        gz_par_stop(state);
+        if (ws_lseek64(state->fd, state->raw_pos, SEEK_SET) == -1) {
+            state->err = errno;
+            state->err_info = NULL;
+            return -1;
+        }
+        state->compression = ZLIB;
+        return 0;
+    }
+
+    here = (const struct fast_seek_point *)state->fast_seek->pdata[state->par->next_point];
+    gz_par_stop(state);
+
+    off = here->in;
+#ifdef HAVE_INFLATEPRIME
+    if (here->compression == ZLIB && here->data.zlib.bits)
+        off--;
+#endif
+    if (ws_lseek64(state->fd, off, SEEK_SET) == -1) {
+        state->err = errno;
+        state->err_info = NULL;
+        return -1;
+    }
+    state->raw_pos = off;
+    state->avail_in = 0;
+    state->eof = FALSE;
+    g_free(state->fast_seek_cur);
+    state->fast_seek_cur = NULL;
+    return zlib_restore(state, here);
+}
+
+/* Hand out the next member or span. */
+static int
+gz_par_fill(FILE_T state)
+{
+    struct gz_par *par = state->par;
+    struct gz_par_job *job;
+    gint64 raw_next;
+    guint n;
+
+    if (par->cur != NULL) {
+        gz_par_job_free(par->cur);
+        par->cur = NULL;
+    }
+
+    /* Read further ahead each time, so that a few small reads from
+       the start of the file, e.g. when it's being opened, don't set
+       all the threads going. */
+    while (!par->raw_done && par->n_jobs < par->depth) {
+        if (par->spans)
+            gz_par_read_span(state);
+        else
+            gz_par_read_member(state);
+    }
+    if (par->depth < par->max_jobs)
+        par->depth *= 2;
+
+    if (par->head == NULL) {
+        if (par->spans)
+            return gz_par_resume(state);
+
+        /* Carry on, from the member we couldn't handle, as usual. */
+        raw_next = par->raw_next;
+        gz_par_stop(state);
+        if (ws_lseek64(state->fd, raw_next, SEEK_SET) == -1) {
+            state->err = errno;
+            state->err_info = NULL;
+            return -1;
+        }
+        state->par_give_up = raw_next;
+        state->raw_pos = raw_next;
+        state->avail_in = 0;
+        state->compression = UNKNOWN;
+        return 0;
+    }
+
+    job = gz_par_next_done(par);
+    if (job->err != 0) {
+        state->err = job->err;
+        state->err_info = job->err_info;
+        gz_par_job_free(job);
+        return -1;
+    }
+    if (state->fast_seek && job->point == NULL)
+        fast_seek_header(state, job->raw_start + job->hdr_len, state->pos, GZIP_AFTER_HEADER);
+    state->raw_pos = job->raw_start + job->raw_len;
+    state->next = job->out;
+    state->have = job->out_len;
+    if (par->discard != 0) {
+        n = MIN(par->discard, state->have);
+        state->next += n;
+        state->have -= n;
+        par->discard -= n;
+    }
+    par->handed_out = TRUE;
+    par->cur = job;
+    return 0;
+}
+
+/* Skip an extra field of length xlen, noting the member length if it
+   has a BGZF subfield giving that.  Return 0 on success, -1 on error. */
+static int
+gz_skip_extra(FILE_T state, guint16 xlen, guint32 *member_len)
+{
+    guint8 si1, si2;
+    guint16 sublen, bsize;
+
+    while (xlen >= 4) {
+        if (gz_next1(state, &si1) == -1 || gz_next1(state, &si2) == -1 ||
+            gz_next2(state, &sublen) == -1)
+            return -1;
+        xlen -= 4;
+        if (sublen > xlen)
+            break;
+        if (si1 == 'B' && si2 == 'C' && sublen == 2) {
+            if (gz_next2(state, &bsize) == -1)
+                return -1;
+            *member_len = (guint32)bsize + 1;
+        } else if (gz_skipn(state, sublen) == -1)
+            return -1;
+        xlen -= sublen;
+    }
+    return gz_skipn(state, xlen);
+}
+#endif
+
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+/* Make sure there are at least n bytes in the input buffer, unless we
+   reach the end of the file.  Return -1, and set state->err, on error;
+   return 0 otherwise. */
+static int
+fill_in_buffer_min(FILE_T state, guint n)
+{
+    guint got;
+
+    if (state->err)
+        return -1;
+    if (state->avail_in >= n || state->eof)
+        return 0;
+    if (state->avail_in != 0)
+        memmove(state->in, state->next_in, state->avail_in);
+    state->next_in = state->in;
+    if (raw_read(state, state->in + state->avail_in,
+                 state->size - state->avail_in, &got) == -1)
+        return -1;
+    state->avail_in += got;
+    return 0;
+}
+
+/* Skip a skippable frame, whose magic number is at next_in.  Return -1,
+   and set state->err, on error; return 0 otherwise. */
+static int
+skip_skippable_frame(FILE_T state)
+{
+    guint32 len;
+    guint n;
+
+    if (fill_in_buffer_min(state, 8) == -1)
+        return -1;
+    if (state->avail_in < 8) {
+        state->err = WTAP_ERR_SHORT_READ;
+        state->err_info = NULL;
+        return -1;
+    }
+    len = pletoh32(state->next_in + 4);
+    state->next_in += 8;
+    state->avail_in -= 8;
+    while (len != 0) {
+        if (state->avail_in == 0 && fill_in_buffer(state) == -1)
+            return -1;
+        if (state->avail_in == 0) {
+            state->err = WTAP_ERR_SHORT_READ;
+            state->err_info = NULL;
+            return -1;
+        }
+        n = state->avail_in > len ? len : state->avail_in;
+        state->next_in += n;
+        state->avail_in -= n;
+        len -= n;
+    }
+    return 0;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+/*
+ * If a Zstandard file that starts at in_pos ends with a seek table,
+ * add a fast seek point at the start of each of its frames, so that
+ * it can be read randomly without having been read sequentially.
+ */
+static void
+zstd_seek_table_load(FILE_T state, gint64 in_pos)
+{
+    ws_statb64 st;
+    guint8 footer[ZSTD_SEEK_FOOTER_LEN];
+    guint8 header[8];
+    guint8 *table = NULL;
+    guint32 nframes, entry_len, i;
+    gint64 table_len, frames_end, in, out;
+
+    if (ws_fstat64(state->fd, &st) == -1 || !S_ISREG(st.st_mode) ||
+        st.st_size < in_pos + 8 + ZSTD_SEEK_FOOTER_LEN)
+        return;
+
+    if (ws_lseek64(state->fd, st.st_size - ZSTD_SEEK_FOOTER_LEN, SEEK_SET) == -1 ||
+        ws_read(state->fd, footer, sizeof footer) != (int)sizeof footer ||
+        pletoh32(&footer[5]) != ZSTD_SEEKABLE_MAGIC ||
+        (footer[4] & 0x7C) != 0)                /* reserved bits */
+        goto done;
+    nframes = pletoh32(&footer[0]);
+    entry_len = (footer[4] & 0x80) ? 12 : 8;    /* with or without checksums */
+    table_len = (gint64)nframes * entry_len + ZSTD_SEEK_FOOTER_LEN;
+    frames_end = st.st_size - table_len - 8;
+    if (nframes == 0 || frames_end < in_pos)
+        goto done;
+
+    if (ws_lseek64(state->fd, frames_end, SEEK_SET) == -1 ||
+        ws_read(state->fd, header, sizeof header) != (int)sizeof header ||
+        pletoh32(&header[0]) != ZSTD_SEEK_TABLE_MAGIC ||
+        pletoh32(&header[4]) != table_len)
+        goto done;
+    table = (guint8 *)g_try_malloc((gsize)(table_len - ZSTD_SEEK_FOOTER_LEN));
+    if (table == NULL ||
+        ws_read(state->fd, table, (unsigned int)(table_len - ZSTD_SEEK_FOOTER_LEN)) !=
+            (int)(table_len - ZSTD_SEEK_FOOTER_LEN))
+        goto done;
+
+    /* The frames must exactly fill the space before the table. */
+    in = in_pos;
+    for (i = 0; i < nframes; i++)
+        in += pletoh32(&table[i * entry_len]);
+    if (in != frames_end)
+        goto done;
+
+    in = in_pos;
+    out = state->pos;
+    for (i = 0; i < nframes; i++) {
+        fast_seek_header(state, in, out, ZSTD);
+        in += pletoh32(&table[i * entry_len]);
+        out += pletoh32(&table[i * entry_len + 4]);
+    }
+
+done:
+    g_free(table);
+    /* Carry on reading where we were. */
+    if (ws_lseek64(state->fd, state->raw_pos, SEEK_SET) == -1) {
+        state->err = errno;
+        state->err_info = NULL;
+    }
+}
+
+/* Get ready to decompress a Zstandard frame.  Return -1, and set
+   state->err, on error; return 0 on success. */
+static int
+zstd_begin(FILE_T state)
+{
+    if (state->zstd_dctx == NULL) {
+        state->zstd_dctx = ZSTD_createDStream();
+        if (state->zstd_dctx == NULL) {
+            state->err = ENOMEM;
+            state->err_info = NULL;
+            return -1;
+        }
+    }
+    if (ZSTD_isError(ZSTD_initDStream(state->zstd_dctx))) {
+        /* This "shouldn't happen". */
+        state->err = WTAP_ERR_INTERNAL;
+        state->err_info = NULL;
+        return -1;
+    }
+    state->compression = ZSTD;
+    state->is_compressed = TRUE;
+    return 0;
+}
+
+static void
+zstd_read(FILE_T state, unsigned char *buf, unsigned int count)
+{
+    ZSTD_inBuffer input;
+    ZSTD_outBuffer output;
+    size_t ret = 1;
+
+    output.dst = buf;
+    output.size = count;
+    output.pos = 0;
+
+    /* fill output buffer up to end of frame or error */
+    do {
+        /* get more input */
+        if (state->avail_in == 0 && fill_in_buffer(state) == -1)
+            break;
+        if (state->avail_in == 0) {
+            /* EOF */
+            state->err = WTAP_ERR_SHORT_READ;
+            state->err_info = NULL;
+            break;
+        }
+
+        input.src = state->next_in;
+        input.size = state->avail_in;
+        input.pos = 0;
+        ret = ZSTD_decompressStream(state->zstd_dctx, &output, &input);
+        state->next_in += input.pos;
+        state->avail_in -= (guint)input.pos;
+        if (ZSTD_isError(ret)) {
+            state->err = WTAP_ERR_DECOMPRESS;
+            state->err_info = ZSTD_getErrorName(ret);
+            break;
+        }
+    } while (output.pos < output.size && ret != 0);
+
+    state->next = buf;
+    state->have = (guint)output.pos;
+
+    /* Another frame, or something else, may follow this one. */
+    if (ret == 0)
+        state->compression = UNKNOWN;      /* ready for next frame, once have is 0 */
+}
+#endif
+
+#ifdef HAVE_LZ4
+/* Get ready to decompress an LZ4 frame.  Return -1, and set state->err,
+   on error; return 0 on success. */
+static int
+lz4_begin(FILE_T state)
+{
+    /* Start afresh, in case we were in the middle of another frame. */
+    if (state->lz4_dctx != NULL) {
+        LZ4F_freeDecompressionContext(state->lz4_dctx);
+        state->lz4_dctx = NULL;
+    }
+    if (LZ4F_isError(LZ4F_createDecompressionContext(&state->lz4_dctx, LZ4F_VERSION))) {
+        state->lz4_dctx = NULL;
+        state->err = ENOMEM;
+        state->err_info = NULL;
+        return -1;
+    }
+    state->compression = LZ4;
+    state->is_compressed = TRUE;
+    return 0;
+}
+
+static void
+lz4_read(FILE_T state, unsigned char *buf, unsigned int count)
+{
+    size_t ret = 1;
+    size_t in_len, out_len;
+    unsigned int got = 0;
+
+    /* fill output buffer up to end of frame or error */
+    do {
+        /* get more input */
+        if (state->avail_in == 0 && fill_in_buffer(state) == -1)
+            break;
+        if (state->avail_in == 0) {
+            /* EOF */
+            state->err = WTAP_ERR_SHORT_READ;
+            state->err_info = NULL;
+            break;
+        }
+
+        in_len = state->avail_in;
+        out_len = count - got;
+        ret = LZ4F_decompress(state->lz4_dctx, buf + got, &out_len,
+                              state->next_in, &in_len, NULL);
+        state->next_in += in_len;
+        state->avail_in -= (guint)in_len;
+        got += (unsigned int)out_len;
+        if (LZ4F_isError(ret)) {
+            state->err = WTAP_ERR_DECOMPRESS;
+            state->err_info = LZ4F_getErrorName(ret);
+            break;
+        }
+    } while (got < count && ret != 0);
+
+    state->next = buf;
+    state->have = got;
+
+    /* Another frame, or something else, may follow this one. */
+    if (ret == 0)
+        state->compression = UNKNOWN;      /* ready for next frame, once have is 0 */
+}
+#endif
+
+static int
+gz_head(FILE_T state)
+{
+    /* get some data in the input buffer */
+    if (state->avail_in == 0) {
+        if (fill_in_buffer(state) == -1)
+            return -1;
+        if (state->avail_in == 0)
+            return 0;
+    }
+
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+    /* look for the magic number at the start of a Zstandard or LZ4 frame */
+    if (fill_in_buffer_min(state, 4) == -1)
+        return -1;
+    if (state->avail_in >= 4) {
+        guint32 magic = pletoh32(state->next_in);
+
+#ifdef HAVE_ZSTD
+        if (magic == ZSTD_FRAME_MAGIC) {
+            gint64 frame_start = state->raw_pos - state->avail_in;
+
+            if (state->fast_seek) {
+                if (state->fast_seek->len == 0)
+                    zstd_seek_table_load(state, frame_start);
+                fast_seek_header(state, frame_start, state->pos, ZSTD);
+            }
+            return zstd_begin(state);
+        }
+#endif
+#ifdef HAVE_LZ4
+        if (magic == LZ4_FRAME_MAGIC) {
+            if (state->fast_seek)
+                fast_seek_header(state, state->raw_pos - state->avail_in, state->pos, LZ4);
+            return lz4_begin(state);
+        }
+#endif
+        /* Skippable frames, such as the seek table at the end of a
+           seekable Zstandard file, can come between compressed frames. */
+        if (state->is_compressed &&
+            (magic & SKIPPABLE_FRAME_MASK) == SKIPPABLE_FRAME_MAGIC)
+            return skip_skippable_frame(state);
+    }
+#endif
+
+    /* look for the gzip magic header bytes 31 and 139 */
+#ifdef HAVE_LIBZ
+    if (state->next_in[0] == 31) {
+        state->avail_in--;
+        state->next_in++;
+        if (state->avail_in == 0 && fill_in_buffer(state) == -1)
+            return -1;
+        if (state->avail_in && state->next_in[0] == 139) {
+            guint8 cm;
+            guint8 flags;
+            guint16 len;
+            guint16 hcrc;
+            gint64 member_start;
+            guint32 member_len = 0;
+
+            /* we have a gzip header, woo hoo! */
+            state->avail_in--;
+            state->next_in++;
+            member_start = state->raw_pos - state->avail_in - 2;
+
+            /* read rest of header */
+
+            /* compression method (CM) */
+            if (gz_next1(state, &cm) == -1)
+                return -1;
+            if (cm != 8) {
+                state->err = WTAP_ERR_DECOMPRESS;
+                state->err_info = "unknown compression method";
+                return -1;
+            }
+
+            /* flags (FLG) */
+            if (gz_next1(state, &flags) == -1)
+                return -1;
+            if (flags & 0xe0) {     /* reserved flag bits */
+                state->err = WTAP_ERR_DECOMPRESS;
+                state->err_info = "reserved flag bits set";
+                return -1;
+            }
+
+            /* modification time (MTIME) */
+            if (gz_skipn(state, 4) == -1)
+                return -1;
+
+            /* extra flags (XFL) */
+            if (gz_skipn(state, 1) == -1)
+                return -1;
+
+            /* operating system (OS) */
+            if (gz_skipn(state, 1) == -1)
+                return -1;
+
+            if (flags & 4) {
+                /* extra field - get XLEN */
+                if (gz_next2(state, &len) == -1)
+                    return -1;
+
+                /* skip the extra field */
+                if (gz_skip_extra(state, len, &member_len) == -1)
+                    return -1;
+            }
+            if (flags & 8) {
+                /* file name */
+                if (gz_skipzstr(state) == -1)
+                    return -1;
+            }
+            if (flags & 16) {
+                /* comment */
+                if (gz_skipzstr(state) == -1)
+                    return -1;
+            }
+            if (flags & 2) {
+                /* header crc */
+                if (gz_next2(state, &hcrc) == -1)
+                    return -1;
+                /* XXX - check the CRC? */
+            }
+
+            /* if the members say how long they are, inflate them in parallel */
+            if (member_len != 0 && flags == 4 &&
+                gz_par_start(state, member_start))
+                return 0;
+
+            /* set up for decompression */
+            inflateReset(&(state->strm));
+            state->strm.adler = crc32(0L, Z_NULL, 0);
+            state->compression = ZLIB;
+            state->is_compressed = TRUE;
+#ifdef Z_BLOCK
+            if (state->fast_seek) {
+                struct zlib_cur_seek_point *cur = g_new(struct zlib_cur_seek_point,1);
+
+                cur->pos = cur->have = 0;
+                g_free(state->fast_seek_cur);
+                state->fast_seek_cur = cur;
+                fast_seek_header(state, state->raw_pos - state->avail_in, state->pos, GZIP_AFTER_HEADER);
+            }
+#endif
+            return 0;
+        }
+        else {
+            /* not a gzip file -- save first byte (31) and fall to raw i/o */
+            state->out[0] = 31;
+            state->have = 1;
+        }
+    }
+#endif
+#ifdef HAVE_LIBXZ
+    /* { 0xFD, '7', 'z', 'X', 'Z', 0x00 } */
+    /* FD 37 7A 58 5A 00 */
+#endif
+    if (state->fast_seek)
+        fast_seek_header(state, state->raw_pos - state->avail_in - state->have, state->pos, UNCOMPRESSED);
+
+    /* doing raw i/o, save start of raw data for seeking, copy any leftover
+       input to output -- this assumes that the output buffer is larger than
+       the input buffer, which also assures space for gzungetc() */
+    state->raw = state->pos;
+    state->next = state->out;
+    if (state->avail_in) {
+        memcpy(state->next + state->have, state->next_in, state->avail_in);
+        state->have += state->avail_in;
+        state->avail_in = 0;
+    }
+    state->compression = UNCOMPRESSED;
+#ifdef HAVE_MMAP
+    map_file(state);
+#endif
+    return 0;
+}
+
+static int /* gz_make */
+fill_out_buffer(FILE_T state)
+{
+    if (state->compression == UNKNOWN) {           /* look for gzip header */
+        if (gz_head(state) == -1)
+            return -1;
+        if (state->have)                /* got some data from gz_head() */
+            return 0;
+    }
+    if (state->compression == UNCOMPRESSED) {           /* straight copy */
+#ifdef HAVE_MMAP
+        if (state->map != NULL) {
+            map_fill(state);
+            return 0;
+        }
+#endif
+        if (raw_read(state, state->out, state->size /* << 1 */, &(state->have)) == -1)
+            return -1;
+        state->next = state->out;
+    }
+#ifdef HAVE_LIBZ
+    else if (state->compression == ZLIB) {      /* decompress */
+        /* if seek points saved by an earlier read go past here,
+           inflate from them in parallel */
+        if (gz_par_start_points(state))
+            return 0;
+        zlib_read(state, state->out, state->size << 1);
+    }
+    else if (state->compression == GZIP_PARALLEL) {
+        if (gz_par_fill(state) == -1)
+            return -1;
+    }
+#endif
+#ifdef HAVE_ZSTD
+    else if (state->compression == ZSTD) {
+        zstd_read(state, state->out, state->size << 1);
+    }
+#endif
+#ifdef HAVE_LZ4
+    else if (state->compression == LZ4) {
+        lz4_read(state, state->out, state->size << 1);
+    }
+#endif
+    return 0;
+}
+
+static int
+gz_skip(FILE_T state, gint64 len)
+{
+    guint n;
+
+    /* skip over len bytes or reach end-of-file, whichever comes first */
+    while (len)
+        if (state->have) {
             /* We have stuff in the output buffer; skip over
                it. */
             n = (gint64)state->have > len ? (unsigned)len : state->have;
@@ -766,6 +1986,9 @@ gz_skip(FILE_T state, gint64 len)
 static void
 gz_reset(FILE_T state)
 {
+#ifdef HAVE_LIBZ
+    gz_par_stop(state);           /* no members in flight */
+#endif
     state->have = 0;              /* no output data available */
     state->eof = FALSE;           /* not at end of file */
     state->compression = UNKNOWN; /* look for gzip header */
@@ -796,6 +2019,23 @@ file_fdopen(int fd)
 
     state->fast_seek_cur = NULL;
     state->fast_seek = NULL;
+    state->is_random = FALSE;
+#ifdef HAVE_LIBZ
+    state->par = NULL;
+    state->par_give_up = -1;
+    state->par_point_tried = -1;
+#endif
+#ifdef HAVE_ZSTD
+    state->zstd_dctx = NULL;
+#endif
+#ifdef HAVE_LZ4
+    state->lz4_dctx = NULL;
+#endif
+#ifdef HAVE_MMAP
+    state->map = NULL;
+    state->map_size = 0;
+    state->no_map = FALSE;
+#endif
 
     /* open the file with the appropriate mode (or just use fd) */
     state->fd = fd;
@@ -913,11 +2153,194 @@ file_open(const char *path)
 }
 
 void
-file_set_random_access(FILE_T stream, gboolean random_flag _U_, GPtrArray *seek)
+file_set_random_access(FILE_T stream, gboolean random_flag, GPtrArray *seek)
 {
+    stream->is_random = random_flag;
     stream->fast_seek = seek;
 }
 
+/*
+ * Saving and restoring fast seek points, so that a file that's been read
+ * once needn't be read all the way through again before we can seek in
+ * it.  The points are written as a count followed by, for each point:
+ *
+ *     0   offset in the input file (64 bits)
+ *     8   offset in the uncompressed data (64 bits)
+ *    16   compression type (8 bits)
+ *    17   bits from the byte before the input offset (8 bits)
+ *    18   reserved, zero (16 bits)
+ *    20   Adler checksum
+ *    24   total_out
+ *    28   length of the window, deflated
+ *    32   the window, deflated
+ *
+ * all in network byte order; there's no window for points that aren't
+ * in the middle of a zlib stream.  The windows are deflated because
+ * they'd otherwise add about 3% of the uncompressed size of the file.
+ */
+#define FAST_SEEK_POINT_LEN 32
+
+static void
+fast_seek_free_points(GPtrArray *fast_seek)
+{
+    guint i;
+
+    for (i = 0; i < fast_seek->len; i++)
+        g_free(fast_seek->pdata[i]);
+    g_ptr_array_set_size(fast_seek, 0);
+}
+
+gboolean
+file_fast_seek_save(GPtrArray *fast_seek, FILE *fp, int *err)
+{
+    guint8 buf[FAST_SEEK_POINT_LEN];
+#ifdef HAVE_LIBZ
+    unsigned char window[ZLIB_WINSIZE + ZLIB_WINSIZE/1000 + 64];
+    uLongf window_len;
+#endif
+    struct fast_seek_point *item;
+    guint i;
+
+    phton32(buf, fast_seek->len);
+    if (fwrite(buf, 1, 4, fp) != 4) {
+        *err = errno;
+        return FALSE;
+    }
+
+    for (i = 0; i < fast_seek->len; i++) {
+        item = (struct fast_seek_point *)fast_seek->pdata[i];
+
+        memset(buf, 0, sizeof buf);
+        phton32(&buf[0], (guint32)((guint64)item->in >> 32));
+        phton32(&buf[4], (guint32)item->in);
+        phton32(&buf[8], (guint32)((guint64)item->out >> 32));
+        phton32(&buf[12], (guint32)item->out);
+        buf[16] = (guint8)item->compression;
+#ifdef HAVE_LIBZ
+        window_len = 0;
+        if (item->compression == ZLIB) {
+#ifdef HAVE_INFLATEPRIME
+            buf[17] = (guint8)item->data.zlib.bits;
+#endif
+            phton32(&buf[20], item->data.zlib.adler);
+            phton32(&buf[24], item->data.zlib.total_out);
+            window_len = sizeof window;
+            if (compress2(window, &window_len, item->data.zlib.window,
+                          ZLIB_WINSIZE, Z_DEFAULT_COMPRESSION) != Z_OK) {
+                *err = WTAP_ERR_INTERNAL;
+                return FALSE;
+            }
+            phton32(&buf[28], (guint32)window_len);
+        }
+#endif
+        if (fwrite(buf, 1, sizeof buf, fp) != sizeof buf) {
+            *err = errno;
+            return FALSE;
+        }
+#ifdef HAVE_LIBZ
+        if (window_len != 0 && fwrite(window, 1, window_len, fp) != window_len) {
+            *err = errno;
+            return FALSE;
+        }
+#endif
+    }
+    return TRUE;
+}
+
+/*
+ * Replace the fast seek points with ones saved by file_fast_seek_save();
+ * if they can't all be read, leave the points we have alone.
+ */
+gboolean
+file_fast_seek_restore(GPtrArray *fast_seek, FILE *fp)
+{
+    guint8 buf[FAST_SEEK_POINT_LEN];
+#ifdef HAVE_LIBZ
+    unsigned char window[ZLIB_WINSIZE + ZLIB_WINSIZE/1000 + 64];
+    uLongf window_len;
+#endif
+    struct fast_seek_point *item;
+    GPtrArray *points;
+    guint32 count, i, saved_window_len;
+    gint64 last_out = -1;
+
+    if (fread(buf, 1, 4, fp) != 4)
+        return FALSE;
+    count = pntoh32(buf);
+
+    points = g_ptr_array_new();
+    for (i = 0; i < count; i++) {
+        if (fread(buf, 1, sizeof buf, fp) != sizeof buf)
+            goto fail;
+
+        item = g_new(struct fast_seek_point, 1);
+        g_ptr_array_add(points, item);
+        item->in = (gint64)pntoh64(&buf[0]);
+        item->out = (gint64)pntoh64(&buf[8]);
+        if (buf[16] >= NUM_COMPRESSION_TYPES)
+            goto fail;
+        item->compression = (compression_t)buf[16];
+        saved_window_len = pntoh32(&buf[28]);
+        if (item->out <= last_out)
+            goto fail;      /* fast_seek_find() needs them in order */
+        last_out = item->out;
+
+        switch (item->compression) {
+
+        case UNCOMPRESSED:
+            break;
+
+#ifdef HAVE_LIBZ
+        case GZIP_AFTER_HEADER:
+            break;
+
+        case ZLIB:
+#ifdef HAVE_INFLATEPRIME
+            item->data.zlib.bits = buf[17];
+#else
+            if (buf[17] != 0)
+                goto fail;  /* we can't resume in the middle of a byte */
+#endif
+            item->data.zlib.adler = pntoh32(&buf[20]);
+            item->data.zlib.total_out = pntoh32(&buf[24]);
+            if (saved_window_len == 0 || saved_window_len > sizeof window ||
+                fread(window, 1, saved_window_len, fp) != saved_window_len)
+                goto fail;
+            window_len = ZLIB_WINSIZE;
+            if (uncompress(item->data.zlib.window, &window_len, window,
+                           saved_window_len) != Z_OK ||
+                window_len != ZLIB_WINSIZE)
+                goto fail;
+            break;
+#endif
+
+#ifdef HAVE_ZSTD
+        case ZSTD:
+            break;
+#endif
+
+#ifdef HAVE_LZ4
+        case LZ4:
+            break;
+#endif
+
+        default:
+            goto fail;
+        }
+    }
+
+    fast_seek_free_points(fast_seek);
+    for (i = 0; i < points->len; i++)
+        g_ptr_array_add(fast_seek, points->pdata[i]);
+    g_ptr_array_free(points, TRUE);
+    return TRUE;
+
+fail:
+    fast_seek_free_points(points);
+    g_ptr_array_free(points, TRUE);
+    return FALSE;
+}
+
 gint64
 file_seek(FILE_T file, gint64 offset, int whence, int *err)
 {
@@ -949,6 +2372,28 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
         offset += file->skip;
     file->seek_pending = FALSE;
 
+#ifdef HAVE_MMAP
+    if (file->map != NULL && file->compression == UNCOMPRESSED &&
+        !file->is_compressed) {
+        /*
+         * The whole file is mapped, and uncompressed, so just move to
+         * the new position; the next read will hand out data from there.
+         */
+        if (file->pos + offset < 0) {        /* before start of file! */
+            *err = EINVAL;
+            return -1;
+        }
+        file->pos += offset;
+        file->raw_pos = file->start + file->pos;
+        file->have = 0;
+        file->eof = FALSE;
+        file->err = 0;
+        file->err_info = NULL;
+        file->avail_in = 0;
+        return file->pos;
+    }
+#endif
+
     /*
      * Are we seeking backwards and, if so, do we have data in the buffer?
      */
@@ -960,7 +2405,14 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
          * To squelch compiler warnings, we cast the
          * result.
          */
-        guint had = (unsigned)(file->next - file->out);
+        unsigned char *start = file->out;
+        guint had;
+
+#ifdef HAVE_LIBZ
+        if (file->par != NULL && file->par->cur != NULL)
+            start = file->par->cur->out;    /* a member inflated in parallel */
+#endif
+        had = (unsigned)(file->next - start);
 
         /*
          * Do we have enough data before the current position in
@@ -1016,12 +2468,27 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
             off = here->in;
             off2 = here->out;
         } else
+#endif
+#ifdef HAVE_ZSTD
+        if (here->compression == ZSTD) {
+            off = here->in;
+            off2 = here->out;
+        } else
+#endif
+#ifdef HAVE_LZ4
+        if (here->compression == LZ4) {
+            off = here->in;
+            off2 = here->out;
+        } else
 #endif
         {
             off2 = (file->pos + offset);
             off = here->in + (off2 - here->out);
         }
 
+#ifdef HAVE_LIBZ
+        gz_par_stop(file);
+#endif
         if (ws_lseek64(file->fd, off, SEEK_SET) == -1) {
             *err = errno;
             return -1;
@@ -1037,36 +2504,27 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
         file->avail_in = 0;
 
 #ifdef HAVE_LIBZ
-        if (here->compression == ZLIB) {
-            z_stream *strm = &file->strm;
-
-            inflateReset(strm);
-            strm->adler = here->data.zlib.adler;
-            strm->total_out = here->data.zlib.total_out;
-#ifdef HAVE_INFLATEPRIME
-            if (here->data.zlib.bits) {
-                FILE_T state = file;
-                int ret = GZ_GETC();
-
-                if (ret == -1) {
-                    if (state->err == 0) {
-                        /* EOF */
-                        *err = WTAP_ERR_SHORT_READ;
-                    } else
-                        *err = state->err;
-                    return -1;
-                }
-                (void)inflatePrime(strm, here->data.zlib.bits, ret >> (8 - here->data.zlib.bits));
+        if (here->compression == ZLIB || here->compression == GZIP_AFTER_HEADER) {
+            if (zlib_restore(file, here) == -1) {
+                *err = file->err;
+                return -1;
+            }
+        } else
+#endif
+#ifdef HAVE_ZSTD
+        if (here->compression == ZSTD) {
+            if (zstd_begin(file) == -1) {
+                *err = file->err;
+                return -1;
             }
+        } else
 #endif
-            (void)inflateSetDictionary(strm, here->data.zlib.window, ZLIB_WINSIZE);
-            file->compression = ZLIB;
-        } else if (here->compression == GZIP_AFTER_HEADER) {
-            z_stream *strm = &file->strm;
-
-            inflateReset(strm);
-            strm->adler = crc32(0L, Z_NULL, 0);
-            file->compression = ZLIB;
+#ifdef HAVE_LZ4
+        if (here->compression == LZ4) {
+            if (lz4_begin(file) == -1) {
+                *err = file->err;
+                return -1;
+            }
         } else
 #endif
             file->compression = here->compression;
@@ -1432,9 +2890,39 @@ file_clearerr(FILE_T stream)
     stream->eof = FALSE;
 }
 
+/*
+ * Don't memory-map this file, and stop doing so if we already are; used
+ * for files that might be truncated or rewritten while we're reading
+ * them, where touching a mapped page past the new end of the file
+ * would get us a SIGBUS.
+ */
+gboolean
+file_set_no_map(FILE_T file, int *err)
+{
+#ifdef HAVE_MMAP
+    file->no_map = TRUE;
+    if (file->map != NULL) {
+        unmap_file(file);
+        /* We'll be using read(); start where we left off. */
+        if (ws_lseek64(file->fd, file->raw_pos, SEEK_SET) == -1) {
+            *err = errno;
+            return FALSE;
+        }
+    }
+#else
+    (void)file;
+    (void)err;
+#endif
+    return TRUE;
+}
+
 void
 file_fdclose(FILE_T file)
 {
+#ifdef HAVE_MMAP
+    /* The file is about to be replaced; don't keep its old contents. */
+    unmap_file(file);
+#endif
     ws_close(file->fd);
     file->fd = -1;
 }
@@ -1447,6 +2935,23 @@ file_fdreopen(FILE_T file, const char *path)
     if ((fd = ws_open(path, O_RDONLY|O_BINARY, 0000)) == -1)
         return FALSE;
     file->fd = fd;
+#ifdef HAVE_MMAP
+    if (file->compression == UNCOMPRESSED) {
+        map_file(file);
+        if (file->map == NULL) {
+            /* We'll be using read(); start where we left off. */
+            if (ws_lseek64(file->fd, file->raw_pos, SEEK_SET) == -1)
+                return FALSE;
+        }
+    }
+#endif
+#ifdef HAVE_LIBZ
+    if (file->par != NULL) {
+        /* Carry on reading members where we left off. */
+        if (ws_lseek64(file->fd, file->par->raw_next, SEEK_SET) == -1)
+            return FALSE;
+    }
+#endif
     return TRUE;
 }
 
@@ -1464,6 +2969,21 @@ file_close(FILE_T file)
         g_free(file->in);
     }
     g_free(file->fast_seek_cur);
+#ifdef HAVE_LIBZ
+    if (file->par != NULL)
+        gz_par_free(file->par);
+#endif
+#ifdef HAVE_ZSTD
+    if (file->zstd_dctx != NULL)
+        ZSTD_freeDStream(file->zstd_dctx);
+#endif
+#ifdef HAVE_LZ4
+    if (file->lz4_dctx != NULL)
+        LZ4F_freeDecompressionContext(file->lz4_dctx);
+#endif
+#ifdef HAVE_MMAP
+    unmap_file(file);
+#endif
     file->err = 0;
     file->err_info = NULL;
     g_free(file);
@@ -1491,8 +3011,75 @@ struct wtap_writer {
     int err;                /* error code */
     /* zlib deflate stream */
     z_stream strm;          /* stream structure in-place (not a pointer) */
+    /* parallel deflation */
+    struct gz_par *par;     /* blocks in flight, if we're doing that */
 };
 
+/*
+ * Runs on a pool thread; turns a block into a BGZF member, i.e. a
+ * complete gzip member with a "BC" extra subfield giving the length of
+ * the member less 1, so that it can be inflated in parallel when it's
+ * read.  A block of GZ_PAR_BLOCK bytes deflates to no more than
+ * GZ_PAR_MAX_BSIZE - GZ_PAR_HDR_LEN - 8 bytes, even if it doesn't
+ * compress.
+ */
+static void
+gz_par_deflate(gpointer data, gpointer user_data)
+{
+    struct gz_par_job *job = (struct gz_par_job *)data;
+    struct gz_par *par = (struct gz_par *)user_data;
+    static const unsigned char header[GZ_PAR_HDR_LEN - 2] = {
+        31, 139, 8, 4,          /* magic, deflate, FEXTRA */
+        0, 0, 0, 0,             /* no modification time */
+        0, 255,                 /* no extra flags, unknown OS */
+        6, 0,                   /* XLEN */
+        'B', 'C', 2, 0          /* subfield ID and length */
+    };
+    z_stream strm;
+    uLong bound;
+    guint32 crc;
+
+    if (par->cancel)
+        goto done;
+    memset(&strm, 0, sizeof strm);
+    if (deflateInit2(&strm, job->level, Z_DEFLATED, -15, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        job->err = ENOMEM;
+        goto done;
+    }
+    bound = deflateBound(&strm, job->in_len);
+    job->out = (unsigned char *)g_malloc(GZ_PAR_HDR_LEN + bound + 8);
+    strm.next_in = job->in;
+    strm.avail_in = job->in_len;
+    strm.next_out = job->out + GZ_PAR_HDR_LEN;
+    strm.avail_out = (uInt)bound;
+    if (deflate(&strm, Z_FINISH) != Z_STREAM_END) {
+        /* This "shouldn't happen". */
+        job->err = WTAP_ERR_INTERNAL;
+        deflateEnd(&strm);
+        goto done;
+    }
+    job->out_len = GZ_PAR_HDR_LEN + (guint)strm.total_out + 8;
+    deflateEnd(&strm);
+    if (job->out_len > GZ_PAR_MAX_BSIZE) {
+        /* This "shouldn't happen" either. */
+        job->err = WTAP_ERR_INTERNAL;
+        goto done;
+    }
+
+    memcpy(job->out, header, sizeof header);
+    job->out[sizeof header] = (unsigned char)((job->out_len - 1) & 0xff);
+    job->out[sizeof header + 1] = (unsigned char)((job->out_len - 1) >> 8);
+    crc = (guint32)crc32(crc32(0L, Z_NULL, 0), job->in, job->in_len);
+    phtole32(job->out + job->out_len - 8, crc);
+    phtole32(job->out + job->out_len - 4, job->in_len);
+
+done:
+    g_free(job->in);
+    job->in = NULL;
+    gz_par_job_done(par, job);
+}
+
 GZWFILE_T
 gzwfile_open(const char *path)
 {
@@ -1509,32 +3096,136 @@ gzwfile_open(const char *path)
         close(fd);
         errno = save_errno;
     }
-    return state;
+    return state;
+}
+
+GZWFILE_T
+gzwfile_fdopen(int fd)
+{
+    GZWFILE_T state;
+
+    /* allocate wtap_writer structure to return */
+    state = (GZWFILE_T)g_try_malloc(sizeof *state);
+    if (state == NULL)
+        return NULL;
+    state->fd = fd;
+    state->size = 0;            /* no buffers allocated yet */
+    state->want = GZBUFSIZE;    /* requested buffer size */
+
+    state->level = Z_DEFAULT_COMPRESSION;
+    state->strategy = Z_DEFAULT_STRATEGY;
+
+    /* initialize stream */
+    state->err = Z_OK;              /* clear error */
+    state->pos = 0;                 /* no uncompressed data yet */
+    state->strm.avail_in = 0;       /* no input data yet */
+
+    /* compress blocks on other threads, if we have any */
+    state->par = gz_par_new(gz_par_deflate);
+
+    /* return stream */
+    return state;
+}
+
+/* Write out the blocks that have been compressed, in order, waiting
+   for them until no more than max_pending are left in flight.  Return
+   -1, and set state->err, on failure; return 0 on success. */
+static int
+gz_par_write_done(GZWFILE_T state, guint max_pending)
+{
+    struct gz_par *par = state->par;
+    struct gz_par_job *job;
+    ssize_t got;
+
+    while (par->head != NULL &&
+           (par->n_jobs > max_pending || gz_par_head_done(par))) {
+        job = gz_par_next_done(par);
+        if (job->err != 0) {
+            state->err = job->err;
+            gz_par_job_free(job);
+            return -1;
+        }
+        got = write(state->fd, job->out, job->out_len);
+        if (got < 0) {
+            state->err = errno;
+            gz_par_job_free(job);
+            return -1;
+        }
+        if ((guint)got != job->out_len) {
+            state->err = WTAP_ERR_SHORT_WRITE;
+            gz_par_job_free(job);
+            return -1;
+        }
+        gz_par_job_free(job);
+    }
+    return 0;
+}
+
+/* Write the empty member that marks the end of a BGZF file.  Return
+   -1, and set state->err, on failure; return 0 on success. */
+static int
+gz_par_write_eof(GZWFILE_T state)
+{
+    static const unsigned char eof[28] = {
+        31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 'B', 'C', 2, 0,
+        27, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0
+    };
+    ssize_t got;
+
+    got = write(state->fd, eof, sizeof eof);
+    if (got < 0) {
+        state->err = errno;
+        return -1;
+    }
+    if ((size_t)got != sizeof eof) {
+        state->err = WTAP_ERR_SHORT_WRITE;
+        return -1;
+    }
+    return 0;
 }
 
-GZWFILE_T
-gzwfile_fdopen(int fd)
+/* Hand the block being filled to a thread.  Return -1, and set
+   state->err, on failure; return 0 on success. */
+static int
+gz_par_submit_fill(GZWFILE_T state)
 {
-    GZWFILE_T state;
-
-    /* allocate wtap_writer structure to return */
-    state = (GZWFILE_T)g_try_malloc(sizeof *state);
-    if (state == NULL)
-        return NULL;
-    state->fd = fd;
-    state->size = 0;            /* no buffers allocated yet */
-    state->want = GZBUFSIZE;    /* requested buffer size */
+    struct gz_par *par = state->par;
+    struct gz_par_job *job = par->fill;
 
-    state->level = Z_DEFAULT_COMPRESSION;
-    state->strategy = Z_DEFAULT_STRATEGY;
+    if (job == NULL)
+        return 0;
+    if (gz_par_write_done(state, par->max_jobs - 1) == -1)
+        return -1;
+    par->fill = NULL;
+    gz_par_submit(par, job);
+    return 0;
+}
 
-    /* initialize stream */
-    state->err = Z_OK;              /* clear error */
-    state->pos = 0;                 /* no uncompressed data yet */
-    state->strm.avail_in = 0;       /* no input data yet */
+static unsigned
+gz_par_write(GZWFILE_T state, const void *buf, guint len)
+{
+    struct gz_par *par = state->par;
+    guint n;
 
-    /* return stream */
-    return state;
+    while (len != 0) {
+        if (par->fill == NULL) {
+            par->fill = g_new0(struct gz_par_job, 1);
+            par->fill->in = (unsigned char *)g_malloc(GZ_PAR_BLOCK);
+            par->fill->level = state->level;
+        }
+        n = GZ_PAR_BLOCK - par->fill->in_len;
+        if (n > len)
+            n = len;
+        memcpy(par->fill->in + par->fill->in_len, buf, n);
+        par->fill->in_len += n;
+        state->pos += n;
+        buf = (const char *)buf + n;
+        len -= n;
+        if (par->fill->in_len == GZ_PAR_BLOCK &&
+            gz_par_submit_fill(state) == -1)
+            return 0;
+    }
+    return 1;
 }
 
 /* Initialize state for writing a gzip file.  Mark initialization by setting
@@ -1667,6 +3358,9 @@ gzwfile_write(GZWFILE_T state, const void *buf, guint len)
     if (len == 0)
         return 0;
 
+    if (state->par != NULL)
+        return gz_par_write(state, buf, len) ? len : 0;
+
     /* allocate memory if this is the first time through */
     if (state->size == 0 && gz_init(state) == -1)
         return 0;
@@ -1719,6 +3413,14 @@ gzwfile_flush(GZWFILE_T state)
     if (state->err != Z_OK)
         return -1;
 
+    /* finish off the current member, and write out everything */
+    if (state->par != NULL) {
+        if (gz_par_submit_fill(state) == -1 ||
+            gz_par_write_done(state, 0) == -1)
+            return -1;
+        return 0;
+    }
+
     /* compress remaining data with Z_SYNC_FLUSH */
     gz_comp(state, Z_SYNC_FLUSH);
     if (state->err != Z_OK)
@@ -1734,11 +3436,22 @@ gzwfile_close(GZWFILE_T state)
     int ret = 0;
 
     /* flush, free memory, and close file */
-    if (gz_comp(state, Z_FINISH) == -1 && ret == 0)
-        ret = state->err;
-    (void)deflateEnd(&(state->strm));
-    g_free(state->out);
-    g_free(state->in);
+    if (state->par != NULL) {
+        if (state->err == Z_OK &&
+            (gz_par_submit_fill(state) == -1 ||
+             gz_par_write_done(state, 0) == -1 ||
+             gz_par_write_eof(state) == -1))
+            ret = state->err;
+        gz_par_free(state->par);
+    } else {
+        if (gz_comp(state, Z_FINISH) == -1 && ret == 0)
+            ret = state->err;
+        if (state->size != 0) {
+            (void)deflateEnd(&(state->strm));
+            g_free(state->out);
+            g_free(state->in);
+        }
+    }
     state->err = Z_OK;
     if (close(state->fd) == -1 && ret == 0)
         ret = errno;
@@ -1753,6 +3466,415 @@ gzwfile_geterr(GZWFILE_T state)
 }
 #endif
 
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+/* Uncompressed data per frame we write; each frame start is a place
+   from which the file can be read randomly. */
+#define WRITE_FRAME_SIZE    (1024*1024)
+
+/* Write out len bytes from buf.  Return -1, and set *err, on failure;
+   return 0 on success. */
+static int
+write_all(int fd, const void *buf, size_t len, int *err)
+{
+    ssize_t got;
+
+    while (len != 0) {
+        got = write(fd, buf, (unsigned int)len);
+        if (got < 0) {
+            *err = errno;
+            return -1;
+        }
+        if (got == 0) {
+            *err = WTAP_ERR_SHORT_WRITE;
+            return -1;
+        }
+        buf = (const char *)buf + got;
+        len -= got;
+    }
+    return 0;
+}
+
+static int
+wfile_open_fd(const char *path)
+{
+    return ws_open(path, O_BINARY|O_WRONLY|O_CREAT|O_TRUNC, 0666);
+}
+#endif
+
+#ifdef HAVE_ZSTD
+/* internal Zstandard file state data structure for writing */
+struct zstd_writer {
+    int fd;                 /* file descriptor */
+    ZSTD_CStream *cstream;  /* compression context */
+    unsigned char *out;     /* output buffer */
+    size_t out_size;
+    guint32 frame_in;       /* uncompressed data in the current frame */
+    guint32 frame_out;      /* compressed data in the current frame */
+    GArray *frames;         /* compressed and uncompressed frame sizes, for the seek table */
+    int err;                /* error code */
+};
+
+#define ZSTD_WRITE_LEVEL    3   /* zstd's default */
+
+ZSTDWFILE_T
+zstdwfile_open(const char *path)
+{
+    int fd;
+    ZSTDWFILE_T state;
+    int save_errno;
+
+    fd = wfile_open_fd(path);
+    if (fd == -1)
+        return NULL;
+    state = zstdwfile_fdopen(fd);
+    if (state == NULL) {
+        save_errno = errno;
+        close(fd);
+        errno = save_errno;
+    }
+    return state;
+}
+
+ZSTDWFILE_T
+zstdwfile_fdopen(int fd)
+{
+    ZSTDWFILE_T state;
+
+    state = g_new(struct zstd_writer, 1);
+    state->cstream = ZSTD_createCStream();
+    if (state->cstream == NULL ||
+        ZSTD_isError(ZSTD_initCStream(state->cstream, ZSTD_WRITE_LEVEL))) {
+        if (state->cstream != NULL)
+            ZSTD_freeCStream(state->cstream);
+        g_free(state);
+        errno = ENOMEM;
+        return NULL;
+    }
+    state->fd = fd;
+    state->out_size = ZSTD_CStreamOutSize();
+    state->out = (unsigned char *)g_malloc(state->out_size);
+    state->frame_in = 0;
+    state->frame_out = 0;
+    state->frames = g_array_new(FALSE, FALSE, sizeof(guint32));
+    state->err = 0;
+    return state;
+}
+
+/* Write out what's in the output buffer. */
+static int
+zstd_write_out(ZSTDWFILE_T state, ZSTD_outBuffer *output)
+{
+    if (output->pos != 0) {
+        if (write_all(state->fd, output->dst, output->pos, &state->err) == -1)
+            return -1;
+        state->frame_out += (guint32)output->pos;
+        output->pos = 0;
+    }
+    return 0;
+}
+
+/* Finish the current frame, if it has anything in it, and note its
+   sizes for the seek table. */
+static int
+zstd_end_frame(ZSTDWFILE_T state)
+{
+    ZSTD_outBuffer output;
+    size_t ret;
+
+    if (state->frame_in == 0)
+        return 0;
+    output.dst = state->out;
+    output.size = state->out_size;
+    output.pos = 0;
+    do {
+        ret = ZSTD_endStream(state->cstream, &output);
+        if (ZSTD_isError(ret)) {
+            /* This "shouldn't happen". */
+            state->err = WTAP_ERR_INTERNAL;
+            return -1;
+        }
+        if (zstd_write_out(state, &output) == -1)
+            return -1;
+    } while (ret != 0);
+
+    g_array_append_val(state->frames, state->frame_out);
+    g_array_append_val(state->frames, state->frame_in);
+    state->frame_in = 0;
+    state->frame_out = 0;
+    if (ZSTD_isError(ZSTD_initCStream(state->cstream, ZSTD_WRITE_LEVEL))) {
+        state->err = WTAP_ERR_INTERNAL;
+        return -1;
+    }
+    return 0;
+}
+
+/* Write out len bytes from buf.  Return 0, and set state->err, on
+   failure or on an attempt to write 0 bytes; return the number of
+   bytes written on success. */
+guint
+zstdwfile_write(ZSTDWFILE_T state, const void *buf, guint len)
+{
+    ZSTD_inBuffer input;
+    ZSTD_outBuffer output;
+    size_t ret;
+    guint n;
+
+    if (state->err != 0 || len == 0)
+        return 0;
+
+    output.dst = state->out;
+    output.size = state->out_size;
+    output.pos = 0;
+    input.src = buf;
+    input.size = 0;
+    input.pos = 0;
+    while (input.pos < len) {
+        /* Don't put more than WRITE_FRAME_SIZE into a frame. */
+        n = MIN(len - (guint)input.pos, WRITE_FRAME_SIZE - state->frame_in);
+        input.size = input.pos + n;
+        while (input.pos < input.size) {
+            ret = ZSTD_compressStream(state->cstream, &output, &input);
+            if (ZSTD_isError(ret)) {
+                /* This "shouldn't happen". */
+                state->err = WTAP_ERR_INTERNAL;
+                return 0;
+            }
+            if (zstd_write_out(state, &output) == -1)
+                return 0;
+        }
+        state->frame_in += n;
+        if (state->frame_in == WRITE_FRAME_SIZE && zstd_end_frame(state) == -1)
+            return 0;
+    }
+    return len;
+}
+
+/* Flush out what we've written so far.  Returns -1, and sets state->err,
+   on failure; returns 0 on success. */
+int
+zstdwfile_flush(ZSTDWFILE_T state)
+{
+    ZSTD_outBuffer output;
+    size_t ret;
+
+    if (state->err != 0)
+        return -1;
+    output.dst = state->out;
+    output.size = state->out_size;
+    output.pos = 0;
+    do {
+        ret = ZSTD_flushStream(state->cstream, &output);
+        if (ZSTD_isError(ret)) {
+            state->err = WTAP_ERR_INTERNAL;
+            return -1;
+        }
+        if (zstd_write_out(state, &output) == -1)
+            return -1;
+    } while (ret != 0);
+    return 0;
+}
+
+/* Write the seek table, as a skippable frame, after the last frame. */
+static int
+zstd_write_seek_table(ZSTDWFILE_T state)
+{
+    guint32 nframes = state->frames->len / 2;
+    guint32 table_len = nframes * 8 + ZSTD_SEEK_FOOTER_LEN;
+    guint8 *table, *p;
+    guint32 i;
+    int ret;
+
+    table = p = (guint8 *)g_malloc(8 + table_len);
+    phtole32(p, ZSTD_SEEK_TABLE_MAGIC);
+    phtole32(p + 4, table_len);
+    p += 8;
+    for (i = 0; i < nframes * 2; i++, p += 4)
+        phtole32(p, g_array_index(state->frames, guint32, i));
+    phtole32(p, nframes);
+    p[4] = 0;                   /* no checksums */
+    phtole32(p + 5, ZSTD_SEEKABLE_MAGIC);
+    ret = write_all(state->fd, table, 8 + table_len, &state->err);
+    g_free(table);
+    return ret;
+}
+
+/* Flush out all data written, and close the file.  Returns a Wiretap
+   error on failure; returns 0 on success. */
+int
+zstdwfile_close(ZSTDWFILE_T state)
+{
+    int ret = 0;
+
+    if (state->err == 0 &&
+        (zstd_end_frame(state) == -1 || zstd_write_seek_table(state) == -1))
+        ret = state->err;
+    ZSTD_freeCStream(state->cstream);
+    g_array_free(state->frames, TRUE);
+    g_free(state->out);
+    if (close(state->fd) == -1 && ret == 0)
+        ret = errno;
+    g_free(state);
+    return ret;
+}
+
+int
+zstdwfile_geterr(ZSTDWFILE_T state)
+{
+    return state->err;
+}
+#endif
+
+#ifdef HAVE_LZ4
+/* internal LZ4 file state data structure for writing */
+struct lz4_writer {
+    int fd;                 /* file descriptor */
+    LZ4F_compressionContext_t cctx;  /* compression context */
+    LZ4F_preferences_t prefs;
+    unsigned char *out;     /* output buffer */
+    size_t out_size;
+    gboolean in_frame;      /* TRUE if we've written a frame header */
+    guint32 frame_in;       /* uncompressed data in the current frame */
+    int err;                /* error code */
+};
+
+#define LZ4_WRITE_CHUNK     (64*1024)   /* most data we hand to LZ4F_compressUpdate() at once */
+#ifndef LZ4F_HEADER_SIZE_MAX
+#define LZ4F_HEADER_SIZE_MAX    19
+#endif
+
+LZ4WFILE_T
+lz4wfile_open(const char *path)
+{
+    int fd;
+    LZ4WFILE_T state;
+    int save_errno;
+
+    fd = wfile_open_fd(path);
+    if (fd == -1)
+        return NULL;
+    state = lz4wfile_fdopen(fd);
+    if (state == NULL) {
+        save_errno = errno;
+        close(fd);
+        errno = save_errno;
+    }
+    return state;
+}
+
+LZ4WFILE_T
+lz4wfile_fdopen(int fd)
+{
+    LZ4WFILE_T state;
+
+    state = g_new0(struct lz4_writer, 1);
+    if (LZ4F_isError(LZ4F_createCompressionContext(&state->cctx, LZ4F_VERSION))) {
+        g_free(state);
+        errno = ENOMEM;
+        return NULL;
+    }
+    state->fd = fd;
+    state->prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+    state->out_size = LZ4F_compressBound(LZ4_WRITE_CHUNK, &state->prefs) +
+                      LZ4F_HEADER_SIZE_MAX;
+    state->out = (unsigned char *)g_malloc(state->out_size);
+    return state;
+}
+
+/* Check the result of an LZ4F_ call, and write out what it produced. */
+static int
+lz4_write_out(LZ4WFILE_T state, size_t ret)
+{
+    if (LZ4F_isError(ret)) {
+        /* This "shouldn't happen". */
+        state->err = WTAP_ERR_INTERNAL;
+        return -1;
+    }
+    return write_all(state->fd, state->out, ret, &state->err);
+}
+
+static int
+lz4_end_frame(LZ4WFILE_T state)
+{
+    if (!state->in_frame)
+        return 0;
+    state->in_frame = FALSE;
+    state->frame_in = 0;
+    return lz4_write_out(state,
+        LZ4F_compressEnd(state->cctx, state->out, state->out_size, NULL));
+}
+
+/* Write out len bytes from buf.  Return 0, and set state->err, on
+   failure or on an attempt to write 0 bytes; return the number of
+   bytes written on success. */
+guint
+lz4wfile_write(LZ4WFILE_T state, const void *buf, guint len)
+{
+    guint put = len;
+    guint n;
+
+    if (state->err != 0 || len == 0)
+        return 0;
+
+    while (len != 0) {
+        if (!state->in_frame) {
+            if (lz4_write_out(state,
+                    LZ4F_compressBegin(state->cctx, state->out,
+                                       state->out_size, &state->prefs)) == -1)
+                return 0;
+            state->in_frame = TRUE;
+        }
+        n = MIN(len, LZ4_WRITE_CHUNK);
+        n = MIN(n, WRITE_FRAME_SIZE - state->frame_in);
+        if (lz4_write_out(state,
+                LZ4F_compressUpdate(state->cctx, state->out, state->out_size,
+                                    buf, n, NULL)) == -1)
+            return 0;
+        buf = (const char *)buf + n;
+        len -= n;
+        state->frame_in += n;
+        if (state->frame_in == WRITE_FRAME_SIZE && lz4_end_frame(state) == -1)
+            return 0;
+    }
+    return put;
+}
+
+/* Flush out what we've written so far.  Returns -1, and sets state->err,
+   on failure; returns 0 on success. */
+int
+lz4wfile_flush(LZ4WFILE_T state)
+{
+    if (state->err != 0)
+        return -1;
+    if (!state->in_frame)
+        return 0;
+    return lz4_write_out(state,
+        LZ4F_flush(state->cctx, state->out, state->out_size, NULL));
+}
+
+/* Flush out all data written, and close the file.  Returns a Wiretap
+   error on failure; returns 0 on success. */
+int
+lz4wfile_close(LZ4WFILE_T state)
+{
+    int ret = 0;
+
+    if (state->err == 0 && lz4_end_frame(state) == -1)
+        ret = state->err;
+    LZ4F_freeCompressionContext(state->cctx);
+    g_free(state->out);
+    if (close(state->fd) == -1 && ret == 0)
+        ret = errno;
+    g_free(state);
+    return ret;
+}
+
+int
+lz4wfile_geterr(LZ4WFILE_T state)
+{
+    return state->err;
+}
+#endif
+
 /*
  * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
  *
@@ -29,6 +29,8 @@
 extern FILE_T file_open(const char *path);
 extern FILE_T file_fdopen(int fildes);
 extern void file_set_random_access(FILE_T stream, gboolean random_flag, GPtrArray *seek);
+extern gboolean file_fast_seek_save(GPtrArray *fast_seek, FILE *fp, int *err);
+extern gboolean file_fast_seek_restore(GPtrArray *fast_seek, FILE *fp);
 WS_DLL_PUBLIC gint64 file_seek(FILE_T stream, gint64 offset, int whence, int *err);
 extern gboolean file_skip(FILE_T file, gint64 delta, int *err);
 WS_DLL_PUBLIC gint64 file_tell(FILE_T stream);
@@ -42,6 +44,7 @@ WS_DLL_PUBLIC char *file_gets(char *buf, int len, FILE_T stream);
 WS_DLL_PUBLIC int file_eof(FILE_T stream);
 WS_DLL_PUBLIC int file_error(FILE_T fh, gchar **err_info);
 extern void file_clearerr(FILE_T stream);
+extern gboolean file_set_no_map(FILE_T file, int *err);
 extern void file_fdclose(FILE_T file);
 extern int file_fdreopen(FILE_T file, const char *path);
 extern void file_close(FILE_T file);
@@ -57,4 +60,26 @@ extern int gzwfile_close(GZWFILE_T state);
 extern int gzwfile_geterr(GZWFILE_T state);
 #endif /* HAVE_LIBZ */
 
+#ifdef HAVE_ZSTD
+typedef struct zstd_writer *ZSTDWFILE_T;
+
+extern ZSTDWFILE_T zstdwfile_open(const char *path);
+extern ZSTDWFILE_T zstdwfile_fdopen(int fd);
+extern guint zstdwfile_write(ZSTDWFILE_T state, const void *buf, guint len);
+extern int zstdwfile_flush(ZSTDWFILE_T state);
+extern int zstdwfile_close(ZSTDWFILE_T state);
+extern int zstdwfile_geterr(ZSTDWFILE_T state);
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4
+typedef struct lz4_writer *LZ4WFILE_T;
+
+extern LZ4WFILE_T lz4wfile_open(const char *path);
+extern LZ4WFILE_T lz4wfile_fdopen(int fd);
+extern guint lz4wfile_write(LZ4WFILE_T state, const void *buf, guint len);
+extern int lz4wfile_flush(LZ4WFILE_T state);
+extern int lz4wfile_close(LZ4WFILE_T state);
+extern int lz4wfile_geterr(LZ4WFILE_T state);
+#endif /* HAVE_LZ4 */
+
 #endif /* __FILE_H__ */
@@ -35,6 +35,69 @@
 
 #include <string.h>
 #include "merge.h"
+#include "wtap-int.h"
+#include <wsutil/buffer.h>
+
+/*
+ * The input files that have a packet waiting to be merged are kept in a
+ * binary min-heap, ordered by the time stamp of that packet, so that
+ * picking the next packet to write takes O(log n) comparisons, rather
+ * than a scan of all n input files; merging hundreds or thousands of
+ * ring buffer files is dominated by that scan otherwise.
+ */
+typedef struct {
+  nstime_t         ts;        /* time stamp of the file's waiting packet */
+  merge_in_file_t *in_file;
+} merge_heap_entry_t;
+
+/*
+ * A record read ahead of the merge.
+ */
+typedef struct {
+  struct wtap_pkthdr phdr;
+  Buffer             buf;
+  gint64             data_offset;
+} merge_rec_t;
+
+/*
+ * Records read ahead from one input file.  They're kept in a ring of
+ * n_recs records; recs[head] through recs[head + count - 1] (modulo
+ * n_recs) have been read.  If "held" is set, recs[head] is the packet
+ * most recently returned by the merge, which the caller may still be
+ * using; it's released when the next packet from the file is asked for.
+ *
+ * A job on the thread pool fills the rest of the ring; at most one job
+ * per file is queued or running at a time ("queued").  Everything but
+ * the records themselves is protected by the merge state's mutex.
+ */
+struct merge_read_ahead_s {
+  merge_in_file_t      *in_file;
+  struct merge_state_s *merge;
+  merge_rec_t          *recs;
+  guint                 n_recs;
+  guint                 head;
+  guint                 count;
+  gboolean              held;
+  gboolean              queued;
+  gboolean              done;    /* the job got an EOF or an error */
+  int                   err;
+  gchar                *err_info;
+};
+
+struct merge_state_s {
+  merge_heap_entry_t *heap;
+  int                 heap_count;
+  int                 next_unread;  /* first file we haven't read a packet from */
+  merge_in_file_t    *last;         /* file whose packet we returned last */
+
+  /* read-ahead */
+  GThreadPool        *pool;
+  GMutex             *mtx;
+  GCond              *cond;
+  gboolean            stop;
+};
+
+static void merge_read_ahead_stop(int count, merge_in_file_t in_files[]);
 
 /*
  * Scan through the arguments and open the input files
@@ -49,20 +112,28 @@ merge_open_in_files(int in_file_count, char *const *in_file_names,
   size_t files_size = in_file_count * sizeof(merge_in_file_t);
   merge_in_file_t *files;
   gint64 size;
+  struct merge_state_s *merge;
 
   files = (merge_in_file_t *)g_malloc(files_size);
   *in_files = files;
 
+  merge = g_new0(struct merge_state_s, 1);
+  merge->heap = g_new(merge_heap_entry_t, in_file_count);
+
   for (i = 0; i < in_file_count; i++) {
     files[i].filename    = in_file_names[i];
     files[i].wth         = wtap_open_offline(in_file_names[i], WTAP_TYPE_AUTO, err, err_info, FALSE);
     files[i].data_offset = 0;
     files[i].state       = PACKET_NOT_PRESENT;
     files[i].packet_num  = 0;
+    files[i].merge       = merge;
+    files[i].read_ahead  = NULL;
     if (!files[i].wth) {
       /* Close the files we've already opened. */
       for (j = 0; j < i; j++)
         wtap_close(files[j].wth);
+      g_free(merge->heap);
+      g_free(merge);
       *err_fileno = i;
       return FALSE;
     }
@@ -70,6 +141,8 @@ merge_open_in_files(int in_file_count, char *const *in_file_names,
     if (size == -1) {
       for (j = 0; j + 1 > j && j <= i; j++)
         wtap_close(files[j].wth);
+      g_free(merge->heap);
+      g_free(merge);
       *err_fileno = i;
       return FALSE;
     }
@@ -85,7 +158,16 @@ void
 merge_close_in_files(int count, merge_in_file_t in_files[])
 {
   int i;
+  struct merge_state_s *merge = count > 0 ? in_files[0].merge : NULL;
+
+  if (merge != NULL) {
+    /* Stop reading ahead before we close the files being read. */
+    merge_read_ahead_stop(count, in_files);
+    g_free(merge->heap);
+    g_free(merge);
+  }
   for (i = 0; i < count; i++) {
+    in_files[i].merge = NULL;
     wtap_close(in_files[i].wth);
   }
 }
@@ -140,24 +222,309 @@ merge_max_snapshot_length(int count, merge_in_file_t in_files[])
 }
 
 /*
- * returns TRUE if first argument is earlier than second
+ * Read-ahead.
+ */
+static void
+merge_rec_fill(merge_rec_t *rec, wtap *wth, gint64 data_offset)
+{
+  struct wtap_pkthdr *phdr = wtap_phdr(wth);
+  Buffer              ft_specific_data = rec->phdr.ft_specific_data;
+
+  g_free(rec->phdr.opt_comment);
+  rec->phdr = *phdr;
+  rec->phdr.opt_comment = g_strdup(phdr->opt_comment);
+  rec->phdr.ft_specific_data = ft_specific_data;
+  ws_buffer_clean(&rec->phdr.ft_specific_data);
+  ws_buffer_append_buffer(&rec->phdr.ft_specific_data, &phdr->ft_specific_data);
+
+  ws_buffer_clean(&rec->buf);
+  ws_buffer_append(&rec->buf, wtap_buf_ptr(wth), phdr->caplen);
+  rec->data_offset = data_offset;
+}
+
+/*
+ * Thread pool job: read records from one input file until its ring is
+ * full, it's at EOF, or we're told to stop.
+ */
+static void
+merge_read_ahead_fill(gpointer data, gpointer user_data)
+{
+  struct merge_read_ahead_s *ra = (struct merge_read_ahead_s *)data;
+  struct merge_state_s      *merge = (struct merge_state_s *)user_data;
+  merge_rec_t               *rec;
+  gint64                     data_offset;
+  int                        err;
+  gchar                     *err_info;
+
+  g_mutex_lock(merge->mtx);
+  while (!merge->stop && ra->count < ra->n_recs) {
+    /* This slot isn't visible to the merge until we count it. */
+    rec = &ra->recs[(ra->head + ra->count) % ra->n_recs];
+    g_mutex_unlock(merge->mtx);
+
+    err_info = NULL;
+    if (wtap_read(ra->in_file->wth, &err, &err_info, &data_offset)) {
+      merge_rec_fill(rec, ra->in_file->wth, data_offset);
+      g_mutex_lock(merge->mtx);
+      /* The merge only waits for a file whose ring is empty. */
+      if (ra->count++ == 0)
+        g_cond_signal(merge->cond);
+    } else {
+      g_mutex_lock(merge->mtx);
+      ra->done = TRUE;
+      ra->err = err;
+      ra->err_info = err_info;
+      g_cond_signal(merge->cond);
+      break;
+    }
+  }
+  ra->queued = FALSE;
+  g_mutex_unlock(merge->mtx);
+}
+
+void
+merge_set_read_ahead(int in_file_count, merge_in_file_t in_files[],
+                     guint depth)
+{
+  struct merge_state_s      *merge;
+  struct merge_read_ahead_s *ra;
+  guint                      threads;
+  int                        i;
+  guint                      j;
+
+  if (depth == 0 || in_file_count == 0)
+    return;
+  merge = in_files[0].merge;
+  if (merge->pool != NULL)
+    return;     /* already reading ahead */
+
+#if !GLIB_CHECK_VERSION(2,31,0)
+  /* It's too late for us to initialize threads. */
+  if (!g_thread_supported())
+    return;
+#endif
+
+  /*
+   * Most of the time goes to waiting for I/O and decompressing, so use
+   * at least a couple of threads even on a single processor, but no
+   * more than there are files.
+   */
+  threads = MAX(wtap_num_processors(), 2);
+  if (threads > (guint)in_file_count)
+    threads = (guint)in_file_count;
+  merge->pool = g_thread_pool_new(merge_read_ahead_fill, merge, (gint)threads,
+                                  FALSE, NULL);
+  if (merge->pool == NULL)
+    return;
+#if GLIB_CHECK_VERSION(2,31,0)
+  merge->mtx = g_new(GMutex, 1);
+  g_mutex_init(merge->mtx);
+  merge->cond = g_new(GCond, 1);
+  g_cond_init(merge->cond);
+#else
+  merge->mtx = g_mutex_new();
+  merge->cond = g_cond_new();
+#endif
+
+  for (i = 0; i < in_file_count; i++) {
+    ra = g_new0(struct merge_read_ahead_s, 1);
+    ra->in_file = &in_files[i];
+    ra->merge = merge;
+    ra->n_recs = depth;
+    ra->recs = g_new(merge_rec_t, depth);
+    for (j = 0; j < depth; j++) {
+      wtap_phdr_init(&ra->recs[j].phdr);
+      ws_buffer_init(&ra->recs[j].buf, 1500);
+    }
+    in_files[i].read_ahead = ra;
+  }
+
+  /* Start filling all the rings, in file order. */
+  g_mutex_lock(merge->mtx);
+  for (i = 0; i < in_file_count; i++) {
+    ra = in_files[i].read_ahead;
+    ra->queued = TRUE;
+    g_thread_pool_push(merge->pool, ra, NULL);
+  }
+  g_mutex_unlock(merge->mtx);
+}
+
+static void
+merge_read_ahead_stop(int count, merge_in_file_t in_files[])
+{
+  struct merge_state_s      *merge = in_files[0].merge;
+  struct merge_read_ahead_s *ra;
+  int                        i;
+  guint                      j;
+
+  if (merge->pool == NULL)
+    return;
+
+  /* Drop the jobs that haven't started and wait for the running ones. */
+  g_mutex_lock(merge->mtx);
+  merge->stop = TRUE;
+  g_mutex_unlock(merge->mtx);
+  g_thread_pool_free(merge->pool, TRUE, TRUE);
+  merge->pool = NULL;
+
+#if GLIB_CHECK_VERSION(2,31,0)
+  g_mutex_clear(merge->mtx);
+  g_free(merge->mtx);
+  g_cond_clear(merge->cond);
+  g_free(merge->cond);
+#else
+  g_mutex_free(merge->mtx);
+  g_cond_free(merge->cond);
+#endif
+  merge->mtx = NULL;
+  merge->cond = NULL;
+
+  for (i = 0; i < count; i++) {
+    ra = in_files[i].read_ahead;
+    if (ra == NULL)
+      continue;
+    for (j = 0; j < ra->n_recs; j++) {
+      g_free(ra->recs[j].phdr.opt_comment);
+      wtap_phdr_cleanup(&ra->recs[j].phdr);
+      ws_buffer_free(&ra->recs[j].buf);
+    }
+    g_free(ra->recs);
+    g_free(ra->err_info);
+    g_free(ra);
+    in_files[i].read_ahead = NULL;
+  }
+}
+
+/*
+ * Get the next packet from an input file, either by reading it or from
+ * the records read ahead.  Returns TRUE if we got one; otherwise *err is
+ * 0 at EOF or the error.
  */
 static gboolean
-is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
+merge_next_packet(merge_in_file_t *in_file, int *err, gchar **err_info)
 {
-  if (l->secs > r->secs) {  /* left is later */
-    return FALSE;
-  } else if (l->secs < r->secs) { /* left is earlier */
-    return TRUE;
-  } else if (l->nsecs > r->nsecs) { /* tv_sec equal, l.usec later */
+  struct merge_read_ahead_s *ra = in_file->read_ahead;
+  struct merge_state_s      *merge;
+
+  if (ra == NULL)
+    return wtap_read(in_file->wth, err, err_info, &in_file->data_offset);
+
+  merge = ra->merge;
+  g_mutex_lock(merge->mtx);
+  if (ra->held) {
+    /* The caller is done with the last packet; give its slot back. */
+    ra->head = (ra->head + 1) % ra->n_recs;
+    ra->count--;
+    ra->held = FALSE;
+  }
+  if (!ra->queued && !ra->done && ra->count <= ra->n_recs / 2) {
+    /* Top up the ring in batches, rather than a record at a time. */
+    ra->queued = TRUE;
+    g_thread_pool_push(merge->pool, ra, NULL);
+  }
+  while (ra->count == 0 && !ra->done)
+    g_cond_wait(merge->cond, merge->mtx);
+  if (ra->count == 0) {
+    /* Everything read before the EOF or error has been merged. */
+    *err = ra->err;
+    *err_info = ra->err_info;
+    ra->err_info = NULL;
+    g_mutex_unlock(merge->mtx);
     return FALSE;
   }
-  /* either one < two or one == two
-   * either way, return one
-   */
+  ra->held = TRUE;
+  g_mutex_unlock(merge->mtx);
+
+  in_file->data_offset = ra->recs[ra->head].data_offset;
   return TRUE;
 }
 
+struct wtap_pkthdr *
+merge_in_file_phdr(merge_in_file_t *in_file)
+{
+  struct merge_read_ahead_s *ra = in_file->read_ahead;
+
+  if (ra == NULL)
+    return wtap_phdr(in_file->wth);
+  return &ra->recs[ra->head].phdr;
+}
+
+guint8 *
+merge_in_file_buf_ptr(merge_in_file_t *in_file)
+{
+  struct merge_read_ahead_s *ra = in_file->read_ahead;
+
+  if (ra == NULL)
+    return wtap_buf_ptr(in_file->wth);
+  return ws_buffer_start_ptr(&ra->recs[ra->head].buf);
+}
+
+/*
+ * Returns TRUE if heap entry l is to be merged before heap entry r.
+ *
+ * Packets with the same time stamp are merged starting with the last
+ * of the files they're in, as the linear scan this replaced did.
+ */
+static gboolean
+merge_heap_before(const merge_heap_entry_t *l, const merge_heap_entry_t *r)
+{
+  if (l->ts.secs != r->ts.secs)
+    return l->ts.secs < r->ts.secs;
+  if (l->ts.nsecs != r->ts.nsecs)
+    return l->ts.nsecs < r->ts.nsecs;
+  return l->in_file > r->in_file;
+}
+
+static void
+merge_heap_sift_down(struct merge_state_s *merge, int pos)
+{
+  merge_heap_entry_t *heap = merge->heap;
+  merge_heap_entry_t  entry = heap[pos];
+  int                 child;
+
+  for (;;) {
+    child = 2 * pos + 1;
+    if (child >= merge->heap_count)
+      break;
+    if (child + 1 < merge->heap_count &&
+        merge_heap_before(&heap[child + 1], &heap[child]))
+      child++;
+    if (!merge_heap_before(&heap[child], &entry))
+      break;
+    heap[pos] = heap[child];
+    pos = child;
+  }
+  heap[pos] = entry;
+}
+
+static void
+merge_heap_push(struct merge_state_s *merge, merge_in_file_t *in_file)
+{
+  merge_heap_entry_t *heap = merge->heap;
+  merge_heap_entry_t  entry;
+  int                 pos, parent;
+
+  entry.ts = merge_in_file_phdr(in_file)->ts;
+  entry.in_file = in_file;
+  pos = merge->heap_count++;
+  while (pos > 0) {
+    parent = (pos - 1) / 2;
+    if (!merge_heap_before(&entry, &heap[parent]))
+      break;
+    heap[pos] = heap[parent];
+    pos = parent;
+  }
+  heap[pos] = entry;
+}
+
+static void
+merge_heap_pop(struct merge_state_s *merge)
+{
+  merge->heap[0] = merge->heap[--merge->heap_count];
+  if (merge->heap_count > 0)
+    merge_heap_sift_down(merge, 0);
+}
+
 /*
  * Read the next packet, in chronological order, from the set of files
  * to be merged.
@@ -175,59 +542,74 @@ merge_in_file_t *
 merge_read_packet(int in_file_count, merge_in_file_t in_files[],
                   int *err, gchar **err_info)
 {
-  int i;
-  int ei = -1;
-  nstime_t tv = { sizeof(time_t) > sizeof(int) ? LONG_MAX : INT_MAX, INT_MAX };
-  struct wtap_pkthdr *phdr;
+  struct merge_state_s *merge;
+  merge_in_file_t      *in_file;
+
+  if (in_file_count == 0) {
+    *err = 0;
+    return NULL;
+  }
+  merge = in_files[0].merge;
 
   /*
    * Make sure we have a packet available from each file, if there are any
-   * packets left in the file in question, and search for the packet
-   * with the earliest time stamp.
+   * packets left in the file in question.  The first time through, that
+   * means reading a packet from every file; after that, only the file
+   * whose packet we returned last, which is at the top of the heap, needs
+   * another one.
    */
-  for (i = 0; i < in_file_count; i++) {
-    if (in_files[i].state == PACKET_NOT_PRESENT) {
-      /*
-       * No packet available, and we haven't seen an error or EOF yet,
-       * so try to read the next packet.
-       */
-      if (!wtap_read(in_files[i].wth, err, err_info, &in_files[i].data_offset)) {
-        if (*err != 0) {
-          in_files[i].state = GOT_ERROR;
-          return &in_files[i];
-        }
-        in_files[i].state = AT_EOF;
-      } else
-        in_files[i].state = PACKET_PRESENT;
+  while (merge->next_unread < in_file_count) {
+    in_file = &in_files[merge->next_unread++];
+    if (!merge_next_packet(in_file, err, err_info)) {
+      if (*err != 0) {
+        in_file->state = GOT_ERROR;
+        return in_file;
+      }
+      in_file->state = AT_EOF;
+    } else {
+      in_file->state = PACKET_PRESENT;
+      merge_heap_push(merge, in_file);
     }
+  }
 
-    if (in_files[i].state == PACKET_PRESENT) {
-      phdr = wtap_phdr(in_files[i].wth);
-      if (is_earlier(&phdr->ts, &tv)) {
-        tv = phdr->ts;
-        ei = i;
+  if (merge->last != NULL) {
+    in_file = merge->last;
+    merge->last = NULL;
+    if (!merge_next_packet(in_file, err, err_info)) {
+      merge_heap_pop(merge);
+      if (*err != 0) {
+        in_file->state = GOT_ERROR;
+        return in_file;
       }
+      in_file->state = AT_EOF;
+    } else {
+      in_file->state = PACKET_PRESENT;
+      merge->heap[0].ts = merge_in_file_phdr(in_file)->ts;
+      merge_heap_sift_down(merge, 0);
     }
   }
 
-  if (ei == -1) {
+  if (merge->heap_count == 0) {
     /* All the streams are at EOF.  Return an EOF indication. */
     *err = 0;
     return NULL;
   }
 
+  in_file = merge->heap[0].in_file;
+
   /* We'll need to read another packet from this file. */
-  in_files[ei].state = PACKET_NOT_PRESENT;
+  in_file->state = PACKET_NOT_PRESENT;
+  merge->last = in_file;
 
   /* Count this packet. */
-  in_files[ei].packet_num++;
+  in_file->packet_num++;
 
   /*
    * Return a pointer to the merge_in_file_t of the file from which the
    * packet was read.
    */
   *err = 0;
-  return &in_files[ei];
+  return in_file;
 }
 
 /*
@@ -255,7 +637,7 @@ merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
   for (i = 0; i < in_file_count; i++) {
     if (in_files[i].state == AT_EOF)
       continue; /* This file is already at EOF */
-    if (wtap_read(in_files[i].wth, err, err_info, &in_files[i].data_offset))
+    if (merge_next_packet(&in_files[i], err, err_info))
       break; /* We have a packet */
     if (*err != 0) {
       /* Read error - quit immediately. */
@@ -36,6 +36,9 @@ typedef enum {
   GOT_ERROR
 } in_file_state_e;
 
+struct merge_state_s;
+struct merge_read_ahead_s;
+
 /**
  * Structures to manage our input files.
  */
@@ -48,6 +51,8 @@ typedef struct merge_in_file_s {
   gint64          size;		      /* file size */
   guint32         interface_id;   /* identifier of the interface.
 								   * Used for fake interfaces when writing WTAP_ENCAP_PER_PACKET */
+  struct merge_state_s      *merge;      /* private; shared by all the input files */
+  struct merge_read_ahead_s *read_ahead; /* private; records read ahead, if any */
 } merge_in_file_t;
 
 /** Open a number of input files to merge.
@@ -91,6 +96,43 @@ merge_select_frame_type(int in_file_count, merge_in_file_t in_files[]);
 WS_DLL_PUBLIC int
 merge_max_snapshot_length(int in_file_count, merge_in_file_t in_files[]);
 
+/** Read records from the input files on a pool of threads, ahead of the
+ * merge, so that reading and decompressing many files overlaps.  Up to
+ * depth records per input file are kept in memory.
+ *
+ * Call this after the last use of the input files' wtap handles and
+ * before the first call to merge_read_packet() or
+ * merge_append_read_packet(); from then on, use merge_in_file_phdr()
+ * and merge_in_file_buf_ptr(), rather than wtap_phdr() and
+ * wtap_buf_ptr(), to get at the packets read.  If threads aren't
+ * available, this does nothing and the files are read as they're merged.
+ *
+ * @param in_file_count number of entries in in_files
+ * @param in_files input file array
+ * @param depth number of records to read ahead per file; 0 for none
+ */
+WS_DLL_PUBLIC void
+merge_set_read_ahead(int in_file_count, merge_in_file_t in_files[],
+                     guint depth);
+
+/** Get the header of the packet most recently returned for an input file
+ * by merge_read_packet() or merge_append_read_packet().
+ *
+ * @param in_file the input file
+ * @return the packet header
+ */
+WS_DLL_PUBLIC struct wtap_pkthdr *
+merge_in_file_phdr(merge_in_file_t *in_file);
+
+/** Get the data of the packet most recently returned for an input file
+ * by merge_read_packet() or merge_append_read_packet().
+ *
+ * @param in_file the input file
+ * @return the packet data
+ */
+WS_DLL_PUBLIC guint8 *
+merge_in_file_buf_ptr(merge_in_file_t *in_file);
+
 /** Read the next packet, in chronological order, from the set of files to
  * be merged.
  *
@@ -85,7 +85,8 @@ struct wtap {
 struct wtap_dumper;
 
 /*
- * This could either be a FILE * or a gzFile.
+ * This could either be a FILE * or one of the compressed file writers
+ * from file_wrappers.c.
  */
 typedef void *WFILE_T;
 
@@ -100,6 +101,7 @@ struct wtap_dumper {
     int                     snaplen;
     int                     encap;
     gboolean                compressed;
+    wtap_compression_type   compression_type;
     gint64                  bytes_dumped;
 
     void                    *priv;       /* this one holds per-file state and is free'd automatically by wtap_dump_close() */
@@ -300,6 +302,13 @@ gboolean
 wtap_read_packet_bytes(FILE_T fh, Buffer *buf, guint length, int *err,
     gchar **err_info);
 
+/*
+ * Number of processors available, for sizing thread pools; 1 if we
+ * can't tell.
+ */
+guint
+wtap_num_processors(void);
+
 #endif /* __WTAP_INT_H__ */
 
 /*
@@ -1033,6 +1033,20 @@ wtap_cleareof(wtap *wth) {
 	file_clearerr(wth->fh);
 }
 
+gboolean
+wtap_set_tailing(wtap *wth, int *err)
+{
+	/*
+	 * The file may be truncated or rewritten under us, so don't
+	 * memory-map it.
+	 */
+	if (wth->fh != NULL && !file_set_no_map(wth->fh, err))
+		return FALSE;
+	if (wth->random_fh != NULL && !file_set_no_map(wth->random_fh, err))
+		return FALSE;
+	return TRUE;
+}
+
 void wtap_set_cb_new_ipv4(wtap *wth, wtap_new_ipv4_callback_t add_new_ipv4) {
 	if (wth)
 		wth->add_new_ipv4 = add_new_ipv4;
@@ -1206,6 +1220,20 @@ wtap_phdr_cleanup(struct wtap_pkthdr *phdr)
 	ws_buffer_free(&phdr->ft_specific_data);
 }
 
+guint
+wtap_num_processors(void)
+{
+#if GLIB_CHECK_VERSION(2,36,0)
+	return g_get_num_processors();
+#elif defined(HAVE_SYSCONF) && defined(_SC_NPROCESSORS_ONLN)
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return n > 0 ? (guint)n : 1;
+#else
+	return 1;
+#endif
+}
+
 gboolean
 wtap_seek_read(wtap *wth, gint64 seek_off,
 	struct wtap_pkthdr *phdr, Buffer *buf, int *err, gchar **err_info)
@@ -1436,6 +1436,19 @@ struct wtap* wtap_open_offline(const char *filename, unsigned int type, int *err
 WS_DLL_PUBLIC
 void wtap_cleareof(wtap *wth);
 
+/**
+ * Tell wiretap that the file is still being written to while we read it,
+ * e.g. because it's the file a live capture is being saved to and we're
+ * tailing it, so that it isn't memory-mapped; if the file were truncated
+ * or rewritten, accessing the mapping would crash us.
+ *
+ * @param wth The wtap session.
+ * @param err The error code if we can't switch to read()ing the file.
+ * @return TRUE on success, FALSE on failure.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_set_tailing(wtap *wth, int *err);
+
 /**
  * Set callback functions to add new hostnames. Currently pcapng-only.
  * MUST match add_ipv4_name and add_ipv6_name in addr_resolv.c.
@@ -1530,6 +1543,24 @@ int wtap_dump_file_encap_type(const GArray *file_encaps);
 WS_DLL_PUBLIC
 gboolean wtap_dump_can_compress(int filetype);
 
+/**
+ * Types of compression for a file being written with
+ * wtap_dump_open_compressed().
+ */
+typedef enum {
+    WTAP_UNCOMPRESSED,
+    WTAP_GZIP_COMPRESSED,
+    WTAP_ZSTD_COMPRESSED,   /**< Zstandard, with a seek table */
+    WTAP_LZ4_COMPRESSED     /**< LZ4 frames */
+} wtap_compression_type;
+
+/**
+ * Return TRUE if this build of Wiretap can write files compressed
+ * with this type of compression, FALSE if not.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_can_write_compression_type(wtap_compression_type compression_type);
+
 /**
  * Return TRUE if this capture file format supports storing name
  * resolution information in it, FALSE if not.
@@ -1552,6 +1583,15 @@ WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_open_ng(const char *filename, int filetype, int encap,
     int snaplen, gboolean compressed, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err);
 
+/**
+ * Like wtap_dump_open_ng(), but with a choice of compression rather than
+ * just gzip or none.
+ */
+WS_DLL_PUBLIC
+wtap_dumper* wtap_dump_open_compressed(const char *filename, int filetype, int encap,
+    int snaplen, wtap_compression_type compression_type, wtapng_section_t *shb_hdr,
+    wtapng_iface_descriptions_t *idb_inf, int *err);
+
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_fdopen(int fd, int filetype, int encap, int snaplen,
     gboolean compressed, int *err);
@@ -0,0 +1,567 @@
+/* wtap_index.c
+ * Routines for reading and writing packet offset index files
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
+#include <wsutil/file_util.h>
+#include <wsutil/crc32.h>
+#include <wsutil/pint.h>
+
+#include "wtap-int.h"
+#include "file_wrappers.h"
+#include "wtap_index.h"
+
+/*
+ * An index file is a header followed by one entry per record, all
+ * fields in network byte order:
+ *
+ *  header:
+ *     0   magic (8 bytes)
+ *     8   version
+ *    12   file type/subtype of the capture file
+ *    16   file encapsulation of the capture file
+ *    20   number of interfaces, for file types that have them
+ *    24   number of entries
+ *    28   CRC of the first INDEX_CHECK_LEN bytes of the capture file
+ *    32   size of the capture file (64 bits)
+ *    40   CRC of the last INDEX_CHECK_LEN bytes of the capture file
+ *    44   modification time of the capture file, in seconds (64 bits)
+ *    52   reserved, zero
+ *
+ *  entry:
+ *     0   data offset (64 bits)
+ *     8   time stamp seconds (64 bits)
+ *    16   time stamp nanoseconds
+ *    20   captured length
+ *    24   length on the wire
+ *    28   encapsulation (16 bits)
+ *    30   time stamp precision (8 bits)
+ *    31   flags (8 bits)
+ *
+ * The header is written last, so an index whose writer died part way
+ * through has a count of 0 and a bad magic number; it's also written
+ * under a temporary name and renamed into place once it's complete.
+ *
+ * The size, modification time and CRCs are only a cheap check that the
+ * capture file hasn't changed since it was indexed; checksumming all of
+ * it would cost as much as the read the index is meant to save.  A file
+ * rewritten in place with the same size, head and tail within the same
+ * second as the index was written won't be noticed.
+ */
+static const char index_magic[8] = { 'w', 't', 'a', 'p', 'i', 'd', 'x', '\0' };
+
+#define INDEX_VERSION       2
+#define INDEX_HDR_LEN       64
+#define INDEX_ENTRY_LEN     32
+#define INDEX_CHECK_LEN     4096
+
+#define INDEX_FLAG_HAS_TS       0x01
+#define INDEX_FLAG_HAS_COMMENT  0x02
+
+/*
+ * A fast seek file is a header followed by the points, as written by
+ * file_fast_seek_save():
+ *
+ *     0   magic (8 bytes)
+ *     8   version
+ *    12   CRC of the first INDEX_CHECK_LEN bytes of the capture file
+ *    16   size of the capture file (64 bits)
+ *    24   CRC of the last INDEX_CHECK_LEN bytes of the capture file
+ *    28   modification time of the capture file, in seconds (64 bits)
+ *    36   reserved, zero
+ */
+static const char fast_seek_magic[8] = { 'w', 't', 'a', 'p', 'f', 's', 'k', '\0' };
+
+#define FAST_SEEK_VERSION   2
+#define FAST_SEEK_HDR_LEN   40
+
+struct wtap_index {
+    FILE     *fp;
+    gchar    *path;             /* name of the index file */
+    gchar    *tmp_path;         /* name it's written under, if we're writing it */
+    gchar    *capture_path;     /* name of the capture file */
+    guint32   count;            /* entries in the index */
+    guint32   cur;              /* entries read or written so far */
+    int       file_encap;
+};
+
+/*
+ * Can records in this file be read with wtap_seek_read() without
+ * having read the file sequentially first?
+ */
+static gboolean
+index_supported(wtap *wth)
+{
+    /* Random access to a compressed file needs its fast seek points. */
+    if (wtap_iscompressed(wth) && wth->fast_seek == NULL)
+        return FALSE;
+
+    switch (wtap_file_type_subtype(wth)) {
+
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP_NSEC:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP_AIX:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP_SS991029:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP_NOKIA:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP_SS990417:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP_SS990915:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAPNG:
+        return TRUE;
+
+    default:
+        return FALSE;
+    }
+}
+
+static guint32
+index_num_idbs(wtap *wth)
+{
+    return wth->interface_data != NULL ? wth->interface_data->len : 0;
+}
+
+/*
+ * Get the size and modification time of a capture file, and checksums
+ * of its head and tail.
+ */
+static gboolean
+index_check_capture(const char *filename, guint64 *size, guint64 *mtime,
+                    guint32 *head_crc, guint32 *tail_crc, int *err)
+{
+    int fd;
+    ws_statb64 st;
+    guint8 buf[INDEX_CHECK_LEN];
+    guint check_len;
+
+    fd = ws_open(filename, O_RDONLY|O_BINARY, 0000);
+    if (fd == -1) {
+        *err = errno;
+        return FALSE;
+    }
+    if (ws_fstat64(fd, &st) == -1) {
+        *err = errno;
+        ws_close(fd);
+        return FALSE;
+    }
+    *size = (guint64)st.st_size;
+    *mtime = (guint64)(gint64)st.st_mtime;
+    check_len = *size < INDEX_CHECK_LEN ? (guint)*size : INDEX_CHECK_LEN;
+
+    if (ws_read(fd, buf, check_len) != (int)check_len) {
+        *err = WTAP_ERR_SHORT_READ;
+        ws_close(fd);
+        return FALSE;
+    }
+    *head_crc = crc32_ccitt(buf, check_len);
+
+    if (ws_lseek64(fd, (gint64)(*size - check_len), SEEK_SET) == -1) {
+        *err = errno;
+        ws_close(fd);
+        return FALSE;
+    }
+    if (ws_read(fd, buf, check_len) != (int)check_len) {
+        *err = WTAP_ERR_SHORT_READ;
+        ws_close(fd);
+        return FALSE;
+    }
+    *tail_crc = crc32_ccitt(buf, check_len);
+
+    ws_close(fd);
+    return TRUE;
+}
+
+/*
+ * Put a newly-written file in place of the old one.
+ */
+static gboolean
+index_replace(const char *tmp_path, const char *path, int *err)
+{
+    /* rename() won't replace an existing file on Windows. */
+    ws_remove(path);
+    if (ws_rename(tmp_path, path) == -1) {
+        *err = errno;
+        ws_unlink(tmp_path);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+gboolean
+wtap_fast_seek_load(wtap *wth, const char *filename)
+{
+    gchar *path;
+    FILE *fp;
+    guint8 hdr[FAST_SEEK_HDR_LEN];
+    guint64 size, mtime;
+    guint32 head_crc, tail_crc;
+    int err;
+    gboolean ok;
+
+    if (!wtap_iscompressed(wth) || wth->fast_seek == NULL)
+        return FALSE;
+
+    path = g_strconcat(filename, WTAP_FAST_SEEK_SUFFIX, NULL);
+    fp = ws_fopen(path, "rb");
+    g_free(path);
+    if (fp == NULL)
+        return FALSE;
+
+    ok = fread(hdr, 1, sizeof hdr, fp) == sizeof hdr &&
+         memcmp(hdr, fast_seek_magic, sizeof fast_seek_magic) == 0 &&
+         pntoh32(&hdr[8]) == FAST_SEEK_VERSION &&
+         index_check_capture(filename, &size, &mtime, &head_crc, &tail_crc, &err) &&
+         pntoh32(&hdr[12]) == head_crc && pntoh64(&hdr[16]) == size &&
+         pntoh32(&hdr[24]) == tail_crc && pntoh64(&hdr[28]) == mtime &&
+         file_fast_seek_restore(wth->fast_seek, fp);
+    fclose(fp);
+    return ok;
+}
+
+gboolean
+wtap_fast_seek_save(wtap *wth, const char *filename, int *err)
+{
+    gchar *path, *tmp_path;
+    FILE *fp;
+    guint8 hdr[FAST_SEEK_HDR_LEN];
+    guint64 size, mtime;
+    guint32 head_crc, tail_crc;
+    gboolean ok;
+
+    *err = 0;
+    if (!wtap_iscompressed(wth) || wth->fast_seek == NULL)
+        return FALSE;
+
+    if (!index_check_capture(filename, &size, &mtime, &head_crc, &tail_crc, err))
+        return FALSE;
+
+    memset(hdr, 0, sizeof hdr);
+    memcpy(hdr, fast_seek_magic, sizeof fast_seek_magic);
+    phton32(&hdr[8], FAST_SEEK_VERSION);
+    phton32(&hdr[12], head_crc);
+    phton32(&hdr[16], (guint32)(size >> 32));
+    phton32(&hdr[20], (guint32)size);
+    phton32(&hdr[24], tail_crc);
+    phton32(&hdr[28], (guint32)(mtime >> 32));
+    phton32(&hdr[32], (guint32)mtime);
+
+    path = g_strconcat(filename, WTAP_FAST_SEEK_SUFFIX, NULL);
+    tmp_path = g_strconcat(path, ".tmp", NULL);
+    fp = ws_fopen(tmp_path, "wb");
+    if (fp == NULL) {
+        *err = errno;
+        ok = FALSE;
+    } else {
+        ok = fwrite(hdr, 1, sizeof hdr, fp) == sizeof hdr;
+        if (!ok)
+            *err = errno;
+        else
+            ok = file_fast_seek_save(wth->fast_seek, fp, err);
+        if (fclose(fp) == EOF && ok) {
+            *err = errno;
+            ok = FALSE;
+        }
+        if (ok)
+            ok = index_replace(tmp_path, path, err);
+        else
+            ws_unlink(tmp_path);
+    }
+    g_free(tmp_path);
+    g_free(path);
+    return ok;
+}
+
+static void
+index_free(wtap_index *idx)
+{
+    if (idx->fp != NULL)
+        fclose(idx->fp);
+    g_free(idx->path);
+    g_free(idx->tmp_path);
+    g_free(idx->capture_path);
+    g_free(idx);
+}
+
+wtap_index *
+wtap_index_open(wtap *wth, const char *filename)
+{
+    wtap_index *idx;
+    guint8 hdr[INDEX_HDR_LEN];
+    guint64 size, mtime;
+    guint32 head_crc, tail_crc;
+    int err;
+
+    if (!index_supported(wth))
+        return NULL;
+
+    idx = g_new0(wtap_index, 1);
+    idx->path = g_strconcat(filename, WTAP_INDEX_SUFFIX, NULL);
+    idx->fp = ws_fopen(idx->path, "rb");
+    if (idx->fp == NULL) {
+        index_free(idx);
+        return NULL;
+    }
+
+    if (fread(hdr, 1, sizeof hdr, idx->fp) != sizeof hdr ||
+        memcmp(hdr, index_magic, sizeof index_magic) != 0 ||
+        pntoh32(&hdr[8]) != INDEX_VERSION ||
+        (int)pntoh32(&hdr[12]) != wtap_file_type_subtype(wth)) {
+        index_free(idx);
+        return NULL;
+    }
+
+    /*
+     * If not all of the interfaces were seen when the file was
+     * opened, some of the records can't be read until we've read
+     * sequentially past the interfaces they refer to.
+     */
+    if (pntoh32(&hdr[20]) != index_num_idbs(wth)) {
+        index_free(idx);
+        return NULL;
+    }
+
+    /* Is this an index of the file as it is now? */
+    if (!index_check_capture(filename, &size, &mtime, &head_crc, &tail_crc, &err) ||
+        pntoh32(&hdr[28]) != head_crc || pntoh64(&hdr[32]) != size ||
+        pntoh32(&hdr[40]) != tail_crc || pntoh64(&hdr[44]) != mtime) {
+        index_free(idx);
+        return NULL;
+    }
+
+    /* We can only seek in a compressed file if we have its seek points. */
+    if (wtap_iscompressed(wth) && !wtap_fast_seek_load(wth, filename)) {
+        index_free(idx);
+        return NULL;
+    }
+
+    idx->file_encap = (int)pntoh32(&hdr[16]);
+    idx->count = pntoh32(&hdr[24]);
+    idx->capture_path = g_strdup(filename);
+    return idx;
+}
+
+guint32
+wtap_index_count(wtap_index *idx)
+{
+    return idx->count;
+}
+
+int
+wtap_index_file_encap(wtap_index *idx)
+{
+    return idx->file_encap;
+}
+
+gboolean
+wtap_index_read(wtap_index *idx, wtap_index_entry *entry, int *err)
+{
+    guint8 buf[INDEX_ENTRY_LEN];
+
+    *err = 0;
+    if (idx->cur >= idx->count)
+        return FALSE;
+
+    if (fread(buf, 1, sizeof buf, idx->fp) != sizeof buf) {
+        *err = ferror(idx->fp) ? errno : WTAP_ERR_SHORT_READ;
+        return FALSE;
+    }
+    idx->cur++;
+
+    entry->data_offset = (gint64)pntoh64(&buf[0]);
+    entry->ts.secs = (time_t)(gint64)pntoh64(&buf[8]);
+    entry->ts.nsecs = (int)pntoh32(&buf[16]);
+    entry->caplen = pntoh32(&buf[20]);
+    entry->len = pntoh32(&buf[24]);
+    entry->pkt_encap = pntoh16(&buf[28]);
+    entry->pkt_tsprec = buf[30];
+    entry->has_ts = (buf[31] & INDEX_FLAG_HAS_TS) ? TRUE : FALSE;
+    entry->has_comment = (buf[31] & INDEX_FLAG_HAS_COMMENT) ? TRUE : FALSE;
+    return TRUE;
+}
+
+wtap_index *
+wtap_index_create(wtap *wth, const char *filename, int *err)
+{
+    wtap_index *idx;
+    guint8 hdr[INDEX_HDR_LEN];
+    ws_statb64 st;
+
+    *err = 0;
+    if (!index_supported(wth))
+        return NULL;
+
+    /* There's no point in indexing something we can't seek in. */
+    if (ws_stat64(filename, &st) == -1 || !S_ISREG(st.st_mode))
+        return NULL;
+
+    idx = g_new0(wtap_index, 1);
+    idx->path = g_strconcat(filename, WTAP_INDEX_SUFFIX, NULL);
+    idx->tmp_path = g_strconcat(idx->path, ".tmp", NULL);
+    idx->capture_path = g_strdup(filename);
+    idx->fp = ws_fopen(idx->tmp_path, "wb");
+    if (idx->fp == NULL) {
+        *err = errno;
+        index_free(idx);
+        return NULL;
+    }
+
+    /* Reserve space for the header; it's filled in by wtap_index_finish(). */
+    memset(hdr, 0, sizeof hdr);
+    if (fwrite(hdr, 1, sizeof hdr, idx->fp) != sizeof hdr) {
+        *err = errno;
+        wtap_index_close(idx);
+        return NULL;
+    }
+    return idx;
+}
+
+gboolean
+wtap_index_add(wtap_index *idx, const struct wtap_pkthdr *phdr,
+               gint64 data_offset, int *err)
+{
+    guint8 buf[INDEX_ENTRY_LEN];
+    guint64 secs;
+
+    if (idx->cur == G_MAXUINT32 || phdr->pkt_encap < 0 ||
+        phdr->pkt_encap > G_MAXUINT16) {
+        /* Can't be represented; don't bother with an index. */
+        *err = WTAP_ERR_UNWRITABLE_ENCAP;
+        return FALSE;
+    }
+
+    secs = (guint64)(gint64)phdr->ts.secs;
+    phton32(&buf[0], (guint32)((guint64)data_offset >> 32));
+    phton32(&buf[4], (guint32)data_offset);
+    phton32(&buf[8], (guint32)(secs >> 32));
+    phton32(&buf[12], (guint32)secs);
+    phton32(&buf[16], (guint32)phdr->ts.nsecs);
+    phton32(&buf[20], phdr->caplen);
+    phton32(&buf[24], phdr->len);
+    phton16(&buf[28], (guint16)phdr->pkt_encap);
+    buf[30] = (guint8)phdr->pkt_tsprec;
+    buf[31] = 0;
+    if (phdr->presence_flags & WTAP_HAS_TS)
+        buf[31] |= INDEX_FLAG_HAS_TS;
+    if (phdr->opt_comment != NULL)
+        buf[31] |= INDEX_FLAG_HAS_COMMENT;
+
+    if (fwrite(buf, 1, sizeof buf, idx->fp) != sizeof buf) {
+        *err = errno;
+        return FALSE;
+    }
+    idx->cur++;
+    return TRUE;
+}
+
+gboolean
+wtap_index_finish(wtap_index *idx, wtap *wth, int *err)
+{
+    guint8 hdr[INDEX_HDR_LEN];
+    guint64 size, mtime;
+    guint32 head_crc, tail_crc;
+
+    if (!index_check_capture(idx->capture_path, &size, &mtime, &head_crc,
+                             &tail_crc, err)) {
+        wtap_index_close(idx);
+        return FALSE;
+    }
+
+    /* The index of a compressed file is no use without its seek points. */
+    if (wtap_iscompressed(wth) &&
+        !wtap_fast_seek_save(wth, idx->capture_path, err)) {
+        wtap_index_close(idx);
+        return FALSE;
+    }
+
+    memset(hdr, 0, sizeof hdr);
+    memcpy(hdr, index_magic, sizeof index_magic);
+    phton32(&hdr[8], INDEX_VERSION);
+    phton32(&hdr[12], (guint32)wtap_file_type_subtype(wth));
+    phton32(&hdr[16], (guint32)wtap_file_encap(wth));
+    phton32(&hdr[20], index_num_idbs(wth));
+    phton32(&hdr[24], idx->cur);
+    phton32(&hdr[28], head_crc);
+    phton32(&hdr[32], (guint32)(size >> 32));
+    phton32(&hdr[36], (guint32)size);
+    phton32(&hdr[40], tail_crc);
+    phton32(&hdr[44], (guint32)(mtime >> 32));
+    phton32(&hdr[48], (guint32)mtime);
+
+    if (fseek(idx->fp, 0, SEEK_SET) == -1 ||
+        fwrite(hdr, 1, sizeof hdr, idx->fp) != sizeof hdr) {
+        *err = errno;
+        wtap_index_close(idx);
+        return FALSE;
+    }
+    if (fclose(idx->fp) == EOF) {
+        idx->fp = NULL;
+        *err = errno;
+        wtap_index_close(idx);
+        return FALSE;
+    }
+    idx->fp = NULL;
+
+    if (!index_replace(idx->tmp_path, idx->path, err)) {
+        wtap_index_close(idx);
+        return FALSE;
+    }
+    g_free(idx->tmp_path);
+    idx->tmp_path = NULL;
+
+    index_free(idx);
+    return TRUE;
+}
+
+void
+wtap_index_close(wtap_index *idx)
+{
+    if (idx->fp != NULL) {
+        fclose(idx->fp);
+        idx->fp = NULL;
+    }
+    if (idx->tmp_path != NULL)
+        ws_unlink(idx->tmp_path);   /* never finished */
+    index_free(idx);
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
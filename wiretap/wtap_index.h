@@ -0,0 +1,161 @@
+/* wtap_index.h
+ * Definitions for packet offset index files
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __WTAP_INDEX_H__
+#define __WTAP_INDEX_H__
+
+#include "wiretap/wtap.h"
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * A packet index is a file, stored next to a capture file, that holds
+ * the offset, lengths, time stamp and encapsulation of every record in
+ * the capture file, i.e. everything a program needs to know about a
+ * record in order to list it and to fetch it later with
+ * wtap_seek_read(), so that a capture file can be reopened without
+ * reading it all the way through first.
+ *
+ * The index also holds the size and modification time of the capture
+ * file and checksums of its first and last few kilobytes; if the capture
+ * file doesn't match those, the index is stale and isn't used.
+ *
+ * Indices are only written and used for file types, such as pcap and
+ * pcapng, for which random access needs no state from a sequential
+ * read.  The index of a gzipped file comes with a fast seek file,
+ * holding the points at which decompression can be resumed.
+ */
+
+/** Suffix appended to the name of a capture file to get the name of its index */
+#define WTAP_INDEX_SUFFIX   ".wtidx"
+
+/** Suffix appended to the name of a compressed capture file to get the
+ * name of the file holding its fast seek points */
+#define WTAP_FAST_SEEK_SUFFIX   ".wtfsk"
+
+typedef struct wtap_index wtap_index;
+
+/** One record of a capture file, as stored in its index. */
+typedef struct {
+    gint64    data_offset;  /**< offset to pass to wtap_seek_read() */
+    nstime_t  ts;           /**< time stamp */
+    guint32   caplen;       /**< data length in the file */
+    guint32   len;          /**< data length on the wire */
+    int       pkt_encap;    /**< WTAP_ENCAP_ value for this record */
+    int       pkt_tsprec;   /**< WTAP_TSPREC_ value for this record */
+    gboolean  has_ts;       /**< TRUE if the record has a time stamp */
+    gboolean  has_comment;  /**< TRUE if the record has a comment */
+} wtap_index_entry;
+
+/** Open the index of a capture file for reading.
+ *
+ * @param wth the open capture file
+ * @param filename the name of the capture file
+ * @return the index, or NULL if there's no usable index for the file
+ */
+WS_DLL_PUBLIC wtap_index *wtap_index_open(wtap *wth, const char *filename);
+
+/** Number of records in an index opened with wtap_index_open(). */
+WS_DLL_PUBLIC guint32 wtap_index_count(wtap_index *idx);
+
+/** File encapsulation, as wtap_file_encap() would return it after a
+ * sequential read of the whole file. */
+WS_DLL_PUBLIC int wtap_index_file_encap(wtap_index *idx);
+
+/** Read the next record from an index opened with wtap_index_open().
+ *
+ * @return TRUE on success, FALSE at the end of the index or on an error,
+ * in which case *err is set to the error or to 0 at the end
+ */
+WS_DLL_PUBLIC gboolean wtap_index_read(wtap_index *idx, wtap_index_entry *entry,
+    int *err);
+
+/** Start writing an index for a capture file that's about to be read
+ * sequentially.
+ *
+ * @param wth the open capture file, before anything has been read from it
+ * @param filename the name of the capture file
+ * @param err set to the error if the index can't be created, or to 0 if
+ * indices aren't supported for the file
+ * @return the index, or NULL if it can't be written
+ */
+WS_DLL_PUBLIC wtap_index *wtap_index_create(wtap *wth, const char *filename,
+    int *err);
+
+/** Add a record just read with wtap_read() to an index opened with
+ * wtap_index_create(). */
+WS_DLL_PUBLIC gboolean wtap_index_add(wtap_index *idx,
+    const struct wtap_pkthdr *phdr, gint64 data_offset, int *err);
+
+/** Finish writing an index once the whole capture file has been read,
+ * and close it.  The index only becomes visible to wtap_index_open()
+ * once this has succeeded. */
+WS_DLL_PUBLIC gboolean wtap_index_finish(wtap_index *idx, wtap *wth, int *err);
+
+/** Close an index; if it was being written and wtap_index_finish()
+ * wasn't called, discard it. */
+WS_DLL_PUBLIC void wtap_index_close(wtap_index *idx);
+
+/** Load the fast seek points saved for a compressed capture file, if
+ * they're up to date, so that it can be read with wtap_seek_read()
+ * without first reading it all the way through, and so that reading it
+ * with wtap_read() can inflate it on several threads at once.
+ *
+ * @param wth the capture file, opened for random access
+ * @param filename the name of the capture file
+ * @return TRUE if the points were loaded
+ */
+WS_DLL_PUBLIC gboolean wtap_fast_seek_load(wtap *wth, const char *filename);
+
+/** Save the fast seek points of a compressed capture file that's been
+ * read all the way through.
+ *
+ * @param wth the capture file, opened for random access
+ * @param filename the name of the capture file
+ * @param err set to the error if the points can't be saved, or to 0 if
+ * the file has none
+ * @return TRUE if the points were saved
+ */
+WS_DLL_PUBLIC gboolean wtap_fast_seek_save(wtap *wth, const char *filename,
+    int *err);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WTAP_INDEX_H__ */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
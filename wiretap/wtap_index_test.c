@@ -0,0 +1,438 @@
+/* wtap_index_test.c
+ * Tests for packet index files
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <wsutil/buffer.h>
+#include <wsutil/file_util.h>
+
+#include "wtap.h"
+#include "wtap_index.h"
+
+#define TEST_FILE       "wtap_index_test.pcap"
+#define TEST_INDEX      TEST_FILE WTAP_INDEX_SUFFIX
+#define TEST_INDEX_TMP  TEST_INDEX ".tmp"
+
+/* Enough records that the file is bigger than the head and tail that
+   the index checksums, so that a change in the middle is only caught
+   by the modification time. */
+#define TEST_RECORDS    100
+#define TEST_REC_LEN    100
+#define TEST_FILE_LEN   (24 + TEST_RECORDS * (16 + TEST_REC_LEN))
+
+static void
+put_le32(guint8 *p, guint32 v)
+{
+    p[0] = (guint8)v;
+    p[1] = (guint8)(v >> 8);
+    p[2] = (guint8)(v >> 16);
+    p[3] = (guint8)(v >> 24);
+}
+
+static void
+write_record(FILE *fp, guint32 n)
+{
+    guint8 hdr[16];
+    guint8 data[TEST_REC_LEN];
+    size_t written;
+
+    put_le32(&hdr[0], 1000000000 + n);      /* seconds */
+    put_le32(&hdr[4], n * 1000);            /* microseconds */
+    put_le32(&hdr[8], TEST_REC_LEN);        /* captured length */
+    put_le32(&hdr[12], TEST_REC_LEN + n);   /* length on the wire */
+    memset(data, (int)n, sizeof data);
+    written = fwrite(hdr, 1, sizeof hdr, fp);
+    written += fwrite(data, 1, sizeof data, fp);
+    g_assert(written == sizeof hdr + sizeof data);
+}
+
+/* Write a little-endian microsecond pcap file of Ethernet packets. */
+static void
+write_capture(void)
+{
+    static const guint8 file_hdr[24] = {
+        0xd4, 0xc3, 0xb2, 0xa1, 0x02, 0x00, 0x04, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0xff, 0xff, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00
+    };
+    FILE *fp;
+    guint32 n;
+    size_t written;
+    int ret;
+
+    ws_unlink(TEST_INDEX);
+    ws_unlink(TEST_INDEX_TMP);
+    fp = ws_fopen(TEST_FILE, "wb");
+    g_assert(fp != NULL);
+    written = fwrite(file_hdr, 1, sizeof file_hdr, fp);
+    g_assert(written == sizeof file_hdr);
+    for (n = 0; n < TEST_RECORDS; n++)
+        write_record(fp, n);
+    ret = fclose(fp);
+    g_assert(ret == 0);
+}
+
+static wtap *
+open_capture(void)
+{
+    wtap *wth;
+    int err;
+    gchar *err_info = NULL;
+
+    wth = wtap_open_offline(TEST_FILE, WTAP_TYPE_AUTO, &err, &err_info, TRUE);
+    g_assert(wth != NULL);
+    return wth;
+}
+
+/* Read the capture file through, as cf_read() does, writing an index. */
+static void
+index_capture(gboolean finish)
+{
+    wtap *wth;
+    wtap_index *idx;
+    gint64 data_offset;
+    gchar *err_info = NULL;
+    int err;
+    gboolean ok;
+
+    wth = open_capture();
+    idx = wtap_index_create(wth, TEST_FILE, &err);
+    g_assert(idx != NULL);
+    while (wtap_read(wth, &err, &err_info, &data_offset)) {
+        ok = wtap_index_add(idx, wtap_phdr(wth), data_offset, &err);
+        g_assert(ok);
+    }
+    g_assert(err == 0);
+    if (finish) {
+        ok = wtap_index_finish(idx, wth, &err);
+        g_assert(ok);
+    } else
+        wtap_index_close(idx);
+    wtap_close(wth);
+}
+
+static gboolean
+index_usable(void)
+{
+    wtap *wth;
+    wtap_index *idx;
+
+    wth = open_capture();
+    idx = wtap_index_open(wth, TEST_FILE);
+    if (idx != NULL)
+        wtap_index_close(idx);
+    wtap_close(wth);
+    return idx != NULL;
+}
+
+/* Overwrite one byte of the capture file without changing its size. */
+static void
+poke_capture(long offset)
+{
+    FILE *fp;
+    int c, ret;
+
+    fp = ws_fopen(TEST_FILE, "r+b");
+    g_assert(fp != NULL);
+    ret = fseek(fp, offset, SEEK_SET);
+    g_assert(ret == 0);
+    c = getc(fp);
+    g_assert(c != EOF);
+    ret = fseek(fp, offset, SEEK_SET);
+    g_assert(ret == 0);
+    ret = putc(c ^ 0xff, fp);
+    g_assert(ret != EOF);
+    ret = fclose(fp);
+    g_assert(ret == 0);
+}
+
+static time_t
+capture_mtime(void)
+{
+    ws_statb64 st;
+    int ret;
+
+    ret = ws_stat64(TEST_FILE, &st);
+    g_assert(ret == 0);
+    return st.st_mtime;
+}
+
+static void
+set_capture_mtime(time_t mtime)
+{
+    struct utimbuf times;
+    int ret;
+
+    times.actime = mtime;
+    times.modtime = mtime;
+    ret = g_utime(TEST_FILE, &times);
+    g_assert(ret == 0);
+}
+
+static void
+wtap_index_test_create(void)
+{
+    ws_statb64 st;
+    int ret;
+
+    write_capture();
+    index_capture(TRUE);
+
+    ret = ws_stat64(TEST_INDEX, &st);
+    g_assert(ret == 0);
+    g_assert(st.st_size > 0);
+    ret = ws_stat64(TEST_INDEX_TMP, &st);
+    g_assert(ret != 0);
+}
+
+static void
+wtap_index_test_unfinished(void)
+{
+    ws_statb64 st;
+    int ret;
+
+    /* An index that's never finished mustn't be left behind, under
+       either name. */
+    write_capture();
+    index_capture(FALSE);
+
+    ret = ws_stat64(TEST_INDEX, &st);
+    g_assert(ret != 0);
+    ret = ws_stat64(TEST_INDEX_TMP, &st);
+    g_assert(ret != 0);
+    g_assert(!index_usable());
+}
+
+static void
+wtap_index_test_open(void)
+{
+    wtap *wth;
+    wtap_index *idx;
+    wtap_index_entry entry;
+    struct wtap_pkthdr *phdr;
+    gint64 data_offset;
+    gchar *err_info = NULL;
+    int err;
+    gboolean ok;
+    guint32 count = 0;
+
+    write_capture();
+    index_capture(TRUE);
+
+    /* The index must list the same records a sequential read finds. */
+    wth = open_capture();
+    idx = wtap_index_open(wth, TEST_FILE);
+    g_assert(idx != NULL);
+    g_assert(wtap_index_count(idx) == TEST_RECORDS);
+    while (wtap_read(wth, &err, &err_info, &data_offset)) {
+        phdr = wtap_phdr(wth);
+        ok = wtap_index_read(idx, &entry, &err);
+        g_assert(ok);
+        g_assert(entry.data_offset == data_offset);
+        g_assert(entry.caplen == phdr->caplen);
+        g_assert(entry.len == phdr->len);
+        g_assert(entry.ts.secs == phdr->ts.secs);
+        g_assert(entry.ts.nsecs == phdr->ts.nsecs);
+        g_assert(entry.pkt_encap == phdr->pkt_encap);
+        g_assert(entry.has_ts);
+        g_assert(!entry.has_comment);
+        count++;
+    }
+    g_assert(count == TEST_RECORDS);
+    ok = wtap_index_read(idx, &entry, &err);
+    g_assert(!ok);
+    g_assert(err == 0);
+    g_assert(wtap_index_file_encap(idx) == wtap_file_encap(wth));
+    wtap_index_close(idx);
+    wtap_close(wth);
+}
+
+static void
+wtap_index_test_invalidate_append(void)
+{
+    FILE *fp;
+    int ret;
+
+    write_capture();
+    index_capture(TRUE);
+    g_assert(index_usable());
+
+    fp = ws_fopen(TEST_FILE, "ab");
+    g_assert(fp != NULL);
+    write_record(fp, TEST_RECORDS);
+    ret = fclose(fp);
+    g_assert(ret == 0);
+    g_assert(!index_usable());
+}
+
+static void
+wtap_index_test_invalidate_head(void)
+{
+    time_t mtime;
+
+    /* Change the first record in place, leaving the size and
+       modification time alone. */
+    write_capture();
+    index_capture(TRUE);
+    mtime = capture_mtime();
+    poke_capture(24 + 16);
+    set_capture_mtime(mtime);
+    g_assert(!index_usable());
+}
+
+static void
+wtap_index_test_invalidate_tail(void)
+{
+    time_t mtime;
+
+    write_capture();
+    index_capture(TRUE);
+    mtime = capture_mtime();
+    poke_capture(TEST_FILE_LEN - 1);
+    set_capture_mtime(mtime);
+    g_assert(!index_usable());
+}
+
+static void
+wtap_index_test_invalidate_mtime(void)
+{
+    time_t mtime;
+
+    /* Change a record in the middle, which the checksums don't cover;
+       the new modification time must give it away. */
+    write_capture();
+    index_capture(TRUE);
+    mtime = capture_mtime();
+    poke_capture(TEST_FILE_LEN / 2);
+    set_capture_mtime(mtime + 10);
+    g_assert(!index_usable());
+}
+
+static void
+wtap_index_test_reopen(void)
+{
+    wtap *wth;
+    wtap_index *idx;
+    wtap_index_entry entry;
+    gint64 last_offset = -1;
+    struct wtap_pkthdr phdr;
+    Buffer buf;
+    gint64 data_offset;
+    gchar *err_info = NULL;
+    int err;
+    gboolean ok;
+    guint32 count = 0;
+    time_t mtime;
+
+    /* Make the length of a record in the middle of the file bogus,
+       where neither the size, the modification time nor the checksums
+       notice it, so that reading through the file fails there. */
+    write_capture();
+    index_capture(TRUE);
+    mtime = capture_mtime();
+    poke_capture(24 + (TEST_RECORDS / 2) * (16 + TEST_REC_LEN) + 11);
+    set_capture_mtime(mtime);
+
+    wth = open_capture();
+    while (wtap_read(wth, &err, &err_info, &data_offset))
+        count++;
+    g_assert(err != 0);
+    g_assert(count == TEST_RECORDS / 2);
+    g_free(err_info);
+    wtap_close(wth);
+
+    /* Every record can still be listed from the index, as nothing but
+       the index is read... */
+    wth = open_capture();
+    idx = wtap_index_open(wth, TEST_FILE);
+    g_assert(idx != NULL);
+    count = 0;
+    while (wtap_index_read(idx, &entry, &err)) {
+        last_offset = entry.data_offset;
+        count++;
+    }
+    g_assert(err == 0);
+    g_assert(count == TEST_RECORDS);
+    wtap_index_close(idx);
+
+    /* ...and a record after the bad one can be read straight away. */
+    wtap_phdr_init(&phdr);
+    ws_buffer_init(&buf, TEST_REC_LEN);
+    ok = wtap_seek_read(wth, last_offset, &phdr, &buf, &err, &err_info);
+    g_assert(ok);
+    g_assert(phdr.caplen == TEST_REC_LEN);
+    g_assert(phdr.len == TEST_REC_LEN + TEST_RECORDS - 1);
+    g_assert(ws_buffer_start_ptr(&buf)[0] == TEST_RECORDS - 1);
+    ws_buffer_free(&buf);
+    wtap_phdr_cleanup(&phdr);
+    wtap_close(wth);
+}
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/wtap_index/create",            wtap_index_test_create);
+    g_test_add_func("/wtap_index/unfinished",        wtap_index_test_unfinished);
+    g_test_add_func("/wtap_index/open",              wtap_index_test_open);
+    g_test_add_func("/wtap_index/reopen",            wtap_index_test_reopen);
+    g_test_add_func("/wtap_index/invalidate/append", wtap_index_test_invalidate_append);
+    g_test_add_func("/wtap_index/invalidate/head",   wtap_index_test_invalidate_head);
+    g_test_add_func("/wtap_index/invalidate/tail",   wtap_index_test_invalidate_tail);
+    g_test_add_func("/wtap_index/invalidate/mtime",  wtap_index_test_invalidate_mtime);
+
+    ret = g_test_run();
+
+    ws_unlink(TEST_FILE);
+    ws_unlink(TEST_INDEX);
+    ws_unlink(TEST_INDEX_TMP);
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -137,4 +137,12 @@
 	((guint8*)(p))[3] = (guint8)((v) >> 0);	\
 	}
 
+#define phtole32(p, v) \
+	{ 				\
+	((guint8*)(p))[0] = (guint8)((v) >> 0);	\
+	((guint8*)(p))[1] = (guint8)((v) >> 8);	\
+	((guint8*)(p))[2] = (guint8)((v) >> 16);	\
+	((guint8*)(p))[3] = (guint8)((v) >> 24);	\
+	}
+
 #endif /* PINT_H */